@@ -0,0 +1,1342 @@
+// Host callback benchmark on the mock driver.
+//
+// Drives ASIOHost::bufferSwitch through MockAsioDriver for a few SAR-like
+// layouts and buffer sizes, back to back, and reports ns per callback and
+// per channel-sample (callback time over (inputs + outputs) x buffer size).
+// A short real-time run checks the timer clock keeps up and prints the
+// host's own timing report (histogram percentiles, deadline counters).
+// Returns non-zero if the host fails to run a layout, leaves routed outputs
+// silent, or its timing histogram disagrees with the mock's count. The
+// bench also counts heap allocations and fails if a callback makes any,
+// checks a buffer size change keeps the driver and the routes, and that
+// reset, buffer size, rate and resync requests from the driver recover.
+// The buffer tuner is run against a simulated load and must settle on the
+// smallest size with headroom. Two hosts on mock drivers with different
+// clocks are bridged, and the drift loop must hold the bridge's fill.
+// Recordings made with the disk recorder tap must hold exactly the blocks
+// the driver passed, with any the ring dropped as silence in their place.
+// The built-in routing rules must classify channel names as the old
+// hard-coded classifier did, rule files must round-trip, and a plan must
+// be reused while the channels and rules stay the same. Muting an output
+// must fade it out over the gain ramp rather than cut it. Outputs streamed
+// over loopback RTP into another host's inputs must arrive intact, with
+// no packet lost or late.
+
+#include "../src/asio_host.h"
+#include "../src/audio_bridge.h"
+#include "../src/buffer_tuner.h"
+#include "../src/disk_recorder.h"
+#include "../src/routing_rules.h"
+#include "../src/rtp_stream.h"
+#include "mock_asio_driver.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every heap allocation in the process, for the no-allocation check
+static std::atomic<long long> g_allocations(0);
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+struct Layout {
+    const char* name;
+    MockDriverConfig config;
+};
+
+// numEndpoints stereo virtual endpoints in, stereo hardware out
+static Layout makeSarLayout(const char* name, int numEndpoints, ASIOSampleType inType, ASIOSampleType outType) {
+    static const char* endpointNames[] = { "System", "Game", "Comms", "Music", "Browser", "Stream", "Alerts", "Voice" };
+    Layout layout;
+    layout.name = name;
+    for (int e = 0; e < numEndpoints; e++) {
+        std::string base = endpointNames[e % 8];
+        if (e >= 8) base += " B";
+        layout.config.inputs.push_back({ base + " L", inType });
+        layout.config.inputs.push_back({ base + " R", inType });
+    }
+    layout.config.outputs.push_back({ "Speakers L", outType });
+    layout.config.outputs.push_back({ "Speakers R", outType });
+    return layout;
+}
+
+// channels virtual inputs, one-to-one onto channels hardware outputs
+static Layout makeWideLayout(const char* name, int channels, ASIOSampleType type) {
+    Layout layout;
+    layout.name = name;
+    for (int ch = 0; ch < channels; ch++) {
+        layout.config.inputs.push_back({ "Track " + std::string(1, (char)('A' + ch % 26)) + std::to_string(ch / 26), type });
+        layout.config.outputs.push_back({ "Line Out " + std::to_string(ch + 1), type });
+    }
+    return layout;
+}
+
+// Attach a fresh mock to the host and create buffers
+static MockAsioDriver* openMock(ASIOHost& host, const MockDriverConfig& config, int bufferSize) {
+    MockAsioDriver* mock = new MockAsioDriver(config);
+    mock->AddRef();  // Keep our pointer valid past unloadDriver's Release
+    host.attachDriver(mock, config.name);
+    if (!host.initialize(nullptr) || !host.createBuffers(bufferSize)) {
+        host.unloadDriver();
+        mock->Release();
+        return nullptr;
+    }
+    return mock;
+}
+
+static void closeMock(ASIOHost& host, MockAsioDriver* mock) {
+    host.stop();
+    host.disposeBuffers();
+    host.unloadDriver();
+    mock->Release();
+}
+
+// True if any routed hardware output carries signal in either half
+static bool outputsCarrySignal(const ASIOHost& host, const MockAsioDriver* mock, const MockDriverConfig& config) {
+    for (const auto& cell : host.getRoutes().getCells()) {
+        int bytes = getSampleBytes(config.outputs[cell.outputChannel].type) * mock->getBufferSize();
+        for (int half = 0; half < 2; half++) {
+            const uint8_t* p = (const uint8_t*)mock->getBuffer(false, cell.outputChannel, half);
+            for (int i = 0; i < bytes; i++) {
+                if (p[i]) return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Every duration must land in a bucket whose bounds contain it
+static int checkHistogramBuckets() {
+    std::mt19937_64 rng(3);
+    for (int i = 0; i < 200000; i++) {
+        uint64_t ns = rng() >> (rng() % 64);
+        int index = CallbackStats::bucketIndex(ns);
+        bool ok = index >= 0 && index < CallbackStats::kNumBuckets &&
+                  CallbackStats::bucketUpperBound(index) >= ns &&
+                  (index == 0 || CallbackStats::bucketUpperBound(index - 1) < ns);
+        if (!ok) {
+            printf("Histogram bucket %d does not hold %llu ns\n", index, (unsigned long long)ns);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// A machine for the buffer tuner to search on: each callback costs fixedNs,
+// and one in spikeEvery takes spikeNs longer. Reports accumulate like the
+// host's from the last time the size was applied.
+struct SimulatedLoad {
+    double fixedNs;
+    double spikeNs;
+    int spikeEvery;
+    double sampleRate = 48000.0;
+    int size = 0;
+    double spikeCredit = 0.0;
+    CallbackTimingReport timing = {};
+    ClockReport clock = {};
+
+    void apply(int frames) {
+        size = frames;
+        spikeCredit = 0.0;
+        timing = CallbackTimingReport();
+        clock = ClockReport();
+        timing.budgetNs = frames * 1e9 / sampleRate;
+    }
+
+    void runSecond() {
+        uint64_t callbacks = (uint64_t)(sampleRate / size);
+        uint64_t spikes = 0;
+        if (spikeEvery > 0) {
+            spikeCredit += (double)callbacks / spikeEvery;
+            spikes = (uint64_t)spikeCredit;
+            spikeCredit -= (double)spikes;
+        }
+        double totalNs = timing.meanNs * timing.callbacks + fixedNs * callbacks + spikeNs * spikes;
+        timing.callbacks += callbacks;
+        timing.meanNs = totalNs / timing.callbacks;
+        auto count = [&](double limit) {
+            return (fixedNs > limit ? callbacks : 0) + (fixedNs <= limit && fixedNs + spikeNs > limit ? spikes : 0);
+        };
+        timing.over80 += count(timing.budgetNs * 0.8);
+        timing.misses += count(timing.budgetNs);
+    }
+};
+
+// Run the tuner against a simulated load, one update per second, and
+// return the last size it asked for; probes counts visits to probeSize
+static int runTuner(BufferTuner& tuner, SimulatedLoad& load, double& now, double seconds, int probeSize,
+                    int* probes) {
+    int size = tuner.getCurrentSize();
+    for (double end = now + seconds; now < end; now += 1.0) {
+        load.runSecond();
+        int next = tuner.update(load.timing, load.clock, now);
+        if (next != size) {
+            size = next;
+            load.apply(size);
+            tuner.sizeApplied(size, now);
+            if (probes && size == probeSize) (*probes)++;
+        }
+    }
+    return size;
+}
+
+// Candidate sizes follow the driver's rules, and the tuner settles on the
+// smallest size with headroom, remembers it, and steps back down when the
+// load drops without oscillating on a size that cannot hold
+static int checkBufferTuner() {
+    int failures = 0;
+    struct Range { long minSize, maxSize, preferred, granularity; };
+    for (const Range& r : {Range{32, 2048, 256, -1}, Range{64, 2048, 256, 1}, Range{48, 1000, 480, 16},
+                           Range{256, 256, 256, 0}}) {
+        std::vector<int> sizes = BufferTuner::candidateSizes(r.minSize, r.maxSize, r.preferred, r.granularity);
+        bool ok = !sizes.empty() && sizes.front() == r.minSize && sizes.back() == r.maxSize;
+        for (size_t i = 1; ok && i < sizes.size(); i++) {
+            ok = sizes[i] > sizes[i - 1] &&
+                 (r.granularity > 0 ? (sizes[i] - r.minSize) % r.granularity == 0 || sizes[i] == r.maxSize
+                                    : (sizes[i] & (sizes[i] - 1)) == 0);
+        }
+        if (!ok || sizes.size() > 20) {
+            printf("Buffer tuner: bad candidate sizes for %ld..%ld granularity %ld (%zu sizes)\n",
+                   r.minSize, r.maxSize, r.granularity, sizes.size());
+            failures++;
+        }
+    }
+
+    // 400 us per callback with a 1.5 ms spike every 1000: 32 frames is too
+    // busy, 64 misses on the spikes, 128 has headroom
+    std::vector<int> sizes = BufferTuner::candidateSizes(32, 2048, 256, -1);
+    BufferTunerSettings settings;
+    BufferTuner tuner;
+    SimulatedLoad load{400e3, 1500e3, 1000};
+    double now = 0.0;
+    load.apply(tuner.begin(sizes, 0, settings, now));
+    int size = runTuner(tuner, load, now, 120.0, 0, nullptr);
+    printf("\nBuffer tuner: settled at %d frames after %.0f s simulated\n%s", size, now, tuner.formatText().c_str());
+    if (size != 128 || tuner.getState() != TunerStable || tuner.getStableSize() != 128) {
+        printf("Buffer tuner: expected stable at 128 frames\n");
+        failures++;
+    }
+
+    // Starting from the remembered size skips the search
+    BufferTuner remembered;
+    load.apply(remembered.begin(sizes, 128, settings, now = 0.0));
+    size = runTuner(remembered, load, now, 30.0, 0, nullptr);
+    if (size != 128 || remembered.getStableSize() != 128) {
+        printf("Buffer tuner: did not keep the remembered 128 frames (at %d)\n", size);
+        failures++;
+    }
+
+    // Spikes gone: step down to 64 and stay, trying 32 (60% mean load)
+    // less and less often
+    settings.stepDownAfterSeconds = 60.0;
+    BufferTuner stepping;
+    load = SimulatedLoad{400e3, 0.0, 0};
+    load.apply(stepping.begin(sizes, 128, settings, now = 0.0));
+    int probes = 0;
+    size = runTuner(stepping, load, now, 3600.0, 32, &probes);
+    printf("Buffer tuner: stepped down to %d frames, tried 32 frames %d times in an hour\n", size, probes);
+    if (size != 64 || stepping.getStableSize() != 64 || probes < 1 || probes > 6) {
+        printf("Buffer tuner: expected 64 frames with a few backed-off probes of 32\n");
+        failures++;
+    }
+    return failures;
+}
+
+// A sine through the resampler at drift-sized and rate-conversion steps
+// must come out as the same sine at the new rate, at every SIMD level
+static int checkResampler() {
+    int failures = 0;
+    const double steps[] = { 1.0 + 80e-6, 44100.0 / 48000.0, 48000.0 / 44100.0 };
+    const int blockFrames = 256;
+    const double cycles = 997.0 / 48000.0;     // Per input frame
+    const double kPi = 3.14159265358979323846;
+    printf("\nResampler (%d taps, %d phases), SNR of a 997 Hz sine:\n", Resampler::kTaps, Resampler::kPhases);
+    SimdLevel saved = getSimdLevel();
+    for (double step : steps) {
+        printf("  step %.6f ", step);
+        for (int level = SimdScalar; level <= detectSimdLevel(); level++) {
+            setSimdLevel((SimdLevel)level);
+            StreamArena arena;
+            Resampler resampler;
+            arena.allocate(Resampler::arenaBytes(1, blockFrames, step, 0.0));
+            if (!resampler.configure(1, blockFrames, step, 0.0, &arena)) {
+                printf("configure failed\n");
+                failures++;
+                break;
+            }
+            std::vector<float> input(blockFrames * 2 + Resampler::kTaps);
+            std::vector<float> output(blockFrames);
+            long long consumed = 0;
+            double signal = 0.0, noise = 0.0;
+            for (int b = 0; b < 200; b++) {
+                int needed = resampler.getInputNeeded(blockFrames);
+                for (int i = 0; i < needed; i++) {
+                    input[i] = 0.5f * (float)std::sin(2.0 * kPi * cycles * (double)(consumed + i));
+                }
+                consumed += needed;
+                const float* in[1] = { input.data() };
+                float* out[1] = { output.data() };
+                resampler.process(in, needed, out, blockFrames);
+                // Skip the filter's start-up; output j is input position j * step
+                for (int j = 0; j < blockFrames && b >= 2; j++) {
+                    double expected = 0.5 * std::sin(2.0 * kPi * cycles * step * (double)(b * blockFrames + j));
+                    signal += expected * expected;
+                    noise += (output[j] - expected) * (output[j] - expected);
+                }
+            }
+            double snr = 10.0 * std::log10(signal / std::max(noise, 1e-30));
+            printf(" %s %.1f dB", getSimdLevelName((SimdLevel)level), snr);
+            if (snr < 80.0) {
+                printf(" (too low)");
+                failures++;
+            }
+
+            // More input than the history holds must refuse, with silence
+            // in place of the last block
+            std::vector<float> flood(blockFrames * 8, 0.5f);
+            const float* in[1] = { flood.data() };
+            float* out[1] = { output.data() };
+            bool refused = !resampler.process(in, (int)flood.size(), out, blockFrames);
+            if (!refused || std::any_of(output.begin(), output.end(), [](float x) { return x != 0.0f; })) {
+                printf(" (overflow not silenced)");
+                failures++;
+            }
+        }
+        printf("\n");
+    }
+    setSimdLevel(saved);
+    return failures;
+}
+
+// RMS of one output channel of a mock, both buffer halves
+static double outputRms(const MockAsioDriver* mock, int channel) {
+    double sum = 0.0;
+    int frames = (int)mock->getBufferSize();
+    std::vector<float> samples(frames);
+    for (int half = 0; half < 2; half++) {
+        getSampleConverter(ASIOSTInt32LSB).toFloat(mock->getBuffer(false, channel, half), samples.data(), frames);
+        for (float v : samples) sum += v * v;
+    }
+    return std::sqrt(sum / (frames * 2));
+}
+
+// Two hosts on two mock drivers whose clocks disagree, one stream bridged
+// into the other. Both run on a shared simulated timeline: each fires when
+// its next block is due by its own clock. The loop must settle on the
+// clock offset with a steady fill and never run dry or over.
+static int checkBridge(double sourceRate, double sourcePpm, int sourceFrames,
+                       double targetRate, double targetPpm, int targetFrames, double seconds) {
+    MockDriverConfig sourceConfig = makeSarLayout("bridge", 1, ASIOSTInt32LSB, ASIOSTInt32LSB).config;
+    sourceConfig.name = "Mock Source";
+    sourceConfig.sampleRate = sourceRate;
+    sourceConfig.clockDriftPpm = sourcePpm;
+    sourceConfig.clock = MockClockManual;
+    MockDriverConfig targetConfig = sourceConfig;
+    targetConfig.name = "Mock Target";
+    targetConfig.sampleRate = targetRate;
+    targetConfig.clockDriftPpm = targetPpm;
+
+    ASIOHost source, target;
+    AudioBridge bridge;
+    MockAsioDriver* sourceMock = openMock(source, sourceConfig, sourceFrames);
+    MockAsioDriver* targetMock = openMock(target, targetConfig, targetFrames);
+    BridgeConfig config;
+    config.sourceChannels = { 0, 1 };
+    config.targetChannels = { 0, 1 };
+    bool ok = sourceMock && targetMock && source.addTap(bridge.getSourceTap()) &&
+              target.addTap(bridge.getTargetTap()) &&
+              bridge.configure(source.getStreamFormat(), target.getStreamFormat(), config) &&
+              source.start() && target.start();
+
+    // Fill over the second half, once the loop has settled
+    double minFill = 1e9, maxFill = -1e9;
+    long long sourceFired = 0, targetFired = 0;
+    double sourcePeriod = sourceFrames / (sourceRate * (1.0 + sourcePpm * 1e-6));
+    double targetPeriod = targetFrames / (targetRate * (1.0 + targetPpm * 1e-6));
+    while (ok) {
+        double sourceDue = sourceFired * sourcePeriod;
+        double targetDue = targetFired * targetPeriod;
+        if (std::min(sourceDue, targetDue) >= seconds) break;
+        if (sourceDue <= targetDue) {
+            sourceMock->fire();
+            sourceFired++;
+        } else {
+            targetMock->fire();
+            targetFired++;
+            if (targetDue >= seconds / 2) {
+                BridgeReport r = bridge.getReport();
+                minFill = std::min(minFill, r.fillFrames);
+                maxFill = std::max(maxFill, r.fillFrames);
+            }
+        }
+    }
+
+    int failures = 0;
+    double expectedPpm = ((1.0 + sourcePpm * 1e-6) / (1.0 + targetPpm * 1e-6) - 1.0) * 1e6;
+    BridgeReport r = bridge.getReport();
+    printf("  %.1fk %+.0f ppm x%d -> %.1fk %+.0f ppm x%d, %.0f s: correction %+.1f ppm (expected %+.1f), "
+           "fill %.0f..%.0f of %.0f\n",
+           sourceRate / 1000, sourcePpm, sourceFrames, targetRate / 1000, targetPpm, targetFrames, seconds,
+           r.driftPpm, expectedPpm, minFill, maxFill, r.targetFillFrames);
+    if (!ok) {
+        printf("  could not set up the two hosts and the bridge\n");
+        failures++;
+    } else {
+        // Each host's callbacks reached that host alone
+        bool routed = source.getTimingReport().callbacks == (uint64_t)sourceFired &&
+                      target.getTimingReport().callbacks == (uint64_t)targetFired;
+        double rms = std::min(outputRms(targetMock, 0), outputRms(targetMock, 1));
+        if (!routed || r.underruns || r.overruns || r.resyncs || r.priming || !r.active) {
+            printf("  %scallbacks %s\n", AudioBridge::formatText(r).c_str(), routed ? "routed" : "mixed up");
+            failures++;
+        }
+        if (std::fabs(r.driftPpm - expectedPpm) > 2.0 || std::fabs(r.correctionPpm - expectedPpm) > 20.0) {
+            printf("  loop did not settle on the clock offset\n");
+            failures++;
+        }
+        if (maxFill - minFill > sourceFrames || rms < 0.1 || rms > 0.2) {
+            printf("  fill swings %.0f frames, output RMS %.3f\n", maxFill - minFill, rms);
+            failures++;
+        }
+    }
+    if (sourceMock) closeMock(source, sourceMock);
+    if (targetMock) closeMock(target, targetMock);
+    return failures;
+}
+
+// Inject drift, skipped and repeated blocks; the host must count each one
+// and measure the drift from the time info alone
+static int checkClockFaults(ASIOHost& host, MockDriverConfig config) {
+    config.clock = MockClockFreeRun;
+    config.callbackLimit = 20000;
+    config.clockDriftPpm = 50.0;
+    config.skipEvery = 999;        // Neither lands on the last block, which the host never sees
+    config.repeatEvery = 1500;
+
+    MockAsioDriver* mock = openMock(host, config, 256);
+    if (!mock || !host.start()) {
+        printf("\nClock faults: failed to start\n");
+        if (mock) closeMock(host, mock);
+        return 1;
+    }
+    mock->waitForCallbacks();
+    host.stop();
+
+    const MockDriverStats& stats = mock->getStats();
+    ClockReport clock = host.getClockReport();
+    printf("\nClock faults: %+.0f ppm, %lld skipped, %lld repeated injected\n%s%s\n",
+           config.clockDriftPpm, stats.skippedBlocks, stats.repeatedBlocks,
+           ClockMonitor::formatText(clock).c_str(), ClockMonitor::formatJson(clock).c_str());
+
+    int failures = 0;
+    if ((long long)clock.skippedBlocks != stats.skippedBlocks ||
+        (long long)clock.repeatedBlocks != stats.repeatedBlocks ||
+        clock.discontinuities != 0 ||
+        (long long)clock.xruns != stats.skippedBlocks + stats.repeatedBlocks) {
+        printf("    xrun counts do not match the injected faults\n");
+        failures++;
+    }
+    if (!clock.driftValid || std::fabs(clock.driftPpm - config.clockDriftPpm) > 1.0) {
+        printf("    drift %.2f ppm, expected %.2f\n", clock.driftPpm, config.clockDriftPpm);
+        failures++;
+    }
+    int64_t position, timeNs;
+    if (!host.getBlockTime(&position, &timeNs) || position != clock.samplePosition) {
+        printf("    block time not published\n");
+        failures++;
+    }
+    closeMock(host, mock);
+    return failures;
+}
+
+// Change the buffer size on a running stream through reconfigure(): the
+// driver stays loaded and initialized, the routes survive (even none), and
+// audio resumes at the new size. Then initialize() again on the same driver must
+// reuse the cached channel info. Prints the phase times of each path.
+static int checkReconfigure(ASIOHost& host, MockDriverConfig config) {
+    config.clock = MockClockManual;
+    MockAsioDriver* mock = openMock(host, config, 256);
+    if (!mock || !host.start()) {
+        printf("\nReconfigure: failed to start\n");
+        if (mock) closeMock(host, mock);
+        return 1;
+    }
+    HostPhaseTimes cold = host.getPhaseTimes();
+    host.setRouteGain(0, 1, 0.5f);  // A cell detection would not make
+    for (int i = 0; i < 4; i++) mock->fire();
+
+    int failures = 0;
+    bool ok = host.reconfigure(128);
+    for (int i = 0; i < 4; i++) mock->fire();
+    if (!ok || !host.isRunning() || host.getBufferSize() != 128 || mock->getBufferSize() != 128) {
+        printf("    reconfigure to 128 frames failed\n");
+        failures++;
+    } else if (host.getRoutes().getGain(0, 1) != 0.5f || !outputsCarrySignal(host, mock, config)) {
+        printf("    routes lost or outputs silent after reconfigure\n");
+        failures++;
+    }
+    HostPhaseTimes warm = host.getPhaseTimes();
+
+    // Routes removed by hand stay removed; detection must not bring them back
+    host.clearRoutes();
+    if (!host.reconfigure(256) || !host.getRoutes().empty()) {
+        printf("    cleared routes came back after reconfigure\n");
+        failures++;
+    }
+
+    host.stop();
+    host.disposeBuffers();
+    if (!host.initialize(nullptr) || !host.getPhaseTimes().channelInfoCached) {
+        printf("    second initialize() did not reuse the channel info\n");
+        failures++;
+    }
+
+    printf("\nReconfigure: cold start, then 256 -> 128 frames on the loaded driver\n%s",
+           ASIOHost::formatPhaseTimes(cold).c_str());
+    printf("  after reconfigure:\n%s", ASIOHost::formatPhaseTimes(warm).c_str());
+    closeMock(host, mock);
+    return failures;
+}
+
+// Input meters must read the peak and RMS of the mock's noise, output
+// meters no lower than the block just written, and once the routes go the
+// output meters must fall back at the documented rates
+static int checkLevelMeters(ASIOHost& host, MockDriverConfig config) {
+    config.clock = MockClockManual;
+    MockAsioDriver* mock = openMock(host, config, 256);
+    if (!mock || !host.start()) {
+        printf("\nLevel meters: failed to start\n");
+        if (mock) closeMock(host, mock);
+        return 1;
+    }
+    int failures = 0;
+    const double blockSeconds = 256 / config.sampleRate;
+    int blocks = (int)(2.0 / blockSeconds);
+    for (int i = 0; i < blocks; i++) {
+        mock->fire();
+    }
+
+    // The mock plays the same two blocks over and over, so their samples
+    // are exactly what the meters have seen
+    for (int ch = 0; ch < host.getInputChannels(); ch++) {
+        std::vector<float> samples(512);
+        SampleConverter conv = getSampleConverter(config.inputs[ch].type);
+        conv.toFloat(mock->getBuffer(true, ch, 0), samples.data(), 256);
+        conv.toFloat(mock->getBuffer(true, ch, 1), samples.data() + 256, 256);
+        double peak = 0.0, sumSquares = 0.0;
+        for (float x : samples) {
+            peak = std::max(peak, (double)std::fabs(x));
+            sumSquares += (double)x * x;
+        }
+        double rms = std::sqrt(sumSquares / samples.size());
+        ChannelLevel level = host.getInputLevel(ch);
+        // The higher peak may be in the other half, and held one block since
+        double oneBlockFall = std::pow(10.0, -LevelMeters::kPeakFallDbPerSecond * blockSeconds / 20.0);
+        if (level.peak > (float)peak || level.peak < peak * oneBlockFall * 0.9999 ||
+            std::fabs(level.rms / rms - 1.0) > 0.01) {
+            printf("    input %d reads peak %.4f RMS %.4f, expected %.4f and %.4f\n",
+                   ch, level.peak, level.rms, peak, rms);
+            failures++;
+        }
+    }
+
+    // The half the host wrote last is the one before the mock's next
+    int lastHalf = (int)((blocks - 1) & 1);
+    ChannelLevel before[2];
+    for (int ch = 0; ch < 2; ch++) {
+        std::vector<float> samples(256);
+        getSampleConverter(config.outputs[ch].type).toFloat(mock->getBuffer(false, ch, lastHalf), samples.data(), 256);
+        float blockPeak = 0.0f;
+        for (float x : samples) blockPeak = std::max(blockPeak, std::fabs(x));
+        before[ch] = host.getOutputLevel(ch);
+        if (blockPeak == 0.0f || before[ch].peak < blockPeak || before[ch].peak > 1.0f || before[ch].rms <= 0.0f) {
+            printf("    output %d reads peak %.4f RMS %.4f, last block peaked at %.4f\n",
+                   ch, before[ch].peak, before[ch].rms, blockPeak);
+            failures++;
+        }
+    }
+
+    host.clearRoutes();
+    const double silentSeconds = 3.0;
+    for (int i = 0; i < (int)(silentSeconds / blockSeconds); i++) {
+        mock->fire();
+    }
+    for (int ch = 0; ch < 2; ch++) {
+        ChannelLevel after = host.getOutputLevel(ch);
+        double peakFall = LevelMeters::toDecibels(before[ch].peak) - LevelMeters::toDecibels(after.peak);
+        double rmsFall = LevelMeters::toDecibels(before[ch].rms) - LevelMeters::toDecibels(after.rms);
+        double expectedFall = LevelMeters::kPeakFallDbPerSecond * silentSeconds;
+        if (std::fabs(peakFall - expectedFall) > 1.0 || rmsFall < 40.0) {
+            printf("    output %d fell %.1f dB peak (expected %.1f), %.1f dB RMS\n",
+                   ch, peakFall, expectedFall, rmsFall);
+            failures++;
+        }
+    }
+    ChannelLevel input = host.getInputLevel(0);
+    printf("\nLevel meters: input 0 %s; output 0 %s, after %.0f s unrouted %s\n",
+           LevelMeters::formatLevel(input).c_str(), LevelMeters::formatLevel(before[0]).c_str(), silentSeconds,
+           LevelMeters::formatLevel(host.getOutputLevel(0)).c_str());
+    closeMock(host, mock);
+    return failures;
+}
+
+// Format and data chunk of a WAV file the recorder wrote
+struct WavContents {
+    int tag = 0;
+    int channels = 0;
+    int bits = 0;
+    double sampleRate = 0.0;
+    size_t dataOffset = 0;
+    size_t dataBytes = 0;
+};
+
+static bool readWav(const std::vector<uint8_t>& file, WavContents* wav) {
+    auto le16 = [&](size_t at) { return (int)(file[at] | (file[at + 1] << 8)); };
+    auto le32 = [&](size_t at) { return (uint32_t)le16(at) | ((uint32_t)le16(at + 2) << 16); };
+    if (file.size() < 12 || memcmp(file.data(), "RIFF", 4) != 0 || memcmp(file.data() + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    for (size_t pos = 12; pos + 8 <= file.size();) {
+        uint32_t size = le32(pos + 4);
+        if (memcmp(file.data() + pos, "fmt ", 4) == 0) {
+            wav->tag = le16(pos + 8) == 0xFFFE ? le16(pos + 32) : le16(pos + 8);
+            wav->channels = le16(pos + 10);
+            wav->sampleRate = le32(pos + 12);
+            wav->bits = le16(pos + 22);
+        } else if (memcmp(file.data() + pos, "data", 4) == 0) {
+            wav->dataOffset = pos + 8;
+            wav->dataBytes = size;
+            return wav->channels > 0 && wav->dataOffset + size <= file.size();
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+// Record while the mock fires bursts of blocks, then check the file block
+// by block: each must be the mock's block for its place in the stream
+// (the two buffer halves alternate, and the mix is the same every time)
+// or, if the ring dropped it, silence. A tiny ring and bursts faster than
+// the writer wakes force drops between stretches that got through.
+static int checkRecording(ASIOHost& host, const char* name, MockDriverConfig config, RecorderConfig recorderConfig,
+                          int bursts, int blocksPerBurst, bool expectDrops) {
+    config.clock = MockClockManual;
+    DiskRecorder recorder;
+    MockAsioDriver* mock = openMock(host, config, 256);
+    recorderConfig.path = (std::filesystem::temp_directory_path() / "callback_bench_recording.wav").string();
+    if (!mock || !host.addTap(&recorder) || !host.start() || !recorder.start(recorderConfig)) {
+        printf("  %-16s failed to start recording\n", name);
+        if (mock) closeMock(host, mock);
+        host.removeTap(&recorder);
+        return 1;
+    }
+    for (int burst = 0; burst < bursts; burst++) {
+        for (int i = 0; i < blocksPerBurst; i++) {
+            mock->fire();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(DiskRecorder::kWakeMs * 2));
+    }
+    bool stopped = recorder.stop();
+    RecorderReport report = recorder.getReport();
+
+    std::vector<uint8_t> file;
+    if (FILE* f = fopen(recorderConfig.path.c_str(), "rb")) {
+        uint8_t chunk[65536];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+            file.insert(file.end(), chunk, chunk + n);
+        }
+        fclose(f);
+    }
+    remove(recorderConfig.path.c_str());
+
+    int failures = 0;
+    const long long blocks = (long long)bursts * blocksPerBurst;
+    const int frames = 256;
+    WavContents wav;
+    int channels = (int)recorderConfig.channels.size();
+    if (!stopped || !readWav(file, &wav) || wav.channels != channels || wav.sampleRate != config.sampleRate ||
+        wav.dataBytes != (size_t)blocks * frames * channels * (wav.bits / 8) || report.frames != (uint64_t)blocks * frames) {
+        printf("  %-16s file does not hold %lld blocks of %d channels\n%s", name, blocks, channels,
+               DiskRecorder::formatText(report).c_str());
+        failures++;
+    } else {
+        // Expected file samples per channel and half: the driver's bytes, or
+        // their float conversion when the file's format differs
+        int sampleBytes = wav.bits / 8;
+        std::vector<std::vector<uint8_t>> expected(channels * 2, std::vector<uint8_t>(frames * sampleBytes));
+        for (int i = 0; i < channels; i++) {
+            int ch = recorderConfig.channels[i];
+            ASIOSampleType type = recorderConfig.fromOutputs ? config.outputs[ch].type : config.inputs[ch].type;
+            for (int half = 0; half < 2; half++) {
+                const void* buffer = mock->getBuffer(!recorderConfig.fromOutputs, ch, half);
+                if (getSampleBytes(type) == sampleBytes && (wav.tag == 3) == (type == ASIOSTFloat32LSB)) {
+                    memcpy(expected[i * 2 + half].data(), buffer, frames * sampleBytes);
+                } else {
+                    getSampleConverter(type).toFloat(buffer, (float*)expected[i * 2 + half].data(), frames);
+                }
+            }
+        }
+        long long recorded = 0, silent = 0, wrong = 0;
+        const uint8_t* data = file.data() + wav.dataOffset;
+        size_t frameBytes = (size_t)channels * sampleBytes;
+        for (long long b = 0; b < blocks; b++) {
+            const uint8_t* block = data + b * frames * frameBytes;
+            bool match = true, zero = true;
+            for (int f = 0; f < frames; f++) {
+                for (int i = 0; i < channels; i++) {
+                    const uint8_t* sample = block + f * frameBytes + i * sampleBytes;
+                    match = match && memcmp(sample, expected[i * 2 + (b & 1)].data() + f * sampleBytes, sampleBytes) == 0;
+                    for (int k = 0; k < sampleBytes; k++) zero = zero && sample[k] == 0;
+                }
+            }
+            if (match) recorded++;
+            else if (zero) silent++;
+            else wrong++;
+        }
+        bool dropsOk = expectDrops ? silent > 0 && recorded > blocksPerBurst : silent == 0;
+        if (wrong || silent * frames != (long long)report.droppedFrames || !dropsOk) {
+            printf("  %-16s %lld blocks recorded, %lld silent, %lld wrong; recorder dropped %llu frames\n",
+                   name, recorded, silent, wrong, (unsigned long long)report.droppedFrames);
+            failures++;
+        }
+        printf("  %-16s %d ch %s: %lld blocks in %llu writes, %lld dropped and filled with silence, ring peak %.0f%%\n",
+               name, channels, report.sampleFormat, blocks, (unsigned long long)report.writes, silent,
+               report.ringPeakPercent);
+    }
+    closeMock(host, mock);
+    host.removeTap(&recorder);
+    return failures;
+}
+
+// Writes a running frame count into the first two (Int24LSB) outputs after
+// the mix, one count per step of the wire format, so each frame the other
+// host plays says which sent frame it was. Output 1 runs half a cycle
+// ahead, so swapped channels show.
+class FrameCountTap : public StreamTap {
+public:
+    explicit FrameCountTap(int bits) : bits(bits) {}
+    void prepare(const StreamFormat& format) override { (void)format; }
+    void process(const StreamBlock& block) override {
+        uint32_t mask = (1u << bits) - 1;
+        for (int ch = 0; ch < 2; ch++) {
+            uint8_t* out = (uint8_t*)block.outputs[ch];
+            for (int i = 0; i < block.frames; i++) {
+                uint32_t value = ((uint32_t)(frame + i + ch * ((uint64_t)1 << (bits - 1))) & mask) << (23 - bits);
+                out[i * 3] = (uint8_t)value;
+                out[i * 3 + 1] = (uint8_t)(value >> 8);
+                out[i * 3 + 2] = (uint8_t)(value >> 16);
+            }
+        }
+        frame += block.frames;
+    }
+
+private:
+    int bits;
+    uint64_t frame = 0;
+};
+
+// Two hosts on mock drivers, one sending two outputs over loopback RTP and
+// the other playing them into two of its inputs, stepped on a shared
+// simulated timeline. Each source block waits until its whole packets
+// have arrived, so nothing may be lost or late. Once the jitter buffer has
+// primed, every frame the receiving host plays must be the one sent at a
+// single fixed delay. With overrun, the sender's ring is as small as it
+// goes and source blocks come in bursts it cannot keep up with: the blocks
+// it drops must play as silence, and the frames around them still at that
+// delay, with the buffer never running dry.
+static int checkNetworkStream(const char* name, RtpEncoding encoding, double packetMs, int sourceFrames,
+                              int targetFrames, double seconds, bool overrun) {
+    MockDriverConfig sourceConfig = makeSarLayout("rtp", 1, ASIOSTInt32LSB, ASIOSTInt24LSB).config;
+    sourceConfig.name = "Mock Sender";
+    sourceConfig.clock = MockClockManual;
+    MockDriverConfig targetConfig = makeSarLayout("rtp", 2, ASIOSTInt32LSB, ASIOSTInt32LSB).config;
+    targetConfig.name = "Mock Receiver";
+    targetConfig.clock = MockClockManual;
+
+    const double rate = sourceConfig.sampleRate;
+    const int packetFrames = (int)std::lround(packetMs * rate / 1000.0);
+    const int bits = encoding == RtpL16 ? 15 : 23;
+    ASIOHost source, target;
+    FrameCountTap counter(bits);
+    RtpSender sender;
+    RtpReceiver receiver;
+    MockAsioDriver* sourceMock = openMock(source, sourceConfig, sourceFrames);
+    MockAsioDriver* targetMock = openMock(target, targetConfig, targetFrames);
+    RtpReceiveConfig receiveConfig;
+    receiveConfig.address = "127.0.0.1";
+    receiveConfig.port = 0;
+    receiveConfig.channels = { 2, 3 };
+    receiveConfig.encoding = encoding;
+    receiveConfig.packetMs = packetMs;
+    // Covers the source block; while overrunning, the sender may also lag
+    // by its whole ring (four blocks or two batches of 32 packets)
+    int lagFrames = overrun ? std::max(sourceFrames * 4, 64 * packetFrames) : sourceFrames;
+    receiveConfig.jitterMs = (lagFrames + packetFrames) * 1000.0 / rate;
+    RtpSendConfig sendConfig;
+    sendConfig.address = "127.0.0.1";
+    sendConfig.channels = { 0, 1 };
+    sendConfig.encoding = encoding;
+    sendConfig.packetMs = packetMs;
+    if (overrun) {
+        sendConfig.ringSeconds = 0.0;
+    }
+    bool ok = sourceMock && targetMock && source.addTap(&counter) && source.addTap(&sender) &&
+              target.addTap(&receiver) && receiver.start(receiveConfig);
+    sendConfig.port = receiver.getPort();
+    ok = ok && sender.start(sendConfig) && source.start() && target.start();
+
+    // What the receiver left in its inputs, per channel as float
+    std::vector<float> received[2];
+    std::vector<float> block(targetFrames);
+    long long sourceFired = 0, targetFired = 0;
+    bool arrived = true;
+    auto waitFor = [&](uint64_t packets) {
+        auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (receiver.getReport().packets < packets && (arrived = std::chrono::steady_clock::now() < giveUp)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    };
+    while (ok && arrived) {
+        double sourceDue = sourceFired * (double)sourceFrames / rate;
+        double targetDue = targetFired * (double)targetFrames / rate;
+        if (std::min(sourceDue, targetDue) >= seconds) break;
+        if (sourceDue <= targetDue) {
+            sourceMock->fire();
+            sourceFired++;
+            if (!overrun) {
+                waitFor((uint64_t)(sourceFired * sourceFrames / packetFrames));
+            }
+        } else {
+            // Source blocks due meanwhile went out back to back, overrunning
+            // the ring; the sender drains what fitted, and what it has sent
+            // must have arrived
+            if (overrun) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                waitFor(sender.getReport().packets);
+            }
+            targetMock->fire();
+            for (int ch = 0; ch < 2; ch++) {
+                getSampleConverter(ASIOSTInt32LSB).toFloat(targetMock->getBuffer(true, 2 + ch, targetFired & 1),
+                                                           block.data(), targetFrames);
+                received[ch].insert(received[ch].end(), block.begin(), block.begin() + targetFrames);
+            }
+            targetFired++;
+        }
+    }
+    if (sourceMock) source.stop();
+    if (targetMock) target.stop();
+    sender.stop();
+    receiver.stop();
+    RtpSendReport sendReport = sender.getReport();
+    RtpReceiveReport receiveReport = receiver.getReport();
+
+    // Each played frame's count, back to the sent frame: the delay modulo
+    // the count's cycle, the same for every frame. A count can come back
+    // a step or two low from the converters' rounding, and both channels
+    // at zero is silence.
+    int failures = 0;
+    const long long cycle = 1LL << bits;
+    size_t primed = (size_t)targetFrames * 2;     // Silent while the first packets arrive
+    long long delay = -1;
+    size_t silent = 0, wrong = 0;
+    for (size_t i = primed; i < received[0].size(); i++) {
+        long long counts[2];
+        for (int ch = 0; ch < 2; ch++) {
+            counts[ch] = std::lround(received[ch][i] * (double)cycle);
+        }
+        if (counts[0] == 0 && counts[1] == 0) {
+            silent++;
+            continue;
+        }
+        for (int ch = 0; ch < 2; ch++) {
+            if (counts[ch] < 2) continue;   // Where the count wraps
+            long long sent = counts[ch] - ch * (cycle / 2);
+            long long d = (((long long)i - sent) % cycle + cycle) % cycle;
+            if (delay < 0) delay = d;
+            if (std::llabs(d - delay) > 2) wrong++;
+        }
+    }
+    double bufferMs = (std::ceil(receiveConfig.jitterMs * rate / 1000.0) + targetFrames) * 1000.0 / rate;
+    printf("  %-16s %d -> %d frames, %d-frame packets: delay %.2f ms (buffer %.2f ms), %.1f packets per send call, "
+           "transit %.3f ms mean, %.3f max",
+           name, sourceFrames, targetFrames, packetFrames, delay >= 0 ? (delay - 1) * 1000.0 / rate : -1.0, bufferMs,
+           sendReport.sendCalls > 0 ? (double)sendReport.packets / sendReport.sendCalls : 0.0,
+           receiveReport.transitMeanMs, receiveReport.transitMaxMs);
+    if (overrun) {
+        printf(", %llu overruns, %zu frames silent", (unsigned long long)sendReport.overruns, silent);
+    }
+    printf("\n");
+    if (!ok || !arrived) {
+        printf("  %s\n", !ok ? "could not set up the two hosts and the stream" : "packets did not arrive");
+        failures++;
+    } else if (delay < 0 || wrong > 0 || (silent > 0) != overrun || silent > receiveReport.missingFrames) {
+        printf("  %zu frames played out of place, %zu silent\n", wrong, silent);
+        failures++;
+    }
+    if (ok && (receiveReport.lost || receiveReport.late || receiveReport.malformed || receiveReport.duplicates ||
+               receiveReport.underruns || receiveReport.resyncs || receiveReport.restarts ||
+               sendReport.sendErrors || (sendReport.overruns > 0) != overrun ||
+               receiveReport.packets != sendReport.packets ||
+               receiveReport.timedPackets != receiveReport.packets || receiveReport.transitMeanMs <= 0.0)) {
+        printf("%s%s", RtpSender::formatText(sendReport).c_str(), RtpReceiver::formatText(receiveReport).c_str());
+        failures++;
+    }
+    if (sourceMock) closeMock(source, sourceMock);
+    if (targetMock) closeMock(target, targetMock);
+    return failures;
+}
+
+// Requests sent the way a driver sends them, from another thread: the host
+// must queue each one, and processDriverRequests() must bring the stream
+// back at the new size or rate, or with the new channels, and report how
+// long it took.
+static int checkDriverRequests(ASIOHost& host, MockDriverConfig config) {
+    config.clock = MockClockManual;
+    std::atomic<int> notified(0);
+    host.setRequestNotify([&notified] { notified.fetch_add(1); });
+    MockAsioDriver* mock = openMock(host, config, 256);
+    if (!mock || !host.start()) {
+        printf("\nDriver requests: failed to start\n");
+        if (mock) closeMock(host, mock);
+        host.setRequestNotify(nullptr);
+        return 1;
+    }
+    host.setRouteGain(0, 1, 0.5f);
+    int failures = 0;
+    printf("\nDriver requests:\n");
+
+    // Drivers ask before sending; unadvertised requests fall back to a reset
+    const long selectors[] = { kAsioResetRequest, kAsioBufferSizeChange, kAsioResyncRequest, kAsioLatenciesChanged };
+    for (long selector : selectors) {
+        if (mock->sendMessage(kAsioSelectorSupported, selector) != 1) {
+            printf("    host does not advertise selector %ld\n", selector);
+            failures++;
+        }
+    }
+    if (mock->sendMessage(kAsioSelectorSupported, kAsioSupportsTimeCode) != 0) {
+        printf("    host advertises time code, which it does not take\n");
+        failures++;
+    }
+
+    // Post from a driver-like thread, then recover on this one
+    auto request = [&](const char* what, std::function<void()> send, std::function<bool()> recovered) {
+        int before = notified.load();
+        std::thread driverThread(send);
+        driverThread.join();
+        bool queued = host.hasDriverRequests() && notified.load() > before;
+        bool ok = host.processDriverRequests();
+        for (int i = 0; i < 4; i++) mock->fire();
+        ok = ok && queued && host.isRunning() && recovered() && outputsCarrySignal(host, mock, config);
+        DriverRequestReport report = host.getRequestReport();
+        printf("  %-28s %s, %.3f ms to audio\n", what, ok ? "recovered" : "FAILED", report.lastRecoveryMs);
+        if (!ok) failures++;
+    };
+
+    request("buffer size change to 512",
+            [&] { mock->sendMessage(kAsioBufferSizeChange, 512); },
+            [&] { return host.getBufferSize() == 512 && mock->getBufferSize() == 512 &&
+                         host.getRoutes().getGain(0, 1) == 0.5f; });
+    request("sample rate change to 44.1k",
+            [&] { mock->changeSampleRate(44100.0); },
+            [&] { return host.getSampleRate() == 44100.0 && host.getBufferSize() == 512 &&
+                         std::fabs(host.getTimingReport().budgetNs - 512 / 44100.0 * 1e9) < 1.0; });
+    request("resync x3",
+            [&] { for (int i = 0; i < 3; i++) mock->sendMessage(kAsioResyncRequest, 0); },
+            [&] { return host.getRequestReport().received[3] == 3; });
+    request("reset, same channels",
+            [&] { mock->sendMessage(kAsioResetRequest, 0); },
+            [&] { return host.getRoutes().getGain(0, 1) == 0.5f && !host.getPhaseTimes().channelInfoCached; });
+    request("reset, renamed input",
+            [&] {
+                host.setOutputMute(1, true);
+                host.setRouteMute(0, 1, true);
+                host.setRouteMute(1, 1, true);
+                mock->renameChannel(true, 0, "Music L");
+                mock->sendMessage(kAsioResetRequest, 0);
+            },
+            [&] {
+                // Output mutes survive; route mutes only where the input kept its name
+                const MixControls& controls = host.getMixControls();
+                bool kept = controls.outputs.size() > 1 && controls.outputs[1].muted && controls.routes.size() == 1 &&
+                            controls.routes[0].inputChannel == 1 && controls.routes[0].outputChannel == 1;
+                host.setOutputMute(1, false);
+                host.setRouteMute(1, 1, false);
+                return kept && host.getInputChannelNames()[0] == "Music L" && host.getRoutes().getGain(0, 1) == 0.0f;
+            });
+
+    printf("%s%s\n", DriverRequests::formatText(host.getRequestReport()).c_str(),
+           DriverRequests::formatJson(host.getRequestReport()).c_str());
+    closeMock(host, mock);
+    host.setRequestNotify(nullptr);
+    return failures;
+}
+
+// The classifier the host had before routing rules, kept as the reference
+// the built-in rules must agree with
+static bool legacyIsHardware(const std::string& name) {
+    static const char* const patterns[] = {
+        "asio4all", "asio 4 all", "realtek", "nvidia", "amd", "intel", "usb", "hdmi", "spdif",
+        "optical", "focusrite", "scarlett", "steinberg", "yamaha", "motu", "rme", "universal audio",
+        "presonus", "behringer", "native instruments", "m-audio", "flexasio", "wasapi", "wdm",
+        "speaker", "headphone", "line out", "line in", "microphone", "mic in", "aux", "topping",
+        "fiio", "schiit", "jds", "geshelli", "not connected", "disconnected"
+    };
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    for (const char* pattern : patterns) {
+        if (lower.find(pattern) != std::string::npos) return true;
+    }
+    if (lower.find("ch") == 0) return true;
+    size_t digitCount = 0;
+    for (char c : name) {
+        if (isdigit((uint8_t)c) || c == '-' || c == ' ') digitCount++;
+    }
+    return !name.empty() && digitCount >= name.size() / 2;
+}
+
+// Rules: the built-ins against the legacy classifier, parsing, priorities
+// and route rules, then on the host a route rule applied by redetection and
+// the plan cache hit when the same channels come back
+static int checkRoutingRules(ASIOHost& host, MockDriverConfig config) {
+    int failures = 0;
+    RoutingRules builtIn;
+    const char* corpus[] = {
+        "System L", "Game R", "Discord", "Browser", "", "01", "1-2", "Out 3", "Ch 1", "CHANNEL",
+        "Speakers L", "SPEAKERS R", "Realtek HD Audio", "USB Audio CODEC", "Line Out 4", "Mic In",
+        "Focusrite USB", "Headphones", "AUX", "Samsung TV (HDMI)", "Not Connected", "Zoom Call",
+        "Music", "Schiit Modi", "m-Audio Fast Track", "Voice Chat", "MOTU 828 1", "Browser R",
+        "Stream Deck", "Alerts", "RME Fireface", "Topping D90", "Comms L", "ASIO4ALL v2 Out 1"
+    };
+    int mismatches = 0;
+    for (const char* name : corpus) {
+        bool hardware = legacyIsHardware(name);
+        ChannelRole expectIn = hardware ? RoleHardware : (*name ? RoleVirtual : RoleNone);
+        ChannelRole expectOut = hardware ? RoleHardware : RoleNone;
+        if (builtIn.classify(name, true) != expectIn || builtIn.classify(name, false) != expectOut) {
+            printf("    built-in rules classify \"%s\" differently\n", name);
+            mismatches++;
+        }
+    }
+    failures += mismatches;
+
+    const char* text =
+        "# SAR endpoints\n"
+        "outputs \"speaker\" hardware\n"
+        "inputs \"speaker mix\" virtual priority 5\n"
+        "inputs \"^voice\" route 1 gain 0.25 priority 2\n"
+        "any \"monitor$\" ignore\n";
+    RoutingRules rules;
+    std::string error;
+    RoutingRules reparsed;
+    if (!rules.parse(text, &error) || rules.getRules().size() != 4 ||
+        !reparsed.parse(rules.format(), &error) || reparsed.getHash() != rules.getHash()) {
+        printf("    rules did not parse or round-trip: %s\n", error.c_str());
+        failures++;
+    }
+    if (rules.parse("inputs \"a\" virtual\noutputs \"b\" loud\n", &error) || error.find("line 2") != 0 ||
+        rules.getRules().size() != 4) {
+        printf("    bad rule accepted or misreported: %s\n", error.c_str());
+        failures++;
+    }
+    if (rules.classify("Speaker Mix", true) != RoleVirtual || rules.classify("Speaker Mix", false) != RoleHardware ||
+        rules.classify("Voice L", true) != RoleVirtual || rules.findRule("Invoice", true) != nullptr ||
+        rules.classify("Studio Monitor", false) != RoleIgnore || rules.classify("Monitor 2", false) != RoleNone) {
+        printf("    rule scope, anchors or priorities misapplied\n");
+        failures++;
+    }
+
+    config.clock = MockClockManual;
+    config.inputs[0].name = "Voice L";
+    host.setRoutingRules(rules);
+    MockAsioDriver* mock = openMock(host, config, 256);
+    if (!mock) {
+        printf("    routing rules: failed to open the driver\n");
+        host.setRoutingRules(RoutingRules::builtIn());
+        return failures + 1;
+    }
+    // Created with the rules already set, so detection applied them
+    bool routed = host.getRoutes().getGain(0, 1) == 0.25f && host.getRoutes().getGain(0, 0) == 0.0f &&
+                  host.getRoutes().getGain(1, 0) == 1.0f && host.getInputRole(0) == RoleVirtual &&
+                  host.getOutputRole(1) == RoleHardware;
+    bool coldCached = host.getPhaseTimes().routingCached;
+    host.disposeBuffers();
+    bool warm = host.createBuffers(256) && host.getPhaseTimes().routingCached &&
+                host.getRoutes().getGain(0, 1) == 0.25f;
+
+    // New rules change the roles at once and the routes on redetection
+    host.setRoutingRules(RoutingRules::builtIn());
+    bool redetected = !host.getPhaseTimes().routingCached && host.redetectRouting() &&
+                      host.getRoutes().getGain(0, 0) == 1.0f && host.getRoutes().getGain(0, 1) == 0.0f;
+    if (!routed || coldCached || !warm || !redetected) {
+        printf("    route rule %s, plan cache %s, redetection %s\n", routed ? "applied" : "ignored",
+               (!coldCached && warm) ? "ok" : "wrong", redetected ? "ok" : "wrong");
+        failures++;
+    }
+    closeMock(host, mock);
+
+    printf("\nRouting rules: %zu built-in, %d name(s) differ from the legacy classifier\n",
+           builtIn.getRules().size(), mismatches);
+    return failures;
+}
+
+// True if the given half of an output holds anything but zeros
+static bool halfCarriesSignal(const MockAsioDriver* mock, const MockDriverConfig& config, int channel, int half) {
+    int bytes = getSampleBytes(config.outputs[channel].type) * mock->getBufferSize();
+    const uint8_t* p = (const uint8_t*)mock->getBuffer(false, channel, half);
+    for (int i = 0; i < bytes; i++) {
+        if (p[i]) return true;
+    }
+    return false;
+}
+
+// Mute an output while it plays: the next block still carries the fade,
+// the ones after are silent, and unmuting brings it back
+static int checkMixControls(ASIOHost& host, MockDriverConfig config) {
+    config.clock = MockClockManual;
+    MockAsioDriver* mock = openMock(host, config, 256);
+    if (!mock || !host.start() || host.getRoutes().empty()) {
+        printf("\nMix controls: failed to start\n");
+        if (mock) closeMock(host, mock);
+        return 1;
+    }
+    int out = host.getRoutes().getCells()[0].outputChannel;
+    int block = 0;
+    for (; block < 4; block++) {
+        mock->fire();
+    }
+    bool playing = halfCarriesSignal(mock, config, out, (block - 1) & 1);
+
+    host.setOutputMute(out, true);
+    mock->fire();
+    bool fading = halfCarriesSignal(mock, config, out, block++ & 1);
+    for (int i = 0; i < 4; i++, block++) {
+        mock->fire();
+    }
+    bool muted = !halfCarriesSignal(mock, config, out, 0) && !halfCarriesSignal(mock, config, out, 1) &&
+                 host.getRoutingInfo().find("[muted]") != std::string::npos;
+
+    host.setOutputMute(out, false);
+    for (int i = 0; i < 4; i++, block++) {
+        mock->fire();
+    }
+    bool back = halfCarriesSignal(mock, config, out, (block - 1) & 1);
+
+    int failures = (playing && fading && muted && back) ? 0 : 1;
+    printf("\nMix controls: output %d %s, fade %s, %s, unmuted %s\n", out, playing ? "playing" : "SILENT",
+           fading ? "ramped" : "CUT", muted ? "muted" : "NOT MUTED", back ? "back" : "STILL SILENT");
+    closeMock(host, mock);
+    return failures;
+}
+
+// Step the host by hand on this thread, with nothing else running, and
+// count heap allocations across the callbacks. There must be none.
+static int checkNoAllocations(ASIOHost& host, const char* name, MockDriverConfig config) {
+    config.clock = MockClockManual;
+    long long setup = g_allocations.load();
+    MockAsioDriver* mock = openMock(host, config, 256);
+    if (!mock || !host.start()) {
+        printf("  %-16s failed to start\n", name);
+        if (mock) closeMock(host, mock);
+        return 1;
+    }
+    if (g_allocations.load() == setup) {
+        printf("  %-16s allocation counter saw nothing during setup\n", name);
+        return 1;
+    }
+    for (int i = 0; i < 16; i++) {
+        mock->fire();
+    }
+    const int blocks = 5000;
+    long long before = g_allocations.load();
+    for (int i = 0; i < blocks; i++) {
+        mock->fire();
+    }
+    long long allocations = g_allocations.load() - before;
+    host.stop();
+
+    printf("  %-16s %d callbacks, %lld heap allocation(s), stream memory %zu KB %s\n",
+           name, blocks, allocations, (host.getStreamMemoryBytes() + 1023) / 1024,
+           host.isStreamMemoryLocked() ? "locked" : "not locked");
+    closeMock(host, mock);
+    return allocations != 0 ? 1 : 0;
+}
+
+int main() {
+    int failures = checkHistogramBuckets();
+
+    std::vector<Layout> layouts;
+    layouts.push_back(makeSarLayout("sar 8x2 int32", 8, ASIOSTInt32LSB, ASIOSTInt32LSB));
+    layouts.push_back(makeSarLayout("sar 8x2 mixed", 8, ASIOSTInt32LSB, ASIOSTInt24LSB));
+    layouts.push_back(makeSarLayout("sar 16x2 float", 16, ASIOSTFloat32LSB, ASIOSTInt32LSB));
+    layouts.push_back(makeWideLayout("wide 64 int32", 64, ASIOSTInt32LSB));
+
+    const int bufferSizes[] = { 64, 256, 1024 };
+    const long long callbacks = 20000;
+
+    ASIOHost host;
+    printf("Free-running callbacks (%lld per run), SIMD level %s\n\n",
+           callbacks, getSimdLevelName(getSimdLevel()));
+    printf("  %-16s %5s %5s %6s %12s %10s %10s %10s %16s\n",
+           "layout", "in", "out", "frames", "ns/callback", "p50 ns", "p99 ns", "max ns", "ns/channel-sample");
+
+    for (auto& layout : layouts) {
+        for (int size : bufferSizes) {
+            MockDriverConfig config = layout.config;
+            config.clock = MockClockFreeRun;
+            config.callbackLimit = callbacks;
+
+            MockAsioDriver* mock = openMock(host, config, size);
+            if (!mock || !host.start()) {
+                printf("  %-16s failed to start at %d frames\n", layout.name, size);
+                if (mock) closeMock(host, mock);
+                failures++;
+                continue;
+            }
+            mock->waitForCallbacks();
+            host.stop();
+
+            const MockDriverStats& stats = mock->getStats();
+            CallbackTimingReport timing = host.getTimingReport();
+            int channels = (int)(config.inputs.size() + config.outputs.size());
+            double mean = stats.totalNs / stats.callbacks;
+            printf("  %-16s %5d %5d %6d %12.0f %10.0f %10.0f %10.0f %16.3f\n",
+                   layout.name, (int)config.inputs.size(), (int)config.outputs.size(), size,
+                   mean, timing.p50Ns, timing.p99Ns, stats.maxNs, mean / ((double)channels * size));
+
+            if ((long long)timing.callbacks != stats.callbacks) {
+                printf("    host timed %llu callbacks, driver made %lld\n",
+                       (unsigned long long)timing.callbacks, stats.callbacks);
+                failures++;
+            }
+
+            ClockReport clock = host.getClockReport();
+            if (clock.blocks != timing.callbacks || clock.xruns != 0) {
+                printf("    clock saw %llu blocks with %llu xruns on a clean run\n",
+                       (unsigned long long)clock.blocks, (unsigned long long)clock.xruns);
+                failures++;
+            }
+
+            if (stats.outputReadyCalls != stats.callbacks) {
+                printf("    outputReady called %lld times for %lld callbacks\n",
+                       stats.outputReadyCalls, stats.callbacks);
+                failures++;
+            }
+            if (!outputsCarrySignal(host, mock, config)) {
+                printf("    routed outputs are silent\n");
+                failures++;
+            }
+            closeMock(host, mock);
+        }
+    }
+
+    // Real-time clock: half a second at 48 kHz / 256 frames
+    MockDriverConfig timed = layouts[0].config;
+    timed.clock = MockClockTimer;
+    timed.callbackLimit = (long long)(0.5 * timed.sampleRate / 256);
+    MockAsioDriver* mock = openMock(host, timed, 256);
+    if (mock && host.start()) {
+        auto begin = std::chrono::steady_clock::now();
+        mock->waitForCallbacks();
+        auto end = std::chrono::steady_clock::now();
+        host.stop();
+        const MockDriverStats& stats = mock->getStats();
+        printf("\nTimer clock: %lld callbacks in %.1f ms (expected %.1f ms), %lld late, max %.0f ns\n",
+               stats.callbacks, std::chrono::duration<double, std::milli>(end - begin).count(),
+               stats.callbacks * 256 * 1000.0 / timed.sampleRate, stats.lateCallbacks, stats.maxNs);
+        CallbackTimingReport timing = host.getTimingReport();
+        printf("%s", CallbackStats::formatText(timing).c_str());
+        printf("%s\n", CallbackStats::formatJson(timing).c_str());
+        closeMock(host, mock);
+    } else {
+        printf("\nTimer clock: failed to start\n");
+        if (mock) closeMock(host, mock);
+        failures++;
+    }
+
+    failures += checkClockFaults(host, layouts[0].config);
+    failures += checkReconfigure(host, layouts[0].config);
+    failures += checkDriverRequests(host, layouts[0].config);
+    failures += checkLevelMeters(host, layouts[0].config);
+    failures += checkRoutingRules(host, layouts[0].config);
+    failures += checkMixControls(host, layouts[0].config);
+    failures += checkBufferTuner();
+    failures += checkResampler();
+    printf("\nBridge between two mock drivers:\n");
+    failures += checkBridge(48000.0, 50.0, 256, 48000.0, -30.0, 128, 60.0);
+    failures += checkBridge(44100.0, 0.0, 512, 48000.0, 20.0, 64, 40.0);
+
+    printf("\nRecording to disk:\n");
+    RecorderConfig inputs;
+    inputs.channels = { 0, 1, 2, 3 };
+    inputs.ringSeconds = 0.0;   // Four blocks: bursts of 40 overrun it
+    failures += checkRecording(host, "int32 inputs", layouts[0].config, inputs, 12, 40, true);
+    RecorderConfig outputs;
+    outputs.fromOutputs = true;
+    outputs.channels = { 1, 0 };
+    failures += checkRecording(host, "int24 outputs", layouts[1].config, outputs, 4, 200, false);
+    RecorderConfig converted;
+    converted.channels = { 0, 1, 2 };
+    converted.writeBytes = 4096;
+    failures += checkRecording(host, "int32 msb", makeSarLayout("msb", 2, ASIOSTInt32MSB, ASIOSTInt32LSB).config,
+                               converted, 4, 200, false);
+
+    printf("\nRTP over loopback:\n");
+    failures += checkNetworkStream("L24 1 ms", RtpL24, 1.0, 64, 64, 2.0, false);
+    failures += checkNetworkStream("L16 250 us", RtpL16, 0.25, 256, 128, 2.0, false);
+    failures += checkNetworkStream("L24 125 us", RtpL24, 0.125, 512, 32, 1.0, false);
+    failures += checkNetworkStream("L24 overrun", RtpL24, 0.125, 32, 512, 2.0, true);
+
+    printf("\nHeap use on the callback:\n");
+    for (auto& layout : layouts) {
+        failures += checkNoAllocations(host, layout.name, layout.config);
+    }
+
+    if (failures) {
+        printf("\n%d failure(s)\n", failures);
+        return 1;
+    }
+    return 0;
+}
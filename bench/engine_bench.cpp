@@ -0,0 +1,391 @@
+// Engine microbenchmark suite with CSV output and a regression check.
+//
+// Times the pieces of the conversion and mixing engine on their own, at
+// the active SIMD level and without a driver:
+//   convert  each converter of the common driver formats, per sample
+//   plan     MixEngine::setRoutes (plan build and publish), per route
+//   mix      MixEngine::process on dense, sparse and SAR-style stereo
+//            downmix layouts, per cell-sample
+//   route    RoutingRules::classify per channel name, with the built-in
+//            rules and with 256 more, and RoutingRules::plan per channel
+// at several buffer sizes and channel counts.
+//
+//   engine_bench [--csv FILE] [--check FILE] [--tolerance F] [--quick]
+//
+// --csv writes every result as a row. --check reads such a file (a saved
+// run from the same machine, or hand-set limits) and fails any case whose
+// ns/unit exceeds the file's by more than the tolerance (default 0.25,
+// i.e. 25%). Cases missing on either side are skipped. Returns 1 if any
+// case regressed, 2 on usage or I/O errors.
+
+#include "../src/mix_engine.h"
+#include "../src/routing_rules.h"
+#include "../src/sample_convert.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+struct BenchResult {
+    std::string group;
+    std::string name;
+    int frames;
+    int channels;
+    double nsPerOp;
+    double nsPerUnit;
+};
+
+struct BenchOptions {
+    double batchMs = 2.0;   // Minimum length of one timed batch
+    int batches = 7;
+};
+
+// ns per call of fn in the fastest of several batches, each long enough
+// for the clock's resolution not to matter. The fastest batch is the one
+// least disturbed by interrupts and other processes, so it is the most
+// repeatable figure to check against a threshold.
+template <typename Fn>
+static double timeOp(const BenchOptions& options, Fn fn) {
+    typedef std::chrono::steady_clock Clock;
+    fn();
+    long iterations = 1;
+    for (;;) {
+        auto begin = Clock::now();
+        for (long i = 0; i < iterations; i++) fn();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        if (ms >= options.batchMs || iterations >= (1L << 30)) break;
+        iterations *= ms > 0.0 ? std::max(2L, (long)(options.batchMs / ms) + 1) : 16;
+    }
+
+    std::vector<double> ns;
+    for (int batch = 0; batch < options.batches; batch++) {
+        auto begin = Clock::now();
+        for (long i = 0; i < iterations; i++) fn();
+        ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / iterations);
+    }
+    return *std::min_element(ns.begin(), ns.end());
+}
+
+struct FormatEntry {
+    ASIOSampleType type;
+    const char* name;
+};
+
+// Formats drivers actually deliver
+static const FormatEntry kFormats[] = {
+    { ASIOSTInt16LSB,   "Int16LSB" },
+    { ASIOSTInt24LSB,   "Int24LSB" },
+    { ASIOSTInt32LSB,   "Int32LSB" },
+    { ASIOSTFloat32LSB, "Float32LSB" },
+};
+
+static const int kFrames[] = { 64, 256, 1024 };
+
+// One benchmark: what it measures and how to time it again. measure()
+// returns ns per operation; units is how many units one operation covers.
+struct BenchCase {
+    BenchResult result;
+    double units;
+    std::function<double()> measure;
+};
+
+static void addConvertCases(const BenchOptions& options, std::mt19937& rng, std::vector<BenchCase>& cases) {
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (const auto& fmt : kFormats) {
+        SampleConverter conv = getSampleConverter(fmt.type);
+        for (int frames : kFrames) {
+            // Buffers shared by the format's three cases
+            auto floats = std::make_shared<std::vector<float>>(frames);
+            auto bus = std::make_shared<std::vector<float>>(frames, 0.0f);
+            auto native = std::make_shared<std::vector<uint8_t>>((size_t)frames * getSampleBytes(fmt.type));
+            for (auto& v : *floats) v = dist(rng);
+            conv.fromFloat(floats->data(), native->data(), frames);
+
+            std::string name = fmt.name;
+            cases.push_back({ { "convert", name + ".toFloat", frames, 1, 0.0, 0.0 }, (double)frames, [=] {
+                return timeOp(options, [&] { conv.toFloat(native->data(), bus->data(), frames); });
+            } });
+            cases.push_back({ { "convert", name + ".accumulate", frames, 1, 0.0, 0.0 }, (double)frames, [=] {
+                return timeOp(options, [&] { conv.accumulate(native->data(), bus->data(), frames); });
+            } });
+            cases.push_back({ { "convert", name + ".fromFloat", frames, 1, 0.0, 0.0 }, (double)frames, [=] {
+                return timeOp(options, [&] { conv.fromFloat(floats->data(), native->data(), frames); });
+            } });
+        }
+    }
+}
+
+struct Layout {
+    const char* name;
+    int numInputs;
+    int numOutputs;
+    std::vector<ChannelRoute> routes;
+};
+
+// Dense: every input to every output at varying gains (float bus).
+// Sparse: pairs swapped at varying gains, every fourth at unity.
+// SAR: stereo endpoints summed into one stereo output (integer path).
+static std::vector<Layout> makeLayouts(int channels, std::mt19937& rng) {
+    std::uniform_real_distribution<float> dist(0.1f, 1.9f);
+    std::vector<Layout> layouts(3);
+    layouts[0] = { "dense", channels, channels, {} };
+    for (int out = 0; out < channels; out++) {
+        for (int in = 0; in < channels; in++) {
+            layouts[0].routes.push_back({ in, out, dist(rng) / channels });
+        }
+    }
+    layouts[1] = { "sparse", channels, channels, {} };
+    for (int in = 0; in < channels; in++) {
+        layouts[1].routes.push_back({ in, in ^ 1, (in % 4 == 0) ? 1.0f : dist(rng) / 2 });
+    }
+    layouts[2] = { "sar", channels, 2, {} };
+    for (int in = 0; in < channels; in++) {
+        layouts[2].routes.push_back({ in, in & 1, 1.0f });
+    }
+    for (auto& layout : layouts) {
+        // Sorted by output then input, as RoutingMatrix keeps them
+        std::sort(layout.routes.begin(), layout.routes.end(), [](const ChannelRoute& a, const ChannelRoute& b) {
+            return a.outputChannel != b.outputChannel ? a.outputChannel < b.outputChannel
+                                                      : a.inputChannel < b.inputChannel;
+        });
+    }
+    return layouts;
+}
+
+static void addMixCases(const BenchOptions& options, std::mt19937& rng, std::vector<BenchCase>& cases) {
+    for (int channels : { 8, 32, 128 }) {
+        for (const Layout& layout : makeLayouts(channels, rng)) {
+            auto shared = std::make_shared<Layout>(layout);
+            double cells = (double)layout.routes.size();
+
+            // Planning does not depend on the block size; time it once
+            cases.push_back({ { "plan", layout.name, 256, channels, 0.0, 0.0 }, cells, [=] {
+                std::vector<ASIOSampleType> inTypes(shared->numInputs, ASIOSTInt32LSB);
+                std::vector<ASIOSampleType> outTypes(shared->numOutputs, ASIOSTInt32LSB);
+                MixEngine engine;
+                engine.configure(inTypes, outTypes, shared->routes, 256);
+                return timeOp(options, [&] { engine.setRoutes(shared->routes); });
+            } });
+
+            for (int frames : kFrames) {
+                unsigned seed = rng();
+                cases.push_back({ { "mix", layout.name, frames, channels, 0.0, 0.0 }, cells * frames, [=] {
+                    std::mt19937 gen(seed);
+                    std::uniform_int_distribution<int32_t> dist(-(1 << 26), 1 << 26);
+                    std::vector<std::vector<int32_t>> in(shared->numInputs, std::vector<int32_t>(frames));
+                    std::vector<std::vector<int32_t>> out(shared->numOutputs, std::vector<int32_t>(frames));
+                    for (auto& buffer : in) {
+                        for (auto& s : buffer) s = dist(gen);
+                    }
+                    std::vector<void*> inPtrs, outPtrs;
+                    for (auto& buffer : in) inPtrs.push_back(buffer.data());
+                    for (auto& buffer : out) outPtrs.push_back(buffer.data());
+
+                    std::vector<ASIOSampleType> inTypes(shared->numInputs, ASIOSTInt32LSB);
+                    std::vector<ASIOSampleType> outTypes(shared->numOutputs, ASIOSTInt32LSB);
+                    MixEngine engine;
+                    engine.configure(inTypes, outTypes, shared->routes, frames);
+                    int half = 0;
+                    return timeOp(options, [&] {
+                        engine.process(half, inPtrs.data(), outPtrs.data());
+                        half ^= 1;
+                    });
+                } });
+            }
+        }
+    }
+}
+
+// Channel names as SAR and typical interfaces report them
+static void makeChannelNames(int channels, std::vector<std::string>* inputs, std::vector<std::string>* outputs) {
+    static const char* endpoints[] = { "System", "Game", "Comms", "Music", "Browser", "Stream", "Alerts", "Voice" };
+    static const char* devices[] = { "Speakers", "Line Out", "HDMI", "Headphones", "Monitor", "S/PDIF Out" };
+    for (int ch = 0; ch < channels; ch++) {
+        inputs->push_back(std::string(endpoints[(ch / 2) % 8]) + " " + std::to_string(ch / 16) + (ch % 2 ? " R" : " L"));
+        outputs->push_back(std::string(devices[(ch / 2) % 6]) + " " + std::to_string(ch / 12) + (ch % 2 ? " R" : " L"));
+    }
+}
+
+static void addRouteCases(const BenchOptions& options, std::vector<BenchCase>& cases) {
+    // A large user rule file: names that never occur, so every channel
+    // still falls through to the built-ins' answers
+    auto manyRules = std::make_shared<RoutingRules>();
+    std::vector<RoutingRule> rules = manyRules->getRules();
+    for (int i = 0; i < 256; i++) {
+        RoutingRule rule;
+        rule.pattern = "device model " + std::to_string(i * 7919);
+        rule.priority = i % 4;
+        rules.push_back(rule);
+    }
+    manyRules->setRules(rules);
+    auto builtIn = std::make_shared<RoutingRules>();
+
+    for (int channels : { 8, 64, 256 }) {
+        auto inputs = std::make_shared<std::vector<std::string>>();
+        auto outputs = std::make_shared<std::vector<std::string>>();
+        makeChannelNames(channels, inputs.get(), outputs.get());
+        double names = 2.0 * channels;
+
+        for (auto set : { std::make_pair("classify", builtIn), std::make_pair("classify-256rules", manyRules) }) {
+            auto ruleSet = set.second;
+            cases.push_back({ { "route", set.first, 0, channels, 0.0, 0.0 }, names, [=] {
+                volatile int sink = 0;
+                return timeOp(options, [&] {
+                    for (const auto& name : *inputs) sink = sink + ruleSet->classify(name, true);
+                    for (const auto& name : *outputs) sink = sink + ruleSet->classify(name, false);
+                });
+            } });
+        }
+        cases.push_back({ { "route", "plan", 0, channels, 0.0, 0.0 }, names, [=] {
+            std::vector<ChannelRole> inputRoles, outputRoles;
+            return timeOp(options, [&] { builtIn->plan(*inputs, *outputs, &inputRoles, &outputRoles); });
+        } });
+    }
+}
+
+static void runCase(BenchCase& c) {
+    c.result.nsPerOp = c.measure();
+    c.result.nsPerUnit = c.result.nsPerOp / c.units;
+}
+
+static std::string caseKey(const BenchResult& r) {
+    return r.group + "/" + r.name + "/" + std::to_string(r.frames) + "/" + std::to_string(r.channels);
+}
+
+static const char* kCsvHeader = "group,case,frames,channels,ns_per_op,ns_per_unit";
+
+static bool writeCsv(const std::string& path, const std::vector<BenchResult>& results) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        return false;
+    }
+    fprintf(f, "%s\n", kCsvHeader);
+    for (const auto& r : results) {
+        fprintf(f, "%s,%s,%d,%d,%.3f,%.5f\n", r.group.c_str(), r.name.c_str(),
+                r.frames, r.channels, r.nsPerOp, r.nsPerUnit);
+    }
+    return fclose(f) == 0;
+}
+
+// Rows keyed by case. Lines that do not parse (the header, comments) are skipped.
+static bool readCsv(const std::string& path, std::map<std::string, BenchResult>* rows) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        return false;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char group[64], name[128];
+        BenchResult r;
+        if (sscanf(line, "%63[^,],%127[^,],%d,%d,%lf,%lf", group, name,
+                   &r.frames, &r.channels, &r.nsPerOp, &r.nsPerUnit) == 6) {
+            r.group = group;
+            r.name = name;
+            (*rows)[caseKey(r)] = r;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// Cases slower than the reference by more than the tolerance. A case over
+// the limit is measured again up to kRetries times and counts as a
+// regression only if every attempt is over, so one noisy run does not fail
+// the check.
+static const int kRetries = 3;
+
+static int checkRegressions(std::vector<BenchCase>& cases,
+                            const std::map<std::string, BenchResult>& reference, double tolerance) {
+    int regressions = 0, compared = 0;
+    for (auto& c : cases) {
+        auto it = reference.find(caseKey(c.result));
+        if (it == reference.end()) continue;
+        compared++;
+        double limit = it->second.nsPerUnit * (1.0 + tolerance);
+        double best = c.result.nsPerUnit;
+        for (int retry = 0; retry < kRetries && best > limit; retry++) {
+            runCase(c);
+            best = std::min(best, c.result.nsPerUnit);
+        }
+        c.result.nsPerUnit = best;
+        if (best > limit) {
+            printf("  REGRESSION %-40s %10.4f ns/unit, limit %.4f (+%.0f%%)\n", caseKey(c.result).c_str(),
+                   best, limit, (best / it->second.nsPerUnit - 1.0) * 100.0);
+            regressions++;
+        }
+    }
+    printf("Checked %d case(s) against the reference, tolerance %.0f%%: %d regression(s)\n",
+           compared, tolerance * 100.0, regressions);
+    return regressions;
+}
+
+static void usage() {
+    printf("Usage: engine_bench [--csv FILE] [--check FILE] [--tolerance F] [--quick]\n");
+}
+
+int main(int argc, char** argv) {
+    std::string csvPath, checkPath;
+    double tolerance = 0.25;
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--csv" && hasValue) csvPath = argv[++i];
+        else if (arg == "--check" && hasValue) checkPath = argv[++i];
+        else if (arg == "--tolerance" && hasValue) tolerance = atof(argv[++i]);
+        else if (arg == "--quick") {
+            options.batchMs = 0.5;
+            options.batches = 5;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    // Read the reference first so a bad path fails before the run
+    std::map<std::string, BenchResult> reference;
+    if (!checkPath.empty() && !readCsv(checkPath, &reference)) {
+        printf("Cannot read %s\n", checkPath.c_str());
+        return 2;
+    }
+
+    std::mt19937 rng(11);
+    std::vector<BenchCase> cases;
+    addConvertCases(options, rng, cases);
+    addMixCases(options, rng, cases);
+    addRouteCases(options, cases);
+
+    printf("Engine benchmarks at %s, Int32LSB mixes\n\n", getSimdLevelName(getSimdLevel()));
+    std::vector<BenchResult> results;
+    for (auto& c : cases) {
+        runCase(c);
+        results.push_back(c.result);
+    }
+
+    // Units: convert = sample, plan = route, mix = cell-sample, route = channel name
+    printf("  %-8s %-22s %6s %8s %12s %12s\n", "group", "case", "frames", "channels", "ns/op", "ns/unit");
+    for (const auto& r : results) {
+        printf("  %-8s %-22s %6d %8d %12.1f %12.4f\n", r.group.c_str(), r.name.c_str(),
+               r.frames, r.channels, r.nsPerOp, r.nsPerUnit);
+    }
+
+    if (!csvPath.empty()) {
+        if (!writeCsv(csvPath, results)) {
+            printf("Cannot write %s\n", csvPath.c_str());
+            return 2;
+        }
+        printf("\nWrote %zu rows to %s\n", results.size(), csvPath.c_str());
+    }
+    if (!checkPath.empty()) {
+        printf("\n");
+        return checkRegressions(cases, reference, tolerance) ? 1 : 0;
+    }
+    return 0;
+}
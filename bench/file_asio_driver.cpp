@@ -0,0 +1,265 @@
+#include "file_asio_driver.h"
+#include "../src/sample_convert.h"
+#include <cstring>
+
+FileAsioDriver::FileAsioDriver(const FileDriverConfig& cfg) : config(cfg) {
+    for (const auto& ch : config.inputs) {
+        inputBytes.push_back(getSampleBytes(ch.type));
+        inputFrameBytes += inputBytes.back();
+    }
+    for (const auto& ch : config.outputs) {
+        outputBytes.push_back(getSampleBytes(ch.type));
+        outputFrameBytes += outputBytes.back();
+    }
+}
+
+FileAsioDriver::~FileAsioDriver() {
+    disposeBuffers();
+}
+
+HRESULT STDMETHODCALLTYPE FileAsioDriver::QueryInterface(REFIID, void** object) {
+    if (object) *object = nullptr;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE FileAsioDriver::AddRef() {
+    return ++refCount;
+}
+
+ULONG STDMETHODCALLTYPE FileAsioDriver::Release() {
+    ULONG count = --refCount;
+    if (count == 0) {
+        delete this;
+    }
+    return count;
+}
+
+long FileAsioDriver::init(void*) {
+    return 1;
+}
+
+void FileAsioDriver::getDriverName(char* name) {
+    strncpy(name, config.name.c_str(), 31);
+    name[31] = '\0';
+}
+
+long FileAsioDriver::getDriverVersion() {
+    return 1;
+}
+
+void FileAsioDriver::getErrorMessage(char* string) {
+    string[0] = '\0';
+}
+
+ASIOError FileAsioDriver::start() {
+    if (!callbacks) {
+        return ASE_InvalidMode;
+    }
+    running = true;
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::stop() {
+    running = false;
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::getChannels(long* numInputChannels, long* numOutputChannels) {
+    *numInputChannels = (long)config.inputs.size();
+    *numOutputChannels = (long)config.outputs.size();
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::getLatencies(long* inputLatency, long* outputLatency) {
+    *inputLatency = config.bufferSize;
+    *outputLatency = config.bufferSize;
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::getBufferSize(long* minSize, long* maxSize, long* preferredSize, long* granularity) {
+    // Only the configured size, so the host cannot pick another
+    *minSize = config.bufferSize;
+    *maxSize = config.bufferSize;
+    *preferredSize = config.bufferSize;
+    *granularity = 0;
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::canSampleRate(double rate) {
+    return rate == config.sampleRate ? ASE_OK : ASE_NoClock;
+}
+
+ASIOError FileAsioDriver::getSampleRate(double* rate) {
+    *rate = config.sampleRate;
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::setSampleRate(double rate) {
+    return rate == config.sampleRate ? ASE_OK : ASE_NoClock;
+}
+
+ASIOError FileAsioDriver::getClockSources(ASIOClockSource* clocks, long* numSources) {
+    if (*numSources > 0) {
+        memset(clocks, 0, sizeof(ASIOClockSource));
+        clocks->associatedChannel = -1;
+        clocks->associatedGroup = -1;
+        clocks->isCurrentSource = 1;
+        strcpy(clocks->name, "File");
+        *numSources = 1;
+    }
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::setClockSource(long reference) {
+    return reference == 0 ? ASE_OK : ASE_InvalidParameter;
+}
+
+ASIOError FileAsioDriver::getSamplePosition(ASIOSamples* sPos, ASIOTimeStamp* tStamp) {
+    asioFromInt64(samplePosition, &sPos->hi, &sPos->lo);
+    asioFromInt64((long long)(samplePosition / config.sampleRate * 1e9), &tStamp->hi, &tStamp->lo);
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::getChannelInfo(ASIOChannelInfo* info) {
+    const std::vector<FileChannel>& channels = info->isInput ? config.inputs : config.outputs;
+    if (info->channel < 0 || info->channel >= (long)channels.size()) {
+        return ASE_InvalidParameter;
+    }
+    const FileChannel& ch = channels[info->channel];
+    info->isActive = callbacks != nullptr;
+    info->channelGroup = 0;
+    info->type = ch.type;
+    strncpy(info->name, ch.name.c_str(), 31);
+    info->name[31] = '\0';
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::createBuffers(ASIOBufferInfo* bufferInfos, long numChannels,
+                                        long size, ASIOCallbacks* cbs) {
+    if (size != config.bufferSize || !cbs) {
+        return ASE_InvalidMode;
+    }
+    disposeBuffers();
+    inputStorage.assign(config.inputs.size(), std::vector<uint8_t>());
+    outputStorage.assign(config.outputs.size(), std::vector<uint8_t>());
+
+    for (long i = 0; i < numChannels; i++) {
+        ASIOBufferInfo& info = bufferInfos[i];
+        const std::vector<FileChannel>& channels = info.isInput ? config.inputs : config.outputs;
+        if (info.channelNum < 0 || info.channelNum >= (long)channels.size()) {
+            disposeBuffers();
+            return ASE_InvalidParameter;
+        }
+        std::vector<uint8_t>& storage = info.isInput ? inputStorage[info.channelNum]
+                                                     : outputStorage[info.channelNum];
+        int bytes = getSampleBytes(channels[info.channelNum].type) * size;
+        storage.assign(bytes * 2, 0);
+        info.buffers[0] = storage.data();
+        info.buffers[1] = storage.data() + bytes;
+    }
+    callbacks = cbs;
+    nextHalf = 0;
+    samplePosition = 0;
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::disposeBuffers() {
+    inputStorage.clear();
+    outputStorage.clear();
+    callbacks = nullptr;
+    return ASE_OK;
+}
+
+ASIOError FileAsioDriver::controlPanel() {
+    return ASE_NotPresent;
+}
+
+ASIOError FileAsioDriver::future(long, void*) {
+    return ASE_InvalidParameter;
+}
+
+ASIOError FileAsioDriver::outputReady() {
+    return ASE_OK;
+}
+
+// Copy one channel between an interleaved stream and a planar buffer
+static void gatherChannel(const uint8_t* interleaved, int frameBytes, int sampleBytes,
+                          uint8_t* planar, int frames) {
+    switch (sampleBytes) {
+        case 2:
+            for (int i = 0; i < frames; i++) memcpy(planar + i * 2, interleaved + (size_t)i * frameBytes, 2);
+            break;
+        case 3:
+            for (int i = 0; i < frames; i++) memcpy(planar + i * 3, interleaved + (size_t)i * frameBytes, 3);
+            break;
+        case 4:
+            for (int i = 0; i < frames; i++) memcpy(planar + i * 4, interleaved + (size_t)i * frameBytes, 4);
+            break;
+        default:
+            for (int i = 0; i < frames; i++) {
+                memcpy(planar + i * sampleBytes, interleaved + (size_t)i * frameBytes, sampleBytes);
+            }
+            break;
+    }
+}
+
+static void scatterChannel(const uint8_t* planar, int sampleBytes,
+                           uint8_t* interleaved, int frameBytes, int frames) {
+    switch (sampleBytes) {
+        case 2:
+            for (int i = 0; i < frames; i++) memcpy(interleaved + (size_t)i * frameBytes, planar + i * 2, 2);
+            break;
+        case 3:
+            for (int i = 0; i < frames; i++) memcpy(interleaved + (size_t)i * frameBytes, planar + i * 3, 3);
+            break;
+        case 4:
+            for (int i = 0; i < frames; i++) memcpy(interleaved + (size_t)i * frameBytes, planar + i * 4, 4);
+            break;
+        default:
+            for (int i = 0; i < frames; i++) {
+                memcpy(interleaved + (size_t)i * frameBytes, planar + i * sampleBytes, sampleBytes);
+            }
+            break;
+    }
+}
+
+bool FileAsioDriver::processBlock(const uint8_t* input, int frames, uint8_t* output) {
+    if (!running || !callbacks || frames <= 0 || frames > config.bufferSize) {
+        return false;
+    }
+    int half = nextHalf;
+    nextHalf ^= 1;
+
+    int offset = 0;
+    for (size_t ch = 0; ch < inputStorage.size(); ch++) {
+        int bytes = inputBytes[ch];
+        uint8_t* planar = inputStorage[ch].data() + (size_t)half * bytes * config.bufferSize;
+        gatherChannel(input + offset, inputFrameBytes, bytes, planar, frames);
+        if (frames < config.bufferSize) {
+            memset(planar + (size_t)frames * bytes, 0, (size_t)(config.bufferSize - frames) * bytes);
+        }
+        offset += bytes;
+    }
+
+    if (callbacks->bufferSwitchTimeInfo) {
+        long long systemNs = (long long)(samplePosition / config.sampleRate * 1e9);
+        time.timeInfo.speed = 1.0;
+        asioFromInt64(systemNs, &time.timeInfo.systemTime.hi, &time.timeInfo.systemTime.lo);
+        asioFromInt64(samplePosition, &time.timeInfo.samplePosition.hi, &time.timeInfo.samplePosition.lo);
+        time.timeInfo.sampleRate = config.sampleRate;
+        time.timeInfo.flags = kSystemTimeValid | kSamplePositionValid | kSampleRateValid;
+        callbacks->bufferSwitchTimeInfo(&time, half, 1);
+    } else {
+        callbacks->bufferSwitch(half, 1);
+    }
+    samplePosition += config.bufferSize;
+
+    offset = 0;
+    for (size_t ch = 0; ch < outputStorage.size(); ch++) {
+        int bytes = outputBytes[ch];
+        const uint8_t* planar = outputStorage[ch].data() + (size_t)half * bytes * config.bufferSize;
+        scatterChannel(planar, bytes, output + offset, outputFrameBytes, frames);
+        offset += bytes;
+    }
+    return true;
+}
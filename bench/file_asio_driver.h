@@ -0,0 +1,92 @@
+#pragma once
+
+// IASIO driver whose "hardware" is a pair of interleaved sample streams,
+// for rendering files through ASIOHost offline.
+//
+// The caller steps it one block at a time with processBlock(): the block's
+// input frames are de-interleaved into the current buffer half, the host's
+// bufferSwitchTimeInfo runs exactly as it would on a real driver, and the
+// output half is interleaved back. There is no clock; blocks run as fast
+// as the host returns. ASIOTime carries the sample position and a system
+// time derived from it, so the host sees a perfect clock.
+
+#include "../src/asio_iface.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct FileChannel {
+    std::string name;
+    ASIOSampleType type;
+};
+
+struct FileDriverConfig {
+    std::string name = "Offline Render";
+    std::vector<FileChannel> inputs;
+    std::vector<FileChannel> outputs;
+    long bufferSize = 256;
+    double sampleRate = 48000.0;
+};
+
+class FileAsioDriver final : public IASIO {
+public:
+    explicit FileAsioDriver(const FileDriverConfig& config);
+
+    // IUnknown. Starts with one reference, owned by whoever attaches it.
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** object) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    // IASIO
+    long init(void* sysHandle) override;
+    void getDriverName(char* name) override;
+    long getDriverVersion() override;
+    void getErrorMessage(char* string) override;
+    ASIOError start() override;
+    ASIOError stop() override;
+    ASIOError getChannels(long* numInputChannels, long* numOutputChannels) override;
+    ASIOError getLatencies(long* inputLatency, long* outputLatency) override;
+    ASIOError getBufferSize(long* minSize, long* maxSize, long* preferredSize, long* granularity) override;
+    ASIOError canSampleRate(double sampleRate) override;
+    ASIOError getSampleRate(double* sampleRate) override;
+    ASIOError setSampleRate(double sampleRate) override;
+    ASIOError getClockSources(ASIOClockSource* clocks, long* numSources) override;
+    ASIOError setClockSource(long reference) override;
+    ASIOError getSamplePosition(ASIOSamples* sPos, ASIOTimeStamp* tStamp) override;
+    ASIOError getChannelInfo(ASIOChannelInfo* info) override;
+    ASIOError createBuffers(ASIOBufferInfo* bufferInfos, long numChannels, long bufferSize, ASIOCallbacks* callbacks) override;
+    ASIOError disposeBuffers() override;
+    ASIOError controlPanel() override;
+    ASIOError future(long selector, void* opt) override;
+    ASIOError outputReady() override;
+
+    // Run one block. input holds frames interleaved input frames (frames
+    // <= buffer size; a short last block is padded with silence), and
+    // output receives frames interleaved output frames.
+    bool processBlock(const uint8_t* input, int frames, uint8_t* output);
+
+    // Bytes in one interleaved frame
+    int getInputFrameBytes() const { return inputFrameBytes; }
+    int getOutputFrameBytes() const { return outputFrameBytes; }
+
+private:
+    ~FileAsioDriver();  // Deleted by the last Release()
+
+    FileDriverConfig config;
+    std::atomic<ULONG> refCount{1};
+    bool running = false;
+
+    // storage[channel] holds both buffer halves back to back
+    std::vector<std::vector<uint8_t>> inputStorage;
+    std::vector<std::vector<uint8_t>> outputStorage;
+    std::vector<int> inputBytes;        // Per sample, per channel
+    std::vector<int> outputBytes;
+    int inputFrameBytes = 0;
+    int outputFrameBytes = 0;
+    ASIOCallbacks* callbacks = nullptr;
+
+    int nextHalf = 0;
+    long long samplePosition = 0;
+    ASIOTime time = {};
+};
@@ -0,0 +1,522 @@
+// Gain-matrix mix check and benchmark.
+//
+// Builds dense (every input to every output) and sparse (each input to one
+// output) matrices at 8, 64 and 256 channels, plus a 16-endpoint stereo
+// downmix. Each plan is checked bit for bit against a per-cell scalar
+// reference, then timed at every SIMD level. A last pass swaps plans from
+// a control thread while another thread mixes, as the host does for live
+// routing changes. Mute, solo and gain changes are then ramped and checked
+// for steps, and for landing back on the bit-exact plan, and a route added
+// and dropped again as fast as plans can be swapped must not step either.
+// Then the dense matrices are mixed serially and on a worker pool to find
+// the channel count where parallel mixing starts to pay off. Returns
+// non-zero on mismatch.
+
+#include "../src/mix_engine.h"
+#include "../src/sample_format.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct MixCase {
+    const char* name;
+    int numInputs;
+    int numOutputs;
+    RoutingMatrix matrix;
+};
+
+static MixCase makeDense(int channels, std::mt19937& rng) {
+    // Gains sum to about 1 per output so the bus stays in range
+    std::uniform_real_distribution<float> dist(0.1f, 1.9f);
+    MixCase c = { "dense", channels, channels, RoutingMatrix() };
+    for (int out = 0; out < channels; out++) {
+        for (int in = 0; in < channels; in++) {
+            c.matrix.setGain(in, out, dist(rng) / channels);
+        }
+    }
+    return c;
+}
+
+static MixCase makeSparse(int channels, std::mt19937& rng) {
+    std::uniform_real_distribution<float> dist(0.25f, 1.0f);
+    MixCase c = { "sparse", channels, channels, RoutingMatrix() };
+    for (int in = 0; in < channels; in++) {
+        // Pairs swap sides at varying levels; every fourth input is unity
+        int out = in ^ 1;
+        c.matrix.setGain(in, out, (in % 4 == 0) ? 1.0f : dist(rng));
+    }
+    return c;
+}
+
+static MixCase makeDownmix(std::mt19937& rng) {
+    std::uniform_real_distribution<float> dist(0.05f, 0.5f);
+    MixCase c = { "downmix", 16, 2, RoutingMatrix() };
+    for (int in = 0; in < 16; in++) {
+        c.matrix.setGain(in, in & 1, dist(rng));
+    }
+    return c;
+}
+
+// Per-cell reference in the mixer's summation order. A lone unity-gain
+// cell is a plain copy, as in the mixer (no float round trip).
+static void referenceMix(const MixCase& c, const std::vector<std::vector<int32_t>>& inputs,
+                         std::vector<std::vector<int32_t>>& outputs, int bufferSize) {
+    typedef SampleTraits<ASIOSTInt32LSB> Traits;
+    std::vector<float> bus(bufferSize);
+    for (int out = 0; out < c.numOutputs; out++) {
+        std::vector<ChannelRoute> cells;
+        for (const auto& cell : c.matrix.getCells()) {
+            if (cell.outputChannel == out) cells.push_back(cell);
+        }
+        if (cells.size() == 1 && cells[0].gain == 1.0f) {
+            outputs[out] = inputs[cells[0].inputChannel];
+            continue;
+        }
+
+        bool first = true;
+        for (const auto& cell : cells) {
+            const void* src = inputs[cell.inputChannel].data();
+            for (int i = 0; i < bufferSize; i++) {
+                float v = Traits::load(src, i);
+                if (cell.gain != 1.0f) v *= cell.gain;
+                bus[i] = first ? v : bus[i] + v;
+            }
+            first = false;
+        }
+        if (first) {
+            std::fill(outputs[out].begin(), outputs[out].end(), 0);
+            continue;
+        }
+        for (int i = 0; i < bufferSize; i++) {
+            Traits::store(clampSample(bus[i]), outputs[out].data(), i);
+        }
+    }
+}
+
+// Swap between dense and sparse plans while a second thread keeps mixing.
+// Checks the mixer settles on the last plan and reports the swap rate.
+// With ramps on, the mixer gets blocks enough to finish its fades before the
+// check.
+static int liveUpdateCheck(int channels, int bufferSize, std::mt19937& rng, int workers = 0, int rampFrames = 0) {
+    MixCase dense = makeDense(channels, rng);
+    MixCase sparse = makeSparse(channels, rng);
+
+    std::uniform_int_distribution<int32_t> dist(-(1 << 28), 1 << 28);
+    std::vector<std::vector<int32_t>> in(channels, std::vector<int32_t>(bufferSize));
+    std::vector<std::vector<int32_t>> out(channels, std::vector<int32_t>(bufferSize));
+    std::vector<std::vector<int32_t>> ref(channels, std::vector<int32_t>(bufferSize));
+    for (auto& buffer : in) {
+        for (auto& s : buffer) s = dist(rng);
+    }
+    std::vector<void*> inPtrs, outPtrs;
+    for (auto& buffer : in) inPtrs.push_back(buffer.data());
+    for (auto& buffer : out) outPtrs.push_back(buffer.data());
+
+    std::vector<ASIOSampleType> types(channels, ASIOSTInt32LSB);
+    MixEngine engine;
+    engine.setWorkers(workers, 0.0);
+    engine.setRamp(rampFrames);
+    engine.configure(types, types, sparse.matrix.getCells(), bufferSize);
+
+    std::atomic<bool> stop(false);
+    std::atomic<long long> blocks(0);
+    std::thread audio([&]() {
+        while (!stop.load(std::memory_order_relaxed)) {
+            engine.process(0, inPtrs.data(), outPtrs.data());
+            blocks.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    const int swaps = 2000;
+    int maxRetired = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < swaps; i++) {
+        engine.setRoutes((i & 1) ? dense.matrix.getCells() : sparse.matrix.getCells());
+        maxRetired = std::max(maxRetired, engine.getRetiredCount());
+    }
+    auto end = std::chrono::steady_clock::now();
+    stop.store(true);
+    audio.join();
+    engine.reclaim();
+
+    // Last swap installed the dense plan; once any fades are done a block
+    // must match it
+    for (int settle = 0; settle <= rampFrames / bufferSize + 1; settle++) {
+        engine.process(0, inPtrs.data(), outPtrs.data());
+    }
+    referenceMix(dense, in, ref, bufferSize);
+    int failures = 0;
+    for (int ch = 0; ch < channels; ch++) {
+        if (memcmp(out[ch].data(), ref[ch].data(), bufferSize * sizeof(int32_t)) != 0) {
+            printf("  MISMATCH live update %dx%d output %d\n", channels, channels, ch);
+            failures++;
+            break;
+        }
+    }
+    if (engine.getRetiredCount() != 0) {
+        printf("  LEAK live update: %d plan(s) still retired\n", engine.getRetiredCount());
+        failures++;
+    }
+
+    double us = std::chrono::duration<double, std::micro>(end - begin).count();
+    printf("  %dx%d, %d worker(s)%s: %d swaps, %.1f us/swap, %lld blocks mixed meanwhile, max %d retired\n",
+           channels, channels, workers, rampFrames ? ", ramped" : "", swaps, us / swaps, blocks.load(), maxRetired);
+    return failures;
+}
+
+// Run blocks of a constant 0.5 on every input and append each output's
+// samples to its trace
+static void traceBlocks(MixEngine& engine, int channels, int bufferSize, int blocks,
+                        std::vector<std::vector<float>>& trace) {
+    std::vector<std::vector<float>> in(channels, std::vector<float>(bufferSize, 0.5f));
+    std::vector<std::vector<float>> out(channels, std::vector<float>(bufferSize));
+    std::vector<void*> inPtrs, outPtrs;
+    for (auto& buffer : in) inPtrs.push_back(buffer.data());
+    for (auto& buffer : out) outPtrs.push_back(buffer.data());
+    trace.resize(channels);
+    for (int block = 0; block < blocks; block++) {
+        engine.process(block & 1, inPtrs.data(), outPtrs.data());
+        for (int ch = 0; ch < channels; ch++) {
+            trace[ch].insert(trace[ch].end(), out[ch].begin(), out[ch].end());
+        }
+    }
+}
+
+// Largest step between neighbouring samples
+static float largestStep(const std::vector<float>& trace) {
+    float largest = 0.0f;
+    for (size_t i = 1; i < trace.size(); i++) {
+        largest = std::max(largest, std::fabs(trace[i] - trace[i - 1]));
+    }
+    return largest;
+}
+
+// Mute, solo and gain changes ramp without steps, and a bus whose ramp is
+// done is mixed exactly as if the gains had always been there
+static int rampCheck(int bufferSize, std::mt19937& rng) {
+    int failures = 0;
+    const int rampFrames = 1000;
+    const float stepLimit = 0.5f / rampFrames * 1.01f;
+
+    // Two Float32 channels straight through; a constant input makes the
+    // output trace the gain
+    std::vector<ASIOSampleType> floats(2, ASIOSTFloat32LSB);
+    std::vector<ChannelRoute> straight = { { 0, 0, 1.0f }, { 1, 1, 1.0f } };
+    MixEngine engine;
+    engine.setRamp(rampFrames);
+    engine.configure(floats, floats, straight, bufferSize);
+    int blocks = rampFrames / bufferSize + 2;
+
+    MixControls controls;
+    controls.routes.push_back({ 0, 0, true, false });
+    engine.setControls(controls);
+    std::vector<std::vector<float>> trace;
+    traceBlocks(engine, 2, bufferSize, blocks, trace);
+    float step = largestStep(trace[0]);
+    bool ok = trace[0].back() == 0.0f && step <= stepLimit && trace[1].front() == 0.5f && trace[1].back() == 0.5f;
+    printf("  route mute:   largest step %.6f (limit %.6f), ends at %g  %s\n", step, stepLimit, trace[0].back(),
+           ok ? "ok" : "FAILED");
+    failures += ok ? 0 : 1;
+
+    // Soloing output 0 (now unmuted) brings it back and fades output 1 out
+    controls.routes.clear();
+    controls.outputs.resize(2);
+    controls.outputs[0].soloed = true;
+    engine.setControls(controls);
+    trace.clear();
+    traceBlocks(engine, 2, bufferSize, blocks, trace);
+    step = std::max(largestStep(trace[0]), largestStep(trace[1]));
+    ok = trace[0].back() == 0.5f && trace[1].back() == 0.0f && step <= stepLimit;
+    printf("  output solo:  largest step %.6f, ends at %g / %g  %s\n", step, trace[0].back(), trace[1].back(),
+           ok ? "ok" : "FAILED");
+    failures += ok ? 0 : 1;
+
+    // An equal-power fade-in is at -3 dB halfway
+    engine.setRamp(rampFrames, RampEqualPower);
+    controls.outputs[0].soloed = false;
+    engine.setControls(controls);
+    trace.clear();
+    traceBlocks(engine, 2, bufferSize, blocks, trace);
+    float half = trace[1][rampFrames / 2] / 0.5f;
+    ok = std::fabs(half - std::sqrt(0.5f)) < 1e-3f && trace[1].back() == 0.5f;
+    printf("  equal power:  gain %.4f halfway (expect %.4f)  %s\n", half, std::sqrt(0.5f), ok ? "ok" : "FAILED");
+    failures += ok ? 0 : 1;
+
+    // Output gain and mute on a dense Int32 matrix: once the ramps are done
+    // the outputs match the reference bit for bit, on the same paths as a
+    // plan that never ramped
+    const int channels = 16;
+    MixCase dense = makeDense(channels, rng);
+    std::uniform_int_distribution<int32_t> dist(-(1 << 28), 1 << 28);
+    std::vector<std::vector<int32_t>> in(channels, std::vector<int32_t>(bufferSize));
+    std::vector<std::vector<int32_t>> out(channels, std::vector<int32_t>(bufferSize));
+    std::vector<std::vector<int32_t>> ref(channels, std::vector<int32_t>(bufferSize));
+    for (auto& buffer : in) {
+        for (auto& s : buffer) s = dist(rng);
+    }
+    std::vector<void*> inPtrs, outPtrs;
+    for (auto& buffer : in) inPtrs.push_back(buffer.data());
+    for (auto& buffer : out) outPtrs.push_back(buffer.data());
+    std::vector<ASIOSampleType> ints(channels, ASIOSTInt32LSB);
+
+    MixEngine ramped;
+    ramped.setRamp(bufferSize / 2);
+    ramped.configure(ints, ints, dense.matrix.getCells(), bufferSize);
+    MixControls denseControls;
+    denseControls.outputs.resize(channels);
+    denseControls.outputs[3].muted = true;
+    denseControls.outputs[5].gain = 0.5f;
+    ramped.setControls(denseControls);
+    ramped.process(0, inPtrs.data(), outPtrs.data());
+    denseControls.outputs[3].muted = false;
+    denseControls.outputs[5].gain = 1.0f;
+    ramped.setControls(denseControls);
+    for (int block = 0; block < 4; block++) {
+        ramped.process(block & 1, inPtrs.data(), outPtrs.data());
+    }
+    referenceMix(dense, in, ref, bufferSize);
+    ok = true;
+    for (int ch = 0; ch < channels; ch++) {
+        if (memcmp(out[ch].data(), ref[ch].data(), bufferSize * sizeof(int32_t)) != 0) {
+            ok = false;
+        }
+    }
+    MixEngine instant;
+    instant.configure(ints, ints, dense.matrix.getCells(), bufferSize);
+    MixPathCounts rampedCounts = ramped.getPathCounts();
+    MixPathCounts instantCounts = instant.getPathCounts();
+    ok = ok && memcmp(&rampedCounts, &instantCounts, sizeof(MixPathCounts)) == 0;
+    printf("  settled:      %dx%d after mute and gain ramps %s\n", channels, channels,
+           ok ? "matches the reference" : "FAILED");
+    failures += ok ? 0 : 1;
+    return failures;
+}
+
+// Route input 0 to output 0 and drop it again, as fast as the control
+// thread can, while a second thread mixes a constant input, pausing
+// between blocks as a driver does, and traces the output. A plan can be replaced before the mixer has played it, and its
+// fades must still carry over, so no two samples may be further apart than
+// the ramp allows. Other inputs feed the remaining outputs so that building
+// a plan takes long enough for the mixer to run in the middle of it.
+static int rapidRouteCheck(int bufferSize) {
+    const int channels = 64;
+    const int rampFrames = 1000;
+    const float stepLimit = 0.5f / rampFrames * 1.01f;
+    std::vector<ChannelRoute> without;
+    for (int out = 1; out < channels; out++) {
+        for (int in = 0; in < channels; in++) {
+            without.push_back({ in, out, 1.0f / channels });
+        }
+    }
+    std::vector<ChannelRoute> with = without;
+    with.push_back({ 0, 0, 1.0f });
+
+    std::vector<ASIOSampleType> floats(channels, ASIOSTFloat32LSB);
+    std::vector<std::vector<float>> in(channels, std::vector<float>(bufferSize, 0.5f));
+    std::vector<std::vector<float>> out(channels, std::vector<float>(bufferSize));
+    std::vector<void*> inPtrs, outPtrs;
+    for (auto& buffer : in) inPtrs.push_back(buffer.data());
+    for (auto& buffer : out) outPtrs.push_back(buffer.data());
+    MixEngine engine;
+    engine.setRamp(rampFrames);
+    engine.configure(floats, floats, without, bufferSize);
+
+    const size_t maxFrames = (size_t)1 << 24;
+    std::vector<float> trace;
+    trace.reserve(maxFrames);
+    std::atomic<bool> stop(false);
+    std::thread audio([&]() {
+        while (!stop.load(std::memory_order_relaxed) && trace.size() + bufferSize <= maxFrames) {
+            engine.process(0, inPtrs.data(), outPtrs.data());
+            trace.insert(trace.end(), out[0].begin(), out[0].end());
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+    const int changes = 4000;
+    for (int i = 0; i < changes; i++) {
+        engine.setRoutes((i & 1) ? without : with);
+    }
+    stop.store(true);
+    audio.join();
+    engine.reclaim();
+
+    float step = largestStep(trace);
+    bool ok = step <= stepLimit;
+    printf("  rapid routes: %d changes over %zu blocks, largest step %.6f (limit %.6f)  %s\n", changes,
+           trace.size() / bufferSize, step, stepLimit, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+// Median time of one block, with a pause before each so the workers have
+// gone to sleep, as they do between real buffer periods
+static double timeBlocks(MixEngine& engine, void* const* inputs, void* const* outputs, int blocks) {
+    std::vector<double> times;
+    for (int i = 0; i < blocks; i++) {
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        auto begin = std::chrono::steady_clock::now();
+        engine.process(i & 1, inputs, outputs);
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+    }
+    std::nth_element(times.begin(), times.begin() + blocks / 2, times.end());
+    return times[blocks / 2];
+}
+
+// Dense matrices mixed serially and in parallel. Checks the parallel mix
+// is bit-identical and prints where it starts to win.
+static int parallelCrossover(int bufferSize, std::mt19937& rng) {
+    int cores = WorkerPool::getCoreCount();
+    int workers = std::max(1, std::min(3, cores - 1));
+    printf("\nParallel mixing, %d worker(s) on %d core(s), dense Int32LSB, %d frames:\n",
+           workers, cores, bufferSize);
+    printf("  %8s %12s %8s %12s %12s %8s\n",
+           "channels", "cost/block", "groups", "serial us", "parallel us", "speedup");
+
+    int failures = 0;
+    int crossover = 0;
+    for (int channels : { 8, 16, 32, 64, 128, 256 }) {
+        MixCase c = makeDense(channels, rng);
+        std::uniform_int_distribution<int32_t> dist(-(1 << 28), 1 << 28);
+        std::vector<std::vector<int32_t>> in(channels, std::vector<int32_t>(bufferSize));
+        std::vector<std::vector<int32_t>> serialOut(channels, std::vector<int32_t>(bufferSize));
+        std::vector<std::vector<int32_t>> parallelOut(channels, std::vector<int32_t>(bufferSize));
+        for (auto& buffer : in) {
+            for (auto& s : buffer) s = dist(rng);
+        }
+        std::vector<void*> inPtrs, serialPtrs, parallelPtrs;
+        for (auto& buffer : in) inPtrs.push_back(buffer.data());
+        for (auto& buffer : serialOut) serialPtrs.push_back(buffer.data());
+        for (auto& buffer : parallelOut) parallelPtrs.push_back(buffer.data());
+        std::vector<ASIOSampleType> types(channels, ASIOSTInt32LSB);
+
+        MixEngine serial;
+        serial.configure(types, types, c.matrix.getCells(), bufferSize);
+        MixEngine parallel;
+        parallel.setWorkers(workers, 0.0);  // Split regardless of cost
+        parallel.configure(types, types, c.matrix.getCells(), bufferSize);
+
+        serial.process(0, inPtrs.data(), serialPtrs.data());
+        parallel.process(0, inPtrs.data(), parallelPtrs.data());
+        for (int ch = 0; ch < channels; ch++) {
+            if (memcmp(serialOut[ch].data(), parallelOut[ch].data(), bufferSize * sizeof(int32_t)) != 0) {
+                printf("  MISMATCH parallel %dx%d output %d\n", channels, channels, ch);
+                failures++;
+                break;
+            }
+        }
+
+        int blocks = channels >= 128 ? 60 : 200;
+        double serialUs = timeBlocks(serial, inPtrs.data(), serialPtrs.data(), blocks);
+        double parallelUs = timeBlocks(parallel, inPtrs.data(), parallelPtrs.data(), blocks);
+        if (parallelUs < serialUs) {
+            if (!crossover) crossover = channels;
+        } else {
+            crossover = 0;
+        }
+        printf("  %8d %12.0f %8d %12.1f %12.1f %7.2fx\n", channels, parallel.estimateCost(),
+               parallel.getPathCounts().partitions, serialUs, parallelUs, serialUs / parallelUs);
+    }
+
+    if (cores < 2) {
+        printf("  Single core: parallel timings only show the hand-off overhead\n");
+    } else if (crossover) {
+        printf("  Parallel mixing pays off from %d channels (default threshold: cost %.0f)\n",
+               crossover, MixEngine::kParallelMinCost);
+    } else {
+        printf("  Parallel mixing did not pay off at any size on this machine\n");
+    }
+    return failures;
+}
+
+int main() {
+    const int bufferSize = 256;
+    std::mt19937 rng(7);
+
+    std::vector<MixCase> cases;
+    for (int channels : { 8, 64, 256 }) {
+        cases.push_back(makeDense(channels, rng));
+        cases.push_back(makeSparse(channels, rng));
+    }
+    cases.push_back(makeDownmix(rng));
+
+    SimdLevel maxLevel = detectSimdLevel();
+    printf("Detected SIMD level: %s, buffer size %d, Int32LSB\n\n", getSimdLevelName(maxLevel), bufferSize);
+    printf("  %-8s %5s %5s %7s %-6s %12s %14s\n",
+           "matrix", "in", "out", "cells", "level", "us/block", "ns/cell-sample");
+
+    int failures = 0;
+    for (const auto& c : cases) {
+        std::uniform_int_distribution<int32_t> dist(-(1 << 28), 1 << 28);
+        std::vector<std::vector<int32_t>> in(c.numInputs, std::vector<int32_t>(bufferSize));
+        std::vector<std::vector<int32_t>> out(c.numOutputs, std::vector<int32_t>(bufferSize));
+        std::vector<std::vector<int32_t>> ref(c.numOutputs, std::vector<int32_t>(bufferSize));
+        for (auto& buffer : in) {
+            for (auto& s : buffer) s = dist(rng);
+        }
+        std::vector<void*> inPtrs, outPtrs;
+        for (auto& buffer : in) inPtrs.push_back(buffer.data());
+        for (auto& buffer : out) outPtrs.push_back(buffer.data());
+
+        referenceMix(c, in, ref, bufferSize);
+
+        std::vector<ASIOSampleType> inTypes(c.numInputs, ASIOSTInt32LSB);
+        std::vector<ASIOSampleType> outTypes(c.numOutputs, ASIOSTInt32LSB);
+
+        for (int level = SimdScalar; level <= maxLevel; level++) {
+            setSimdLevel((SimdLevel)level);
+            MixEngine engine;
+            engine.configure(inTypes, outTypes, c.matrix.getCells(), bufferSize);
+
+            engine.process(0, inPtrs.data(), outPtrs.data());
+            for (int ch = 0; ch < c.numOutputs; ch++) {
+                if (memcmp(out[ch].data(), ref[ch].data(), bufferSize * sizeof(int32_t)) != 0) {
+                    printf("  MISMATCH %s %dx%d %s output %d\n", c.name, c.numInputs, c.numOutputs,
+                           getSimdLevelName((SimdLevel)level), ch);
+                    failures++;
+                    break;
+                }
+            }
+
+            // Aim for roughly the same amount of work per case
+            long long cellSamples = (long long)c.matrix.size() * bufferSize;
+            int iterations = (int)std::max(20LL, 50000000LL / cellSamples);
+
+            auto begin = std::chrono::steady_clock::now();
+            for (int it = 0; it < iterations; it++) {
+                engine.process(it & 1, inPtrs.data(), outPtrs.data());
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+
+            printf("  %-8s %5d %5d %7d %-6s %12.2f %14.3f\n", c.name, c.numInputs, c.numOutputs,
+                   c.matrix.size(), getSimdLevelName((SimdLevel)level), ns / 1000.0,
+                   ns / (double)cellSamples);
+        }
+    }
+    setSimdLevel(maxLevel);
+
+    printf("\nLive route updates (plan swaps while mixing):\n");
+    failures += liveUpdateCheck(8, bufferSize, rng);
+    failures += liveUpdateCheck(64, bufferSize, rng);
+    failures += liveUpdateCheck(64, bufferSize, rng, 1);
+    failures += liveUpdateCheck(64, bufferSize, rng, 1, 1000);
+
+    printf("\nGain ramps (mute, solo and gain changes):\n");
+    failures += rampCheck(bufferSize, rng);
+    failures += rapidRouteCheck(bufferSize);
+
+    failures += parallelCrossover(bufferSize, rng);
+
+    if (failures) {
+        printf("\n%d mismatch(es)\n", failures);
+        return 1;
+    }
+    printf("\nAll plans match the scalar reference\n");
+    return 0;
+}
@@ -0,0 +1,329 @@
+#include "mock_asio_driver.h"
+#include "../src/sample_convert.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MockAsioDriver::MockAsioDriver(const MockDriverConfig& cfg)
+    : config(cfg), sampleRate(cfg.sampleRate) {
+}
+
+MockAsioDriver::~MockAsioDriver() {
+    stop();
+    disposeBuffers();
+}
+
+HRESULT STDMETHODCALLTYPE MockAsioDriver::QueryInterface(REFIID, void** object) {
+    if (object) *object = nullptr;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE MockAsioDriver::AddRef() {
+    return ++refCount;
+}
+
+ULONG STDMETHODCALLTYPE MockAsioDriver::Release() {
+    ULONG count = --refCount;
+    if (count == 0) {
+        delete this;
+    }
+    return count;
+}
+
+long MockAsioDriver::init(void*) {
+    return 1;
+}
+
+void MockAsioDriver::getDriverName(char* name) {
+    strncpy(name, config.name.c_str(), 31);
+    name[31] = '\0';
+}
+
+long MockAsioDriver::getDriverVersion() {
+    return 1;
+}
+
+void MockAsioDriver::getErrorMessage(char* string) {
+    string[0] = '\0';
+}
+
+ASIOError MockAsioDriver::start() {
+    if (!callbacks) {
+        return ASE_InvalidMode;
+    }
+    if (running.exchange(true)) {
+        return ASE_OK;
+    }
+    delivered.store(0);
+    startNs = nowNs() - (long long)(samplePosition / clockRate() * 1e9);
+    if (config.clock != MockClockManual) {
+        thread = std::thread(&MockAsioDriver::clockThread, this);
+    }
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::stop() {
+    running.store(false);
+    if (thread.joinable()) {
+        thread.join();
+    }
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::getChannels(long* numInputChannels, long* numOutputChannels) {
+    *numInputChannels = (long)config.inputs.size();
+    *numOutputChannels = (long)config.outputs.size();
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::getLatencies(long* inputLatency, long* outputLatency) {
+    *inputLatency = bufferSize;
+    *outputLatency = bufferSize;
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::getBufferSize(long* minSize, long* maxSize, long* preferredSize, long* granularity) {
+    *minSize = config.minBufferSize;
+    *maxSize = config.maxBufferSize;
+    *preferredSize = config.preferredBufferSize;
+    *granularity = -1;  // Powers of two
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::canSampleRate(double rate) {
+    return rate == config.sampleRate ? ASE_OK : ASE_NoClock;
+}
+
+ASIOError MockAsioDriver::getSampleRate(double* rate) {
+    *rate = sampleRate;
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::setSampleRate(double rate) {
+    if (rate != config.sampleRate) {
+        return ASE_NoClock;
+    }
+    sampleRate = rate;
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::getClockSources(ASIOClockSource* clocks, long* numSources) {
+    if (*numSources > 0) {
+        memset(clocks, 0, sizeof(ASIOClockSource));
+        clocks->associatedChannel = -1;
+        clocks->associatedGroup = -1;
+        clocks->isCurrentSource = 1;
+        strcpy(clocks->name, "Internal");
+        *numSources = 1;
+    }
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::setClockSource(long reference) {
+    return reference == 0 ? ASE_OK : ASE_InvalidParameter;
+}
+
+ASIOError MockAsioDriver::getSamplePosition(ASIOSamples* sPos, ASIOTimeStamp* tStamp) {
+    asioFromInt64(samplePosition, &sPos->hi, &sPos->lo);
+    asioFromInt64(nowNs(), &tStamp->hi, &tStamp->lo);
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::getChannelInfo(ASIOChannelInfo* info) {
+    const std::vector<MockChannel>& channels = info->isInput ? config.inputs : config.outputs;
+    if (info->channel < 0 || info->channel >= (long)channels.size()) {
+        return ASE_InvalidParameter;
+    }
+    const MockChannel& ch = channels[info->channel];
+    info->isActive = bufferSize > 0;
+    info->channelGroup = 0;
+    info->type = ch.type;
+    strncpy(info->name, ch.name.c_str(), 31);
+    info->name[31] = '\0';
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::createBuffers(ASIOBufferInfo* bufferInfos, long numChannels,
+                                        long size, ASIOCallbacks* cbs) {
+    if (size < config.minBufferSize || size > config.maxBufferSize || !cbs) {
+        return ASE_InvalidMode;
+    }
+    disposeBuffers();
+    bufferSize = size;
+    callbacks = cbs;
+    inputStorage.assign(config.inputs.size(), std::vector<uint8_t>());
+    outputStorage.assign(config.outputs.size(), std::vector<uint8_t>());
+
+    // Deterministic noise around -12 dBFS, different per channel
+    std::vector<float> signal(bufferSize * 2);
+    for (long i = 0; i < numChannels; i++) {
+        ASIOBufferInfo& info = bufferInfos[i];
+        const std::vector<MockChannel>& channels = info.isInput ? config.inputs : config.outputs;
+        if (info.channelNum < 0 || info.channelNum >= (long)channels.size()) {
+            disposeBuffers();
+            return ASE_InvalidParameter;
+        }
+        ASIOSampleType type = channels[info.channelNum].type;
+        std::vector<uint8_t>& storage = info.isInput ? inputStorage[info.channelNum]
+                                                     : outputStorage[info.channelNum];
+        int bytes = getSampleBytes(type) * bufferSize;
+        storage.assign(bytes * 2, 0);
+
+        if (info.isInput) {
+            uint32_t seed = 0x9e3779b9u * (uint32_t)(info.channelNum + 1);
+            for (float& s : signal) {
+                seed = seed * 1664525u + 1013904223u;
+                s = ((int32_t)seed / 2147483648.0f) * 0.25f;
+            }
+            getSampleConverter(type).fromFloat(signal.data(), storage.data(), bufferSize * 2);
+        }
+        info.buffers[0] = storage.data();
+        info.buffers[1] = storage.data() + bytes;
+    }
+    nextHalf = 0;
+    samplePosition = 0;
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::disposeBuffers() {
+    inputStorage.clear();
+    outputStorage.clear();
+    callbacks = nullptr;
+    bufferSize = 0;
+    return ASE_OK;
+}
+
+ASIOError MockAsioDriver::controlPanel() {
+    return ASE_NotPresent;
+}
+
+ASIOError MockAsioDriver::future(long, void*) {
+    return ASE_InvalidParameter;
+}
+
+ASIOError MockAsioDriver::outputReady() {
+    stats.outputReadyCalls++;
+    return ASE_OK;
+}
+
+void MockAsioDriver::fire() {
+    if (!callbacks) {
+        return;
+    }
+    int half = nextHalf;
+    nextHalf ^= 1;
+
+    long long begin = nowNs();
+    if (config.useTimeInfo && callbacks->bufferSwitchTimeInfo) {
+        long long systemNs = config.clock == MockClockTimer
+            ? begin : startNs + (long long)(samplePosition / clockRate() * 1e9);
+        time.timeInfo.speed = 1.0;
+        asioFromInt64(systemNs, &time.timeInfo.systemTime.hi, &time.timeInfo.systemTime.lo);
+        asioFromInt64(samplePosition, &time.timeInfo.samplePosition.hi, &time.timeInfo.samplePosition.lo);
+        time.timeInfo.sampleRate = sampleRate;
+        time.timeInfo.flags = kSystemTimeValid | kSamplePositionValid | kSampleRateValid;
+        callbacks->bufferSwitchTimeInfo(&time, half, 1);
+    } else {
+        callbacks->bufferSwitch(half, 1);
+    }
+    double ns = (double)(nowNs() - begin);
+
+    if (stats.callbacks == 0) {
+        stats.minNs = ns;
+        stats.maxNs = ns;
+    } else {
+        stats.minNs = std::min(stats.minNs, ns);
+        stats.maxNs = std::max(stats.maxNs, ns);
+    }
+    stats.totalNs += ns;
+    stats.callbacks++;
+
+    long long block = stats.callbacks;
+    if (config.repeatEvery > 0 && block % config.repeatEvery == 0) {
+        stats.repeatedBlocks++;
+    } else {
+        samplePosition += bufferSize;
+        if (config.skipEvery > 0 && block % config.skipEvery == 0) {
+            samplePosition += bufferSize;
+            stats.skippedBlocks++;
+        }
+    }
+    delivered.fetch_add(1, std::memory_order_release);
+}
+
+double MockAsioDriver::clockRate() const {
+    // Samples per second of system time
+    return sampleRate * (1.0 + config.clockDriftPpm * 1e-6);
+}
+
+void MockAsioDriver::clockThread() {
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(bufferSize / clockRate()));
+    auto next = Clock::now();
+
+    while (running.load(std::memory_order_acquire)) {
+        if (config.callbackLimit > 0 && delivered.load() >= config.callbackLimit) {
+            break;
+        }
+        if (config.clock == MockClockTimer) {
+            std::this_thread::sleep_until(next);
+            if (Clock::now() - next > period) {
+                stats.lateCallbacks++;
+            }
+            next += period;
+        }
+        fire();
+    }
+}
+
+void MockAsioDriver::waitForCallbacks() {
+    while (running.load() && config.callbackLimit > 0 &&
+           delivered.load(std::memory_order_acquire) < config.callbackLimit) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+long MockAsioDriver::sendMessage(long selector, long value) {
+    if (!callbacks || !callbacks->asioMessage) {
+        return 0;
+    }
+    // Like a real driver, ask first and send nothing the host does not support
+    if (selector != kAsioSelectorSupported &&
+        callbacks->asioMessage(kAsioSelectorSupported, selector, nullptr, nullptr) == 0) {
+        return 0;
+    }
+    return callbacks->asioMessage(selector, value, nullptr, nullptr);
+}
+
+void MockAsioDriver::changeSampleRate(double rate) {
+    config.sampleRate = rate;
+    sampleRate = rate;
+    if (callbacks && callbacks->sampleRateDidChange) {
+        callbacks->sampleRateDidChange(rate);
+    }
+}
+
+void MockAsioDriver::renameChannel(bool isInput, int channel, const std::string& name) {
+    std::vector<MockChannel>& channels = isInput ? config.inputs : config.outputs;
+    if (channel >= 0 && channel < (int)channels.size()) {
+        channels[channel].name = name;
+    }
+}
+
+void MockAsioDriver::resetStats() {
+    stats = MockDriverStats();
+}
+
+const void* MockAsioDriver::getBuffer(bool isInput, int channel, int half) const {
+    const std::vector<std::vector<uint8_t>>& storage = isInput ? inputStorage : outputStorage;
+    if (channel < 0 || channel >= (int)storage.size() || storage[channel].empty()) {
+        return nullptr;
+    }
+    return storage[channel].data() + (half ? storage[channel].size() / 2 : 0);
+}
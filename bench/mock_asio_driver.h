@@ -0,0 +1,143 @@
+#pragma once
+
+// In-process IASIO driver for exercising ASIOHost without hardware.
+//
+// Channel counts, names, sample types, buffer sizes and rate come from a
+// config. Input buffers are filled once with a deterministic signal. After
+// start() the driver calls the host from its own thread: on a real-time
+// timer (one block per buffer period), back to back, or not at all (the
+// caller steps it with fire()). Each callback is timed.
+//
+// ASIOTime carries the sample position and its system time. On the timer
+// clock that is the real time of the callback; otherwise the driver keeps
+// a virtual timeline at the nominal rate, so free-running still reports a
+// steady clock. Drift, skipped and repeated blocks can be injected.
+
+#include "../src/asio_iface.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct MockChannel {
+    std::string name;
+    ASIOSampleType type;
+};
+
+enum MockClock {
+    MockClockTimer = 0,     // One callback per buffer period, like hardware
+    MockClockFreeRun,       // Back to back, as fast as the host returns
+    MockClockManual         // Only when fire() is called
+};
+
+struct MockDriverConfig {
+    std::string name = "Mock ASIO";
+    std::vector<MockChannel> inputs;
+    std::vector<MockChannel> outputs;
+    long minBufferSize = 32;
+    long maxBufferSize = 4096;
+    long preferredBufferSize = 256;
+    double sampleRate = 48000.0;
+    bool useTimeInfo = true;        // bufferSwitchTimeInfo instead of bufferSwitch
+    MockClock clock = MockClockFreeRun;
+    long long callbackLimit = 0;    // Stop the clock thread after this many (0 = no limit)
+
+    // Faults for the host's ASIOTime checks
+    double clockDriftPpm = 0.0;     // Sample clock runs this much fast against system time
+    int skipEvery = 0;              // Every Nth block, skip a block (a missed callback)
+    int repeatEvery = 0;            // Every Nth block, repeat its sample position
+};
+
+// Callback timing. Written by the callback thread; read it after stop()
+// or once waitForCallbacks() returns.
+struct MockDriverStats {
+    long long callbacks = 0;
+    long long outputReadyCalls = 0;
+    long long lateCallbacks = 0;    // Timer clock: fired more than one period late
+    long long skippedBlocks = 0;    // Injected by skipEvery
+    long long repeatedBlocks = 0;   // Injected by repeatEvery
+    double totalNs = 0.0;
+    double minNs = 0.0;
+    double maxNs = 0.0;
+};
+
+class MockAsioDriver final : public IASIO {
+public:
+    explicit MockAsioDriver(const MockDriverConfig& config);
+
+    // IUnknown. Starts with one reference, owned by whoever attaches it.
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** object) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    // IASIO
+    long init(void* sysHandle) override;
+    void getDriverName(char* name) override;
+    long getDriverVersion() override;
+    void getErrorMessage(char* string) override;
+    ASIOError start() override;
+    ASIOError stop() override;
+    ASIOError getChannels(long* numInputChannels, long* numOutputChannels) override;
+    ASIOError getLatencies(long* inputLatency, long* outputLatency) override;
+    ASIOError getBufferSize(long* minSize, long* maxSize, long* preferredSize, long* granularity) override;
+    ASIOError canSampleRate(double sampleRate) override;
+    ASIOError getSampleRate(double* sampleRate) override;
+    ASIOError setSampleRate(double sampleRate) override;
+    ASIOError getClockSources(ASIOClockSource* clocks, long* numSources) override;
+    ASIOError setClockSource(long reference) override;
+    ASIOError getSamplePosition(ASIOSamples* sPos, ASIOTimeStamp* tStamp) override;
+    ASIOError getChannelInfo(ASIOChannelInfo* info) override;
+    ASIOError createBuffers(ASIOBufferInfo* bufferInfos, long numChannels, long bufferSize, ASIOCallbacks* callbacks) override;
+    ASIOError disposeBuffers() override;
+    ASIOError controlPanel() override;
+    ASIOError future(long selector, void* opt) override;
+    ASIOError outputReady() override;
+
+    // Run one callback on the calling thread
+    void fire();
+
+    // Changes a real driver's control panel would make, reported to the
+    // host through its callbacks like a driver does: a message is only sent
+    // if kAsioSelectorSupported says the host takes it. Use while the clock
+    // thread is not running (manual clock, or stopped).
+    long sendMessage(long selector, long value);
+    void changeSampleRate(double rate);     // Switch and call sampleRateDidChange
+    void renameChannel(bool isInput, int channel, const std::string& name);
+
+    // Block until the clock thread has delivered callbackLimit callbacks
+    void waitForCallbacks();
+
+    const MockDriverStats& getStats() const { return stats; }
+    void resetStats();
+
+    // Buffer of one channel and double-buffer half, for checking output
+    const void* getBuffer(bool isInput, int channel, int half) const;
+    long getBufferSize() const { return bufferSize; }
+
+private:
+    ~MockAsioDriver();  // Deleted by the last Release()
+    void clockThread();
+    double clockRate() const;
+
+    MockDriverConfig config;
+    std::atomic<ULONG> refCount{1};
+    double sampleRate;
+
+    // Buffers: storage[channel] holds both halves back to back
+    long bufferSize = 0;
+    std::vector<std::vector<uint8_t>> inputStorage;
+    std::vector<std::vector<uint8_t>> outputStorage;
+    ASIOCallbacks* callbacks = nullptr;
+
+    // Clock
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<long long> delivered{0};
+    int nextHalf = 0;
+    long long samplePosition = 0;
+    long long startNs = 0;          // System time of sample position 0
+    ASIOTime time = {};
+
+    MockDriverStats stats;
+};
@@ -0,0 +1,559 @@
+// Offline render: push a multichannel file through ASIOHost at full speed.
+//
+//   offline_render [options] <input.wav|input.raw> <output.wav|output.raw>
+//
+// The input file's channels become the driver's input channels and the
+// routed outputs are written to the output file. Routing is whatever
+// createBuffers/detectRouting picks from the channel names (with --rules,
+// under the rules in that file), and every
+// block goes through the host's real bufferSwitch path, driven by an
+// in-process file driver instead of hardware. The input is memory-mapped;
+// the output is streamed as blocks complete.
+//
+// Prints the throughput (channel-samples per second, inputs plus outputs)
+// and the host's callback timing. With --golden the output is compared
+// bit for bit against a reference file; the exit code is 1 on mismatch,
+// 2 on usage or I/O errors.
+
+#include "../src/asio_host.h"
+#include "../src/sample_convert.h"
+#include "file_asio_driver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file
+class MappedFile {
+public:
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+        size = (size_t)fileSize.QuadPart;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            close();
+            return false;
+        }
+        data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)st.st_size;
+        void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            size = 0;
+            return false;
+        }
+        madvise(view, size, MADV_SEQUENTIAL);
+        data = (const uint8_t*)view;
+#endif
+        if (!data) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap((void*)data, size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+// Interleaved sample stream: layout and where the samples are
+struct FileFormat {
+    int channels = 0;
+    double sampleRate = 0.0;
+    ASIOSampleType type = ASIOSTInt32LSB;
+    size_t dataOffset = 0;
+    size_t dataBytes = 0;
+};
+
+struct TypeName {
+    const char* name;
+    ASIOSampleType type;
+};
+
+// Sample types a WAV file can hold directly
+static const TypeName kTypes[] = {
+    { "int16",   ASIOSTInt16LSB },
+    { "int24",   ASIOSTInt24LSB },
+    { "int32",   ASIOSTInt32LSB },
+    { "float32", ASIOSTFloat32LSB },
+};
+
+static bool parseType(const std::string& name, ASIOSampleType* type) {
+    for (const auto& entry : kTypes) {
+        if (name == entry.name) {
+            *type = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char* typeName(ASIOSampleType type) {
+    for (const auto& entry : kTypes) {
+        if (entry.type == type) return entry.name;
+    }
+    return "unknown";
+}
+
+static uint32_t readLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t readLE16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static bool endsWith(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    if (s.size() < n) return false;
+    for (size_t i = 0; i < n; i++) {
+        if (tolower((unsigned char)s[s.size() - n + i]) != suffix[i]) return false;
+    }
+    return true;
+}
+
+// PCM 16/24/32 or float 32, plain or WAVE_FORMAT_EXTENSIBLE
+static bool parseWav(const uint8_t* data, size_t size, FileFormat* format, std::string* error) {
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        *error = "not a RIFF/WAVE file";
+        return false;
+    }
+    bool haveFormat = false;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        uint32_t chunkSize = readLE32(data + pos + 4);
+        const uint8_t* body = data + pos + 8;
+        if (memcmp(data + pos, "fmt ", 4) == 0 && chunkSize >= 16) {
+            uint16_t tag = readLE16(body);
+            int bits = readLE16(body + 14);
+            if (tag == 0xFFFE && chunkSize >= 40) {
+                tag = readLE16(body + 24);  // First two bytes of the sub-format GUID
+                if (readLE16(body + 18) != bits) {
+                    *error = "padded samples (valid bits != container bits) are not supported";
+                    return false;
+                }
+            }
+            format->channels = readLE16(body + 2);
+            format->sampleRate = readLE32(body + 4);
+            if (tag == 1 && bits == 16) format->type = ASIOSTInt16LSB;
+            else if (tag == 1 && bits == 24) format->type = ASIOSTInt24LSB;
+            else if (tag == 1 && bits == 32) format->type = ASIOSTInt32LSB;
+            else if (tag == 3 && bits == 32) format->type = ASIOSTFloat32LSB;
+            else {
+                *error = "unsupported sample format (format " + std::to_string(tag) +
+                         ", " + std::to_string(bits) + " bits)";
+                return false;
+            }
+            haveFormat = true;
+        } else if (memcmp(data + pos, "data", 4) == 0) {
+            if (!haveFormat) {
+                *error = "data chunk before fmt chunk";
+                return false;
+            }
+            format->dataOffset = pos + 8;
+            format->dataBytes = std::min((size_t)chunkSize, size - format->dataOffset);
+            return format->channels > 0;
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    *error = "no data chunk";
+    return false;
+}
+
+// Streams interleaved frames to a raw or WAV file. The WAV sizes are
+// patched in when the file is finished.
+class OutputFile {
+public:
+    ~OutputFile() { finish(); }
+
+    bool open(const std::string& path, bool asWav, int numChannels, double rate, ASIOSampleType sampleType) {
+        file = fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        wav = asWav;
+        channels = numChannels;
+        sampleRate = rate;
+        type = sampleType;
+        if (wav) {
+            writeHeader(0);
+        }
+        return true;
+    }
+
+    bool write(const uint8_t* frames, size_t bytes) {
+        dataBytes += bytes;
+        return fwrite(frames, 1, bytes, file) == bytes;
+    }
+
+    bool finish() {
+        if (!file) {
+            return true;
+        }
+        bool ok = true;
+        if (wav) {
+            if (dataBytes & 1) ok = fputc(0, file) != EOF;
+            ok = ok && fseek(file, 0, SEEK_SET) == 0;
+            ok = ok && writeHeader((uint32_t)dataBytes);
+        }
+        ok = fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+
+private:
+    bool writeHeader(uint32_t bytes) {
+        // WAVE_FORMAT_EXTENSIBLE beyond stereo, so readers accept the layout
+        bool extensible = channels > 2;
+        int bits = getSampleBytes(type) * 8;
+        uint16_t tag = type == ASIOSTFloat32LSB ? 3 : 1;
+        uint32_t fmtSize = extensible ? 40 : 16;
+        uint32_t blockAlign = (uint32_t)channels * getSampleBytes(type);
+
+        std::vector<uint8_t> h;
+        auto put16 = [&](uint32_t v) { h.push_back(v & 0xff); h.push_back((v >> 8) & 0xff); };
+        auto put32 = [&](uint32_t v) { put16(v & 0xffff); put16(v >> 16); };
+        auto putTag = [&](const char* s) { h.insert(h.end(), s, s + 4); };
+
+        putTag("RIFF");
+        put32(4 + 8 + fmtSize + 8 + bytes + (bytes & 1));
+        putTag("WAVE");
+        putTag("fmt ");
+        put32(fmtSize);
+        put16(extensible ? 0xFFFE : tag);
+        put16(channels);
+        put32((uint32_t)sampleRate);
+        put32((uint32_t)sampleRate * blockAlign);
+        put16(blockAlign);
+        put16(bits);
+        if (extensible) {
+            static const uint8_t kGuidTail[14] = {
+                0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+            };
+            put16(22);
+            put16(bits);    // Valid bits
+            put32(0);       // No speaker positions
+            put16(tag);
+            h.insert(h.end(), kGuidTail, kGuidTail + 14);
+        }
+        putTag("data");
+        put32(bytes);
+        return fwrite(h.data(), 1, h.size(), file) == h.size();
+    }
+
+    FILE* file = nullptr;
+    bool wav = false;
+    int channels = 0;
+    double sampleRate = 0.0;
+    ASIOSampleType type = ASIOSTInt32LSB;
+    size_t dataBytes = 0;
+};
+
+// Bit-exact comparison of the rendered samples with a reference file.
+// WAV files must match in format; then their data chunks are compared.
+static bool compareGolden(const std::string& outputPath, const std::string& goldenPath,
+                          int channels, int sampleBytes) {
+    MappedFile out, golden;
+    if (!out.open(outputPath) || !golden.open(goldenPath)) {
+        printf("Golden: cannot read %s\n", out.data ? goldenPath.c_str() : outputPath.c_str());
+        return false;
+    }
+    size_t outOffset = 0, outBytes = out.size;
+    size_t goldenOffset = 0, goldenBytes = golden.size;
+    if (endsWith(outputPath, ".wav")) {
+        FileFormat a, b;
+        std::string error;
+        if (!parseWav(out.data, out.size, &a, &error) || !parseWav(golden.data, golden.size, &b, &error)) {
+            printf("Golden: %s\n", error.c_str());
+            return false;
+        }
+        if (a.channels != b.channels || a.type != b.type || a.sampleRate != b.sampleRate) {
+            printf("Golden: format differs (%d ch %s %.0f Hz vs %d ch %s %.0f Hz)\n",
+                   a.channels, typeName(a.type), a.sampleRate, b.channels, typeName(b.type), b.sampleRate);
+            return false;
+        }
+        outOffset = a.dataOffset;
+        outBytes = a.dataBytes;
+        goldenOffset = b.dataOffset;
+        goldenBytes = b.dataBytes;
+    }
+
+    size_t common = std::min(outBytes, goldenBytes);
+    const uint8_t* p = out.data + outOffset;
+    const uint8_t* q = golden.data + goldenOffset;
+    if (memcmp(p, q, common) != 0) {
+        size_t at = 0;
+        while (p[at] == q[at]) at++;
+        size_t frameBytes = (size_t)channels * sampleBytes;
+        printf("Golden: MISMATCH at frame %zu, output channel %zu\n",
+               at / frameBytes, (at % frameBytes) / sampleBytes);
+        return false;
+    }
+    if (outBytes != goldenBytes) {
+        printf("Golden: MISMATCH in length (%zu vs %zu bytes)\n", outBytes, goldenBytes);
+        return false;
+    }
+    printf("Golden: output matches %s\n", goldenPath.c_str());
+    return true;
+}
+
+static std::vector<std::string> splitNames(const std::string& list) {
+    std::vector<std::string> names;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) comma = list.size();
+        names.push_back(list.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return names;
+}
+
+static void usage() {
+    printf(
+        "Usage: offline_render [options] <input.wav|input.raw> <output.wav|output.raw>\n"
+        "\n"
+        "  --raw CH:TYPE:RATE   Input is raw interleaved samples, e.g. 8:int32:48000\n"
+        "  --in-names A,B,...   Input channel names (default \"Input 1\", ...)\n"
+        "  --outputs N          Output channels (default 2)\n"
+        "  --out-names A,B,...  Output channel names, sets --outputs (default \"Output 1\", ...)\n"
+        "  --out-type TYPE      Output sample type (default: the input's)\n"
+        "  --buffer N           Frames per block (default 256)\n"
+        "  --threads N          Mix threads, the callback's included (default 1)\n"
+        "  --passes N           Render the file N times for timing; only the first is written\n"
+        "  --golden FILE        Compare the output bit for bit with FILE\n"
+        "  --rules FILE         Routing rules file (default: the built-in rules)\n"
+        "  --show-routing       Print the routing the host chose\n"
+        "\n"
+        "TYPE is int16, int24, int32 or float32. Files ending in .wav are WAV,\n"
+        "anything else is raw interleaved little-endian samples.\n");
+}
+
+int main(int argc, char** argv) {
+    std::string inputPath, outputPath, goldenPath, rawSpec, rulesPath;
+    std::vector<std::string> inNames, outNames;
+    int numOutputs = 2;
+    int bufferSize = 256;
+    int threads = 1;
+    int passes = 1;
+    bool haveOutType = false;
+    bool showRouting = false;
+    ASIOSampleType outType = ASIOSTInt32LSB;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--raw" && hasValue) rawSpec = argv[++i];
+        else if (arg == "--in-names" && hasValue) inNames = splitNames(argv[++i]);
+        else if (arg == "--outputs" && hasValue) numOutputs = atoi(argv[++i]);
+        else if (arg == "--out-names" && hasValue) outNames = splitNames(argv[++i]);
+        else if (arg == "--buffer" && hasValue) bufferSize = atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) threads = atoi(argv[++i]);
+        else if (arg == "--passes" && hasValue) passes = atoi(argv[++i]);
+        else if (arg == "--golden" && hasValue) goldenPath = argv[++i];
+        else if (arg == "--rules" && hasValue) rulesPath = argv[++i];
+        else if (arg == "--show-routing") showRouting = true;
+        else if (arg == "--out-type" && hasValue) {
+            if (!parseType(argv[++i], &outType)) {
+                printf("Unknown sample type %s\n", argv[i]);
+                return 2;
+            }
+            haveOutType = true;
+        } else if (arg[0] == '-' && arg.size() > 1) {
+            usage();
+            return 2;
+        } else if (inputPath.empty()) inputPath = arg;
+        else if (outputPath.empty()) outputPath = arg;
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (!outNames.empty()) numOutputs = (int)outNames.size();
+    if (inputPath.empty() || outputPath.empty() || numOutputs <= 0 || bufferSize <= 0 || passes <= 0) {
+        usage();
+        return 2;
+    }
+
+    // Input layout
+    MappedFile input;
+    if (!input.open(inputPath)) {
+        printf("Cannot map %s\n", inputPath.c_str());
+        return 2;
+    }
+    FileFormat in;
+    if (!rawSpec.empty()) {
+        size_t a = rawSpec.find(':'), b = rawSpec.rfind(':');
+        if (a == std::string::npos || a == b || !parseType(rawSpec.substr(a + 1, b - a - 1), &in.type)) {
+            printf("Bad --raw spec %s (want CH:TYPE:RATE)\n", rawSpec.c_str());
+            return 2;
+        }
+        in.channels = atoi(rawSpec.c_str());
+        in.sampleRate = atof(rawSpec.c_str() + b + 1);
+        in.dataOffset = 0;
+        in.dataBytes = input.size;
+        if (in.channels <= 0 || in.sampleRate <= 0.0) {
+            printf("Bad --raw spec %s\n", rawSpec.c_str());
+            return 2;
+        }
+    } else {
+        std::string error;
+        if (!parseWav(input.data, input.size, &in, &error)) {
+            printf("%s: %s\n", inputPath.c_str(), error.c_str());
+            return 2;
+        }
+    }
+    if (!haveOutType) outType = in.type;
+
+    RoutingRules rules;
+    std::string rulesError;
+    if (!rulesPath.empty() && !rules.load(rulesPath, &rulesError)) {
+        printf("%s\n", rulesError.c_str());
+        return 2;
+    }
+
+    // Driver channels named for detectRouting
+    FileDriverConfig config;
+    config.bufferSize = bufferSize;
+    config.sampleRate = in.sampleRate;
+    for (int ch = 0; ch < in.channels; ch++) {
+        std::string name = ch < (int)inNames.size() ? inNames[ch] : "Input " + std::to_string(ch + 1);
+        config.inputs.push_back({ name, in.type });
+    }
+    for (int ch = 0; ch < numOutputs; ch++) {
+        std::string name = ch < (int)outNames.size() ? outNames[ch] : "Output " + std::to_string(ch + 1);
+        config.outputs.push_back({ name, outType });
+    }
+
+    FileAsioDriver* driver = new FileAsioDriver(config);
+    driver->AddRef();  // Keep our pointer valid past unloadDriver's Release
+    ASIOHost host;
+    host.setMixThreads(threads);
+    host.setRoutingRules(rules);
+    host.attachDriver(driver, config.name);
+    if (!host.initialize(nullptr) || !host.createBuffers(bufferSize) || !host.start()) {
+        printf("Host failed to start on the file driver\n");
+        host.unloadDriver();
+        driver->Release();
+        return 2;
+    }
+    if (showRouting) {
+        printf("%s\n", host.getRoutingInfo().c_str());
+    }
+
+    OutputFile output;
+    if (!output.open(outputPath, endsWith(outputPath, ".wav"), numOutputs, in.sampleRate, outType)) {
+        printf("Cannot create %s\n", outputPath.c_str());
+        host.stop();
+        host.disposeBuffers();
+        host.unloadDriver();
+        driver->Release();
+        return 2;
+    }
+
+    int inFrameBytes = driver->getInputFrameBytes();
+    int outFrameBytes = driver->getOutputFrameBytes();
+    size_t totalFrames = in.dataBytes / inFrameBytes;
+    const uint8_t* samples = input.data + in.dataOffset;
+    std::vector<uint8_t> block((size_t)bufferSize * outFrameBytes);
+
+    bool ok = true;
+    auto begin = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes && ok; pass++) {
+        for (size_t frame = 0; frame < totalFrames && ok; frame += bufferSize) {
+            int frames = (int)std::min((size_t)bufferSize, totalFrames - frame);
+            ok = driver->processBlock(samples + frame * inFrameBytes, frames, block.data());
+            if (ok && pass == 0) {
+                ok = output.write(block.data(), (size_t)frames * outFrameBytes);
+            }
+        }
+        if (pass == 0) {
+            ok = output.finish() && ok;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    CallbackTimingReport timing = host.getTimingReport();
+    host.stop();
+    host.disposeBuffers();
+    host.unloadDriver();
+    driver->Release();
+    if (!ok) {
+        printf("Render failed writing %s\n", outputPath.c_str());
+        return 2;
+    }
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    double frames = (double)totalFrames * passes;
+    double channelSamples = frames * (in.channels + numOutputs);
+    printf("Rendered %zu frames x %d pass(es): %d in (%s) -> %d out (%s), %.0f Hz, %d-frame blocks\n",
+           totalFrames, passes, in.channels, typeName(in.type), numOutputs, typeName(outType),
+           in.sampleRate, bufferSize);
+    printf("  %.3f s, %.1fx real time, %.1f M channel-samples/s\n",
+           seconds, frames / in.sampleRate / seconds, channelSamples / seconds / 1e6);
+    printf("  callback mean %.2f us, p99 %.2f us, max %.2f us\n",
+           timing.meanNs / 1000.0, timing.p99Ns / 1000.0, timing.maxNs / 1000.0);
+
+    if (!goldenPath.empty()) {
+        return compareGolden(outputPath, goldenPath, numOutputs, getSampleBytes(outType)) ? 0 : 1;
+    }
+    return 0;
+}
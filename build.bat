@@ -64,8 +64,9 @@ if not exist build mkdir build
 cl /nologo /EHsc /O2 /MT /DUNICODE /D_UNICODE /W3 ^
    /Fobuild\ ^
    src\main.cpp src\asio_host.cpp ^
+   src\sample_convert.cpp src\sample_convert_sse2.cpp src\sample_convert_avx2.cpp src\routing_matrix.cpp src\routing_rules.cpp src\mix_engine.cpp src\callback_stats.cpp src\clock_monitor.cpp src\worker_pool.cpp src\stream_arena.cpp src\driver_requests.cpp src\buffer_tuner.cpp src\spsc_ring.cpp src\resampler.cpp src\audio_bridge.cpp src\level_meters.cpp src\disk_recorder.cpp src\rtp_stream.cpp ^
    /link /SUBSYSTEM:WINDOWS ^
-   ole32.lib oleaut32.lib uuid.lib shell32.lib advapi32.lib ^
+   ole32.lib oleaut32.lib uuid.lib shell32.lib advapi32.lib synchronization.lib ws2_32.lib ^
    /OUT:build\ASIOMiniHost.exe
 
 if %errorlevel% neq 0 (
@@ -1,137 +1,103 @@
 #define NOMINMAX  // Prevent Windows.h from defining min/max macros
 
 #include "asio_host.h"
+#include "asio_iface.h"
+#ifdef _WIN32
 #include <combaseapi.h>
 #include <initguid.h>
+#endif
 #include <iostream>
 #include <cstring>
 #include <algorithm>
 #include <cctype>
 #include <sstream>
 #include <cmath>
-
-// ASIO Interface definitions (COM-based, no SDK needed)
-
-#pragma pack(push, 4)
-
-struct ASIODriverInfo {
-    long asioVersion;
-    long driverVersion;
-    char name[32];
-    char errorMessage[124];
-    void* sysRef;
-};
-
-struct ASIOClockSource {
-    long index;
-    long associatedChannel;
-    long associatedGroup;
-    long isCurrentSource;
-    char name[32];
-};
-
-struct ASIOChannelInfo {
-    long channel;
-    long isInput;
-    long isActive;
-    long channelGroup;
-    ASIOSampleType type;
-    char name[32];
-};
-
-struct ASIOBufferInfo {
-    long isInput;
-    long channelNum;
-    void* buffers[2];
-};
-
-struct ASIOTime {
-    long reserved[4];
-    struct {
-        double speed;
-        long long timeCodeSamples;
-        unsigned long flags;
-        char future[64];
-    } timeCode;
-    struct {
-        double samplePosition;
-        double sampleRate;
-        long long nanoSeconds;
-        long long samples;
-        unsigned long flags;
-        char future[12];
-    } timeInfo;
-};
-
-struct ASIOCallbacks {
-    void (*bufferSwitch)(long doubleBufferIndex, long directProcess);
-    void (*sampleRateDidChange)(double sRate);
-    long (*asioMessage)(long selector, long value, void* message, double* opt);
-    ASIOTime* (*bufferSwitchTimeInfo)(ASIOTime* params, long doubleBufferIndex, long directProcess);
+#include <chrono>
+#include <cstdio>
+
+// ASIO callbacks carry no pointer back to the host, so several hosts
+// streaming at once need separate functions. Each slot has its own set,
+// generated from CallbackSlot<Slot>, and points at the host that claimed
+// it in createBuffers.
+static const int kCallbackSlots = 4;
+static std::atomic<ASIOHost*> slotHosts[kCallbackSlots];
+
+template <int Slot>
+struct CallbackSlot {
+    static void bufferSwitch(long index, long directProcess) {
+        if (ASIOHost* host = slotHosts[Slot].load(std::memory_order_acquire)) {
+            host->bufferSwitch(index, directProcess != 0);
+        }
+    }
+    static void sampleRateDidChange(double sRate) {
+        if (ASIOHost* host = slotHosts[Slot].load(std::memory_order_acquire)) {
+            host->sampleRateChanged(sRate);
+        }
+    }
+    static long asioMessage(long selector, long value, void*, double*) {
+        ASIOHost* host = slotHosts[Slot].load(std::memory_order_acquire);
+        return host ? host->asioMessage(selector, value) : 0;
+    }
+    static ASIOTime* bufferSwitchTimeInfo(ASIOTime* timeInfo, long index, long directProcess) {
+        if (ASIOHost* host = slotHosts[Slot].load(std::memory_order_acquire)) {
+            host->bufferSwitchTimeInfo(timeInfo, index, directProcess);
+        }
+        return timeInfo;
+    }
+    static ASIOCallbacks make() {
+        ASIOCallbacks callbacks;
+        callbacks.bufferSwitch = &bufferSwitch;
+        callbacks.sampleRateDidChange = &sampleRateDidChange;
+        callbacks.asioMessage = &asioMessage;
+        callbacks.bufferSwitchTimeInfo = &bufferSwitchTimeInfo;
+        return callbacks;
+    }
 };
 
-#pragma pack(pop)
-
-// ASIO message selectors
-enum {
-    kAsioSelectorSupported = 1,
-    kAsioEngineVersion,
-    kAsioResetRequest,
-    kAsioBufferSizeChange,
-    kAsioResyncRequest,
-    kAsioLatenciesChanged,
-    kAsioSupportsTimeInfo,
-    kAsioSupportsTimeCode,
-    kAsioSupportsInputMonitor
+// Drivers keep the pointer they were given until disposeBuffers
+static ASIOCallbacks slotCallbacks[kCallbackSlots] = {
+    CallbackSlot<0>::make(), CallbackSlot<1>::make(), CallbackSlot<2>::make(), CallbackSlot<3>::make()
 };
 
-// IASIO interface
-class IASIO : public IUnknown {
+// Times one control-path phase into its HostPhaseTimes slot
+class PhaseTimer {
 public:
-    virtual long init(void* sysHandle) = 0;
-    virtual void getDriverName(char* name) = 0;
-    virtual long getDriverVersion() = 0;
-    virtual void getErrorMessage(char* string) = 0;
-    virtual ASIOError start() = 0;
-    virtual ASIOError stop() = 0;
-    virtual ASIOError getChannels(long* numInputChannels, long* numOutputChannels) = 0;
-    virtual ASIOError getLatencies(long* inputLatency, long* outputLatency) = 0;
-    virtual ASIOError getBufferSize(long* minSize, long* maxSize, long* preferredSize, long* granularity) = 0;
-    virtual ASIOError canSampleRate(double sampleRate) = 0;
-    virtual ASIOError getSampleRate(double* sampleRate) = 0;
-    virtual ASIOError setSampleRate(double sampleRate) = 0;
-    virtual ASIOError getClockSources(ASIOClockSource* clocks, long* numSources) = 0;
-    virtual ASIOError setClockSource(long reference) = 0;
-    virtual ASIOError getSamplePosition(long long* sPos, long long* tStamp) = 0;
-    virtual ASIOError getChannelInfo(ASIOChannelInfo* info) = 0;
-    virtual ASIOError createBuffers(ASIOBufferInfo* bufferInfos, long numChannels, long bufferSize, ASIOCallbacks* callbacks) = 0;
-    virtual ASIOError disposeBuffers() = 0;
-    virtual ASIOError controlPanel() = 0;
-    virtual ASIOError future(long selector, void* opt) = 0;
-    virtual ASIOError outputReady() = 0;
-};
+    explicit PhaseTimer(double* slot) : slot(slot), begin(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        *slot = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
 
-// Static instance
-ASIOHost* ASIOHost::instance = nullptr;
+private:
+    double* slot;
+    std::chrono::steady_clock::time_point begin;
+};
 
 ASIOHost::ASIOHost() {
+#ifdef _WIN32
     CoInitialize(nullptr);
-    instance = this;
+#endif
 }
 
 ASIOHost::~ASIOHost() {
     stop();
     disposeBuffers();
     unloadDriver();
+#ifdef _WIN32
     CoUninitialize();
-    if (instance == this) {
-        instance = nullptr;
-    }
+#endif
 }
 
-std::vector<DriverInfo> ASIOHost::getDriverList() {
+std::vector<DriverInfo> ASIOHost::getDriverList(bool refresh) {
+    // Control thread only, like the rest of the host's setup calls
+    static std::vector<DriverInfo> cached;
+    static bool listed = false;
+    if (listed && !refresh) {
+        return cached;
+    }
+
     std::vector<DriverInfo> drivers;
     
+#ifdef _WIN32
     HKEY asioKey;
     if (RegOpenKeyExA(HKEY_LOCAL_MACHINE, "SOFTWARE\\ASIO", 0, KEY_READ, &asioKey) != ERROR_SUCCESS) {
         return drivers;
@@ -156,11 +122,7 @@ std::vector<DriverInfo> ASIOHost::getDriverList() {
             if (RegQueryValueExA(driverKey, "CLSID", nullptr, &type, (LPBYTE)clsidStr, &clsidSize) == ERROR_SUCCESS) {
                 DriverInfo info;
                 info.name = keyName;
-                
-                wchar_t wclsid[64];
-                MultiByteToWideChar(CP_ACP, 0, clsidStr, -1, wclsid, 64);
-                CLSIDFromString(wclsid, &info.clsid);
-                
+                info.clsid = clsidStr;
                 drivers.push_back(info);
             }
             RegCloseKey(driverKey);
@@ -168,21 +130,30 @@ std::vector<DriverInfo> ASIOHost::getDriverList() {
     }
 
     RegCloseKey(asioKey);
+#endif
+    cached = drivers;
+    listed = true;
     return drivers;
 }
 
 bool ASIOHost::loadDriver(const std::string& name) {
     unloadDriver();
+    PhaseTimer timer(&phases.ms[PhaseLoadDriver]);
     
-    auto drivers = getDriverList();
+#ifdef _WIN32
     CLSID clsid = {0};
     bool found = false;
     
-    for (const auto& driver : drivers) {
-        if (driver.name == name) {
-            clsid = driver.clsid;
-            found = true;
-            break;
+    // A driver installed since the list was cached needs a fresh read
+    for (int attempt = 0; attempt < 2 && !found; attempt++) {
+        auto drivers = getDriverList(attempt > 0);
+        for (const auto& driver : drivers) {
+            if (driver.name == name) {
+                wchar_t wclsid[64];
+                MultiByteToWideChar(CP_ACP, 0, driver.clsid.c_str(), -1, wclsid, 64);
+                found = SUCCEEDED(CLSIDFromString(wclsid, &clsid));
+                break;
+            }
         }
     }
     
@@ -196,6 +167,24 @@ bool ASIOHost::loadDriver(const std::string& name) {
     }
     
     driverName = name;
+    fromRegistry = true;
+    return true;
+#else
+    // No COM registry off Windows; use attachDriver
+    (void)name;
+    return false;
+#endif
+}
+
+bool ASIOHost::attachDriver(IASIO* driver, const std::string& name) {
+    unloadDriver();
+    if (!driver) {
+        return false;
+    }
+    asioDriver = driver;
+    driverName = name;
+    fromRegistry = false;
+    channelCache.erase(name);   // A new object; its channels may differ
     return true;
 }
 
@@ -210,32 +199,57 @@ void ASIOHost::unloadDriver() {
     outputChannelNames.clear();
     inputSampleTypes.clear();
     outputSampleTypes.clear();
+    inputRoles.clear();
+    outputRoles.clear();
     routes.clear();
+    routesSet = false;
+    controls = MixControls();
 }
 
-bool ASIOHost::initialize(HWND hwnd) {
+bool ASIOHost::initialize(void* sysHandle) {
     if (!asioDriver) {
         return false;
     }
     
     IASIO* drv = (IASIO*)asioDriver;
+    systemHandle = sysHandle;
     
-    if (drv->init(hwnd) != 1) {
-        return false;
-    }
-    
-    // Get channel counts
-    long inputs, outputs;
-    if (drv->getChannels(&inputs, &outputs) != ASE_OK) {
-        return false;
+    {
+        PhaseTimer timer(&phases.ms[PhaseInitialize]);
+        if (drv->init(sysHandle) != 1) {
+            return false;
+        }
+        
+        // Get channel counts
+        long inputs, outputs;
+        if (drv->getChannels(&inputs, &outputs) != ASE_OK) {
+            return false;
+        }
+        numInputs = inputs;
+        numOutputs = outputs;
+        
+        // Get sample rate
+        drv->getSampleRate(&sampleRate);
+    }
+    inputRoles.clear();     // Until the channels are planned again
+    outputRoles.clear();
+    
+    // Channel names and types: reuse what this driver reported last time
+    // if its channel counts have not changed
+    PhaseTimer timer(&phases.ms[PhaseChannelInfo]);
+    auto cached = channelCache.find(driverName);
+    phases.channelInfoCached = cached != channelCache.end() &&
+                               (int)cached->second.inputNames.size() == numInputs &&
+                               (int)cached->second.outputNames.size() == numOutputs;
+    if (phases.channelInfoCached) {
+        inputChannelNames = cached->second.inputNames;
+        outputChannelNames = cached->second.outputNames;
+        inputSampleTypes = cached->second.inputTypes;
+        outputSampleTypes = cached->second.outputTypes;
+        initialized = true;
+        return true;
     }
-    numInputs = inputs;
-    numOutputs = outputs;
     
-    // Get sample rate
-    drv->getSampleRate(&sampleRate);
-    
-    // Get channel names and sample types
     inputChannelNames.resize(numInputs);
     outputChannelNames.resize(numOutputs);
     inputSampleTypes.resize(numInputs);
@@ -267,136 +281,60 @@ bool ASIOHost::initialize(HWND hwnd) {
         }
     }
     
+    channelCache[driverName] = { inputChannelNames, outputChannelNames, inputSampleTypes, outputSampleTypes };
     initialized = true;
     return true;
 }
 
-bool ASIOHost::isHardwareChannelName(const std::string& name) const {
-    std::string lower = name;
-    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-    
-    // Common hardware/driver identifiers
-    const char* hwPatterns[] = {
-        "asio4all", "asio 4 all",
-        "realtek", "nvidia", "amd", "intel",
-        "usb", "hdmi", "spdif", "optical",
-        "focusrite", "scarlett", "steinberg", "yamaha",
-        "motu", "rme", "universal audio", "presonus",
-        "behringer", "native instruments", "m-audio",
-        "flexasio", "wasapi", "wdm",
-        "speaker", "headphone", "line out", "line in",
-        "microphone", "mic in", "aux",
-        "topping", "fiio", "schiit", "jds", "geshelli",
-        "not connected", "disconnected"
-    };
-    
-    for (const auto& pattern : hwPatterns) {
-        if (lower.find(pattern) != std::string::npos) {
-            return true;
-        }
-    }
-    
-    // Check if it's just a number or "Ch X" pattern
-    if (lower.find("ch ") == 0 || lower.find("ch") == 0) {
-        return true;
-    }
-    
-    // Check if mostly digits (like "01" or "1-2")
-    int digitCount = 0;
-    for (char c : name) {
-        if (isdigit(c) || c == '-' || c == ' ') digitCount++;
-    }
-    if (name.length() > 0 && digitCount >= name.length() / 2) {
-        return true;
+void ASIOHost::planRouting() {
+    auto cached = planCache.find(driverName);
+    phases.routingCached = cached != planCache.end() &&
+                           cached->second.rulesHash == routingRules.getHash() &&
+                           cached->second.inputNames == inputChannelNames &&
+                           cached->second.outputNames == outputChannelNames;
+    if (phases.routingCached) {
+        inputRoles = cached->second.inputRoles;
+        outputRoles = cached->second.outputRoles;
+        plannedRoutes = cached->second.routes;
+        return;
     }
     
-    return false;
+    plannedRoutes = routingRules.plan(inputChannelNames, outputChannelNames, &inputRoles, &outputRoles);
+    planCache[driverName] = { routingRules.getHash(), inputChannelNames, outputChannelNames,
+                              inputRoles, outputRoles, plannedRoutes };
 }
 
-bool ASIOHost::isVirtualEndpointName(const std::string& name) const {
-    // If it's clearly hardware, it's not virtual
-    if (isHardwareChannelName(name)) {
-        return false;
-    }
-    
-    // SAR virtual endpoints have user-defined names
-    // They typically don't match hardware patterns
-    // Common user names: "System Audio", "Game", "Discord", "Music", "Browser", etc.
-    
-    // If the name is descriptive and not hardware-like, assume it's a virtual endpoint
-    return name.length() > 0;
+void ASIOHost::detectRouting() {
+    planRouting();
+    routes = plannedRoutes;
 }
 
-void ASIOHost::detectRouting() {
-    routes.clear();
-    
-    // Strategy:
-    // 1. Find all input channels that look like virtual endpoints (SAR playback endpoints)
-    // 2. Find all output channels that look like hardware outputs
-    // 3. Route virtual inputs to hardware outputs in order
-    
-    std::vector<int> virtualInputs;
-    std::vector<int> hardwareOutputs;
-    
-    // Categorize inputs
-    for (int i = 0; i < numInputs; i++) {
-        if (isVirtualEndpointName(inputChannelNames[i])) {
-            virtualInputs.push_back(i);
-        }
-    }
-    
-    // If no virtual inputs detected, assume ALL inputs are virtual
-    // (This happens when the underlying driver has no physical inputs, common for DACs)
-    if (virtualInputs.empty()) {
-        for (int i = 0; i < numInputs; i++) {
-            virtualInputs.push_back(i);
-        }
-    }
-    
-    // Categorize outputs - prefer hardware-looking ones, but use all if unclear
-    for (int i = 0; i < numOutputs; i++) {
-        if (isHardwareChannelName(outputChannelNames[i])) {
-            hardwareOutputs.push_back(i);
-        }
-    }
-    
-    // If no hardware outputs detected, use the first 2 (or all if less)
-    // SAR typically puts hardware channels first
-    if (hardwareOutputs.empty()) {
-        int hwCount = std::min(numOutputs, 2);  // Assume stereo hardware
-        for (int i = 0; i < hwCount; i++) {
-            hardwareOutputs.push_back(i);
-        }
-    }
-    
-    // Create routing: pair virtual inputs with hardware outputs
-    // For stereo: virtual L -> hw L, virtual R -> hw R
-    // For multiple virtual endpoints: sum them
-    
-    // Group virtual inputs into stereo pairs and route to hardware outputs
-    int numHwChannels = (int)hardwareOutputs.size();
-    
-    for (size_t i = 0; i < virtualInputs.size(); i++) {
-        // Map to corresponding hardware output channel (with wraparound)
-        int hwIdx = i % numHwChannels;
-        
-        ChannelRoute route;
-        route.inputChannel = virtualInputs[i];
-        route.outputChannel = hardwareOutputs[hwIdx];
-        routes.push_back(route);
+void ASIOHost::setRoutingRules(const RoutingRules& rules) {
+    routingRules = rules;
+    if (initialized) {
+        planRouting();
     }
 }
 
+ChannelRole ASIOHost::getInputRole(int channel) const {
+    return (channel >= 0 && channel < (int)inputRoles.size()) ? inputRoles[channel] : RoleNone;
+}
+
+ChannelRole ASIOHost::getOutputRole(int channel) const {
+    return (channel >= 0 && channel < (int)outputRoles.size()) ? outputRoles[channel] : RoleNone;
+}
+
 std::string ASIOHost::getRoutingInfo() const {
     std::stringstream ss;
     
     ss << "Input Channels:\n";
     for (int i = 0; i < numInputs; i++) {
         ss << "  [" << i << "] " << inputChannelNames[i];
-        if (isVirtualEndpointName(inputChannelNames[i])) {
-            ss << " (virtual)";
-        } else {
-            ss << " (hardware)";
+        if (getInputRole(i) != RoleNone) {
+            ss << " (" << RoutingRules::getRoleName(getInputRole(i)) << ")";
+        }
+        if (buffersCreated) {
+            ss << ": " << LevelMeters::formatLevel(meters.getInputLevel(i));
         }
         ss << "\n";
     }
@@ -404,20 +342,43 @@ std::string ASIOHost::getRoutingInfo() const {
     ss << "\nOutput Channels:\n";
     for (int i = 0; i < numOutputs; i++) {
         ss << "  [" << i << "] " << outputChannelNames[i];
-        if (isHardwareChannelName(outputChannelNames[i])) {
-            ss << " (hardware)";
+        if (getOutputRole(i) != RoleNone) {
+            ss << " (" << RoutingRules::getRoleName(getOutputRole(i)) << ")";
+        }
+        if (i < (int)controls.outputs.size()) {
+            const OutputControl& output = controls.outputs[i];
+            if (output.muted) ss << " [muted]";
+            if (output.soloed) ss << " [solo]";
+            if (output.gain != 1.0f) ss << " [gain " << output.gain << "]";
+        }
+        if (buffersCreated) {
+            ss << ": " << LevelMeters::formatLevel(meters.getOutputLevel(i));
         }
         ss << "\n";
     }
     
-    ss << "\nRouting:\n";
+    ss << "\nRouting matrix (linear gain, rows = inputs, columns = outputs):\n";
     if (routes.empty()) {
         ss << "  (no routes configured)\n";
     } else {
-        for (const auto& route : routes) {
-            ss << "  In[" << route.inputChannel << "] \"" << inputChannelNames[route.inputChannel] 
-               << "\" -> Out[" << route.outputChannel << "] \"" << outputChannelNames[route.outputChannel] << "\"\n";
+        ss << routes.render(inputChannelNames, outputChannelNames);
+        
+        MixPathCounts counts = mixer.getPathCounts();
+        ss << "\nMix paths:\n";
+        for (int p = 0; p < NumMixPaths; p++) {
+            ss << "  " << MixEngine::getPathName((MixPath)p) << ": " << counts.routes[p] << " route(s)\n";
         }
+        ss << "  scaled routes: " << counts.scaledRoutes << "\n";
+        ss << "  staged inputs: " << counts.stagedInputs << "\n";
+        ss << "  cleared outputs: " << counts.silentOutputs << "\n";
+        ss << "  parallel groups: " << counts.partitions << "\n";
+    }
+    if (!controls.routes.empty()) {
+        ss << "\nRoute controls:\n";
+    }
+    for (const auto& route : controls.routes) {
+        ss << "  " << route.inputChannel << " -> " << route.outputChannel << ":"
+           << (route.muted ? " muted" : "") << (route.soloed ? " solo" : "") << "\n";
     }
     
     return ss.str();
@@ -429,6 +390,7 @@ bool ASIOHost::createBuffers(int preferredSize) {
     }
     
     IASIO* drv = (IASIO*)asioDriver;
+    auto begin = std::chrono::steady_clock::now();
     
     // Get buffer size range
     long minSize, maxSize, preferred, granularity;
@@ -436,13 +398,11 @@ bool ASIOHost::createBuffers(int preferredSize) {
         return false;
     }
     
+    requestedBufferSize = preferredSize;
     bufferSize = (preferredSize > 0) ? preferredSize : preferred;
     if (bufferSize < minSize) bufferSize = minSize;
     if (bufferSize > maxSize) bufferSize = maxSize;
     
-    // Allocate mix buffer
-    mixBuffer.resize(bufferSize);
-    
     // Prepare buffer info structs
     int totalChannels = numInputs + numOutputs;
     std::vector<ASIOBufferInfo> bufferInfos(totalChannels);
@@ -463,25 +423,37 @@ bool ASIOHost::createBuffers(int preferredSize) {
         idx++;
     }
     
-    // Set up callbacks
-    static ASIOCallbacks callbacks;
-    callbacks.bufferSwitch = bufferSwitchCallback;
-    callbacks.sampleRateDidChange = sampleRateChangedCallback;
-    callbacks.asioMessage = asioMessageCallback;
-    callbacks.bufferSwitchTimeInfo = (ASIOTime* (*)(ASIOTime*, long, long))bufferSwitchTimeInfoCallback;
+    // Callbacks that reach this host, whichever others are streaming
+    if (!claimCallbackSlot()) {
+        return false;
+    }
     
     // Create buffers
-    ASIOError err = drv->createBuffers(bufferInfos.data(), totalChannels, bufferSize, &callbacks);
+    ASIOError err = drv->createBuffers(bufferInfos.data(), totalChannels, bufferSize, &slotCallbacks[callbackSlot]);
     if (err != ASE_OK) {
+        releaseCallbackSlot();
         return false;
     }
     
-    // Store buffer pointers
-    inputBuffers[0].resize(numInputs);
-    inputBuffers[1].resize(numInputs);
-    outputBuffers[0].resize(numOutputs);
-    outputBuffers[1].resize(numOutputs);
+    // One locked arena for the pointer tables and the mixer's per-block
+    // state, sized for the worker count the mixer will use
+    int workers = std::min(mixThreads, WorkerPool::getCoreCount()) - 1;
+    mixer.setWorkers(std::max(workers, 0));
+    size_t arenaBytes = StreamArena::bytesFor<void*>(numInputs) * 2 +
+                        StreamArena::bytesFor<void*>(numOutputs) * 2 +
+                        mixer.arenaBytes(numInputs, numOutputs, bufferSize) +
+                        LevelMeters::arenaBytes(numInputs, numOutputs);
+    if (!arena.allocate(arenaBytes)) {
+        drv->disposeBuffers();
+        releaseCallbackSlot();
+        return false;
+    }
+    for (int half = 0; half < 2; half++) {
+        inputBuffers[half] = arena.take<void*>(numInputs);
+        outputBuffers[half] = arena.take<void*>(numOutputs);
+    }
     
+    // Store buffer pointers
     idx = 0;
     for (int i = 0; i < numInputs; i++) {
         inputBuffers[0][i] = bufferInfos[idx].buffers[0];
@@ -494,26 +466,188 @@ bool ASIOHost::createBuffers(int preferredSize) {
         idx++;
     }
     
-    // Detect routing now that we have channel info
-    detectRouting();
+    phases.ms[PhaseCreateBuffers] =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    
+    // Classify the channels and detect routing now that we have channel
+    // info (unless routes were set explicitly), and build the mix plan
+    {
+        PhaseTimer timer(&phases.ms[PhasePlan]);
+        if (!routesSet) {
+            detectRouting();
+        } else {
+            planRouting();
+        }
+        mixer.setRamp((int)(sampleRate * gainRampMs / 1000.0), gainRampShape);
+        mixer.setControls(controls);
+        mixer.configure(inputSampleTypes, outputSampleTypes, routes.getCells(), bufferSize, &arena);
+    }
+    meters.configure(numInputs, numOutputs, bufferSize, sampleRate, &arena);
+    timing.reset(bufferSize, sampleRate);
+    clock.reset(bufferSize, sampleRate);
     
     buffersCreated = true;
+    if (numTaps > 0) {
+        StreamFormat format = getStreamFormat();
+        for (int i = 0; i < numTaps; i++) {
+            taps[i]->prepare(format);
+        }
+    }
     return true;
 }
 
+bool ASIOHost::getBufferSizeRange(long* minSize, long* maxSize, long* preferredSize, long* granularity) const {
+    if (!initialized || !asioDriver) {
+        return false;
+    }
+    return ((IASIO*)asioDriver)->getBufferSize(minSize, maxSize, preferredSize, granularity) == ASE_OK;
+}
+
+bool ASIOHost::reconfigure(int preferredSize) {
+    if (!initialized || !asioDriver) {
+        return false;
+    }
+    auto begin = std::chrono::steady_clock::now();
+    bool wasRunning = running;
+    stop();
+    
+    // disposeBuffers() forgets the routes; this stream keeps them
+    RoutingMatrix kept = routes;
+    bool keptSet = routesSet;
+    MixControls keptControls = controls;
+    disposeBuffers();
+    routes = kept;
+    routesSet = keptSet;
+    controls = keptControls;
+    
+    if (!createBuffers(preferredSize)) {
+        return false;
+    }
+    if (wasRunning && !start()) {
+        return false;
+    }
+    phases.reconfigureMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return true;
+}
+
+bool ASIOHost::processDriverRequests() {
+    if (!requests.isPending()) {
+        return true;
+    }
+    uint64_t taken = CallbackStats::now();
+    PendingRequests pending = requests.take();
+    if (!initialized || !asioDriver) {
+        return true;    // Nothing loaded to recover; the next start reads fresh state
+    }
+    
+    bool ok = true;
+    if (pending.requests & RequestReset) {
+        // Covers every other request
+        ok = resetDriver();
+    } else if (pending.requests & (RequestBufferSize | RequestSampleRate)) {
+        if (pending.requests & RequestSampleRate) {
+            ((IASIO*)asioDriver)->getSampleRate(&sampleRate);
+        }
+        int size = (pending.requests & RequestBufferSize) ? (int)pending.bufferSize : requestedBufferSize;
+        ok = reconfigure(size);
+    } else if (pending.requests & RequestResync) {
+        // The driver lost its position; the clock monitor sees the jump by
+        // itself, but outputs may hold stale samples
+        mixer.invalidateOutputs();
+    }
+    // RequestLatencies alone needs nothing: latencies are not cached
+    
+    if (!ok) {
+        stop();
+        disposeBuffers();
+    }
+    requests.recordRecovery(pending, taken, ok);
+    return ok;
+}
+
+bool ASIOHost::resetDriver() {
+    bool wasRunning = running;
+    stop();
+    RoutingMatrix kept = routes;
+    bool keptSet = routesSet;
+    MixControls keptControls = controls;
+    std::vector<std::string> inputs = inputChannelNames;
+    std::vector<std::string> outputs = outputChannelNames;
+    disposeBuffers();
+    
+    // The SDK asks for the driver to be released and loaded again; one the
+    // caller attached can only be initialized again
+    channelCache.erase(driverName);
+    if (fromRegistry) {
+        std::string name = driverName;
+        if (!loadDriver(name)) {
+            return false;
+        }
+    }
+    if (!initialize(systemHandle)) {
+        return false;
+    }
+    
+    // Routes refer to channels by index; keep them only for the same
+    // channels. Output controls need only the same outputs, and route
+    // controls the same two ends.
+    if (inputChannelNames == inputs && outputChannelNames == outputs) {
+        routes = kept;
+        routesSet = keptSet;
+        controls = keptControls;
+    } else {
+        auto sameChannel = [](const std::vector<std::string>& before, const std::vector<std::string>& after, int ch) {
+            return ch < (int)before.size() && ch < (int)after.size() && before[ch] == after[ch];
+        };
+        if (outputChannelNames == outputs) {
+            controls.outputs = keptControls.outputs;
+        }
+        for (const auto& route : keptControls.routes) {
+            if (sameChannel(inputs, inputChannelNames, route.inputChannel) &&
+                sameChannel(outputs, outputChannelNames, route.outputChannel)) {
+                controls.routes.push_back(route);
+            }
+        }
+    }
+    if (!createBuffers(requestedBufferSize)) {
+        return false;
+    }
+    return !wasRunning || start();
+}
+
+void ASIOHost::postRequest(DriverRequest request, long frames, double rate) {
+    if (request == RequestBufferSize) {
+        requests.postBufferSize(frames);
+    } else if (request == RequestSampleRate) {
+        requests.postSampleRate(rate);
+    } else {
+        requests.post(request);
+    }
+    if (requestNotify) {
+        requestNotify();
+    }
+}
+
 void ASIOHost::disposeBuffers() {
     if (buffersCreated && asioDriver) {
+        PhaseTimer timer(&phases.ms[PhaseDisposeBuffers]);
         IASIO* drv = (IASIO*)asioDriver;
         drv->disposeBuffers();
         buffersCreated = false;
     }
+    releaseCallbackSlot();
     
-    inputBuffers[0].clear();
-    inputBuffers[1].clear();
-    outputBuffers[0].clear();
-    outputBuffers[1].clear();
-    mixBuffer.clear();
+    for (int half = 0; half < 2; half++) {
+        inputBuffers[half] = nullptr;
+        outputBuffers[half] = nullptr;
+    }
+    mixer.clear();
+    meters.clear();
+    arena.release();
     routes.clear();
+    routesSet = false;
+    controls = MixControls();
 }
 
 bool ASIOHost::start() {
@@ -521,12 +655,17 @@ bool ASIOHost::start() {
         return false;
     }
     
+    PhaseTimer timer(&phases.ms[PhaseStart]);
+    
+    // Drivers may call back before start() returns, so be ready first
+    running.store(true, std::memory_order_release);
+    
     IASIO* drv = (IASIO*)asioDriver;
     if (drv->start() != ASE_OK) {
+        running.store(false, std::memory_order_release);
         return false;
     }
     
-    running = true;
     return true;
 }
 
@@ -535,183 +674,307 @@ bool ASIOHost::stop() {
         return false;
     }
     
+    PhaseTimer timer(&phases.ms[PhaseStop]);
     IASIO* drv = (IASIO*)asioDriver;
     drv->stop();
-    running = false;
+    running.store(false, std::memory_order_release);
     return true;
 }
 
-int ASIOHost::getBytesPerSample(ASIOSampleType type) const {
-    switch (type) {
-        case ASIOSTInt16MSB:
-        case ASIOSTInt16LSB:
-            return 2;
-        case ASIOSTInt24MSB:
-        case ASIOSTInt24LSB:
-            return 3;
-        case ASIOSTInt32MSB:
-        case ASIOSTInt32LSB:
-        case ASIOSTInt32MSB16:
-        case ASIOSTInt32MSB18:
-        case ASIOSTInt32MSB20:
-        case ASIOSTInt32MSB24:
-        case ASIOSTInt32LSB16:
-        case ASIOSTInt32LSB18:
-        case ASIOSTInt32LSB20:
-        case ASIOSTInt32LSB24:
-        case ASIOSTFloat32MSB:
-        case ASIOSTFloat32LSB:
-            return 4;
-        case ASIOSTFloat64MSB:
-        case ASIOSTFloat64LSB:
-            return 8;
-        default:
-            return 4;
-    }
-}
-
-float ASIOHost::sampleToFloat(void* buffer, int sampleIndex, ASIOSampleType type) const {
-    switch (type) {
-        case ASIOSTInt32LSB: {
-            int32_t* buf = (int32_t*)buffer;
-            return buf[sampleIndex] / 2147483648.0f;
-        }
-        case ASIOSTInt16LSB: {
-            int16_t* buf = (int16_t*)buffer;
-            return buf[sampleIndex] / 32768.0f;
-        }
-        case ASIOSTInt24LSB: {
-            uint8_t* buf = (uint8_t*)buffer + sampleIndex * 3;
-            int32_t val = (buf[0]) | (buf[1] << 8) | (buf[2] << 16);
-            if (val & 0x800000) val |= 0xFF000000;  // Sign extend
-            return val / 8388608.0f;
-        }
-        case ASIOSTFloat32LSB: {
-            float* buf = (float*)buffer;
-            return buf[sampleIndex];
-        }
-        case ASIOSTFloat64LSB: {
-            double* buf = (double*)buffer;
-            return (float)buf[sampleIndex];
-        }
-        default:
-            // Assume 32-bit int LSB as fallback
-            return ((int32_t*)buffer)[sampleIndex] / 2147483648.0f;
+StreamFormat ASIOHost::getStreamFormat() const {
+    StreamFormat format;
+    format.numInputs = numInputs;
+    format.numOutputs = numOutputs;
+    format.inputTypes = inputSampleTypes;
+    format.outputTypes = outputSampleTypes;
+    format.bufferSize = bufferSize;
+    format.sampleRate = sampleRate;
+    return format;
+}
+
+bool ASIOHost::addTap(StreamTap* tap) {
+    if (!tap || running || numTaps == kMaxTaps) {
+        return false;
+    }
+    for (int i = 0; i < numTaps; i++) {
+        if (taps[i] == tap) return true;
+    }
+    if (buffersCreated) {
+        tap->prepare(getStreamFormat());
     }
+    taps[numTaps++] = tap;
+    return true;
 }
 
-void ASIOHost::floatToSample(float value, void* buffer, int sampleIndex, ASIOSampleType type) const {
-    // Clamp to valid range
-    value = std::max(-1.0f, std::min(1.0f, value));
-    
-    switch (type) {
-        case ASIOSTInt32LSB: {
-            int32_t* buf = (int32_t*)buffer;
-            buf[sampleIndex] = (int32_t)(value * 2147483647.0f);
-            break;
-        }
-        case ASIOSTInt16LSB: {
-            int16_t* buf = (int16_t*)buffer;
-            buf[sampleIndex] = (int16_t)(value * 32767.0f);
-            break;
+bool ASIOHost::removeTap(StreamTap* tap) {
+    if (running) {
+        return false;
+    }
+    for (int i = 0; i < numTaps; i++) {
+        if (taps[i] == tap) {
+            for (int j = i + 1; j < numTaps; j++) {
+                taps[j - 1] = taps[j];
+            }
+            taps[--numTaps] = nullptr;
+            return true;
         }
-        case ASIOSTInt24LSB: {
-            int32_t val = (int32_t)(value * 8388607.0f);
-            uint8_t* buf = (uint8_t*)buffer + sampleIndex * 3;
-            buf[0] = val & 0xFF;
-            buf[1] = (val >> 8) & 0xFF;
-            buf[2] = (val >> 16) & 0xFF;
-            break;
+    }
+    return false;
+}
+
+const char* ASIOHost::getPhaseName(HostPhase phase) {
+    static const char* const kNames[NumHostPhases] = {
+        "load driver", "initialize", "channel info", "create buffers",
+        "plan routing", "start", "stop", "dispose buffers"
+    };
+    return (phase >= 0 && phase < NumHostPhases) ? kNames[phase] : "unknown";
+}
+
+std::string ASIOHost::formatPhaseTimes(const HostPhaseTimes& times) {
+    std::stringstream ss;
+    char line[96];
+    for (int p = 0; p < NumHostPhases; p++) {
+        if (times.ms[p] < 0) {
+            continue;
         }
-        case ASIOSTFloat32LSB: {
-            float* buf = (float*)buffer;
-            buf[sampleIndex] = value;
-            break;
+        snprintf(line, sizeof(line), "  %-16s %8.2f ms%s\n", getPhaseName((HostPhase)p), times.ms[p],
+                 ((p == PhaseChannelInfo && times.channelInfoCached) ||
+                  (p == PhasePlan && times.routingCached)) ? " (cached)" : "");
+        ss << line;
+    }
+    if (times.reconfigureMs >= 0) {
+        snprintf(line, sizeof(line), "  Last reconfigure: %.2f ms without audio\n", times.reconfigureMs);
+        ss << line;
+    }
+    return ss.str();
+}
+
+bool ASIOHost::setRoutes(const RoutingMatrix& matrix) {
+    routes = matrix;
+    routesSet = true;
+    return publishRoutes();
+}
+
+bool ASIOHost::clearRoutes() {
+    return setRoutes(RoutingMatrix());
+}
+
+bool ASIOHost::setRouteGain(int inputChannel, int outputChannel, float gain) {
+    if (inputChannel < 0 || inputChannel >= numInputs ||
+        outputChannel < 0 || outputChannel >= numOutputs) {
+        return false;
+    }
+    routes.setGain(inputChannel, outputChannel, gain);
+    routesSet = true;
+    return publishRoutes();
+}
+
+bool ASIOHost::redetectRouting() {
+    if (!initialized) {
+        return false;
+    }
+    detectRouting();
+    return publishRoutes();
+}
+
+bool ASIOHost::setMixControls(const MixControls& mixControls) {
+    controls = mixControls;
+    return publishControls();
+}
+
+OutputControl* ASIOHost::getOutputControl(int outputChannel) {
+    if (outputChannel < 0 || outputChannel >= numOutputs) {
+        return nullptr;
+    }
+    if ((int)controls.outputs.size() <= outputChannel) {
+        controls.outputs.resize(outputChannel + 1);
+    }
+    return &controls.outputs[outputChannel];
+}
+
+RouteControl* ASIOHost::getRouteControl(int inputChannel, int outputChannel) {
+    if (inputChannel < 0 || inputChannel >= numInputs ||
+        outputChannel < 0 || outputChannel >= numOutputs) {
+        return nullptr;
+    }
+    for (auto& route : controls.routes) {
+        if (route.inputChannel == inputChannel && route.outputChannel == outputChannel) {
+            return &route;
         }
-        case ASIOSTFloat64LSB: {
-            double* buf = (double*)buffer;
-            buf[sampleIndex] = value;
-            break;
+    }
+    controls.routes.push_back({ inputChannel, outputChannel, false, false });
+    return &controls.routes.back();
+}
+
+bool ASIOHost::setOutputGain(int outputChannel, float gain) {
+    OutputControl* output = getOutputControl(outputChannel);
+    if (!output) {
+        return false;
+    }
+    output->gain = gain;
+    return publishControls();
+}
+
+bool ASIOHost::setOutputMute(int outputChannel, bool muted) {
+    OutputControl* output = getOutputControl(outputChannel);
+    if (!output) {
+        return false;
+    }
+    output->muted = muted;
+    return publishControls();
+}
+
+bool ASIOHost::setOutputSolo(int outputChannel, bool soloed) {
+    OutputControl* output = getOutputControl(outputChannel);
+    if (!output) {
+        return false;
+    }
+    output->soloed = soloed;
+    return publishControls();
+}
+
+bool ASIOHost::setRouteMute(int inputChannel, int outputChannel, bool muted) {
+    RouteControl* route = getRouteControl(inputChannel, outputChannel);
+    if (!route) {
+        return false;
+    }
+    route->muted = muted;
+    return publishControls();
+}
+
+bool ASIOHost::setRouteSolo(int inputChannel, int outputChannel, bool soloed) {
+    RouteControl* route = getRouteControl(inputChannel, outputChannel);
+    if (!route) {
+        return false;
+    }
+    route->soloed = soloed;
+    return publishControls();
+}
+
+void ASIOHost::setGainRamp(double ms, RampShape shape) {
+    gainRampMs = std::max(ms, 0.0);
+    gainRampShape = shape;
+}
+
+bool ASIOHost::publishControls() {
+    // Unset route flags are dropped so the list stays short
+    size_t kept = 0;
+    for (const auto& route : controls.routes) {
+        if (route.muted || route.soloed) {
+            controls.routes[kept++] = route;
         }
-        default:
-            ((int32_t*)buffer)[sampleIndex] = (int32_t)(value * 2147483647.0f);
-            break;
     }
+    controls.routes.resize(kept);
+
+    if (!buffersCreated) {
+        return true;
+    }
+    return mixer.setControls(controls);
+}
+
+bool ASIOHost::publishRoutes() {
+    // Before createBuffers the matrix is just stored; createBuffers plans it
+    if (!buffersCreated) {
+        return true;
+    }
+    return mixer.setRoutes(routes.getCells());
 }
 
 void ASIOHost::bufferSwitch(long index, bool directProcess) {
-    if (!running) {
+    if (!running.load(std::memory_order_acquire)) {
         return;
     }
-    
-    // Clear all output buffers first
-    for (int ch = 0; ch < numOutputs; ch++) {
-        int bytes = getBytesPerSample(outputSampleTypes[ch]) * bufferSize;
-        memset(outputBuffers[index][ch], 0, bytes);
+    uint64_t begin = CallbackStats::now();
+    
+    // Taps that supply audio write their inputs before the mix reads them
+    StreamBlock block;
+    if (numTaps > 0) {
+        block.inputs = inputBuffers[index];
+        block.outputs = outputBuffers[index];
+        block.frames = bufferSize;
+        int64_t position;
+        if (!clock.getBlockTime(&position, &block.systemTimeNs)) {
+            block.systemTimeNs = 0;
+        }
+        block.callbackNs = (int64_t)begin;
+        for (int i = 0; i < numTaps; i++) {
+            taps[i]->feed(block);
+        }
     }
     
-    // Process routes: copy and sum inputs to outputs
-    for (const auto& route : routes) {
-        int inCh = route.inputChannel;
-        int outCh = route.outputChannel;
-        
-        if (inCh >= numInputs || outCh >= numOutputs) continue;
-        
-        ASIOSampleType inType = inputSampleTypes[inCh];
-        ASIOSampleType outType = outputSampleTypes[outCh];
-        
-        void* inBuf = inputBuffers[index][inCh];
-        void* outBuf = outputBuffers[index][outCh];
-        
-        // If sample types match and this is the only route to this output,
-        // we could do a direct memcpy. But for mixing we need to sum.
-        
-        for (int i = 0; i < bufferSize; i++) {
-            float inSample = sampleToFloat(inBuf, i, inType);
-            float outSample = sampleToFloat(outBuf, i, outType);
-            floatToSample(inSample + outSample, outBuf, i, outType);
-        }
+    // Mix all routes through the float bus using the current plan snapshot;
+    // silent inputs are skipped and outputs that are already zero are not
+    // cleared again
+    mixer.process(index, inputBuffers[index], outputBuffers[index]);
+    meters.update(mixer.getInputLevels(), mixer.getOutputLevels());
+    
+    for (int i = 0; i < numTaps; i++) {
+        taps[i]->process(block);
     }
     
     // Notify driver we're ready
     if (asioDriver) {
         ((IASIO*)asioDriver)->outputReady();
     }
+    
+    timing.record(begin, CallbackStats::now());
 }
 
-// Static callbacks
-void ASIOHost::bufferSwitchCallback(long index, long directProcess) {
-    if (instance) {
-        instance->bufferSwitch(index, directProcess != 0);
+bool ASIOHost::claimCallbackSlot() {
+    if (callbackSlot >= 0) {
+        return true;
     }
+    for (int slot = 0; slot < kCallbackSlots; slot++) {
+        ASIOHost* none = nullptr;
+        if (slotHosts[slot].compare_exchange_strong(none, this, std::memory_order_acq_rel)) {
+            callbackSlot = slot;
+            return true;
+        }
+    }
+    return false;
 }
 
-void ASIOHost::sampleRateChangedCallback(double sRate) {
-    if (instance) {
-        instance->sampleRate = sRate;
+void ASIOHost::releaseCallbackSlot() {
+    if (callbackSlot >= 0) {
+        slotHosts[callbackSlot].store(nullptr, std::memory_order_release);
+        callbackSlot = -1;
     }
 }
 
-long ASIOHost::asioMessageCallback(long selector, long value, void* message, double* opt) {
+// Driver callbacks
+void ASIOHost::sampleRateChanged(double sRate) {
+    // Applied on the control thread; the stream is rebuilt for the new rate
+    postRequest(RequestSampleRate, 0, sRate);
+}
+
+long ASIOHost::asioMessage(long selector, long value) {
     switch (selector) {
         case kAsioSelectorSupported:
             if (value == kAsioResetRequest || 
+                value == kAsioBufferSizeChange ||
                 value == kAsioEngineVersion ||
                 value == kAsioResyncRequest ||
                 value == kAsioLatenciesChanged ||
-                value == kAsioSupportsTimeInfo ||
-                value == kAsioSupportsTimeCode) {
+                value == kAsioSupportsTimeInfo) {
                 return 1;
             }
             return 0;
         case kAsioEngineVersion:
             return 2;
+        // Requests are handed to the control thread (processDriverRequests)
         case kAsioResetRequest:
+            postRequest(RequestReset);
+            return 1;
+        case kAsioBufferSizeChange:
+            if (value <= 0) return 0;
+            postRequest(RequestBufferSize, value);
+            return 1;
         case kAsioResyncRequest:
+            postRequest(RequestResync);
+            return 1;
         case kAsioLatenciesChanged:
+            postRequest(RequestLatencies);
             return 1;
-        case kAsioBufferSizeChange:
-            return 0;
         case kAsioSupportsTimeInfo:
             return 1;
         case kAsioSupportsTimeCode:
@@ -720,9 +983,15 @@ long ASIOHost::asioMessageCallback(long selector, long value, void* message, dou
     return 0;
 }
 
-void* ASIOHost::bufferSwitchTimeInfoCallback(void* timeInfo, long index, long directProcess) {
-    if (instance) {
-        instance->bufferSwitch(index, directProcess != 0);
-    }
-    return timeInfo;
+void ASIOHost::bufferSwitchTimeInfo(void* timeInfo, long index, long directProcess) {
+    // The driver already filled in position and time; no extra calls
+    const AsioTimeInfo& info = ((ASIOTime*)timeInfo)->timeInfo;
+    const unsigned long needed = kSamplePositionValid | kSystemTimeValid;
+    if ((info.flags & needed) == needed && running.load(std::memory_order_acquire)) {
+        clock.update(
+            asioToInt64(info.samplePosition.hi, info.samplePosition.lo),
+            asioToInt64(info.systemTime.hi, info.systemTime.lo),
+            (info.flags & kSampleRateValid) ? info.sampleRate : 0.0);
+    }
+    bufferSwitch(index, directProcess != 0);
 }
@@ -1,61 +1,52 @@
 #pragma once
 
-#include <windows.h>
+#include "asio_types.h"
+#include "callback_stats.h"
+#include "clock_monitor.h"
+#include "driver_requests.h"
+#include "level_meters.h"
+#include "mix_engine.h"
+#include "routing_rules.h"
+#include "stream_arena.h"
+#include "stream_tap.h"
+#include <atomic>
+#include <map>
 #include <string>
 #include <vector>
 #include <functional>
 
-// Forward declarations for ASIO types
+// Forward declarations for ASIO types (see asio_iface.h)
 struct ASIODriverInfo;
 struct ASIOChannelInfo;
 struct ASIOBufferInfo;
 struct ASIOCallbacks;
-
-// ASIO sample types
-enum ASIOSampleType {
-    ASIOSTInt16MSB = 0,
-    ASIOSTInt24MSB = 1,
-    ASIOSTInt32MSB = 2,
-    ASIOSTFloat32MSB = 3,
-    ASIOSTFloat64MSB = 4,
-    ASIOSTInt32MSB16 = 8,
-    ASIOSTInt32MSB18 = 9,
-    ASIOSTInt32MSB20 = 10,
-    ASIOSTInt32MSB24 = 11,
-    ASIOSTInt16LSB = 16,
-    ASIOSTInt24LSB = 17,
-    ASIOSTInt32LSB = 18,
-    ASIOSTFloat32LSB = 19,
-    ASIOSTFloat64LSB = 20,
-    ASIOSTInt32LSB16 = 24,
-    ASIOSTInt32LSB18 = 25,
-    ASIOSTInt32LSB20 = 26,
-    ASIOSTInt32LSB24 = 27,
-};
-
-// ASIO error codes
-enum ASIOError {
-    ASE_OK = 0,
-    ASE_SUCCESS = 0x3f4847a0,
-    ASE_NotPresent = -1000,
-    ASE_HWMalfunction,
-    ASE_InvalidParameter,
-    ASE_InvalidMode,
-    ASE_SPNotAdvancing,
-    ASE_NoClock,
-    ASE_NoMemory
-};
+class IASIO;
 
 // Simplified ASIO driver info
 struct DriverInfo {
     std::string name;
-    CLSID clsid;
+    std::string clsid;  // Registry form, "{xxxxxxxx-...}"
+};
+
+// Control-path steps, timed each time they run so the cost of starting
+// and reconfiguring (and the dropout it causes) is visible
+enum HostPhase {
+    PhaseLoadDriver = 0,    // Registry lookup and CoCreateInstance
+    PhaseInitialize,        // init() and getChannels()
+    PhaseChannelInfo,       // getChannelInfo() per channel, unless cached
+    PhaseCreateBuffers,     // Driver buffers and the stream arena
+    PhasePlan,              // Routing detection and the first mix plan
+    PhaseStart,
+    PhaseStop,
+    PhaseDisposeBuffers,
+    NumHostPhases
 };
 
-// Channel routing: which inputs go to which outputs
-struct ChannelRoute {
-    int inputChannel;   // Source input channel
-    int outputChannel;  // Destination output channel
+struct HostPhaseTimes {
+    double ms[NumHostPhases];   // Latest run of each phase, -1 if it has not run
+    bool channelInfoCached;     // The latest initialize() reused cached channel info
+    bool routingCached;         // The latest routing plan was reused for the same channels and rules
+    double reconfigureMs;       // Latest reconfigure(), stop to streaming again; -1 if none
 };
 
 class ASIOHost {
@@ -63,17 +54,28 @@ public:
     ASIOHost();
     ~ASIOHost();
 
-    // Get list of available ASIO drivers
-    static std::vector<DriverInfo> getDriverList();
+    // Installed ASIO drivers. The registry is read once and cached; pass
+    // refresh to read it again.
+    static std::vector<DriverInfo> getDriverList(bool refresh = false);
 
-    // Load a specific driver by name
+    // Load a specific driver by name. The cached driver list is re-read
+    // once if the name is not in it.
     bool loadDriver(const std::string& driverName);
     
+    // Use a driver object created by the caller (e.g. a mock driver). The
+    // host takes over the caller's reference and releases it on unload.
+    bool attachDriver(IASIO* driver, const std::string& driverName);
+    
     // Unload current driver
     void unloadDriver();
 
-    // Initialize the driver
-    bool initialize(HWND hwnd);
+    // Initialize the driver. sysHandle is the window handle on Windows.
+    // Channel names and types are cached per driver and reused while the
+    // driver reports the same channel counts.
+    bool initialize(void* sysHandle);
+
+    // Forget cached channel info, so the next initialize() asks the driver
+    void clearChannelCache() { channelCache.clear(); }
 
     // Get channel counts
     int getInputChannels() const { return numInputs; }
@@ -85,9 +87,24 @@ public:
     // Get buffer size
     int getBufferSize() const { return bufferSize; }
 
+    // Mix on up to this many threads, the driver's included (1 = serial).
+    // Capped at the core count; takes effect at the next createBuffers.
+    void setMixThreads(int threads) { mixThreads = threads; }
+    int getMixThreads() const { return mixThreads; }
+
+    // Buffer sizes the driver accepts (granularity -1 = powers of two)
+    bool getBufferSizeRange(long* minSize, long* maxSize, long* preferredSize, long* granularity) const;
+
     // Create buffers and prepare for streaming
     bool createBuffers(int preferredSize = 0);
 
+    // Recreate the buffers at a new size (0 = the driver's preferred) and
+    // with the current mix thread setting, keeping the loaded, initialized
+    // driver and the routes, and resume streaming if it was running. The
+    // stop-to-start gap is reported as reconfigureMs. Routing changes need
+    // none of this; see setRoutes().
+    bool reconfigure(int preferredSize = 0);
+
     // Start audio streaming
     bool start();
 
@@ -110,21 +127,120 @@ public:
     // Get routing info as string for display
     std::string getRoutingInfo() const;
 
+    // Routing matrix. Changes are published to the audio callback as a new
+    // mix plan, so they apply while audio runs without stopping the driver.
+    // Until routes are set, createBuffers detects them from the channel
+    // names. Routes set here, even none, are kept across reconfigure() and
+    // driver requests until the buffers are disposed or the channels change.
+    const RoutingMatrix& getRoutes() const { return routes; }
+    bool setRoutes(const RoutingMatrix& matrix);
+    bool setRouteGain(int inputChannel, int outputChannel, float gain);
+    bool clearRoutes();
+
+    // Rebuild the default virtual-to-hardware routing
+    bool redetectRouting();
+
+    // Mute, solo and gain on top of the routes (see MixControls). Changes
+    // ramp over the gain ramp instead of clicking, and are kept and dropped
+    // together with the routes.
+    const MixControls& getMixControls() const { return controls; }
+    bool setMixControls(const MixControls& mixControls);
+    bool setOutputGain(int outputChannel, float gain);
+    bool setOutputMute(int outputChannel, bool muted);
+    bool setOutputSolo(int outputChannel, bool soloed);
+    bool setRouteMute(int inputChannel, int outputChannel, bool muted);
+    bool setRouteSolo(int inputChannel, int outputChannel, bool soloed);
+
+    // Length of a full-scale gain ramp (default 5 ms, linear); 0 switches
+    // changes at the next block. Takes effect at the next createBuffers.
+    void setGainRamp(double ms, RampShape shape = RampLinear);
+
+    // Rules that classify channels by name for the default routing (see
+    // RoutingRules). Channel roles follow new rules at once; the routes
+    // only at the next redetectRouting() or fresh createBuffers. The plan
+    // is cached per driver and reused while its channel names and the
+    // rules are unchanged.
+    void setRoutingRules(const RoutingRules& rules);
+    const RoutingRules& getRoutingRules() const { return routingRules; }
+
+    // Role of each channel under the rules, RoleNone before the first plan
+    ChannelRole getInputRole(int channel) const;
+    ChannelRole getOutputRole(int channel) const;
+
+    // Memory set aside for the stream, and whether it is locked in RAM
+    size_t getStreamMemoryBytes() const { return arena.getSize(); }
+    bool isStreamMemoryLocked() const { return arena.isLocked(); }
+
+    // Callback timing against the block deadline since createBuffers
+    CallbackTimingReport getTimingReport() const { return timing.getReport(); }
+
+    // Peak and RMS level of each channel, measured as the callback converts
+    // it. Poll from any thread at any rate; readers never block the callback.
+    // Silence while no buffers exist.
+    ChannelLevel getInputLevel(int channel) const { return meters.getInputLevel(channel); }
+    ChannelLevel getOutputLevel(int channel) const { return meters.getOutputLevel(channel); }
+
+    // Xruns and clock drift, from the time info the driver passes with
+    // each block (drivers that only call bufferSwitch report nothing)
+    ClockReport getClockReport() const { return clock.getReport(); }
+
+    // Sample position and system time (ns) of the latest block, for taps
+    // that need to timestamp audio. False until a time-stamped block arrives.
+    bool getBlockTime(int64_t* samplePosition, int64_t* systemTimeNs) const {
+        return clock.getBlockTime(samplePosition, systemTimeNs);
+    }
+
+    // Requests the driver makes through asioMessage and sampleRateDidChange
+    // (reset, buffer size or rate change, resync) arrive on its thread and
+    // wait here for the control thread. notify is called on the driver's
+    // thread after each one, e.g. to post a window message, and must not
+    // block. Set it before loading a driver.
+    void setRequestNotify(std::function<void()> notify) { requestNotify = notify; }
+    bool hasDriverRequests() const { return requests.isPending(); }
+
+    // Control thread: act on pending requests with the least work each
+    // needs. A reset re-initializes the driver (keeping the routes if the
+    // channels are unchanged, and the mix controls of unchanged channels),
+    // a buffer size or rate change recreates the buffers, a resync only
+    // re-clears the outputs. False if the stream could not be brought
+    // back; it is then stopped.
+    bool processDriverRequests();
+    DriverRequestReport getRequestReport() const { return requests.getReport(); }
+
+    // Channel counts, sample types, block size and rate of the stream
+    StreamFormat getStreamFormat() const;
+
+    // Taps run on the driver's thread around each mix (feed before it,
+    // process after it), in the order added. Add and remove them while the
+    // stream is stopped; a tap added after createBuffers is prepared at
+    // once. The host does not own them.
+    static const int kMaxTaps = 4;
+    bool addTap(StreamTap* tap);
+    bool removeTap(StreamTap* tap);
+
+    // How long each control-path phase took the last time it ran
+    HostPhaseTimes getPhaseTimes() const { return phases; }
+    static const char* getPhaseName(HostPhase phase);
+    static std::string formatPhaseTimes(const HostPhaseTimes& times);
+
     // Callback for buffer switch (called from ASIO driver)
     void bufferSwitch(long index, bool directProcess);
 
 private:
-    void* asioDriver = nullptr;
     std::string driverName;
     
     int numInputs = 0;
     int numOutputs = 0;
     double sampleRate = 44100.0;
     int bufferSize = 512;
+    int mixThreads = 1;
+    int requestedBufferSize = 0;        // As passed to the last createBuffers
+    void* systemHandle = nullptr;       // As passed to initialize
+    bool fromRegistry = false;          // Loaded by loadDriver, so it can be reloaded
+    std::function<void()> requestNotify;
     
     bool initialized = false;
     bool buffersCreated = false;
-    bool running = false;
 
     // Channel info
     std::vector<std::string> inputChannelNames;
@@ -132,40 +248,103 @@ private:
     std::vector<ASIOSampleType> inputSampleTypes;
     std::vector<ASIOSampleType> outputSampleTypes;
 
-    // Intelligent routing
-    std::vector<ChannelRoute> routes;
-    
-    // Mixing buffer for combining multiple inputs
-    std::vector<float> mixBuffer;
+    // Channel names and types per driver name, from the last initialize()
+    struct ChannelInfoCache {
+        std::vector<std::string> inputNames;
+        std::vector<std::string> outputNames;
+        std::vector<ASIOSampleType> inputTypes;
+        std::vector<ASIOSampleType> outputTypes;
+    };
+    std::map<std::string, ChannelInfoCache> channelCache;
+
+    HostPhaseTimes phases = { { -1, -1, -1, -1, -1, -1, -1, -1 }, false, false, -1 };
+
+    // Intelligent routing: sparse input x output gain matrix
+    RoutingMatrix routes;
+    bool routesSet = false;             // routes came from the caller, not detection
+    MixControls controls;
+    double gainRampMs = 5.0;
+    RampShape gainRampShape = RampLinear;
+
+    // Default routing from the rules, and the channel roles behind it
+    RoutingRules routingRules;
+    RoutingMatrix plannedRoutes;
+    std::vector<ChannelRole> inputRoles;
+    std::vector<ChannelRole> outputRoles;
+
+    // The last plan per driver name, for the channels and rules it was made for
+    struct RoutingPlanCache {
+        uint64_t rulesHash;
+        std::vector<std::string> inputNames;
+        std::vector<std::string> outputNames;
+        std::vector<ChannelRole> inputRoles;
+        std::vector<ChannelRole> outputRoles;
+        RoutingMatrix routes;
+    };
+    std::map<std::string, RoutingPlanCache> planCache;
+
+    // Everything the callback writes or reads per block: the buffer
+    // pointer tables and the mixer's state. Sized in createBuffers.
+    StreamArena arena;
 
-    // Buffer pointers
-    std::vector<void*> inputBuffers[2];
-    std::vector<void*> outputBuffers[2];
+    // Driver-thread state from here on. It starts on a fresh cache line so
+    // the control-thread fields above never share a line with it.
+    alignas(StreamArena::kCacheLine) std::atomic<bool> running{false};
+    void* asioDriver = nullptr;         // Set while no stream is running
+    void** inputBuffers[2] = {};        // Per buffer half, one pointer per channel
+    void** outputBuffers[2] = {};
+
+    // Float mix bus that executes the matrix
+    MixEngine mixer;
+
+    // Per-callback duration histogram and deadline counters
+    CallbackStats timing;
+
+    // Xrun and drift tracking from ASIOTime
+    ClockMonitor clock;
+
+    // Channel levels, published for the UI
+    LevelMeters meters;
+
+    // Driver requests posted from the driver's thread
+    DriverRequests requests;
+
+    // Set while stopped; running's release store publishes them
+    StreamTap* taps[kMaxTaps] = {};
+    int numTaps = 0;
+
+    // Callback slot this host's buffers were created with, -1 if none
+    int callbackSlot = -1;
+
+    // Classify the channels and plan the default routing, or reuse the
+    // cached plan
+    void planRouting();
 
     // Detect and setup channel routing
     void detectRouting();
-    
-    // Helper: check if channel name looks like a SAR virtual endpoint
-    bool isVirtualEndpointName(const std::string& name) const;
-    
-    // Helper: check if channel name looks like hardware I/O
-    bool isHardwareChannelName(const std::string& name) const;
 
-    // Helper: get bytes per sample for a sample type
-    int getBytesPerSample(ASIOSampleType type) const;
+    // Find or add the control of an output or route
+    OutputControl* getOutputControl(int outputChannel);
+    RouteControl* getRouteControl(int inputChannel, int outputChannel);
+    bool publishControls();
+
+    // Hand the matrix to the mixer as a new plan
+    bool publishRoutes();
 
-    // Helper: convert sample to float
-    float sampleToFloat(void* buffer, int sampleIndex, ASIOSampleType type) const;
+    // kAsioResetRequest: reload or re-initialize the driver and rebuild the stream
+    bool resetDriver();
 
-    // Helper: convert float to sample
-    void floatToSample(float value, void* buffer, int sampleIndex, ASIOSampleType type) const;
+    // Post a driver request and wake the control thread
+    void postRequest(DriverRequest request, long bufferSize = 0, double sampleRate = 0.0);
 
-    // Static instance for callbacks
-    static ASIOHost* instance;
+    // ASIO callbacks carry no context, so each streaming host takes a slot
+    // with its own set of callback functions (see CallbackSlot)
+    template <int Slot> friend struct CallbackSlot;
+    bool claimCallbackSlot();
+    void releaseCallbackSlot();
     
-    // ASIO callbacks
-    static void bufferSwitchCallback(long index, long directProcess);
-    static void sampleRateChangedCallback(double sRate);
-    static long asioMessageCallback(long selector, long value, void* message, double* opt);
-    static void* bufferSwitchTimeInfoCallback(void* timeInfo, long index, long directProcess);
+    // Driver callbacks, reached through the slot
+    void sampleRateChanged(double sRate);
+    long asioMessage(long selector, long value);
+    void bufferSwitchTimeInfo(void* timeInfo, long index, long directProcess);
 };
@@ -0,0 +1,161 @@
+#pragma once
+
+// ASIO driver interface (COM-based, no SDK needed). Drivers are normally
+// loaded through COM on Windows; anything implementing IASIO can also be
+// attached directly (see ASIOHost::attachDriver), which is how the mock
+// driver used by the benchmarks runs on any platform.
+
+#include "asio_types.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+// Just enough of COM's IUnknown for in-process drivers off Windows, with
+// the same spelling so a driver class builds on either side
+typedef long HRESULT;
+typedef unsigned long ULONG;
+typedef const void* REFIID;
+#define STDMETHODCALLTYPE
+#define S_OK ((HRESULT)0)
+#define E_NOINTERFACE ((HRESULT)0x80004002L)
+
+class IUnknown {
+public:
+    virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** object) = 0;
+    virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+    virtual ULONG STDMETHODCALLTYPE Release() = 0;
+};
+#endif
+
+#pragma pack(push, 4)
+
+struct ASIODriverInfo {
+    long asioVersion;
+    long driverVersion;
+    char name[32];
+    char errorMessage[124];
+    void* sysRef;
+};
+
+struct ASIOClockSource {
+    long index;
+    long associatedChannel;
+    long associatedGroup;
+    long isCurrentSource;
+    char name[32];
+};
+
+struct ASIOChannelInfo {
+    long channel;
+    long isInput;
+    long isActive;
+    long channelGroup;
+    ASIOSampleType type;
+    char name[32];
+};
+
+struct ASIOBufferInfo {
+    long isInput;
+    long channelNum;
+    void* buffers[2];
+};
+
+// 64-bit sample counts and nanosecond timestamps, split as in the SDK
+struct ASIOSamples {
+    unsigned long hi;
+    unsigned long lo;
+};
+
+struct ASIOTimeStamp {
+    unsigned long hi;
+    unsigned long lo;
+};
+
+inline long long asioToInt64(unsigned long hi, unsigned long lo) {
+    return (long long)(((unsigned long long)(unsigned int)hi << 32) | (unsigned int)lo);
+}
+
+inline void asioFromInt64(long long value, unsigned long* hi, unsigned long* lo) {
+    *hi = (unsigned long)(unsigned int)((unsigned long long)value >> 32);
+    *lo = (unsigned long)(unsigned int)value;
+}
+
+struct AsioTimeInfo {
+    double speed;                   // Absolute speed (1.0 = nominal)
+    ASIOTimeStamp systemTime;       // System time of samplePosition, in ns
+    ASIOSamples samplePosition;
+    double sampleRate;
+    unsigned long flags;
+    char reserved[12];
+};
+
+struct ASIOTimeCode {
+    double speed;
+    ASIOSamples timeCodeSamples;
+    unsigned long flags;
+    char future[64];
+};
+
+struct ASIOTime {
+    long reserved[4];
+    AsioTimeInfo timeInfo;
+    ASIOTimeCode timeCode;
+};
+
+struct ASIOCallbacks {
+    void (*bufferSwitch)(long doubleBufferIndex, long directProcess);
+    void (*sampleRateDidChange)(double sRate);
+    long (*asioMessage)(long selector, long value, void* message, double* opt);
+    ASIOTime* (*bufferSwitchTimeInfo)(ASIOTime* params, long doubleBufferIndex, long directProcess);
+};
+
+#pragma pack(pop)
+
+// ASIOTime timeInfo flags
+enum {
+    kSystemTimeValid = 1,
+    kSamplePositionValid = 1 << 1,
+    kSampleRateValid = 1 << 2,
+    kSpeedValid = 1 << 3,
+    kSampleRateChanged = 1 << 4,
+    kClockSourceChanged = 1 << 5
+};
+
+// ASIO message selectors
+enum {
+    kAsioSelectorSupported = 1,
+    kAsioEngineVersion,
+    kAsioResetRequest,
+    kAsioBufferSizeChange,
+    kAsioResyncRequest,
+    kAsioLatenciesChanged,
+    kAsioSupportsTimeInfo,
+    kAsioSupportsTimeCode,
+    kAsioSupportsInputMonitor
+};
+
+// IASIO interface
+class IASIO : public IUnknown {
+public:
+    virtual long init(void* sysHandle) = 0;
+    virtual void getDriverName(char* name) = 0;
+    virtual long getDriverVersion() = 0;
+    virtual void getErrorMessage(char* string) = 0;
+    virtual ASIOError start() = 0;
+    virtual ASIOError stop() = 0;
+    virtual ASIOError getChannels(long* numInputChannels, long* numOutputChannels) = 0;
+    virtual ASIOError getLatencies(long* inputLatency, long* outputLatency) = 0;
+    virtual ASIOError getBufferSize(long* minSize, long* maxSize, long* preferredSize, long* granularity) = 0;
+    virtual ASIOError canSampleRate(double sampleRate) = 0;
+    virtual ASIOError getSampleRate(double* sampleRate) = 0;
+    virtual ASIOError setSampleRate(double sampleRate) = 0;
+    virtual ASIOError getClockSources(ASIOClockSource* clocks, long* numSources) = 0;
+    virtual ASIOError setClockSource(long reference) = 0;
+    virtual ASIOError getSamplePosition(ASIOSamples* sPos, ASIOTimeStamp* tStamp) = 0;
+    virtual ASIOError getChannelInfo(ASIOChannelInfo* info) = 0;
+    virtual ASIOError createBuffers(ASIOBufferInfo* bufferInfos, long numChannels, long bufferSize, ASIOCallbacks* callbacks) = 0;
+    virtual ASIOError disposeBuffers() = 0;
+    virtual ASIOError controlPanel() = 0;
+    virtual ASIOError future(long selector, void* opt) = 0;
+    virtual ASIOError outputReady() = 0;
+};
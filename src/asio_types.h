@@ -0,0 +1,39 @@
+#pragma once
+
+// Plain ASIO enums shared by the host and the sample conversion code.
+// Kept free of windows.h so the DSP side can be built anywhere.
+
+// ASIO sample types
+enum ASIOSampleType {
+    ASIOSTInt16MSB = 0,
+    ASIOSTInt24MSB = 1,
+    ASIOSTInt32MSB = 2,
+    ASIOSTFloat32MSB = 3,
+    ASIOSTFloat64MSB = 4,
+    ASIOSTInt32MSB16 = 8,
+    ASIOSTInt32MSB18 = 9,
+    ASIOSTInt32MSB20 = 10,
+    ASIOSTInt32MSB24 = 11,
+    ASIOSTInt16LSB = 16,
+    ASIOSTInt24LSB = 17,
+    ASIOSTInt32LSB = 18,
+    ASIOSTFloat32LSB = 19,
+    ASIOSTFloat64LSB = 20,
+    ASIOSTInt32LSB16 = 24,
+    ASIOSTInt32LSB18 = 25,
+    ASIOSTInt32LSB20 = 26,
+    ASIOSTInt32LSB24 = 27,
+};
+
+// ASIO error codes
+enum ASIOError {
+    ASE_OK = 0,
+    ASE_SUCCESS = 0x3f4847a0,
+    ASE_NotPresent = -1000,
+    ASE_HWMalfunction,
+    ASE_InvalidParameter,
+    ASE_InvalidMode,
+    ASE_SPNotAdvancing,
+    ASE_NoClock,
+    ASE_NoMemory
+};
@@ -0,0 +1,321 @@
+#include "audio_bridge.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+AudioBridge::AudioBridge() = default;
+
+bool AudioBridge::configure(const StreamFormat& source, const StreamFormat& target, const BridgeConfig& bridgeConfig) {
+    configured.store(false, std::memory_order_release);
+    sourceReady.store(false, std::memory_order_release);
+    targetReady.store(false, std::memory_order_release);
+
+    int count = (int)bridgeConfig.sourceChannels.size();
+    if (count == 0 || count != (int)bridgeConfig.targetChannels.size() ||
+        source.bufferSize <= 0 || target.bufferSize <= 0 || source.sampleRate <= 0.0 || target.sampleRate <= 0.0 ||
+        bridgeConfig.maxCorrectionPpm <= 0.0 || bridgeConfig.maxCorrectionPpm >= 1e5) {
+        return false;
+    }
+    sourceFormat = source;
+    targetFormat = target;
+    config = bridgeConfig;
+    channels = count;
+    if (!sourceMatches(source) || !targetMatches(target)) {
+        return false;
+    }
+
+    // Fill the target needs per block, one source block that may still be
+    // on its way, and the margin
+    double ratio = source.sampleRate / target.sampleRate;
+    double maxDeviation = config.maxCorrectionPpm * 1e-6;
+    setpoint = std::ceil(target.bufferSize * ratio) + source.bufferSize + config.extraLatencyFrames;
+    resyncAbove = setpoint * 2 + source.bufferSize;
+    int capacity = (int)(setpoint * 4);
+    int maxInput = (int)std::ceil(target.bufferSize * ratio * (1.0 + maxDeviation)) + Resampler::kTaps + 2;
+
+    // Second-order loop: natural frequency loopHz, damping 0.7
+    double omega = 2.0 * 3.14159265358979323846 * config.loopHz;
+    kp = 2.0 * 0.7 * omega;
+    ki = omega * omega;
+
+    size_t bytes = SpscRing::arenaBytes(channels, capacity) +
+                   Resampler::arenaBytes(channels, target.bufferSize, ratio, maxDeviation) +
+                   StreamArena::bytesFor<int>(channels) * 2 +
+                   StreamArena::bytesFor<SampleConverter>(channels) * 2 +
+                   StreamArena::bytesFor<float*>(channels) * 3 +
+                   StreamArena::bytesFor<float>(source.bufferSize) * channels +
+                   StreamArena::bytesFor<float>(maxInput) * channels +
+                   StreamArena::bytesFor<float>(target.bufferSize) * channels;
+    if (!arena.allocate(bytes) || !ring.configure(channels, capacity, &arena) ||
+        !resampler.configure(channels, target.bufferSize, ratio, maxDeviation, &arena)) {
+        return false;
+    }
+
+    int* sourceMap = arena.take<int>(channels);
+    int* targetMap = arena.take<int>(channels);
+    sourceConverters = arena.take<SampleConverter>(channels);
+    targetConverters = arena.take<SampleConverter>(channels);
+    sourceScratch = arena.take<float*>(channels);
+    inputScratch = arena.take<float*>(channels);
+    outputScratch = arena.take<float*>(channels);
+    if (!sourceMap || !targetMap || !sourceConverters || !targetConverters ||
+        !sourceScratch || !inputScratch || !outputScratch) {
+        return false;
+    }
+    const std::vector<ASIOSampleType>& sourceTypes = config.fromOutputs ? source.outputTypes : source.inputTypes;
+    for (int i = 0; i < channels; i++) {
+        sourceMap[i] = config.sourceChannels[i];
+        targetMap[i] = config.targetChannels[i];
+        sourceConverters[i] = getSampleConverter(sourceTypes[sourceMap[i]]);
+        targetConverters[i] = getSampleConverter(target.outputTypes[targetMap[i]]);
+        sourceScratch[i] = arena.take<float>(source.bufferSize);
+        inputScratch[i] = arena.take<float>(maxInput);
+        outputScratch[i] = arena.take<float>(target.bufferSize);
+        if (!sourceScratch[i] || !inputScratch[i] || !outputScratch[i]) {
+            return false;
+        }
+    }
+    sourceChannels = sourceMap;
+    targetChannels = targetMap;
+
+    writeSequence.store(0, std::memory_order_relaxed);
+    writtenFrames.store(0, std::memory_order_relaxed);
+    writeDriverNs.store(0, std::memory_order_relaxed);
+    writeCallbackNs.store(0, std::memory_order_relaxed);
+    priming = true;
+    integral = 0.0;
+    primingNow.store(true, std::memory_order_relaxed);
+    lastFill.store(0.0, std::memory_order_relaxed);
+    lastCorrection.store(0.0, std::memory_order_relaxed);
+    lastIntegral.store(0.0, std::memory_order_relaxed);
+
+    sourceReady.store(true, std::memory_order_release);
+    targetReady.store(true, std::memory_order_release);
+    configured.store(true, std::memory_order_release);
+    return true;
+}
+
+bool AudioBridge::sourceMatches(const StreamFormat& format) const {
+    if (format.bufferSize != sourceFormat.bufferSize || format.sampleRate != sourceFormat.sampleRate) {
+        return false;
+    }
+    const std::vector<ASIOSampleType>& types = config.fromOutputs ? format.outputTypes : format.inputTypes;
+    const std::vector<ASIOSampleType>& expected =
+        config.fromOutputs ? sourceFormat.outputTypes : sourceFormat.inputTypes;
+    for (int ch : config.sourceChannels) {
+        if (ch < 0 || ch >= (int)types.size() || ch >= (int)expected.size() || types[ch] != expected[ch]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AudioBridge::targetMatches(const StreamFormat& format) const {
+    if (format.bufferSize != targetFormat.bufferSize || format.sampleRate != targetFormat.sampleRate) {
+        return false;
+    }
+    for (int ch : config.targetChannels) {
+        if (ch < 0 || ch >= (int)format.outputTypes.size() || ch >= (int)targetFormat.outputTypes.size() ||
+            format.outputTypes[ch] != targetFormat.outputTypes[ch]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AudioBridge::isActive() const {
+    return configured.load(std::memory_order_acquire) && sourceReady.load(std::memory_order_acquire) &&
+           targetReady.load(std::memory_order_acquire);
+}
+
+void AudioBridge::SourceTap::prepare(const StreamFormat& format) {
+    bridge->sourceReady.store(bridge->configured.load(std::memory_order_acquire) && bridge->sourceMatches(format),
+                              std::memory_order_release);
+}
+
+void AudioBridge::SourceTap::process(const StreamBlock& block) {
+    bridge->produce(block);
+}
+
+void AudioBridge::TargetTap::prepare(const StreamFormat& format) {
+    // The target side is stopped: start over with an empty filter
+    if (bridge->configured.load(std::memory_order_acquire)) {
+        bridge->resampler.reset();
+        bridge->priming = true;
+    }
+    bridge->targetReady.store(bridge->configured.load(std::memory_order_acquire) && bridge->targetMatches(format),
+                              std::memory_order_release);
+}
+
+void AudioBridge::TargetTap::process(const StreamBlock& block) {
+    bridge->consume(block);
+}
+
+void AudioBridge::publishWrite(uint64_t written, int64_t driverNs, int64_t callbackNs) {
+    // Odd while the three values change
+    uint32_t sequence = writeSequence.load(std::memory_order_relaxed);
+    writeSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    writtenFrames.store(written, std::memory_order_relaxed);
+    writeDriverNs.store(driverNs, std::memory_order_relaxed);
+    writeCallbackNs.store(callbackNs, std::memory_order_relaxed);
+    writeSequence.store(sequence + 2, std::memory_order_release);
+}
+
+void AudioBridge::readWrite(uint64_t* written, int64_t* driverNs, int64_t* callbackNs) const {
+    for (;;) {
+        uint32_t before = writeSequence.load(std::memory_order_acquire);
+        *written = writtenFrames.load(std::memory_order_relaxed);
+        *driverNs = writeDriverNs.load(std::memory_order_relaxed);
+        *callbackNs = writeCallbackNs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1) == 0 && writeSequence.load(std::memory_order_relaxed) == before) {
+            return;
+        }
+    }
+}
+
+void AudioBridge::produce(const StreamBlock& block) {
+    sourceBlocks.fetch_add(1, std::memory_order_relaxed);
+    if (!isActive() || block.frames != sourceFormat.bufferSize) {
+        return;
+    }
+    void* const* buffers = config.fromOutputs ? block.outputs : block.inputs;
+    for (int i = 0; i < channels; i++) {
+        sourceConverters[i].toFloat(buffers[sourceChannels[i]], sourceScratch[i], block.frames);
+    }
+    if (!ring.write(sourceScratch, block.frames)) {
+        // The target has stopped taking; it drops the backlog when it resumes
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    publishWrite(ring.getWritten(), block.systemTimeNs, block.callbackNs);
+}
+
+void AudioBridge::playSilence(const StreamBlock& block) {
+    for (int i = 0; i < channels; i++) {
+        memset(outputScratch[i], 0, block.frames * sizeof(float));
+        targetConverters[i].fromFloat(outputScratch[i], block.outputs[targetChannels[i]], block.frames);
+    }
+}
+
+void AudioBridge::consume(const StreamBlock& block) {
+    targetBlocks.fetch_add(1, std::memory_order_relaxed);
+    if (!configured.load(std::memory_order_acquire) || block.frames != targetFormat.bufferSize) {
+        return;
+    }
+    if (!isActive()) {
+        playSilence(block);
+        return;
+    }
+
+    // Continuous fill: what the source has written, plus what it has
+    // produced since, at its nominal rate. Both times must come from the
+    // same clock, so driver time is used only when both sides have it.
+    uint64_t written;
+    int64_t sourceDriverNs, sourceCallbackNs;
+    readWrite(&written, &sourceDriverNs, &sourceCallbackNs);
+    int available = ring.getAvailable();
+    if (written == 0) {
+        playSilence(block);
+        return;
+    }
+    bool driverTime = sourceDriverNs != 0 && block.systemTimeNs != 0;
+    int64_t sinceWrite = driverTime ? block.systemTimeNs - sourceDriverNs : block.callbackNs - sourceCallbackNs;
+    double sourcePeriod = sourceFormat.bufferSize / sourceFormat.sampleRate;
+    double elapsed = std::min(std::max(sinceWrite / 1e9, 0.0), sourcePeriod);
+    double fill = (double)(written - ring.getRead()) + elapsed * sourceFormat.sampleRate;
+
+    if (priming) {
+        if (available < setpoint) {
+            playSilence(block);
+            return;
+        }
+        priming = false;
+        primingNow.store(false, std::memory_order_relaxed);
+        // A whole source block may have landed on top of the setpoint;
+        // start the loop from the setpoint rather than draining it slowly
+        int excess = (int)(fill - setpoint);
+        if (excess > 0) {
+            ring.skip(excess);
+            fill -= excess;
+            available = ring.getAvailable();
+        }
+    }
+
+    // A backlog (the target stalled, or the source burst ahead) is dropped
+    // rather than worked off slowly at the correction limit
+    if (fill > resyncAbove) {
+        int excess = (int)(fill - setpoint);
+        ring.skip(excess);
+        fill -= excess;
+        available = ring.getAvailable();
+        resyncs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Too full: consume a little faster (a larger step), and vice versa
+    double limit = config.maxCorrectionPpm * 1e-6;
+    double error = (fill - setpoint) / sourceFormat.sampleRate;
+    double dt = block.frames / targetFormat.sampleRate;
+    integral = std::min(limit, std::max(-limit, integral + ki * error * dt));
+    double correction = std::min(limit, std::max(-limit, kp * error + integral));
+    resampler.setStep(resampler.getNominalStep() * (1.0 + correction));
+
+    int needed = resampler.getInputNeeded(block.frames);
+    if (available < needed) {
+        underruns.fetch_add(1, std::memory_order_relaxed);
+        priming = true;
+        primingNow.store(true, std::memory_order_relaxed);
+        playSilence(block);
+        return;
+    }
+    ring.read(inputScratch, needed);
+    if (!resampler.process(inputScratch, needed, outputScratch, block.frames)) {
+        // More than the filter can take; prime again from fresh input
+        underruns.fetch_add(1, std::memory_order_relaxed);
+        priming = true;
+        primingNow.store(true, std::memory_order_relaxed);
+        playSilence(block);
+        return;
+    }
+    for (int i = 0; i < channels; i++) {
+        targetConverters[i].fromFloat(outputScratch[i], block.outputs[targetChannels[i]], block.frames);
+    }
+
+    lastFill.store(fill, std::memory_order_relaxed);
+    lastCorrection.store(correction, std::memory_order_relaxed);
+    lastIntegral.store(integral, std::memory_order_relaxed);
+}
+
+BridgeReport AudioBridge::getReport() const {
+    BridgeReport r;
+    r.active = isActive();
+    r.priming = primingNow.load(std::memory_order_relaxed);
+    r.nominalRatio = targetFormat.sampleRate > 0 ? sourceFormat.sampleRate / targetFormat.sampleRate : 0.0;
+    r.correctionPpm = lastCorrection.load(std::memory_order_relaxed) * 1e6;
+    r.driftPpm = lastIntegral.load(std::memory_order_relaxed) * 1e6;
+    r.fillFrames = lastFill.load(std::memory_order_relaxed);
+    r.targetFillFrames = setpoint;
+    r.latencyMs = sourceFormat.sampleRate > 0
+        ? (r.fillFrames + Resampler::getLatencyFrames()) * 1000.0 / sourceFormat.sampleRate : 0.0;
+    r.sourceBlocks = sourceBlocks.load(std::memory_order_relaxed);
+    r.targetBlocks = targetBlocks.load(std::memory_order_relaxed);
+    r.underruns = underruns.load(std::memory_order_relaxed);
+    r.overruns = overruns.load(std::memory_order_relaxed);
+    r.resyncs = resyncs.load(std::memory_order_relaxed);
+    return r;
+}
+
+std::string AudioBridge::formatText(const BridgeReport& r) {
+    char buf[384];
+    snprintf(buf, sizeof(buf),
+             "Bridge: %s, ratio %.6f %+.1f ppm (drift %+.1f ppm)\n"
+             "Fill: %.0f frames (target %.0f), %.2f ms latency\n"
+             "Blocks: %llu in, %llu out; %llu underruns, %llu overruns, %llu resyncs\n",
+             !r.active ? "inactive" : r.priming ? "filling" : "running",
+             r.nominalRatio, r.correctionPpm, r.driftPpm, r.fillFrames, r.targetFillFrames, r.latencyMs,
+             (unsigned long long)r.sourceBlocks, (unsigned long long)r.targetBlocks,
+             (unsigned long long)r.underruns, (unsigned long long)r.overruns, (unsigned long long)r.resyncs);
+    return buf;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "resampler.h"
+#include "sample_convert.h"
+#include "spsc_ring.h"
+#include "stream_arena.h"
+#include "stream_tap.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct BridgeConfig {
+    bool fromOutputs = false;           // Carry the source host's mix instead of its inputs
+    std::vector<int> sourceChannels;    // Source host channels carried
+    std::vector<int> targetChannels;    // Target host outputs they play on, one each
+    int extraLatencyFrames = 64;        // Ring fill kept above what the blocks need
+    double maxCorrectionPpm = 1000.0;   // Largest ratio correction the loop may apply
+    double loopHz = 0.05;               // Drift loop bandwidth
+};
+
+struct BridgeReport {
+    bool active;                // Configured, and both hosts stream the configured formats
+    bool priming;               // Waiting for the ring to fill, at start or after an underrun
+    double nominalRatio;        // Source rate / target rate
+    double correctionPpm;       // Ratio correction applied to the latest target block
+    double driftPpm;            // Its integral part: the clock offset the loop has learned
+    double fillFrames;          // Ring fill at the latest target block, source frames
+    double targetFillFrames;    // Fill the loop steers to
+    double latencyMs;           // Ring plus filter delay at that fill
+    uint64_t sourceBlocks;
+    uint64_t targetBlocks;
+    uint64_t underruns;         // Target blocks played silent for lack of input
+    uint64_t overruns;          // Source blocks dropped for lack of ring space
+    uint64_t resyncs;           // Times a backlog was dropped to get back to the target fill
+};
+
+// Carries audio from one host's stream to another's outputs when the two
+// run on different drivers and so on different clocks. The source tap
+// converts the chosen channels to float and pushes them into a lock-free
+// SPSC ring from the source driver's thread; the target tap pulls them out
+// on the target driver's thread through a resampler and writes them to
+// its outputs.
+//
+// The rates never match exactly, so a control loop on the target side
+// keeps the ring's fill steady by nudging the resampling ratio. The fill
+// it steers on is continuous: the frames the source has written plus
+// those it has produced since its last block, judged from the two
+// drivers' block times (or callback arrival times when a driver has no
+// time info), so the source's block rhythm does not disturb the loop. A
+// PI controller turns the fill error into a ratio correction; its
+// integral term ends up holding the clock offset between the drivers.
+//
+// Register getSourceTap() with the source host and getTargetTap() with the
+// target, then configure() with both stopped. A host that later recreates
+// its buffers with a different format leaves the bridge inactive (the
+// target channels play silence) until it is configured again.
+class AudioBridge {
+public:
+    AudioBridge();
+    AudioBridge(const AudioBridge&) = delete;
+    AudioBridge& operator=(const AudioBridge&) = delete;
+
+    // Control thread, with both hosts stopped
+    bool configure(const StreamFormat& source, const StreamFormat& target, const BridgeConfig& config);
+
+    StreamTap* getSourceTap() { return &sourceTap; }
+    StreamTap* getTargetTap() { return &targetTap; }
+
+    bool isActive() const;
+    BridgeReport getReport() const;
+    static std::string formatText(const BridgeReport& report);
+
+private:
+    class SourceTap : public StreamTap {
+    public:
+        explicit SourceTap(AudioBridge* bridge) : bridge(bridge) {}
+        void prepare(const StreamFormat& format) override;
+        void process(const StreamBlock& block) override;
+    private:
+        AudioBridge* bridge;
+    };
+
+    class TargetTap : public StreamTap {
+    public:
+        explicit TargetTap(AudioBridge* bridge) : bridge(bridge) {}
+        void prepare(const StreamFormat& format) override;
+        void process(const StreamBlock& block) override;
+    private:
+        AudioBridge* bridge;
+    };
+
+    bool sourceMatches(const StreamFormat& format) const;
+    bool targetMatches(const StreamFormat& format) const;
+    void produce(const StreamBlock& block);
+    void consume(const StreamBlock& block);
+    void playSilence(const StreamBlock& block);
+
+    // Source block times for the target's fill estimate, as a seqlock
+    void publishWrite(uint64_t written, int64_t driverNs, int64_t callbackNs);
+    void readWrite(uint64_t* written, int64_t* driverNs, int64_t* callbackNs) const;
+
+    SourceTap sourceTap{this};
+    TargetTap targetTap{this};
+
+    // Control thread
+    StreamFormat sourceFormat;
+    StreamFormat targetFormat;
+    BridgeConfig config;
+    StreamArena arena;
+    int channels = 0;
+    double kp = 0.0;                // Loop gains, for a fill error in seconds
+    double ki = 0.0;
+    double setpoint = 0.0;          // Target fill, source frames
+    double resyncAbove = 0.0;       // Fill beyond this drops the backlog
+
+    std::atomic<bool> configured{false};
+    std::atomic<bool> sourceReady{false};
+    std::atomic<bool> targetReady{false};
+
+    SpscRing ring;
+
+    // Source driver's thread
+    alignas(StreamArena::kCacheLine) const int* sourceChannels = nullptr;
+    SampleConverter* sourceConverters = nullptr;
+    float** sourceScratch = nullptr;
+    std::atomic<uint32_t> writeSequence{0};
+    std::atomic<uint64_t> writtenFrames{0};
+    std::atomic<int64_t> writeDriverNs{0};
+    std::atomic<int64_t> writeCallbackNs{0};
+    std::atomic<uint64_t> sourceBlocks{0};
+    std::atomic<uint64_t> overruns{0};
+
+    // Target driver's thread
+    alignas(StreamArena::kCacheLine) const int* targetChannels = nullptr;
+    SampleConverter* targetConverters = nullptr;
+    float** inputScratch = nullptr;
+    float** outputScratch = nullptr;
+    Resampler resampler;
+    bool priming = true;
+    double integral = 0.0;
+    std::atomic<uint64_t> targetBlocks{0};
+    std::atomic<uint64_t> underruns{0};
+    std::atomic<uint64_t> resyncs{0};
+    std::atomic<bool> primingNow{true};
+    std::atomic<double> lastFill{0.0};
+    std::atomic<double> lastCorrection{0.0};
+    std::atomic<double> lastIntegral{0.0};
+};
@@ -0,0 +1,167 @@
+#include "buffer_tuner.h"
+#include <algorithm>
+#include <cstdio>
+
+std::vector<int> BufferTuner::candidateSizes(long minSize, long maxSize, long preferredSize, long granularity) {
+    std::vector<int> sizes;
+    if (minSize <= 0 || maxSize < minSize || granularity == 0 || minSize == maxSize) {
+        // Fixed size, or a range we cannot trust
+        long only = preferredSize > 0 ? preferredSize : minSize;
+        if (only > 0) sizes.push_back((int)only);
+        return sizes;
+    }
+    sizes.push_back((int)minSize);
+    if (granularity < 0) {
+        for (long size = 1; size < maxSize; size *= 2) {
+            if (size > minSize) sizes.push_back((int)size);
+        }
+    } else {
+        // Every granularity step would make a long search for tiny gains
+        long size = minSize;
+        for (;;) {
+            long target = size + std::max(granularity, size / 4);
+            long next = minSize + (target - minSize + granularity - 1) / granularity * granularity;
+            if (next >= maxSize) break;
+            sizes.push_back((int)next);
+            size = next;
+        }
+    }
+    sizes.push_back((int)maxSize);
+    return sizes;
+}
+
+int BufferTuner::begin(const std::vector<int>& candidates, int startSize, const BufferTunerSettings& tunerSettings,
+                       double nowSeconds) {
+    settings = tunerSettings;
+    sizes = candidates;
+    failures.clear();
+    retryAt.clear();
+    stable = -1;
+    if (sizes.empty()) {
+        state = TunerIdle;
+        current = -1;
+        return 0;
+    }
+    state = TunerSearching;
+    current = 0;
+    while (current + 1 < (int)sizes.size() && sizes[current] < startSize) {
+        current++;
+    }
+    lastReason = "started";
+    sizeApplied(sizes[current], nowSeconds);
+    return sizes[current];
+}
+
+void BufferTuner::sizeApplied(int size, double nowSeconds) {
+    if (sizes.empty()) return;
+    current = 0;
+    while (current + 1 < (int)sizes.size() && sizes[current] < size) {
+        current++;
+    }
+    cleanWindows = 0;
+    appliedAt = nowSeconds;
+    startWindow(Baseline(), nowSeconds);
+}
+
+void BufferTuner::startWindow(const Baseline& from, double nowSeconds) {
+    window = from;
+    windowStart = nowSeconds;
+}
+
+int BufferTuner::stepUp(const Baseline& now, double nowSeconds) {
+    // Wait twice as long before probing this size again each time it fails
+    int count = ++failures[current];
+    retryAt[current] = nowSeconds + settings.stepDownAfterSeconds * (double)(1u << std::min(count, 10));
+    if (stable == current) stable = -1;
+    cleanWindows = 0;
+    if (current + 1 < (int)sizes.size()) {
+        current++;
+        state = TunerSearching;
+        return sizes[current];
+    }
+    // Nothing larger: stay, and keep watching from here
+    lastReason += " at the largest size";
+    stable = current;
+    state = TunerStable;
+    stableSince = nowSeconds;
+    startWindow(now, nowSeconds);
+    return sizes[current];
+}
+
+int BufferTuner::update(const CallbackTimingReport& timing, const ClockReport& clock, double nowSeconds) {
+    if (state == TunerIdle || current < 0) return getCurrentSize();
+
+    Baseline now;
+    now.callbacks = timing.callbacks;
+    now.totalNs = timing.meanNs * (double)timing.callbacks;
+    now.over80 = timing.over80;
+    now.misses = timing.misses;
+    now.xruns = clock.xruns;
+
+    // Starting a stream often glitches once; measure from after that. The
+    // counters also restart whenever the buffers are recreated.
+    if (nowSeconds - appliedAt < settings.settleSeconds || now.callbacks < window.callbacks) {
+        startWindow(now, nowSeconds);
+        return sizes[current];
+    }
+
+    char reason[128];
+    uint64_t callbacks = now.callbacks - window.callbacks;
+    uint64_t misses = now.misses - window.misses;
+    uint64_t xruns = now.xruns - window.xruns;
+    if (misses > 0 || xruns > 0) {
+        snprintf(reason, sizeof(reason), "%d frames: %llu missed deadlines, %llu xruns", sizes[current],
+                 (unsigned long long)misses, (unsigned long long)xruns);
+        lastReason = reason;
+        return stepUp(now, nowSeconds);
+    }
+    if (nowSeconds - windowStart < settings.windowSeconds || callbacks == 0) {
+        return sizes[current];
+    }
+
+    double meanLoad = timing.budgetNs > 0 ? (now.totalNs - window.totalNs) / (double)callbacks / timing.budgetNs : 0.0;
+    double over80 = (double)(now.over80 - window.over80) / (double)callbacks;
+    if (meanLoad > settings.maxMeanLoad) {
+        snprintf(reason, sizeof(reason), "%d frames: mean load %.0f%%", sizes[current], meanLoad * 100.0);
+        lastReason = reason;
+        return stepUp(now, nowSeconds);
+    }
+    if (over80 > settings.maxOver80Fraction) {
+        snprintf(reason, sizeof(reason), "%d frames: %.2f%% of callbacks over 80%%", sizes[current], over80 * 100.0);
+        lastReason = reason;
+        return stepUp(now, nowSeconds);
+    }
+
+    startWindow(now, nowSeconds);
+    cleanWindows++;
+    if (state == TunerSearching && cleanWindows >= settings.confirmWindows) {
+        state = TunerStable;
+        stable = current;
+        stableSince = nowSeconds;
+        failures.erase(current);
+        snprintf(reason, sizeof(reason), "%d frames: mean load %.0f%%, no misses", sizes[current], meanLoad * 100.0);
+        lastReason = reason;
+    }
+
+    if (state == TunerStable && settings.stepDownAfterSeconds > 0 && current > 0 &&
+        nowSeconds - stableSince >= settings.stepDownAfterSeconds) {
+        auto retry = retryAt.find(current - 1);
+        if (retry == retryAt.end() || nowSeconds >= retry->second) {
+            // The stable size stays recorded until the probe confirms
+            current--;
+            state = TunerSearching;
+            cleanWindows = 0;
+            snprintf(reason, sizeof(reason), "probing %d frames", sizes[current]);
+            lastReason = reason;
+        }
+    }
+    return sizes[current];
+}
+
+std::string BufferTuner::formatText() const {
+    const char* names[] = {"off", "searching", "stable"};
+    char buf[256];
+    snprintf(buf, sizeof(buf), "Buffer tuning: %s at %d frames, stable size %d\nLast decision: %s\n",
+             names[state], getCurrentSize(), getStableSize(), lastReason.c_str());
+    return buf;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "callback_stats.h"
+#include "clock_monitor.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+struct BufferTunerSettings {
+    double settleSeconds = 1.0;         // Ignored after a size is applied
+    double windowSeconds = 5.0;         // Length of one measurement window
+    int confirmWindows = 2;             // Clean windows in a row before a size is stable
+    double maxMeanLoad = 0.5;           // Mean callback time as a share of the block
+    double maxOver80Fraction = 0.001;   // Share of callbacks allowed over 80% of the block
+    double stepDownAfterSeconds = 0.0;  // Try a smaller size after this long stable (0 = never)
+};
+
+enum BufferTunerState {
+    TunerIdle = 0,
+    TunerSearching,     // Measuring the current size
+    TunerStable         // Settled; still watched for trouble
+};
+
+// Finds the smallest buffer size that runs with headroom on this machine.
+// It starts small and measures each size for a window: any deadline miss
+// or xrun, too high a mean load, or too many callbacks near the deadline
+// moves it one size up. A size that stays clean for confirmWindows windows
+// is stable. Stable sizes are still watched and left if they degrade;
+// optionally a smaller size is probed again after a while, with the wait
+// doubling each time that size fails, so it does not oscillate.
+//
+// Pure logic: the caller feeds it the stream's cumulative timing and
+// clock reports and the time, and applies the sizes it asks for. Control
+// thread only.
+class BufferTuner {
+public:
+    // Sizes worth trying for a driver's getBufferSize() range, ascending:
+    // powers of two for granularity -1, steps of at least 25% on the
+    // granularity grid otherwise, just the preferred size for granularity 0
+    static std::vector<int> candidateSizes(long minSize, long maxSize, long preferredSize, long granularity);
+
+    // Start tuning over sizes (ascending) from the candidate nearest to,
+    // and not below, startSize. Returns the size to apply first.
+    int begin(const std::vector<int>& sizes, int startSize, const BufferTunerSettings& settings,
+              double nowSeconds);
+    void stop() { state = TunerIdle; }
+
+    // Periodically (about once a second), with the reports of the stream
+    // running at getCurrentSize() since its buffers were created. Returns
+    // the size it should run at: when that differs, recreate the buffers
+    // and call sizeApplied().
+    int update(const CallbackTimingReport& timing, const ClockReport& clock, double nowSeconds);
+
+    // The stream now runs at size with fresh reports
+    void sizeApplied(int size, double nowSeconds);
+
+    BufferTunerState getState() const { return state; }
+    int getCurrentSize() const { return current >= 0 ? sizes[current] : 0; }
+    int getStableSize() const { return stable >= 0 ? sizes[stable] : 0; }
+
+    std::string formatText() const;
+
+private:
+    // Counters at the start of the current window
+    struct Baseline {
+        uint64_t callbacks = 0;
+        double totalNs = 0.0;
+        uint64_t over80 = 0;
+        uint64_t misses = 0;
+        uint64_t xruns = 0;
+    };
+
+    void startWindow(const Baseline& from, double nowSeconds);
+    int stepUp(const Baseline& now, double nowSeconds);
+
+    BufferTunerSettings settings;
+    std::vector<int> sizes;
+    BufferTunerState state = TunerIdle;
+    int current = -1;               // Index into sizes
+    int stable = -1;
+    int cleanWindows = 0;
+    Baseline window;
+    double windowStart = 0.0;
+    double appliedAt = 0.0;
+    double stableSince = 0.0;
+    std::string lastReason;
+
+    // Per size index: failures so far, and no probe before retryAt
+    std::map<int, int> failures;
+    std::map<int, double> retryAt;
+};
@@ -0,0 +1,153 @@
+#include "callback_stats.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Index of the highest set bit; v must be non-zero
+static int highestBit(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+void CallbackStats::reset(int bufferSize, double sampleRate) {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    totalNs.store(0, std::memory_order_relaxed);
+    maxNs.store(0, std::memory_order_relaxed);
+    over50.store(0, std::memory_order_relaxed);
+    over80.store(0, std::memory_order_relaxed);
+    misses.store(0, std::memory_order_relaxed);
+
+    double budget = sampleRate > 0.0 ? bufferSize / sampleRate * 1e9 : 0.0;
+    budgetNs.store((uint64_t)budget, std::memory_order_relaxed);
+    budget50Ns.store((uint64_t)(budget * 0.5), std::memory_order_relaxed);
+    budget80Ns.store((uint64_t)(budget * 0.8), std::memory_order_relaxed);
+}
+
+uint64_t CallbackStats::now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int CallbackStats::bucketIndex(uint64_t ns) {
+    const uint64_t subBuckets = 1ULL << kSubBucketBits;
+    if (ns < subBuckets) {
+        return (int)ns;
+    }
+    int shift = highestBit(ns) - kSubBucketBits;
+    return ((shift + 1) << kSubBucketBits) + (int)((ns >> shift) & (subBuckets - 1));
+}
+
+uint64_t CallbackStats::bucketUpperBound(int index) {
+    const int subBuckets = 1 << kSubBucketBits;
+    if (index < subBuckets) {
+        return (uint64_t)index;
+    }
+    int shift = (index >> kSubBucketBits) - 1;
+    uint64_t mantissa = (uint64_t)((index & (subBuckets - 1)) | subBuckets);
+    // Wraps to UINT64_MAX for the top bucket
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void CallbackStats::record(uint64_t beginNs, uint64_t endNs) {
+    uint64_t ns = endNs > beginNs ? endNs - beginNs : 0;
+
+    bump(buckets[bucketIndex(ns)]);
+    bump(count);
+    totalNs.store(totalNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    if (ns > maxNs.load(std::memory_order_relaxed)) {
+        maxNs.store(ns, std::memory_order_relaxed);
+    }
+
+    uint64_t budget = budgetNs.load(std::memory_order_relaxed);
+    if (budget == 0) return;
+    if (ns > budget50Ns.load(std::memory_order_relaxed)) bump(over50);
+    if (ns > budget80Ns.load(std::memory_order_relaxed)) bump(over80);
+    if (ns > budget) bump(misses);
+}
+
+CallbackTimingReport CallbackStats::getReport() const {
+    CallbackTimingReport report = {};
+
+    // Snapshot the histogram; counts are taken from it so percentiles agree
+    uint64_t snapshot[kNumBuckets];
+    uint64_t total = 0;
+    for (int i = 0; i < kNumBuckets; i++) {
+        snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+        total += snapshot[i];
+    }
+
+    report.callbacks = total;
+    report.budgetNs = (double)budgetNs.load(std::memory_order_relaxed);
+    report.maxNs = (double)maxNs.load(std::memory_order_relaxed);
+    report.over50 = over50.load(std::memory_order_relaxed);
+    report.over80 = over80.load(std::memory_order_relaxed);
+    report.misses = misses.load(std::memory_order_relaxed);
+    if (total == 0) {
+        return report;
+    }
+
+    uint64_t recorded = count.load(std::memory_order_relaxed);
+    report.meanNs = recorded ? (double)totalNs.load(std::memory_order_relaxed) / recorded : 0.0;
+
+    // Smallest bucket bound covering each rank, capped at the exact max
+    const double quantiles[] = { 0.5, 0.99, 0.999 };
+    double* results[] = { &report.p50Ns, &report.p99Ns, &report.p999Ns };
+    for (int q = 0; q < 3; q++) {
+        uint64_t rank = (uint64_t)(quantiles[q] * total);
+        if (rank < 1) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kNumBuckets; i++) {
+            seen += snapshot[i];
+            if (seen >= rank) {
+                *results[q] = std::min((double)bucketUpperBound(i), report.maxNs);
+                break;
+            }
+        }
+    }
+
+    if (report.budgetNs > 0.0) {
+        report.loadPercent = report.meanNs / report.budgetNs * 100.0;
+        report.peakPercent = report.maxNs / report.budgetNs * 100.0;
+    }
+    return report;
+}
+
+std::string CallbackStats::formatText(const CallbackTimingReport& r) {
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "Callbacks: %llu\n"
+             "Budget: %.1f us per block\n"
+             "Time p50 / p99 / p99.9 / max: %.1f / %.1f / %.1f / %.1f us\n"
+             "Load: %.1f%% mean, %.1f%% peak\n"
+             "Over 50%% budget: %llu, over 80%%: %llu, missed: %llu\n",
+             (unsigned long long)r.callbacks, r.budgetNs / 1000.0,
+             r.p50Ns / 1000.0, r.p99Ns / 1000.0, r.p999Ns / 1000.0, r.maxNs / 1000.0,
+             r.loadPercent, r.peakPercent,
+             (unsigned long long)r.over50, (unsigned long long)r.over80, (unsigned long long)r.misses);
+    return buf;
+}
+
+std::string CallbackStats::formatJson(const CallbackTimingReport& r) {
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "{\"callbacks\":%llu,\"budget_ns\":%.0f,\"mean_ns\":%.0f,\"p50_ns\":%.0f,"
+             "\"p99_ns\":%.0f,\"p999_ns\":%.0f,\"max_ns\":%.0f,\"load_pct\":%.2f,"
+             "\"peak_pct\":%.2f,\"over50\":%llu,\"over80\":%llu,\"misses\":%llu}",
+             (unsigned long long)r.callbacks, r.budgetNs, r.meanNs, r.p50Ns,
+             r.p99Ns, r.p999Ns, r.maxNs, r.loadPercent,
+             r.peakPercent, (unsigned long long)r.over50, (unsigned long long)r.over80,
+             (unsigned long long)r.misses);
+    return buf;
+}
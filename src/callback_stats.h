@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Summary of callback timing, computed from the histogram on demand
+struct CallbackTimingReport {
+    uint64_t callbacks;
+    double budgetNs;        // Block deadline: bufferSize / sampleRate
+    double meanNs;
+    double p50Ns;
+    double p99Ns;
+    double p999Ns;
+    double maxNs;
+    double loadPercent;     // Mean duration as a share of the budget
+    double peakPercent;     // Max duration as a share of the budget
+    uint64_t over50;        // Callbacks that used more than 50% of the budget
+    uint64_t over80;        // ... more than 80%
+    uint64_t misses;        // ... more than 100% (deadline missed)
+};
+
+// Real-time-safe timing of the audio callback. The driver thread records
+// one duration per block: a log-scale histogram bucket (8 per octave, so
+// percentiles err high by at most 12.5%) and the deadline counters are bumped
+// with relaxed atomic stores. No locks, no allocation. There must be a
+// single recording thread; any thread may read a report, which is
+// approximate only while recording is in progress.
+class CallbackStats {
+public:
+    // Clear everything and set the per-block budget
+    void reset(int bufferSize, double sampleRate);
+
+    // Monotonic timestamp for begin/end of a callback
+    static uint64_t now();
+
+    // Driver thread: record one callback that started at begin
+    void record(uint64_t beginNs, uint64_t endNs);
+
+    CallbackTimingReport getReport() const;
+
+    // Human-readable summary for the Info dialog
+    static std::string formatText(const CallbackTimingReport& report);
+
+    // One-line JSON object, for scripts and regression checks
+    static std::string formatJson(const CallbackTimingReport& report);
+
+    static const int kSubBucketBits = 3;
+    static const int kNumBuckets = (64 - kSubBucketBits + 1) << kSubBucketBits;
+
+    // Bucket for a duration, and the largest duration that maps to it
+    static int bucketIndex(uint64_t ns);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    // Single writer, so increments are a relaxed load and store
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> buckets[kNumBuckets] = {};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+    std::atomic<uint64_t> over50{0};
+    std::atomic<uint64_t> over80{0};
+    std::atomic<uint64_t> misses{0};
+
+    // Thresholds in ns, set by reset()
+    std::atomic<uint64_t> budgetNs{0};
+    std::atomic<uint64_t> budget50Ns{0};
+    std::atomic<uint64_t> budget80Ns{0};
+};
@@ -0,0 +1,170 @@
+#include "clock_monitor.h"
+#include <cstdio>
+
+// Drift is fitted over windows of this much system time, then smoothed
+static const double kDriftWindowSeconds = 2.0;
+static const double kDriftSmoothing = 0.25;
+
+void ClockMonitor::reset(int bufferSize, double sampleRate) {
+    blockSize = bufferSize;
+    currentRate = sampleRate;
+    havePrevious = false;
+    previousPosition = 0;
+    driftWindows = 0;
+    restartDrift(0, 0);
+
+    blocks.store(0, std::memory_order_relaxed);
+    xruns.store(0, std::memory_order_relaxed);
+    skippedBlocks.store(0, std::memory_order_relaxed);
+    repeatedBlocks.store(0, std::memory_order_relaxed);
+    discontinuities.store(0, std::memory_order_relaxed);
+    driftPpm.store(0.0, std::memory_order_relaxed);
+    driftValid.store(false, std::memory_order_relaxed);
+    timeSequence.store(0, std::memory_order_relaxed);
+    latestPosition.store(0, std::memory_order_relaxed);
+    latestTimeNs.store(0, std::memory_order_relaxed);
+}
+
+void ClockMonitor::restartDrift(int64_t samplePosition, int64_t systemTimeNs) {
+    anchorPosition = samplePosition;
+    anchorTimeNs = systemTimeNs;
+    fitCount = 0;
+    sumT = sumP = sumTT = sumTP = 0.0;
+}
+
+void ClockMonitor::update(int64_t samplePosition, int64_t systemTimeNs, double driverRate) {
+    if (blockSize <= 0) {
+        return;
+    }
+    bump(blocks);
+
+    // A reported rate change restarts the drift fit against the new rate
+    if (driverRate > 0.0 && driverRate != currentRate) {
+        currentRate = driverRate;
+        restartDrift(samplePosition, systemTimeNs);
+    }
+
+    if (!havePrevious) {
+        restartDrift(samplePosition, systemTimeNs);
+    } else {
+        int64_t delta = samplePosition - previousPosition;
+        if (delta != blockSize) {
+            bump(xruns);
+            if (delta > 0 && delta % blockSize == 0) {
+                // Position and time stay consistent, so the fit carries on
+                bump(skippedBlocks, (uint64_t)(delta / blockSize - 1));
+            } else {
+                if (delta == 0) {
+                    bump(repeatedBlocks);
+                } else {
+                    bump(discontinuities);
+                }
+                restartDrift(samplePosition, systemTimeNs);
+            }
+        }
+    }
+    havePrevious = true;
+    previousPosition = samplePosition;
+
+    // Publish the block time
+    uint64_t seq = timeSequence.load(std::memory_order_relaxed);
+    timeSequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    latestPosition.store(samplePosition, std::memory_order_relaxed);
+    latestTimeNs.store(systemTimeNs, std::memory_order_relaxed);
+    timeSequence.store(seq + 2, std::memory_order_release);
+
+    // Least-squares fit of position against time over the window; far less
+    // sensitive to timestamp jitter than the window's two end points
+    double t = (systemTimeNs - anchorTimeNs) * 1e-9;
+    double p = (double)(samplePosition - anchorPosition);
+    fitCount++;
+    sumT += t;
+    sumP += p;
+    sumTT += t * t;
+    sumTP += t * p;
+
+    if (t >= kDriftWindowSeconds && fitCount >= 3) {
+        double n = (double)fitCount;
+        double denom = n * sumTT - sumT * sumT;
+        if (denom > 0.0 && currentRate > 0.0) {
+            double rate = (n * sumTP - sumT * sumP) / denom;
+            double windowPpm = (rate / currentRate - 1.0) * 1e6;
+            double ppm = driftPpm.load(std::memory_order_relaxed);
+            ppm = driftWindows == 0 ? windowPpm : ppm + kDriftSmoothing * (windowPpm - ppm);
+            driftWindows++;
+            driftPpm.store(ppm, std::memory_order_relaxed);
+            driftValid.store(true, std::memory_order_relaxed);
+        }
+        restartDrift(samplePosition, systemTimeNs);
+    }
+}
+
+ClockReport ClockMonitor::getReport() const {
+    ClockReport report = {};
+    report.blocks = blocks.load(std::memory_order_relaxed);
+    report.xruns = xruns.load(std::memory_order_relaxed);
+    report.skippedBlocks = skippedBlocks.load(std::memory_order_relaxed);
+    report.repeatedBlocks = repeatedBlocks.load(std::memory_order_relaxed);
+    report.discontinuities = discontinuities.load(std::memory_order_relaxed);
+    report.driftPpm = driftPpm.load(std::memory_order_relaxed);
+    report.driftValid = driftValid.load(std::memory_order_relaxed);
+    int64_t position, timeNs;
+    if (getBlockTime(&position, &timeNs)) {
+        report.samplePosition = position;
+        report.systemTimeNs = timeNs;
+    }
+    return report;
+}
+
+bool ClockMonitor::getBlockTime(int64_t* samplePosition, int64_t* systemTimeNs) const {
+    for (;;) {
+        uint64_t before = timeSequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        int64_t position = latestPosition.load(std::memory_order_relaxed);
+        int64_t timeNs = latestTimeNs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (timeSequence.load(std::memory_order_relaxed) == before) {
+            if (before == 0) {
+                return false;
+            }
+            *samplePosition = position;
+            *systemTimeNs = timeNs;
+            return true;
+        }
+    }
+}
+
+std::string ClockMonitor::formatText(const ClockReport& r) {
+    char buf[384];
+    char drift[32];
+    if (r.driftValid) {
+        snprintf(drift, sizeof(drift), "%+.1f ppm", r.driftPpm);
+    } else {
+        snprintf(drift, sizeof(drift), "measuring");
+    }
+    snprintf(buf, sizeof(buf),
+             "Time-stamped blocks: %llu\n"
+             "Xruns: %llu (skipped %llu, repeated %llu, jumps %llu)\n"
+             "Clock drift: %s\n",
+             (unsigned long long)r.blocks, (unsigned long long)r.xruns,
+             (unsigned long long)r.skippedBlocks, (unsigned long long)r.repeatedBlocks,
+             (unsigned long long)r.discontinuities, drift);
+    return buf;
+}
+
+std::string ClockMonitor::formatJson(const ClockReport& r) {
+    char buf[384];
+    snprintf(buf, sizeof(buf),
+             "{\"blocks\":%llu,\"xruns\":%llu,\"skipped\":%llu,\"repeated\":%llu,"
+             "\"discontinuities\":%llu,\"drift_ppm\":%s,\"sample_position\":%lld,"
+             "\"system_time_ns\":%lld}",
+             (unsigned long long)r.blocks, (unsigned long long)r.xruns,
+             (unsigned long long)r.skippedBlocks, (unsigned long long)r.repeatedBlocks,
+             (unsigned long long)r.discontinuities,
+             r.driftValid ? std::to_string(r.driftPpm).c_str() : "null",
+             (long long)r.samplePosition, (long long)r.systemTimeNs);
+    return buf;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Xrun and drift counters, computed from the driver's ASIOTime
+struct ClockReport {
+    uint64_t blocks;            // Time-stamped blocks seen
+    uint64_t xruns;             // Blocks whose position did not follow the last one
+    uint64_t skippedBlocks;     // Blocks the driver advanced past without a callback
+    uint64_t repeatedBlocks;    // Callbacks that repeated the previous position
+    uint64_t discontinuities;   // Position went backwards or moved by a partial block
+    double driftPpm;            // Driver sample clock against system time; > 0 is fast
+    bool driftValid;            // False until the first drift window completes
+    int64_t samplePosition;     // Latest block
+    int64_t systemTimeNs;       // System time of samplePosition
+};
+
+// Watches the sample position and system time the driver passes with each
+// block. A position that does not advance by exactly one block is an xrun:
+// skipped blocks, a repeated block, or a jump. Drift is the slope of a
+// least-squares fit of position against system time over ~2 s windows,
+// smoothed across windows; skipped blocks do not disturb it, repeats and
+// jumps restart the current window.
+//
+// update() runs on the driver thread, single writer, with relaxed atomic
+// stores only. Reports and block times can be read from any thread.
+class ClockMonitor {
+public:
+    // Clear everything; sampleRate is the nominal rate
+    void reset(int bufferSize, double sampleRate);
+
+    // Driver thread: one block's position and time. driverRate is the
+    // rate reported with it, or 0 if the driver did not report one.
+    void update(int64_t samplePosition, int64_t systemTimeNs, double driverRate);
+
+    ClockReport getReport() const;
+
+    // Position and system time of the latest block, read consistently.
+    // False if no time-stamped block has been seen.
+    bool getBlockTime(int64_t* samplePosition, int64_t* systemTimeNs) const;
+
+    static std::string formatText(const ClockReport& report);
+    static std::string formatJson(const ClockReport& report);
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t amount = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    void restartDrift(int64_t samplePosition, int64_t systemTimeNs);
+
+    // Writer-only state
+    int blockSize = 0;
+    double currentRate = 0.0;
+    bool havePrevious = false;
+    int64_t previousPosition = 0;
+    int64_t anchorPosition = 0;
+    int64_t anchorTimeNs = 0;
+    int driftWindows = 0;
+
+    // Running sums for the fit, relative to the anchor
+    int fitCount = 0;
+    double sumT = 0.0;
+    double sumP = 0.0;
+    double sumTT = 0.0;
+    double sumTP = 0.0;
+
+    // Published
+    std::atomic<uint64_t> blocks{0};
+    std::atomic<uint64_t> xruns{0};
+    std::atomic<uint64_t> skippedBlocks{0};
+    std::atomic<uint64_t> repeatedBlocks{0};
+    std::atomic<uint64_t> discontinuities{0};
+    std::atomic<double> driftPpm{0.0};
+    std::atomic<bool> driftValid{false};
+
+    // Latest block time under a sequence lock: odd while being written, 0
+    // before the first block, and 64 bits so it never wraps back to 0
+    std::atomic<uint64_t> timeSequence{0};
+    std::atomic<int64_t> latestPosition{0};
+    std::atomic<int64_t> latestTimeNs{0};
+};
@@ -0,0 +1,439 @@
+#include "disk_recorder.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+
+// Formats a WAV file holds as they are
+static bool isWavType(ASIOSampleType type) {
+    return type == ASIOSTInt16LSB || type == ASIOSTInt24LSB || type == ASIOSTInt32LSB || type == ASIOSTFloat32LSB;
+}
+
+static const char* formatName(ASIOSampleType type, bool native) {
+    if (!native || type == ASIOSTFloat32LSB) return "float32";
+    if (type == ASIOSTInt16LSB) return "int16";
+    if (type == ASIOSTInt24LSB) return "int24";
+    if (type == ASIOSTInt32LSB) return "int32";
+    return "driver format";
+}
+
+// One channel's samples into every stride-th slot of an interleaved buffer
+template <int Width>
+static void interleaveWidth(const uint8_t* src, uint8_t* dst, int frames, int stride) {
+    for (int i = 0; i < frames; i++) {
+        memcpy(dst + (size_t)i * stride, src + (size_t)i * Width, Width);
+    }
+}
+
+static void interleave(const uint8_t* src, uint8_t* dst, int frames, int width, int stride) {
+    switch (width) {
+        case 2: interleaveWidth<2>(src, dst, frames, stride); break;
+        case 3: interleaveWidth<3>(src, dst, frames, stride); break;
+        case 8: interleaveWidth<8>(src, dst, frames, stride); break;
+        default: interleaveWidth<4>(src, dst, frames, stride); break;
+    }
+}
+
+// RIFF/WAVE header padded with a JUNK chunk to exactly bytes, so the
+// samples start on a page. Past 4 GB it becomes RF64: the first JUNK chunk
+// is reserved for that and turns into the ds64 chunk with the real sizes.
+static std::vector<uint8_t> makeWavHeader(size_t bytes, int channels, double sampleRate, ASIOSampleType type,
+                                          uint64_t dataBytes, uint64_t frames) {
+    bool extensible = channels > 2;
+    int sampleBytes = getSampleBytes(type);
+    uint16_t tag = type == ASIOSTFloat32LSB ? 3 : 1;
+    uint32_t fmtSize = extensible ? 40 : 16;
+    uint32_t blockAlign = (uint32_t)channels * sampleBytes;
+    uint64_t riffSize = bytes - 8 + dataBytes + (dataBytes & 1);
+    bool rf64 = riffSize > 0xFFFFFFFFull;
+
+    std::vector<uint8_t> h;
+    auto put16 = [&](uint32_t v) { h.push_back(v & 0xff); h.push_back((v >> 8) & 0xff); };
+    auto put32 = [&](uint32_t v) { put16(v & 0xffff); put16(v >> 16); };
+    auto put64 = [&](uint64_t v) { put32((uint32_t)v); put32((uint32_t)(v >> 32)); };
+    auto putTag = [&](const char* s) { h.insert(h.end(), s, s + 4); };
+
+    putTag(rf64 ? "RF64" : "RIFF");
+    put32(rf64 ? 0xFFFFFFFFu : (uint32_t)riffSize);
+    putTag("WAVE");
+    putTag(rf64 ? "ds64" : "JUNK");
+    put32(28);
+    put64(rf64 ? riffSize : 0);
+    put64(rf64 ? dataBytes : 0);
+    put64(rf64 ? frames : 0);
+    put32(0);       // No table of other large chunks
+    putTag("fmt ");
+    put32(fmtSize);
+    put16(extensible ? 0xFFFE : tag);
+    put16(channels);
+    put32((uint32_t)sampleRate);
+    put32((uint32_t)sampleRate * blockAlign);
+    put16(blockAlign);
+    put16(sampleBytes * 8);
+    if (extensible) {
+        static const uint8_t kGuidTail[14] = {
+            0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+        };
+        put16(22);
+        put16(sampleBytes * 8);    // Valid bits
+        put32(0);                   // No speaker positions
+        put16(tag);
+        h.insert(h.end(), kGuidTail, kGuidTail + 14);
+    }
+    // Pad so the data chunk's header ends the page
+    uint32_t padBytes = (uint32_t)(bytes - h.size() - 16);
+    putTag("JUNK");
+    put32(padBytes);
+    h.resize(bytes - 8, 0);
+    putTag("data");
+    put32(rf64 ? 0xFFFFFFFFu : (uint32_t)dataBytes);
+    return h;
+}
+
+DiskRecorder::~DiskRecorder() {
+    stop();
+}
+
+void DiskRecorder::prepare(const StreamFormat& streamFormat) {
+    if (recording && !matches(streamFormat)) {
+        stop();
+        stopReason = "the stream's format changed";
+    }
+    format = streamFormat;
+    haveFormat = true;
+}
+
+bool DiskRecorder::matches(const StreamFormat& streamFormat) const {
+    if (streamFormat.sampleRate != format.sampleRate || streamFormat.bufferSize * 2 > ring.getCapacity()) {
+        return false;
+    }
+    const std::vector<ASIOSampleType>& types = config.fromOutputs ? streamFormat.outputTypes : streamFormat.inputTypes;
+    const std::vector<ASIOSampleType>& recorded = config.fromOutputs ? format.outputTypes : format.inputTypes;
+    for (int ch : config.channels) {
+        if (ch >= (int)types.size() || types[ch] != recorded[ch]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DiskRecorder::start(const RecorderConfig& recorderConfig) {
+    if (recording || !haveFormat || recorderConfig.channels.empty() || recorderConfig.path.empty() ||
+        format.bufferSize <= 0 || format.sampleRate <= 0.0) {
+        return false;
+    }
+    const std::vector<ASIOSampleType>& types = recorderConfig.fromOutputs ? format.outputTypes : format.inputTypes;
+    int count = (int)recorderConfig.channels.size();
+    std::vector<int> rawBytes(count);
+    bool uniform = true;
+    for (int i = 0; i < count; i++) {
+        int ch = recorderConfig.channels[i];
+        if (ch < 0 || ch >= (int)types.size()) {
+            return false;
+        }
+        rawBytes[i] = getSampleBytes(types[ch]);
+        uniform = uniform && types[ch] == types[recorderConfig.channels[0]];
+    }
+    config = recorderConfig;
+    channels = count;
+    rate = format.sampleRate;
+    ASIOSampleType firstType = types[config.channels[0]];
+    nativeSamples = uniform && (config.fileType == RecordRaw || isWavType(firstType));
+    fileSampleType = nativeSamples ? firstType : ASIOSTFloat32LSB;
+    frameBytes = channels * getSampleBytes(fileSampleType);
+
+    // Pages for the file buffer; the ring holds ringSeconds and at least a
+    // few blocks
+    writeBytes = (std::max(config.writeBytes, 1) + kHeaderBytes - 1) / kHeaderBytes * kHeaderBytes;
+    int capacity = std::max((int)(config.ringSeconds * format.sampleRate), format.bufferSize * 4);
+    size_t bytes = StreamArena::bytesFor<uint8_t>(writeBytes + frameBytes) +
+                   SpscRing::arenaBytes(rawBytes.data(), channels, capacity) +
+                   StreamArena::bytesFor<int>(channels) * 2 +
+                   StreamArena::bytesFor<const void*>(channels) +
+                   StreamArena::bytesFor<Gap>(kMaxGaps) +
+                   StreamArena::bytesFor<SampleConverter>(channels) +
+                   StreamArena::bytesFor<void*>(channels) +
+                   StreamArena::bytesFor<float*>(channels);
+    for (int i = 0; i < channels; i++) {
+        bytes += StreamArena::bytesFor<uint8_t>((size_t)kBatchFrames * rawBytes[i]);
+        if (!nativeSamples) {
+            bytes += StreamArena::bytesFor<float>(kBatchFrames);
+        }
+    }
+    // The file buffer goes first, so it starts the arena's first page
+    if (!arena.allocate(bytes) || !(output = arena.take<uint8_t>(writeBytes + frameBytes)) ||
+        !ring.configure(rawBytes.data(), channels, capacity, &arena)) {
+        return false;
+    }
+    int* map = arena.take<int>(channels);
+    int* widths = arena.take<int>(channels);
+    sources = arena.take<const void*>(channels);
+    gaps = arena.take<Gap>(kMaxGaps);
+    converters = arena.take<SampleConverter>(channels);
+    rawStaging = arena.take<void*>(channels);
+    floatStaging = arena.take<float*>(channels);
+    if (!map || !widths || !sources || !gaps || !converters || !rawStaging || !floatStaging) {
+        return false;
+    }
+    for (int i = 0; i < channels; i++) {
+        map[i] = config.channels[i];
+        widths[i] = rawBytes[i];
+        converters[i] = getSampleConverter(types[map[i]]);
+        if (!(rawStaging[i] = arena.take<uint8_t>((size_t)kBatchFrames * rawBytes[i])) ||
+            (!nativeSamples && !(floatStaging[i] = arena.take<float>(kBatchFrames)))) {
+            return false;
+        }
+    }
+    channelMap = map;
+    rawWidths = widths;
+
+    // Unbuffered: each write is one of ours, whole pages from the buffer
+    file = fopen(config.path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    setvbuf(file, nullptr, _IONBF, 0);
+    outputUsed = 0;
+    dataBytes = 0;
+    writeError.store(0, std::memory_order_relaxed);
+    framesRecorded.store(0, std::memory_order_relaxed);
+    if (config.fileType == RecordWav && !writeHeader()) {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    stopReason.clear();
+    quit = false;
+    tailGap = 0;
+    pendingGap = 0;
+    gapsWritten.store(0, std::memory_order_relaxed);
+    gapsRead.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    droppedFrames.store(0, std::memory_order_relaxed);
+    bytesWritten.store(0, std::memory_order_relaxed);
+    writes.store(0, std::memory_order_relaxed);
+    ringPeak.store(0, std::memory_order_relaxed);
+    writer = std::thread(&DiskRecorder::writerLoop, this);
+
+    // Everything the callback reads is in place before it sees armed
+    armed.store(true);
+    recording = true;
+    return true;
+}
+
+bool DiskRecorder::stop() {
+    if (!recording) {
+        return true;
+    }
+    // After this, no callback is inside capture() or will enter it
+    armed.store(false);
+    while (inProcess.load()) {
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        tailGap = pendingGap;
+    }
+    wake.notify_one();
+    writer.join();
+
+    bool ok = writeError.load(std::memory_order_relaxed) == 0;
+    if (config.fileType == RecordWav) {
+        ok = writeHeader() && ok;
+    }
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    recording = false;
+    return ok;
+}
+
+bool DiskRecorder::writeHeader() {
+    std::vector<uint8_t> header = makeWavHeader(kHeaderBytes, channels, rate, fileSampleType, dataBytes,
+                                                framesRecorded.load(std::memory_order_relaxed));
+    return fseek(file, 0, SEEK_SET) == 0 && fwrite(header.data(), 1, header.size(), file) == header.size();
+}
+
+void DiskRecorder::process(const StreamBlock& block) {
+    // Sequentially consistent with stop(): either it sees this callback
+    // inside, or this callback sees the recorder disarmed
+    inProcess.store(true);
+    if (armed.load()) {
+        capture(block);
+    }
+    inProcess.store(false, std::memory_order_release);
+}
+
+void DiskRecorder::capture(const StreamBlock& block) {
+    void* const* buffers = config.fromOutputs ? block.outputs : block.inputs;
+    for (int i = 0; i < channels; i++) {
+        sources[i] = buffers[channelMap[i]];
+    }
+    // Frames dropped before this block go in the gap queue first, and only
+    // with room for the block behind them, so they land where they belong
+    if (pendingGap > 0) {
+        uint32_t written = gapsWritten.load(std::memory_order_relaxed);
+        if (written - gapsRead.load(std::memory_order_acquire) == kMaxGaps || ring.getSpace() < block.frames) {
+            drop(block.frames);
+            return;
+        }
+        gaps[written % kMaxGaps] = { ring.getWritten(), pendingGap };
+        gapsWritten.store(written + 1, std::memory_order_release);
+        pendingGap = 0;
+    }
+    if (!ring.write(sources, block.frames)) {
+        drop(block.frames);
+    }
+}
+
+void DiskRecorder::drop(int frames) {
+    pendingGap += frames;
+    overruns.fetch_add(1, std::memory_order_relaxed);
+    droppedFrames.fetch_add(frames, std::memory_order_relaxed);
+}
+
+void DiskRecorder::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!quit) {
+        wake.wait_for(lock, std::chrono::milliseconds(kWakeMs));
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+    uint64_t tail = tailGap;
+    lock.unlock();
+
+    // The callback has let go; what it left ends the file
+    drain();
+    appendSilence(tail);
+    if (config.fileType == RecordWav && (dataBytes & 1)) {
+        output[outputUsed++] = 0;   // RIFF pads odd chunks
+    }
+    if (outputUsed > 0) {
+        writeChunk(outputUsed);
+    }
+}
+
+void DiskRecorder::drain() {
+    for (;;) {
+        // The index first: a gap at or before it is then visible too
+        int available = ring.getAvailable();
+        if (available > ringPeak.load(std::memory_order_relaxed)) {
+            ringPeak.store(available, std::memory_order_relaxed);
+        }
+        uint64_t position = ring.getRead();
+        uint32_t next = gapsRead.load(std::memory_order_relaxed);
+        bool gapQueued = next != gapsWritten.load(std::memory_order_acquire);
+        if (gapQueued && gaps[next % kMaxGaps].position == position) {
+            appendSilence(gaps[next % kMaxGaps].frames);
+            gapsRead.store(next + 1, std::memory_order_release);
+            continue;
+        }
+        int frames = std::min(available, kBatchFrames);
+        if (gapQueued) {
+            frames = (int)std::min<uint64_t>(frames, gaps[next % kMaxGaps].position - position);
+        }
+        if (frames <= 0) {
+            return;
+        }
+        ring.read(rawStaging, frames);
+        appendFrames(frames);
+    }
+}
+
+void DiskRecorder::appendFrames(int frames) {
+    int sampleBytes = getSampleBytes(fileSampleType);
+    for (int done = 0; done < frames;) {
+        // Up to the first frame that reaches writeBytes
+        int count = std::min(frames - done, (int)((writeBytes - outputUsed + frameBytes - 1) / frameBytes));
+        uint8_t* dst = output + outputUsed;
+        for (int i = 0; i < channels; i++) {
+            const uint8_t* src = (const uint8_t*)rawStaging[i] + (size_t)done * rawWidths[i];
+            if (!nativeSamples) {
+                converters[i].toFloat(src, floatStaging[i], count);
+                src = (const uint8_t*)floatStaging[i];
+            }
+            interleave(src, dst + i * sampleBytes, count, sampleBytes, frameBytes);
+        }
+        outputUsed += (size_t)count * frameBytes;
+        dataBytes += (uint64_t)count * frameBytes;
+        done += count;
+        if (outputUsed >= writeBytes) {
+            writeChunk(writeBytes);
+        }
+    }
+    framesRecorded.fetch_add(frames, std::memory_order_relaxed);
+}
+
+void DiskRecorder::appendSilence(uint64_t frames) {
+    // Zero bytes are silence in every sample format
+    for (uint64_t done = 0; done < frames;) {
+        uint64_t count = std::min<uint64_t>(frames - done, (writeBytes - outputUsed + frameBytes - 1) / frameBytes);
+        memset(output + outputUsed, 0, (size_t)count * frameBytes);
+        outputUsed += (size_t)count * frameBytes;
+        dataBytes += count * frameBytes;
+        done += count;
+        if (outputUsed >= writeBytes) {
+            writeChunk(writeBytes);
+        }
+    }
+    framesRecorded.fetch_add(frames, std::memory_order_relaxed);
+}
+
+void DiskRecorder::writeChunk(size_t bytes) {
+    // After a failed write the file is finished; keep draining the ring so
+    // the callback does not start dropping too
+    if (writeError.load(std::memory_order_relaxed) == 0) {
+        if (fwrite(output, 1, bytes, file) == bytes) {
+            bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+            writes.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            writeError.store(errno != 0 ? errno : EIO, std::memory_order_relaxed);
+        }
+    }
+    memmove(output, output + bytes, outputUsed - bytes);
+    outputUsed -= bytes;
+}
+
+RecorderReport DiskRecorder::getReport() const {
+    RecorderReport r;
+    r.recording = recording;
+    r.path = config.path;
+    r.channels = channels;
+    r.sampleRate = rate;
+    r.sampleFormat = formatName(fileSampleType, nativeSamples);
+    r.frames = framesRecorded.load(std::memory_order_relaxed);
+    r.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+    r.writes = writes.load(std::memory_order_relaxed);
+    r.overruns = overruns.load(std::memory_order_relaxed);
+    r.droppedFrames = droppedFrames.load(std::memory_order_relaxed);
+    r.ringSeconds = rate > 0.0 ? ring.getCapacity() / rate : 0.0;
+    r.ringPeakPercent = ring.getCapacity() > 0 ? ringPeak.load(std::memory_order_relaxed) * 100.0 / ring.getCapacity() : 0.0;
+    r.error = stopReason;
+    int error = writeError.load(std::memory_order_relaxed);
+    if (error != 0) {
+        r.error = "write failed: " + std::generic_category().message(error);
+    }
+    return r;
+}
+
+std::string DiskRecorder::formatText(const RecorderReport& r) {
+    if (r.path.empty()) {
+        return "Not recording\n";
+    }
+    char buf[256];
+    std::string text = (r.recording ? "Recording to " : "Recorded to ") + r.path + "\n";
+    snprintf(buf, sizeof(buf),
+             "%d channels, %s at %.0f Hz; %.1f s, %.1f MB in %llu writes\n"
+             "Ring: %.1f s, peak %.0f%% full; %llu overruns, %.3f s recorded as silence\n",
+             r.channels, r.sampleFormat, r.sampleRate, r.sampleRate > 0 ? r.frames / r.sampleRate : 0.0,
+             r.bytesWritten / 1048576.0, (unsigned long long)r.writes, r.ringSeconds, r.ringPeakPercent,
+             (unsigned long long)r.overruns, r.sampleRate > 0 ? r.droppedFrames / r.sampleRate : 0.0);
+    text += buf;
+    if (!r.error.empty()) {
+        text += "Stopped: " + r.error + "\n";
+    }
+    return text;
+}
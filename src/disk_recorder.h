@@ -0,0 +1,156 @@
+#pragma once
+
+#include "sample_convert.h"
+#include "spsc_ring.h"
+#include "stream_arena.h"
+#include "stream_tap.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum RecordFileType {
+    RecordWav = 0,      // RIFF/WAVE, switched to RF64 if it grows past 4 GB
+    RecordRaw           // Interleaved samples, no header
+};
+
+struct RecorderConfig {
+    std::string path;
+    RecordFileType fileType = RecordWav;
+    bool fromOutputs = false;           // Record the mix instead of the inputs
+    std::vector<int> channels;          // Host channels recorded, in file order
+    double ringSeconds = 2.0;           // Audio the ring holds while the disk is slow
+    int writeBytes = 1 << 20;           // Size of each file write, rounded to whole pages
+};
+
+struct RecorderReport {
+    bool recording;
+    std::string path;
+    int channels;
+    double sampleRate;
+    const char* sampleFormat;   // As stored in the file
+    uint64_t frames;            // Frames in the file so far, dropped ones included
+    uint64_t bytesWritten;
+    uint64_t writes;            // File writes made
+    uint64_t overruns;          // Blocks the callback dropped because the ring was full
+    uint64_t droppedFrames;     // Frames in them, recorded as silence
+    double ringSeconds;
+    double ringPeakPercent;     // Fullest the writer has found the ring
+    std::string error;          // Why the file stopped growing, if it did
+};
+
+// Records channels of a host stream to a WAV or raw file. The tap's
+// process() only copies the chosen channels' driver buffers, as they are,
+// into a lock-free SPSC ring sized for ringSeconds of audio. A writer
+// thread wakes every kWakeMs, drains whatever the ring holds, interleaves
+// it into a page-aligned buffer and writes that out writeBytes at a time,
+// at page-aligned file offsets (the WAV header is padded to one page).
+//
+// The callback never waits for the writer: a block that does not fit in
+// the ring is dropped and counted. The writer records the dropped frames
+// as silence where they belong, so the file's timeline stays that of the
+// stream. Channels whose format WAV cannot hold (big-endian, padded
+// 32-bit, float64) are converted to float32 on the writer thread; raw
+// files keep the driver's format when all channels share one.
+//
+// Register the tap with the host once, then start() and stop() recordings
+// from the control thread at any time after the host has created its
+// buffers, streaming or not. A buffer size change keeps recording; any
+// other format change ends the recording, with the file complete up to it.
+class DiskRecorder : public StreamTap {
+public:
+    static const int kWakeMs = 50;
+
+    DiskRecorder() = default;
+    ~DiskRecorder() override;
+    DiskRecorder(const DiskRecorder&) = delete;
+    DiskRecorder& operator=(const DiskRecorder&) = delete;
+
+    // StreamTap
+    void prepare(const StreamFormat& format) override;
+    void process(const StreamBlock& block) override;
+
+    // Control thread. start() fails if the host has no buffers, a channel
+    // does not exist, or the file cannot be created; stop() returns false
+    // if the file could not be written in full.
+    bool start(const RecorderConfig& config);
+    bool stop();
+    bool isRecording() const { return recording; }
+
+    RecorderReport getReport() const;
+    static std::string formatText(const RecorderReport& report);
+
+private:
+    // Frames the callback dropped, owed to the file at a ring position
+    struct Gap {
+        uint64_t position;
+        uint64_t frames;
+    };
+    static const uint32_t kMaxGaps = 64;
+    static const int kBatchFrames = 4096;
+    static const size_t kHeaderBytes = 4096;
+
+    bool matches(const StreamFormat& format) const;
+    void capture(const StreamBlock& block);
+    void drop(int frames);
+
+    // Writer thread
+    void writerLoop();
+    void drain();
+    void appendFrames(int frames);
+    void appendSilence(uint64_t frames);
+    void writeChunk(size_t bytes);
+    bool writeHeader();
+
+    // Control thread
+    StreamFormat format;
+    bool haveFormat = false;
+    RecorderConfig config;
+    bool recording = false;
+    std::string stopReason;
+    StreamArena arena;
+    FILE* file = nullptr;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit = false;                  // Under mutex
+    uint64_t tailGap = 0;               // Dropped frames owed at stop(), under mutex
+    int channels = 0;
+    double rate = 0.0;
+    ASIOSampleType fileSampleType = ASIOSTFloat32LSB;
+    bool nativeSamples = false;         // File holds the driver's bytes unconverted
+    int frameBytes = 0;                 // One interleaved frame in the file
+
+    SpscRing ring;
+
+    // Driver's thread
+    alignas(StreamArena::kCacheLine) const int* channelMap = nullptr;
+    const void** sources = nullptr;
+    uint64_t pendingGap = 0;
+    std::atomic<bool> armed{false};
+    std::atomic<bool> inProcess{false};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> droppedFrames{0};
+    Gap* gaps = nullptr;
+    std::atomic<uint32_t> gapsWritten{0};
+
+    // Writer thread
+    alignas(StreamArena::kCacheLine) std::atomic<uint32_t> gapsRead{0};
+    const int* rawWidths = nullptr;     // Ring bytes per frame of each channel
+    SampleConverter* converters = nullptr;
+    void** rawStaging = nullptr;
+    float** floatStaging = nullptr;
+    uint8_t* output = nullptr;          // writeBytes plus one frame, page-aligned
+    size_t outputUsed = 0;
+    size_t writeBytes = 0;
+    uint64_t dataBytes = 0;
+    std::atomic<uint64_t> framesRecorded{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> writes{0};
+    std::atomic<int> ringPeak{0};
+    std::atomic<int> writeError{0};     // errno of the first failed write
+};
@@ -0,0 +1,128 @@
+#include "driver_requests.h"
+#include "callback_stats.h"
+#include <cstdio>
+
+static int requestIndex(DriverRequest request) {
+    int index = 0;
+    while (index < NumDriverRequests && (1u << index) != (uint32_t)request) {
+        index++;
+    }
+    return index;
+}
+
+void DriverRequests::post(DriverRequest request) {
+    // Time the first request of a batch; later ones join its recovery
+    uint64_t none = 0;
+    postedNs.compare_exchange_strong(none, CallbackStats::now(), std::memory_order_relaxed);
+    int index = requestIndex(request);
+    if (index < NumDriverRequests) {
+        received[index].fetch_add(1, std::memory_order_relaxed);
+    }
+    pending.fetch_or(request, std::memory_order_release);
+}
+
+void DriverRequests::postBufferSize(long frames) {
+    bufferSize.store(frames, std::memory_order_relaxed);
+    post(RequestBufferSize);
+}
+
+void DriverRequests::postSampleRate(double rate) {
+    sampleRate.store(rate, std::memory_order_relaxed);
+    post(RequestSampleRate);
+}
+
+PendingRequests DriverRequests::take() {
+    PendingRequests taken;
+    taken.requests = pending.exchange(0, std::memory_order_acquire);
+    // A request posted from here on is left for the next take(); its time
+    // may be lost, which only leaves that recovery untimed
+    taken.postedNs = postedNs.exchange(0, std::memory_order_relaxed);
+    taken.bufferSize = bufferSize.load(std::memory_order_relaxed);
+    taken.sampleRate = sampleRate.load(std::memory_order_relaxed);
+    return taken;
+}
+
+void DriverRequests::recordRecovery(const PendingRequests& handled, uint64_t takenNs, bool succeeded) {
+    uint64_t end = CallbackStats::now();
+    recoveries++;
+    lastRequests = handled.requests;
+    lastWorkMs = (end - takenNs) / 1e6;
+    if (!succeeded) {
+        failedRecoveries++;
+        return;
+    }
+    if (handled.postedNs != 0) {
+        lastRecoveryMs = (end - handled.postedNs) / 1e6;
+        if (lastRecoveryMs > maxRecoveryMs) {
+            maxRecoveryMs = lastRecoveryMs;
+        }
+    }
+}
+
+DriverRequestReport DriverRequests::getReport() const {
+    DriverRequestReport r;
+    for (int i = 0; i < NumDriverRequests; i++) {
+        r.received[i] = received[i].load(std::memory_order_relaxed);
+    }
+    r.recoveries = recoveries;
+    r.failedRecoveries = failedRecoveries;
+    r.lastRecoveryMs = lastRecoveryMs;
+    r.maxRecoveryMs = maxRecoveryMs;
+    r.lastWorkMs = lastWorkMs;
+    r.lastRequests = lastRequests;
+    return r;
+}
+
+const char* DriverRequests::getRequestName(uint32_t requestBit) {
+    switch (requestBit) {
+        case RequestReset: return "reset";
+        case RequestBufferSize: return "buffer size";
+        case RequestSampleRate: return "sample rate";
+        case RequestResync: return "resync";
+        case RequestLatencies: return "latencies";
+    }
+    return "unknown";
+}
+
+// Names of the set bits, comma separated
+static std::string requestList(uint32_t requests) {
+    std::string list;
+    for (int i = 0; i < NumDriverRequests; i++) {
+        if (requests & (1u << i)) {
+            if (!list.empty()) list += ", ";
+            list += DriverRequests::getRequestName(1u << i);
+        }
+    }
+    return list.empty() ? "none" : list;
+}
+
+std::string DriverRequests::formatText(const DriverRequestReport& r) {
+    char buf[384];
+    int n = snprintf(buf, sizeof(buf),
+                     "Requests: %llu reset, %llu buffer size, %llu sample rate, %llu resync, %llu latency\n"
+                     "Recoveries: %llu (%llu failed)\n",
+                     (unsigned long long)r.received[0], (unsigned long long)r.received[1],
+                     (unsigned long long)r.received[2], (unsigned long long)r.received[3],
+                     (unsigned long long)r.received[4],
+                     (unsigned long long)r.recoveries, (unsigned long long)r.failedRecoveries);
+    if (r.lastRecoveryMs >= 0 && n > 0 && n < (int)sizeof(buf)) {
+        snprintf(buf + n, sizeof(buf) - n, "Last recovery: %s, %.1f ms to audio (max %.1f ms)\n",
+                 requestList(r.lastRequests).c_str(), r.lastRecoveryMs, r.maxRecoveryMs);
+    }
+    return buf;
+}
+
+std::string DriverRequests::formatJson(const DriverRequestReport& r) {
+    char buf[384];
+    snprintf(buf, sizeof(buf),
+             "{\"reset\":%llu,\"buffer_size\":%llu,\"sample_rate\":%llu,\"resync\":%llu,"
+             "\"latencies\":%llu,\"recoveries\":%llu,\"failed\":%llu,\"last_recovery_ms\":%s,"
+             "\"max_recovery_ms\":%.3f}",
+             (unsigned long long)r.received[0], (unsigned long long)r.received[1],
+             (unsigned long long)r.received[2], (unsigned long long)r.received[3],
+             (unsigned long long)r.received[4],
+             (unsigned long long)r.recoveries, (unsigned long long)r.failedRecoveries,
+             r.lastRecoveryMs >= 0 ? std::to_string(r.lastRecoveryMs).c_str() : "null",
+             r.maxRecoveryMs);
+    return buf;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Kinds of request a driver makes, as bits so pending ones combine
+enum DriverRequest {
+    RequestReset = 1u << 0,         // kAsioResetRequest: re-initialize the driver
+    RequestBufferSize = 1u << 1,    // kAsioBufferSizeChange: recreate buffers at a new size
+    RequestSampleRate = 1u << 2,    // sampleRateDidChange
+    RequestResync = 1u << 3,        // kAsioResyncRequest: position lost, restart tracking
+    RequestLatencies = 1u << 4,     // kAsioLatenciesChanged
+    NumDriverRequests = 5
+};
+
+// Requests taken by the control thread in one go
+struct PendingRequests {
+    uint32_t requests;          // DriverRequest bits
+    long bufferSize;            // Latest size from RequestBufferSize
+    double sampleRate;          // Latest rate from RequestSampleRate
+    uint64_t postedNs;          // When the first of them was posted, 0 if unknown
+};
+
+// Requests received and how recovering from them went
+struct DriverRequestReport {
+    uint64_t received[NumDriverRequests];   // Per DriverRequest bit, in bit order
+    uint64_t recoveries;        // Times the control thread acted on requests
+    uint64_t failedRecoveries;
+    double lastRecoveryMs;      // Posted to streaming again, -1 if none yet
+    double maxRecoveryMs;
+    double lastWorkMs;          // Control-thread time of the last recovery
+    uint32_t lastRequests;      // What the last recovery handled
+};
+
+// Mailbox for driver requests, from whichever thread the driver calls
+// asioMessage or sampleRateDidChange on to the control thread. post() is
+// lock-free and never allocates: each request sets a bit in one atomic
+// word, and the values travel in their own atomics. Repeats of a request
+// that is still pending merge into one, so a burst of resets costs one
+// recovery. take() hands everything pending to the control thread at once;
+// it, recordRecovery() and getReport() belong to the control thread.
+class DriverRequests {
+public:
+    // Any thread. Values are published before the bit.
+    void post(DriverRequest request);
+    void postBufferSize(long frames);
+    void postSampleRate(double rate);
+
+    bool isPending() const { return pending.load(std::memory_order_acquire) != 0; }
+
+    // Control thread: everything posted so far, clearing it
+    PendingRequests take();
+
+    // Control thread: how recovering from requests taken at takenNs went
+    void recordRecovery(const PendingRequests& handled, uint64_t takenNs, bool succeeded);
+
+    DriverRequestReport getReport() const;
+
+    static const char* getRequestName(uint32_t requestBit);
+    static std::string formatText(const DriverRequestReport& report);
+    static std::string formatJson(const DriverRequestReport& report);
+
+private:
+    std::atomic<uint32_t> pending{0};
+    std::atomic<long> bufferSize{0};
+    std::atomic<double> sampleRate{0.0};
+    std::atomic<uint64_t> postedNs{0};
+    std::atomic<uint64_t> received[NumDriverRequests] = {};
+
+    // Control thread only
+    uint64_t recoveries = 0;
+    uint64_t failedRecoveries = 0;
+    double lastRecoveryMs = -1.0;
+    double maxRecoveryMs = 0.0;
+    double lastWorkMs = 0.0;
+    uint32_t lastRequests = 0;
+};
@@ -0,0 +1,115 @@
+#include "level_meters.h"
+#include <cmath>
+#include <cstdio>
+#include <new>
+
+// Peak programme meter fall-back and a VU-like RMS window
+const double LevelMeters::kPeakFallDbPerSecond = 20.0;
+const double LevelMeters::kRmsSeconds = 0.3;
+
+// Float inputs can carry anything; cap what a block contributes so an
+// infinity or NaN cannot stick in the meter, and flush tiny values before
+// the decay turns them into denormals
+static const float kMaxLevel = 1e6f;
+static const float kMinMeanSquare = 1e-24f;
+static const float kMinPeak = 1e-12f;
+
+size_t LevelMeters::arenaBytes(int numInputs, int numOutputs) {
+    return StreamArena::bytesFor<Meter>(numInputs) + StreamArena::bytesFor<Meter>(numOutputs);
+}
+
+bool LevelMeters::configure(int inputs, int outputs, int bufferSize, double sampleRate, StreamArena* arena) {
+    clear();
+    if (bufferSize <= 0 || sampleRate <= 0.0) {
+        return false;
+    }
+    Meter* in = arena->take<Meter>(inputs);
+    Meter* out = arena->take<Meter>(outputs);
+    if ((inputs > 0 && !in) || (outputs > 0 && !out)) {
+        return false;
+    }
+    for (int ch = 0; ch < inputs; ch++) {
+        new (&in[ch]) Meter();
+    }
+    for (int ch = 0; ch < outputs; ch++) {
+        new (&out[ch]) Meter();
+    }
+
+    double blockSeconds = bufferSize / sampleRate;
+    frames = (float)bufferSize;
+    peakFall = (float)std::pow(10.0, -kPeakFallDbPerSecond * blockSeconds / 20.0);
+    rmsWeight = (float)(1.0 - std::exp(-blockSeconds / kRmsSeconds));
+    inputMeters = in;
+    outputMeters = out;
+    numInputs = inputs;
+    numOutputs = outputs;
+    return true;
+}
+
+void LevelMeters::clear() {
+    inputMeters = nullptr;
+    outputMeters = nullptr;
+    numInputs = 0;
+    numOutputs = 0;
+}
+
+void LevelMeters::fold(Meter& meter, const BlockLevel& block, float fall, float weight, float blockFrames) {
+    float peak = block.peak < kMaxLevel ? block.peak : kMaxLevel;
+    float meanSquare = block.sumSquares / blockFrames;
+    if (!(meanSquare < kMaxLevel)) {
+        meanSquare = kMaxLevel;
+    }
+
+    float held = meter.heldPeak * fall;
+    meter.heldPeak = peak > held ? peak : (held > kMinPeak ? held : 0.0f);
+    meter.meanSquare += weight * (meanSquare - meter.meanSquare);
+    if (meter.meanSquare < kMinMeanSquare) {
+        meter.meanSquare = 0.0f;
+    }
+
+    meter.peak.store(meter.heldPeak, std::memory_order_relaxed);
+    meter.rms.store(std::sqrt(meter.meanSquare), std::memory_order_relaxed);
+}
+
+void LevelMeters::update(const BlockLevel* inputs, const BlockLevel* outputs) {
+    if (!inputs || !outputs) {
+        return;
+    }
+    for (int ch = 0; ch < numInputs; ch++) {
+        fold(inputMeters[ch], inputs[ch], peakFall, rmsWeight, frames);
+    }
+    for (int ch = 0; ch < numOutputs; ch++) {
+        fold(outputMeters[ch], outputs[ch], peakFall, rmsWeight, frames);
+    }
+}
+
+ChannelLevel LevelMeters::read(const Meter* meters, int count, int channel) {
+    ChannelLevel level = { 0.0f, 0.0f };
+    if (meters && channel >= 0 && channel < count) {
+        level.peak = meters[channel].peak.load(std::memory_order_relaxed);
+        level.rms = meters[channel].rms.load(std::memory_order_relaxed);
+    }
+    return level;
+}
+
+ChannelLevel LevelMeters::getInputLevel(int channel) const {
+    return read(inputMeters, numInputs, channel);
+}
+
+ChannelLevel LevelMeters::getOutputLevel(int channel) const {
+    return read(outputMeters, numOutputs, channel);
+}
+
+double LevelMeters::toDecibels(float level) {
+    return level > 0.0f ? 20.0 * std::log10(level) : -INFINITY;
+}
+
+std::string LevelMeters::formatLevel(const ChannelLevel& level) {
+    if (level.peak <= 0.0f) {
+        return "silent";
+    }
+    char text[64];
+    snprintf(text, sizeof(text), "peak %.1f dBFS, RMS %.1f dBFS",
+             toDecibels(level.peak), toDecibels(level.rms));
+    return text;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "sample_convert.h"
+#include "stream_arena.h"
+#include <atomic>
+#include <string>
+
+// A channel's level as a meter shows it, linear (1.0 = full scale)
+struct ChannelLevel {
+    float peak;     // Block peaks, held and falling at kPeakFallDbPerSecond
+    float rms;      // RMS over about the last kRmsSeconds
+};
+
+// Peak and RMS meters for every input and output of a stream. The driver
+// thread folds in the levels MixEngine measured for each block and
+// publishes the result with relaxed atomic stores; any thread may load
+// them at any rate without locks and without ever holding up the callback.
+// A reader may see a channel's peak from one block and its RMS from the
+// next, which no meter can show.
+//
+// The meters live in the stream arena, so they exist from createBuffers
+// to disposeBuffers; readers on threads other than the control thread
+// must not outlive the stream.
+class LevelMeters {
+public:
+    static const double kPeakFallDbPerSecond;
+    static const double kRmsSeconds;
+
+    // Control thread, with the stream stopped. Levels start at zero.
+    static size_t arenaBytes(int numInputs, int numOutputs);
+    bool configure(int numInputs, int numOutputs, int bufferSize, double sampleRate, StreamArena* arena);
+    void clear();
+
+    // Driver thread, once per block
+    void update(const BlockLevel* inputs, const BlockLevel* outputs);
+
+    // Any thread; silence for a channel the stream does not have
+    ChannelLevel getInputLevel(int channel) const;
+    ChannelLevel getOutputLevel(int channel) const;
+
+    // dBFS, with silence as -inf
+    static double toDecibels(float level);
+    static std::string formatLevel(const ChannelLevel& level);
+
+private:
+    struct Meter {
+        std::atomic<float> peak{0.0f};      // Published
+        std::atomic<float> rms{0.0f};
+        float heldPeak = 0.0f;              // Driver thread
+        float meanSquare = 0.0f;
+    };
+
+    static void fold(Meter& meter, const BlockLevel& block, float peakFall, float rmsWeight, float blockFrames);
+    static ChannelLevel read(const Meter* meters, int count, int channel);
+
+    Meter* inputMeters = nullptr;
+    Meter* outputMeters = nullptr;
+    int numInputs = 0;
+    int numOutputs = 0;
+    float frames = 0.0f;
+    float peakFall = 0.0f;      // Held peak multiplier per block
+    float rmsWeight = 0.0f;     // Weight of each block's mean square
+};
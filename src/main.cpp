@@ -1,17 +1,41 @@
 #include "asio_host.h"
+#include "audio_bridge.h"
+#include "buffer_tuner.h"
+#include "disk_recorder.h"
+#include "routing_rules.h"
+#include "rtp_stream.h"
 #include <windows.h>
 #include <shellapi.h>
+#include <shlobj.h>
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <vector>
 
 // Application constants
 #define WM_TRAYICON (WM_USER + 1)
+#define WM_ASIO_REQUEST (WM_USER + 2)
 #define ID_TRAY_EXIT 1001
 #define ID_TRAY_TOGGLE 1002
 #define ID_TRAY_INFO 1003
 #define ID_TRAY_ROUTING 1004
+#define ID_TRAY_REDETECT 1005
+#define ID_TRAY_TIMING 1006
+#define ID_TRAY_PARALLEL 1007
+#define ID_TRAY_AUTOTUNE 1008
+#define ID_TRAY_BRIDGE_OFF 1009
+#define ID_TRAY_RECORD_INPUTS 1010
+#define ID_TRAY_RECORD_OUTPUTS 1011
+#define ID_TRAY_RECORD_STOP 1012
+#define ID_TRAY_EDIT_RULES 1013
+#define ID_TRAY_MUTE 1014
+#define ID_TRAY_NETWORK 1015
 #define ID_TRAY_DRIVERS 1100
+#define ID_TRAY_BUFFERS 1200
+#define ID_TRAY_BRIDGES 1300
+#define ID_TUNER_TIMER 1
 
 // Global variables
 HWND g_hwnd = nullptr;
@@ -20,6 +44,37 @@ HMENU g_menu = nullptr;
 ASIOHost g_asioHost;
 bool g_running = false;
 std::string g_selectedDriver = "Synchronous Audio Router";
+int g_bufferSize = 0;                   // 0 = the driver's preferred size
+std::vector<int> g_bufferChoices;       // Sizes listed in the last menu
+bool g_autoTune = false;                // Pick the buffer size from measured headroom
+BufferTuner g_tuner;
+std::string g_tunedDriver;              // Driver the tuner is searching for
+int g_savedTunedSize = 0;               // Last size stored for it
+ASIOHost g_bridgeHost;                  // Second driver the outputs are bridged to
+AudioBridge g_bridge;
+std::string g_bridgeDriver;             // Empty = no bridge
+bool g_bridgeRunning = false;
+DiskRecorder g_recorder;                 // Tap on the main host, added once
+RtpSender g_networkSender;              // Likewise
+bool g_muted = false;                   // All outputs muted, kept across restarts
+
+// Settings live in the registry; tuned buffer sizes are one value per driver
+const char* kSettingsKey = "Software\\ASIOMiniHost";
+const char* kTunedSizesKey = "Software\\ASIOMiniHost\\TunedBufferSizes";
+
+// Threads used by "Parallel Mixing", the driver's included
+const int kParallelMixThreads = 4;
+
+// Where "Stream Outputs to Network" sends, and how many outputs at most:
+// the usual AES67 multicast range and port
+const char* kNetworkAddress = "239.69.0.1";
+const int kNetworkPort = 5004;
+const int kNetworkMaxChannels = 8;
+
+// How often auto-tuning looks at the callback timing, and how long a tuned
+// size runs cleanly before a smaller one is tried again
+const UINT kTunerIntervalMs = 1000;
+const double kTunerStepDownSeconds = 600.0;
 
 // Function declarations
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -29,8 +84,27 @@ void ShowContextMenu(HWND hwnd);
 void UpdateTrayTooltip();
 bool StartAudio();
 void StopAudio();
+void ReconfigureAudio();
+std::vector<int> GetBufferSizeChoices();
+int BeginBufferTuning();
+void TuneBufferSize();
+void SetAutoTune(bool enabled);
+DWORD ReadSetting(const char* key, const char* name, DWORD fallback);
+void WriteSetting(const char* key, const char* name, DWORD value);
+bool StartBridge();
+void StopBridge();
+void RefreshBridge();
+void StartRecording(bool outputs);
+void StopRecording();
+void StartNetworkStream();
+void StopNetworkStream();
+std::string GetRoutingRulesPath();
+void SetMuted(bool muted);
+void LoadRoutingRules();
+void EditRoutingRules();
 void ShowInfo();
 void ShowRouting();
+void SaveTimingReport();
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
     // Parse command line for driver name
@@ -64,10 +138,19 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     }
     
     CreateTrayIcon(g_hwnd);
+    g_autoTune = ReadSetting(kSettingsKey, "AutoTune", 0) != 0;
+    
+    // Driver requests (reset, buffer size change, ...) come in on the
+    // driver's thread; handle them here on the message loop
+    g_asioHost.setRequestNotify([] { PostMessageA(g_hwnd, WM_ASIO_REQUEST, 0, 0); });
+    g_bridgeHost.setRequestNotify([] { PostMessageA(g_hwnd, WM_ASIO_REQUEST, 1, 0); });
+    g_asioHost.addTap(&g_recorder);
+    g_asioHost.addTap(&g_networkSender);
+    LoadRoutingRules();
     
     // Try to start audio
     if (!StartAudio()) {
-        auto drivers = ASIOHost::getDriverList();
+        auto drivers = ASIOHost::getDriverList(true);
         std::stringstream ss;
         ss << "Could not start with driver: " << g_selectedDriver << "\n\n";
         ss << "Available ASIO drivers:\n";
@@ -99,6 +182,42 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             }
             return 0;
             
+        case WM_ASIO_REQUEST: {
+            if (wParam == 1) {
+                // From the bridge's driver; the main stream is not affected
+                if (g_bridgeRunning && !g_bridgeHost.processDriverRequests()) {
+                    StopBridge();
+                    StartBridge();
+                }
+                RefreshBridge();
+                return 0;
+            }
+            // Several requests may share one message; the host takes them all
+            int sizeBefore = g_asioHost.getBufferSize();
+            if (!g_asioHost.processDriverRequests() && g_running) {
+                StopAudio();
+                StartAudio();
+            } else if (g_running) {
+                // A reset with new outputs drops their mutes; outputs it added
+                // must follow the mute too
+                SetMuted(g_muted);
+            }
+            // A size set in the driver's own panel overrides auto-tuning,
+            // like one picked from the menu
+            if (g_autoTune && g_running && g_asioHost.getBufferSize() != sizeBefore) {
+                SetAutoTune(false);
+            }
+            RefreshBridge();
+            UpdateTrayTooltip();
+            return 0;
+        }
+            
+        case WM_TIMER:
+            if (wParam == ID_TUNER_TIMER) {
+                TuneBufferSize();
+            }
+            return 0;
+            
         case WM_COMMAND:
             switch (LOWORD(wParam)) {
                 case ID_TRAY_EXIT:
@@ -122,13 +241,87 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     ShowRouting();
                     return 0;
                     
+                case ID_TRAY_TIMING:
+                    SaveTimingReport();
+                    return 0;
+                    
+                case ID_TRAY_PARALLEL:
+                    // The worker pool is set up with the buffers; the driver stays loaded
+                    g_asioHost.setMixThreads(g_asioHost.getMixThreads() > 1 ? 1 : kParallelMixThreads);
+                    ReconfigureAudio();
+                    return 0;
+                    
+                case ID_TRAY_AUTOTUNE:
+                    SetAutoTune(!g_autoTune);
+                    return 0;
+                    
+                case ID_TRAY_BRIDGE_OFF:
+                    StopBridge();
+                    g_bridgeDriver.clear();
+                    return 0;
+                    
+                case ID_TRAY_RECORD_INPUTS:
+                case ID_TRAY_RECORD_OUTPUTS:
+                    StopRecording();
+                    StartRecording(LOWORD(wParam) == ID_TRAY_RECORD_OUTPUTS);
+                    return 0;
+                    
+                case ID_TRAY_RECORD_STOP:
+                    StopRecording();
+                    return 0;
+                    
+                case ID_TRAY_NETWORK:
+                    if (g_networkSender.isSending()) {
+                        StopNetworkStream();
+                    } else {
+                        StartNetworkStream();
+                    }
+                    return 0;
+                    
+                case ID_TRAY_MUTE:
+                    SetMuted(!g_muted);
+                    return 0;
+                    
+                case ID_TRAY_REDETECT:
+                    // Picks up edits to the rules file. Applied live; the
+                    // driver keeps running
+                    LoadRoutingRules();
+                    g_asioHost.redetectRouting();
+                    return 0;
+                    
+                case ID_TRAY_EDIT_RULES:
+                    EditRoutingRules();
+                    return 0;
+                    
                 default:
-                    if (LOWORD(wParam) >= ID_TRAY_DRIVERS) {
+                    if (LOWORD(wParam) >= ID_TRAY_BRIDGES) {
+                        int driverIndex = LOWORD(wParam) - ID_TRAY_BRIDGES;
+                        auto drivers = ASIOHost::getDriverList();
+                        if (driverIndex < (int)drivers.size()) {
+                            StopBridge();
+                            g_bridgeDriver = drivers[driverIndex].name;
+                            if (!StartBridge()) {
+                                MessageBoxA(g_hwnd, ("Could not bridge to " + g_bridgeDriver).c_str(),
+                                            "ASIO Mini Host", MB_OK | MB_ICONERROR);
+                                g_bridgeDriver.clear();
+                            }
+                        }
+                    } else if (LOWORD(wParam) >= ID_TRAY_BUFFERS) {
+                        int choice = LOWORD(wParam) - ID_TRAY_BUFFERS;
+                        if (choice < (int)g_bufferChoices.size()) {
+                            SetAutoTune(false);
+                            g_bufferSize = g_bufferChoices[choice];
+                            ReconfigureAudio();
+                        }
+                    } else if (LOWORD(wParam) >= ID_TRAY_DRIVERS) {
+                        // Same cached list the menu was built from
                         int driverIndex = LOWORD(wParam) - ID_TRAY_DRIVERS;
                         auto drivers = ASIOHost::getDriverList();
                         if (driverIndex < (int)drivers.size()) {
                             StopAudio();
                             g_selectedDriver = drivers[driverIndex].name;
+                            g_bufferSize = 0;
+                            g_tuner.stop();
                             StartAudio();
                             UpdateTrayTooltip();
                         }
@@ -168,6 +361,15 @@ void UpdateTrayTooltip() {
         ss << "Running: " << g_asioHost.getDriverName() << "\n";
         ss << g_asioHost.getInputChannels() << " in / " << g_asioHost.getOutputChannels() << " out\n";
         ss << (int)g_asioHost.getSampleRate() << " Hz";
+        if (g_recorder.isRecording()) {
+            ss << "\nRecording";
+        }
+        if (g_networkSender.isSending()) {
+            ss << "\nStreaming";
+        }
+        if (g_muted) {
+            ss << "\nMuted";
+        }
     } else {
         ss << "Stopped";
     }
@@ -202,9 +404,48 @@ void ShowContextMenu(HWND hwnd) {
     }
     AppendMenuA(menu, MF_POPUP, (UINT_PTR)driverMenu, "Select Driver");
     
+    // Buffer size submenu; changes keep the driver loaded
+    HMENU bufferMenu = CreatePopupMenu();
+    g_bufferChoices = g_running ? GetBufferSizeChoices() : std::vector<int>();
+    for (size_t i = 0; i < g_bufferChoices.size(); i++) {
+        UINT flags = MF_STRING;
+        if (g_bufferChoices[i] == g_asioHost.getBufferSize()) {
+            flags |= MF_CHECKED;
+        }
+        std::string label = std::to_string(g_bufferChoices[i]) + " samples";
+        AppendMenuA(bufferMenu, flags, ID_TRAY_BUFFERS + i, label.c_str());
+    }
+    AppendMenuA(menu, MF_POPUP | (g_bufferChoices.empty() ? MF_GRAYED : 0), (UINT_PTR)bufferMenu, "Buffer Size");
+    AppendMenuA(menu, MF_STRING | (g_autoTune ? MF_CHECKED : 0), ID_TRAY_AUTOTUNE, "Auto-tune Buffer Size");
+    
+    // Bridge submenu: any driver but the running one
+    HMENU bridgeMenu = CreatePopupMenu();
+    AppendMenuA(bridgeMenu, MF_STRING | (g_bridgeDriver.empty() ? MF_CHECKED : 0), ID_TRAY_BRIDGE_OFF, "None");
+    for (size_t i = 0; i < drivers.size(); i++) {
+        if (drivers[i].name == g_asioHost.getDriverName()) continue;
+        UINT flags = MF_STRING | (drivers[i].name == g_bridgeDriver ? MF_CHECKED : 0);
+        AppendMenuA(bridgeMenu, flags, ID_TRAY_BRIDGES + i, drivers[i].name.c_str());
+    }
+    AppendMenuA(menu, MF_POPUP | (g_running ? 0 : MF_GRAYED), (UINT_PTR)bridgeMenu, "Bridge Outputs To");
+    
+    // Record submenu: all inputs or all outputs to a new file
+    HMENU recordMenu = CreatePopupMenu();
+    AppendMenuA(recordMenu, MF_STRING, ID_TRAY_RECORD_INPUTS, "All Inputs");
+    AppendMenuA(recordMenu, MF_STRING, ID_TRAY_RECORD_OUTPUTS, "All Outputs");
+    AppendMenuA(recordMenu, MF_STRING | (g_recorder.isRecording() ? 0 : MF_GRAYED), ID_TRAY_RECORD_STOP, "Stop Recording");
+    AppendMenuA(menu, MF_POPUP | (g_running ? 0 : MF_GRAYED) | (g_recorder.isRecording() ? MF_CHECKED : 0),
+                (UINT_PTR)recordMenu, "Record");
+    AppendMenuA(menu, MF_STRING | (g_running ? 0 : MF_GRAYED) | (g_networkSender.isSending() ? MF_CHECKED : 0),
+                ID_TRAY_NETWORK, "Stream Outputs to Network");
+    
     AppendMenuA(menu, MF_SEPARATOR, 0, nullptr);
     AppendMenuA(menu, MF_STRING, ID_TRAY_INFO, "Info...");
     AppendMenuA(menu, MF_STRING, ID_TRAY_ROUTING, "Show Routing...");
+    AppendMenuA(menu, MF_STRING | (g_muted ? MF_CHECKED : 0), ID_TRAY_MUTE, "Mute");
+    AppendMenuA(menu, MF_STRING | (g_running ? 0 : MF_GRAYED), ID_TRAY_REDETECT, "Re-detect Routing");
+    AppendMenuA(menu, MF_STRING, ID_TRAY_EDIT_RULES, "Edit Routing Rules...");
+    AppendMenuA(menu, MF_STRING | (g_running ? 0 : MF_GRAYED), ID_TRAY_TIMING, "Save Timing Report");
+    AppendMenuA(menu, MF_STRING | (g_asioHost.getMixThreads() > 1 ? MF_CHECKED : 0), ID_TRAY_PARALLEL, "Parallel Mixing");
     AppendMenuA(menu, MF_SEPARATOR, 0, nullptr);
     AppendMenuA(menu, MF_STRING, ID_TRAY_EXIT, "Exit");
     
@@ -227,7 +468,17 @@ bool StartAudio() {
         return false;
     }
     
-    if (!g_asioHost.createBuffers()) {
+    // A fresh driver starts with no controls
+    if (g_muted) {
+        SetMuted(true);
+    }
+    
+    // A restart while tuning keeps the search where it was
+    if (g_autoTune && (g_tuner.getState() == TunerIdle || g_asioHost.getDriverName() != g_tunedDriver)) {
+        g_bufferSize = BeginBufferTuning();
+    }
+    
+    if (!g_asioHost.createBuffers(g_bufferSize)) {
         g_asioHost.unloadDriver();
         return false;
     }
@@ -239,6 +490,13 @@ bool StartAudio() {
     }
     
     g_running = true;
+    if (!g_bridgeDriver.empty()) {
+        StartBridge();
+    }
+    if (g_autoTune) {
+        g_tuner.sizeApplied(g_asioHost.getBufferSize(), GetTickCount64() / 1000.0);
+        SetTimer(g_hwnd, ID_TUNER_TIMER, kTunerIntervalMs, nullptr);
+    }
     UpdateTrayTooltip();
     return true;
 }
@@ -248,13 +506,317 @@ void StopAudio() {
         return;
     }
     
+    KillTimer(g_hwnd, ID_TUNER_TIMER);
     g_asioHost.stop();
+    StopRecording();
+    StopNetworkStream();
+    StopBridge();
     g_asioHost.disposeBuffers();
     g_asioHost.unloadDriver();
     g_running = false;
     UpdateTrayTooltip();
 }
 
+// Mute or unmute every output. The host ramps the change, so it does not
+// click; before buffers exist it is kept for createBuffers.
+void SetMuted(bool muted) {
+    g_muted = muted;
+    for (int ch = 0; ch < g_asioHost.getOutputChannels(); ch++) {
+        g_asioHost.setOutputMute(ch, muted);
+    }
+    UpdateTrayTooltip();
+}
+
+// Apply a buffer size or mix thread change on the loaded driver, falling
+// back to a full restart if the driver refuses
+void ReconfigureAudio() {
+    if (!g_running) {
+        return;
+    }
+    if (!g_asioHost.reconfigure(g_bufferSize)) {
+        StopAudio();
+        StartAudio();
+    }
+    RefreshBridge();
+    UpdateTrayTooltip();
+}
+
+// Powers of two the driver accepts, plus its minimum, maximum and
+// preferred sizes
+std::vector<int> GetBufferSizeChoices() {
+    long minSize, maxSize, preferred, granularity;
+    std::vector<int> sizes;
+    if (!g_asioHost.getBufferSizeRange(&minSize, &maxSize, &preferred, &granularity)) {
+        return sizes;
+    }
+    sizes.push_back(minSize);
+    sizes.push_back(maxSize);
+    sizes.push_back(preferred);
+    for (long size = 16; size <= maxSize; size *= 2) {
+        if (size <= minSize) continue;
+        if (granularity > 0 && (size - minSize) % granularity != 0) continue;
+        sizes.push_back(size);
+    }
+    std::sort(sizes.begin(), sizes.end());
+    sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+    return sizes;
+}
+
+// Start searching for the loaded driver's buffer size, from the size
+// tuned for it last time or else from its smallest. Returns the size to
+// create buffers with.
+int BeginBufferTuning() {
+    long minSize, maxSize, preferred, granularity;
+    if (!g_asioHost.getBufferSizeRange(&minSize, &maxSize, &preferred, &granularity)) {
+        g_tuner.stop();
+        return g_bufferSize;
+    }
+    g_tunedDriver = g_asioHost.getDriverName();
+    g_savedTunedSize = (int)ReadSetting(kTunedSizesKey, g_tunedDriver.c_str(), 0);
+    
+    BufferTunerSettings settings;
+    settings.stepDownAfterSeconds = kTunerStepDownSeconds;
+    std::vector<int> sizes = BufferTuner::candidateSizes(minSize, maxSize, preferred, granularity);
+    int size = g_tuner.begin(sizes, g_savedTunedSize, settings, GetTickCount64() / 1000.0);
+    return size > 0 ? size : g_bufferSize;
+}
+
+// Timer tick while auto-tuning: move to the size the tuner asks for and
+// remember sizes it settles on
+void TuneBufferSize() {
+    if (!g_running || !g_autoTune) {
+        return;
+    }
+    double now = GetTickCount64() / 1000.0;
+    int size = g_tuner.update(g_asioHost.getTimingReport(), g_asioHost.getClockReport(), now);
+    if (size > 0 && size != g_asioHost.getBufferSize()) {
+        g_bufferSize = size;
+        ReconfigureAudio();
+        g_tuner.sizeApplied(g_asioHost.getBufferSize(), now);
+    }
+    int stable = g_tuner.getStableSize();
+    if (stable > 0 && stable != g_savedTunedSize) {
+        WriteSetting(kTunedSizesKey, g_tunedDriver.c_str(), (DWORD)stable);
+        g_savedTunedSize = stable;
+    }
+}
+
+void SetAutoTune(bool enabled) {
+    if (enabled == g_autoTune) {
+        return;
+    }
+    g_autoTune = enabled;
+    WriteSetting(kSettingsKey, "AutoTune", enabled ? 1 : 0);
+    if (!enabled) {
+        // Stay at whatever size tuning reached
+        KillTimer(g_hwnd, ID_TUNER_TIMER);
+        g_tuner.stop();
+        return;
+    }
+    if (g_running) {
+        g_bufferSize = BeginBufferTuning();
+        ReconfigureAudio();
+        g_tuner.sizeApplied(g_asioHost.getBufferSize(), GetTickCount64() / 1000.0);
+        SetTimer(g_hwnd, ID_TUNER_TIMER, kTunerIntervalMs, nullptr);
+    }
+}
+
+DWORD ReadSetting(const char* key, const char* name, DWORD fallback) {
+    HKEY hkey;
+    if (RegOpenKeyExA(HKEY_CURRENT_USER, key, 0, KEY_READ, &hkey) != ERROR_SUCCESS) {
+        return fallback;
+    }
+    DWORD value = 0;
+    DWORD type = 0;
+    DWORD size = sizeof(value);
+    LONG result = RegQueryValueExA(hkey, name, nullptr, &type, (LPBYTE)&value, &size);
+    RegCloseKey(hkey);
+    return (result == ERROR_SUCCESS && type == REG_DWORD) ? value : fallback;
+}
+
+void WriteSetting(const char* key, const char* name, DWORD value) {
+    HKEY hkey;
+    if (RegCreateKeyExA(HKEY_CURRENT_USER, key, 0, nullptr, 0, KEY_SET_VALUE, nullptr, &hkey, nullptr) != ERROR_SUCCESS) {
+        return;
+    }
+    RegSetValueExA(hkey, name, 0, REG_DWORD, (const BYTE*)&value, sizeof(value));
+    RegCloseKey(hkey);
+}
+
+// Play the main host's outputs on a second driver too, through the
+// drift-compensated bridge. The main stream pauses while the taps go in.
+bool StartBridge() {
+    if (!g_running || g_bridgeRunning || g_bridgeDriver.empty() || g_bridgeDriver == g_asioHost.getDriverName()) {
+        return g_bridgeRunning;
+    }
+    if (!g_bridgeHost.loadDriver(g_bridgeDriver)) {
+        return false;
+    }
+    if (!g_bridgeHost.initialize(g_hwnd) || !g_bridgeHost.createBuffers(0)) {
+        g_bridgeHost.unloadDriver();
+        return false;
+    }
+    
+    // Output channels pair up in order
+    BridgeConfig config;
+    config.fromOutputs = true;
+    int channels = std::min(g_asioHost.getOutputChannels(), g_bridgeHost.getOutputChannels());
+    for (int ch = 0; ch < channels; ch++) {
+        config.sourceChannels.push_back(ch);
+        config.targetChannels.push_back(ch);
+    }
+    
+    g_asioHost.stop();
+    bool ok = g_asioHost.addTap(g_bridge.getSourceTap()) && g_bridgeHost.addTap(g_bridge.getTargetTap()) &&
+              g_bridge.configure(g_asioHost.getStreamFormat(), g_bridgeHost.getStreamFormat(), config) &&
+              g_bridgeHost.start();
+    if (!ok) {
+        g_asioHost.removeTap(g_bridge.getSourceTap());
+        g_bridgeHost.removeTap(g_bridge.getTargetTap());
+        g_bridgeHost.disposeBuffers();
+        g_bridgeHost.unloadDriver();
+    }
+    g_asioHost.start();
+    g_bridgeRunning = ok;
+    return ok;
+}
+
+void StopBridge() {
+    if (!g_bridgeRunning) {
+        return;
+    }
+    g_bridgeHost.stop();
+    g_bridgeHost.removeTap(g_bridge.getTargetTap());
+    g_bridgeHost.disposeBuffers();
+    g_bridgeHost.unloadDriver();
+    bool wasRunning = g_asioHost.stop();
+    g_asioHost.removeTap(g_bridge.getSourceTap());
+    if (wasRunning) {
+        g_asioHost.start();
+    }
+    g_bridgeRunning = false;
+}
+
+// Either side recreating its buffers in another format leaves the bridge
+// idle; set it up again for the new formats
+void RefreshBridge() {
+    if (g_bridgeRunning && !g_bridge.isActive()) {
+        StopBridge();
+        StartBridge();
+    }
+}
+
+// Record every input or output of the main stream to a new WAV file in
+// the user's Music folder
+void StartRecording(bool outputs) {
+    if (!g_running || g_recorder.isRecording()) {
+        return;
+    }
+    char folder[MAX_PATH];
+    if (SHGetFolderPathA(nullptr, CSIDL_MYMUSIC, nullptr, SHGFP_TYPE_CURRENT, folder) != S_OK) {
+        DWORD len = GetTempPathA(MAX_PATH, folder);
+        if (len == 0) strcpy_s(folder, ".");
+    }
+    SYSTEMTIME now;
+    GetLocalTime(&now);
+    char name[64];
+    snprintf(name, sizeof(name), "\\ASIOMiniHost %04d-%02d-%02d %02d%02d%02d.wav",
+             now.wYear, now.wMonth, now.wDay, now.wHour, now.wMinute, now.wSecond);
+    
+    RecorderConfig config;
+    config.path = std::string(folder) + name;
+    config.fromOutputs = outputs;
+    int channels = outputs ? g_asioHost.getOutputChannels() : g_asioHost.getInputChannels();
+    for (int ch = 0; ch < channels; ch++) {
+        config.channels.push_back(ch);
+    }
+    if (!g_recorder.start(config)) {
+        MessageBoxA(g_hwnd, ("Could not record to " + config.path).c_str(), "ASIO Mini Host", MB_OK | MB_ICONERROR);
+    }
+    UpdateTrayTooltip();
+}
+
+void StopRecording() {
+    if (!g_recorder.isRecording()) {
+        return;
+    }
+    if (!g_recorder.stop()) {
+        std::string text = "The recording is incomplete.\n\n" + DiskRecorder::formatText(g_recorder.getReport());
+        MessageBoxA(g_hwnd, text.c_str(), "ASIO Mini Host", MB_OK | MB_ICONWARNING);
+    }
+    UpdateTrayTooltip();
+}
+
+// Send the first outputs of the main stream as one L24 RTP stream to the
+// AES67 multicast group
+void StartNetworkStream() {
+    if (!g_running || g_networkSender.isSending()) {
+        return;
+    }
+    RtpSendConfig config;
+    config.address = kNetworkAddress;
+    config.port = kNetworkPort;
+    // 1 ms packets, shorter above 48 kHz so eight channels still fit one datagram
+    config.packetMs = std::min(1.0, 48000.0 / g_asioHost.getSampleRate());
+    int channels = std::min(g_asioHost.getOutputChannels(), kNetworkMaxChannels);
+    for (int ch = 0; ch < channels; ch++) {
+        config.channels.push_back(ch);
+    }
+    if (!g_networkSender.start(config)) {
+        std::string text = "Could not stream to the network.\n\n" + RtpSender::formatText(g_networkSender.getReport());
+        MessageBoxA(g_hwnd, text.c_str(), "ASIO Mini Host", MB_OK | MB_ICONERROR);
+    }
+    UpdateTrayTooltip();
+}
+
+void StopNetworkStream() {
+    if (!g_networkSender.isSending()) {
+        return;
+    }
+    g_networkSender.stop();
+    UpdateTrayTooltip();
+}
+
+// Routing rules are a text file in the user's application data folder;
+// without one the built-in rules apply
+std::string GetRoutingRulesPath() {
+    char folder[MAX_PATH];
+    if (SHGetFolderPathA(nullptr, CSIDL_APPDATA, nullptr, SHGFP_TYPE_CURRENT, folder) != S_OK) {
+        return "";
+    }
+    std::string dir = std::string(folder) + "\\ASIOMiniHost";
+    CreateDirectoryA(dir.c_str(), nullptr);
+    return dir + "\\routing_rules.txt";
+}
+
+void LoadRoutingRules() {
+    std::string path = GetRoutingRulesPath();
+    RoutingRules rules;
+    std::string error;
+    if (!path.empty() && GetFileAttributesA(path.c_str()) != INVALID_FILE_ATTRIBUTES &&
+        !rules.load(path, &error)) {
+        MessageBoxA(g_hwnd, ("Routing rules not loaded, using the built-in ones.\n\n" + path + ", " + error).c_str(),
+                    "ASIO Mini Host", MB_OK | MB_ICONWARNING);
+        rules = RoutingRules::builtIn();
+    }
+    g_asioHost.setRoutingRules(rules);
+}
+
+// Open the rules file, writing out the built-in rules first if there is
+// none; "Re-detect Routing" applies the edits
+void EditRoutingRules() {
+    std::string path = GetRoutingRulesPath();
+    if (path.empty()) {
+        return;
+    }
+    if (GetFileAttributesA(path.c_str()) == INVALID_FILE_ATTRIBUTES &&
+        !RoutingRules::builtIn().save(path)) {
+        MessageBoxA(g_hwnd, ("Could not write " + path).c_str(), "ASIO Mini Host", MB_OK | MB_ICONERROR);
+        return;
+    }
+    ShellExecuteA(g_hwnd, "open", path.c_str(), nullptr, nullptr, SW_SHOWNORMAL);
+}
+
 void ShowInfo() {
     std::stringstream ss;
     ss << "ASIO Mini Host v1.1\n";
@@ -272,12 +834,39 @@ void ShowInfo() {
         
         double latencyMs = (g_asioHost.getBufferSize() * 1000.0) / g_asioHost.getSampleRate();
         ss << "Buffer Latency: " << latencyMs << " ms\n";
+        ss << "Stream Memory: " << (g_asioHost.getStreamMemoryBytes() + 1023) / 1024 << " KB"
+           << (g_asioHost.isStreamMemoryLocked() ? " (locked)" : " (not locked)") << "\n";
+        
+        ss << "\nCallback Timing:\n";
+        ss << CallbackStats::formatText(g_asioHost.getTimingReport());
+        ss << "\nDriver Clock:\n";
+        ss << ClockMonitor::formatText(g_asioHost.getClockReport());
+        ss << "\nDriver Requests:\n";
+        ss << DriverRequests::formatText(g_asioHost.getRequestReport());
+        if (g_autoTune) {
+            ss << "\n" << g_tuner.formatText();
+        }
+        if (g_bridgeRunning) {
+            ss << "\nBridge to " << g_bridgeHost.getDriverName() << ":\n";
+            ss << AudioBridge::formatText(g_bridge.getReport());
+        }
+        RecorderReport recording = g_recorder.getReport();
+        if (!recording.path.empty()) {
+            ss << "\n" << DiskRecorder::formatText(recording);
+        }
+        RtpSendReport network = g_networkSender.getReport();
+        if (!network.destination.empty()) {
+            ss << "\nNetwork Stream:\n" << RtpSender::formatText(network);
+        }
+        ss << "\nStartup Phases:\n";
+        ss << ASIOHost::formatPhaseTimes(g_asioHost.getPhaseTimes());
     } else {
         ss << "Status: STOPPED\n";
     }
     
+    // Re-read the registry here, so newly installed drivers show up in the menu
     ss << "\nAvailable Drivers:\n";
-    auto drivers = ASIOHost::getDriverList();
+    auto drivers = ASIOHost::getDriverList(true);
     for (const auto& drv : drivers) {
         ss << "  - " << drv.name;
         if (g_running && drv.name == g_asioHost.getDriverName()) {
@@ -307,3 +896,25 @@ void ShowRouting() {
     
     MessageBoxA(g_hwnd, ss.str().c_str(), "Routing Info", MB_OK | MB_ICONINFORMATION);
 }
+
+void SaveTimingReport() {
+    if (!g_running) {
+        return;
+    }
+    
+    // One JSON object per line, appended, so repeated saves form a log
+    char tempDir[MAX_PATH];
+    DWORD len = GetTempPathA(MAX_PATH, tempDir);
+    std::string path = std::string(len > 0 ? tempDir : ".\\") + "ASIOMiniHost_timing.jsonl";
+    
+    std::ofstream file(path, std::ios::app);
+    if (!file) {
+        MessageBoxA(g_hwnd, ("Could not write " + path).c_str(), "Timing Report", MB_OK | MB_ICONERROR);
+        return;
+    }
+    file << "{\"timing\":" << CallbackStats::formatJson(g_asioHost.getTimingReport())
+         << ",\"clock\":" << ClockMonitor::formatJson(g_asioHost.getClockReport())
+         << ",\"requests\":" << DriverRequests::formatJson(g_asioHost.getRequestReport()) << "}\n";
+    
+    MessageBoxA(g_hwnd, ("Timing report appended to\n" + path).c_str(), "Timing Report", MB_OK | MB_ICONINFORMATION);
+}
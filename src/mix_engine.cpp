@@ -0,0 +1,783 @@
+#include "mix_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+// Float buses an input must feed before it is staged. With two or more,
+// one conversion plus float reads beats converting per bus (mix_bench).
+static const int kStageMinFanOut = 2;
+
+// Cost model for splitting buses across threads, per sample and relative
+// to one float multiply-accumulate. Rough ratios from mix_bench; only the
+// balance between groups and the parallel threshold depend on them.
+static const double kCostCopy = 0.25;           // memcpy of the block
+static const double kCostIntegerInput = 0.5;    // Per input of a wide integer sum
+static const double kCostFloatInput = 1.0;      // Float or staged input into the bus
+static const double kCostConvertInput = 2.0;    // Integer input converted on the fly
+static const double kCostFromFloat = 1.5;       // Clamp and convert the bus
+static const double kCostBus = 64.0;            // Per bus per block, whatever its size
+
+// About 40-50 us of serial mixing on a current desktop core. Below that a
+// futex wake-up of the workers costs about as much as it saves
+// (mix_bench's crossover table measures this per machine).
+const double MixEngine::kParallelMinCost = 256.0 * 1024.0;
+
+MixEngine::~MixEngine() {
+    clear();
+}
+
+void MixEngine::setWorkers(int count, double minBlockCost) {
+    minParallelCost = minBlockCost;
+    if (count != workers.getWorkerCount()) {
+        workers.start(count);
+    }
+}
+
+size_t MixEngine::arenaBytes(int numInputs, int numOutputs, int size) const {
+    size_t groups = workers.getWorkerCount() + 1;
+    return StreamArena::bytesFor<int>(numInputs) +
+           StreamArena::bytesFor<uint8_t>(numInputs) +
+           StreamArena::bytesFor<MeterFn>(numInputs) +
+           StreamArena::bytesFor<BlockLevel>(numInputs) +
+           StreamArena::bytesFor<BlockLevel>(numOutputs) +
+           StreamArena::bytesFor<uint8_t>(numOutputs) * 2 +
+           StreamArena::bytesFor<float>((size_t)numInputs * size) +
+           StreamArena::bytesFor<float>(groups * size) +
+           StreamArena::bytesFor<const void*>(groups * numInputs) +
+           StreamArena::bytesFor<std::atomic<float>>((size_t)numInputs * numOutputs) +
+           StreamArena::bytesFor<uint8_t>(numOutputs) +
+           StreamArena::bytesFor<float>(groups * size);
+}
+
+void MixEngine::configure(const std::vector<ASIOSampleType>& inputFormats,
+                          const std::vector<ASIOSampleType>& outputFormats,
+                          const std::vector<ChannelRoute>& routes,
+                          int size,
+                          StreamArena* arena) {
+    clear();
+    planRoutes = routes;
+    int numInputs = (int)inputFormats.size();
+    int numOutputs = (int)outputFormats.size();
+    if (!arena) {
+        if (!ownArena.allocate(arenaBytes(numInputs, numOutputs, size))) {
+            return;
+        }
+        arena = &ownArena;
+    }
+
+    // Per-block state, one cache-aligned piece each
+    maxGroups = workers.getWorkerCount() + 1;
+    inputBytes = arena->take<int>(numInputs);
+    inputSilent = arena->take<uint8_t>(numInputs);
+    inputMeter = arena->take<MeterFn>(numInputs);
+    inputLevels = arena->take<BlockLevel>(numInputs);
+    outputLevels = arena->take<BlockLevel>(numOutputs);
+    outputDirty[0] = arena->take<uint8_t>(numOutputs);
+    outputDirty[1] = arena->take<uint8_t>(numOutputs);
+    stageBuffer = arena->take<float>((size_t)numInputs * size);
+    mixBuffer = arena->take<float>((size_t)maxGroups * size);
+    gatherBuffer = arena->take<const void*>((size_t)maxGroups * numInputs);
+    cellGain = arena->take<std::atomic<float>>((size_t)numInputs * numOutputs);
+    busRamping = arena->take<uint8_t>(numOutputs);
+    rampBuffer = arena->take<float>((size_t)maxGroups * size);
+    if (!inputBytes || !inputSilent || !inputMeter || !inputLevels || !outputLevels || !outputDirty[0] || !outputDirty[1] ||
+        !stageBuffer || !mixBuffer || !gatherBuffer || !cellGain || !busRamping || !rampBuffer) {
+        clear();
+        return;
+    }
+
+    inputTypes = inputFormats;
+    outputTypes = outputFormats;
+    bufferSize = size;
+
+    // Silence detection state; every output starts out unknown (dirty)
+    isSilent = getSilenceCheck();
+    for (int ch = 0; ch < numInputs; ch++) {
+        inputBytes[ch] = getSampleBytes(inputTypes[ch]) * bufferSize;
+        inputMeter[ch] = getBlockConverter(inputTypes[ch], bufferSize).meter;
+    }
+    memset(outputDirty[0], 1, numOutputs);
+    memset(outputDirty[1], 1, numOutputs);
+
+    // The arena hands out zeroed memory; the cell gains still need
+    // constructing. The first plan starts at its gains, with no ramp.
+    for (size_t cell = 0; cell < (size_t)numInputs * numOutputs; cell++) {
+        new (&cellGain[cell]) std::atomic<float>(0.0f);
+    }
+    rampMixers[RampLinear] = getRampMixer(RampLinear);
+    rampMixers[RampEqualPower] = getRampMixer(RampEqualPower);
+    accumulateFloat = getSampleConverter(ASIOSTFloat32LSB).accumulateScaled;  // Partial blocks: generic
+
+    MixPlan* plan = buildPlan();
+    for (const auto& input : plan->busInputs) {
+        cellGain[input.cell].store(input.gain, std::memory_order_relaxed);
+    }
+    rampSerial = plan->serial;
+    currentPlan.store(plan, std::memory_order_release);
+}
+
+bool MixEngine::setRoutes(const std::vector<ChannelRoute>& routes) {
+    planRoutes = routes;
+    return publishPlan();
+}
+
+bool MixEngine::setControls(const MixControls& newControls) {
+    controls = newControls;
+    return publishPlan();
+}
+
+void MixEngine::setRamp(int frames, RampShape shape) {
+    rampFrames = std::max(frames, 0);
+    rampShape = shape;
+}
+
+bool MixEngine::publishPlan() {
+    if (bufferSize == 0) {
+        return false;
+    }
+
+    // Everything that allocates happens here, before the swap
+    MixPlan* plan = buildPlan();
+    MixPlan* old = currentPlan.exchange(plan, std::memory_order_seq_cst);
+    if (old) {
+        retired.push_back(old);
+    }
+    reclaim();
+    return true;
+}
+
+void MixEngine::reclaim() {
+    // After the swap process() can only pick up the new plan, so a retired
+    // plan is free once the reader's hazard pointer no longer names it
+    MixPlan* inUse = readerPlan.load(std::memory_order_seq_cst);
+    size_t kept = 0;
+    for (MixPlan* plan : retired) {
+        if (plan == inUse) {
+            retired[kept++] = plan;
+        } else {
+            delete plan;
+        }
+    }
+    retired.resize(kept);
+}
+
+float MixEngine::targetGain(const ChannelRoute& route, const std::vector<uint8_t>& routeFlags,
+                            bool anyOutputSoloed, bool anyRouteSoloed) const {
+    float gain = route.gain;
+    if (route.outputChannel < (int)controls.outputs.size()) {
+        const OutputControl& output = controls.outputs[route.outputChannel];
+        if (output.muted || (anyOutputSoloed && !output.soloed)) {
+            return 0.0f;
+        }
+        gain *= output.gain;
+    } else if (anyOutputSoloed) {
+        return 0.0f;
+    }
+    uint8_t flags = routeFlags[(size_t)route.outputChannel * inputTypes.size() + route.inputChannel];
+    if ((flags & 1) || (anyRouteSoloed && !(flags & 2))) {
+        return 0.0f;
+    }
+    return gain;
+}
+
+MixEngine::MixPlan* MixEngine::buildPlan() {
+    MixPlan* plan = new MixPlan();
+    plan->serial = ++planSerial;
+    plan->rampStep = rampFrames > 0 ? 1.0f / rampFrames : 0.0f;
+    plan->rampShape = rampShape;
+
+    int numInputs = (int)inputTypes.size();
+    int numOutputs = (int)outputTypes.size();
+    size_t numCells = (size_t)numInputs * numOutputs;
+
+    // Mute and solo flags per cell (1 = muted, 2 = soloed)
+    std::vector<uint8_t> routeFlags(numCells, 0);
+    bool anyOutputSoloed = false;
+    bool anyRouteSoloed = false;
+    for (const auto& output : controls.outputs) {
+        anyOutputSoloed |= output.soloed;
+    }
+    for (const auto& route : controls.routes) {
+        if (route.inputChannel < 0 || route.inputChannel >= numInputs) continue;
+        if (route.outputChannel < 0 || route.outputChannel >= numOutputs) continue;
+        routeFlags[(size_t)route.outputChannel * numInputs + route.inputChannel] =
+            (route.muted ? 1 : 0) | (route.soloed ? 2 : 0);
+        anyRouteSoloed |= route.soloed;
+    }
+
+    // Routes at their target gains, one per cell; a cell given twice sums
+    std::vector<ChannelRoute> sorted;
+    std::vector<int> routeOf(numCells, -1);
+    for (const auto& route : planRoutes) {
+        if (route.inputChannel < 0 || route.inputChannel >= numInputs) continue;
+        if (route.outputChannel < 0 || route.outputChannel >= numOutputs) continue;
+        float gain = targetGain(route, routeFlags, anyOutputSoloed, anyRouteSoloed);
+        if (gain == 0.0f) continue;
+        size_t cell = (size_t)route.outputChannel * numInputs + route.inputChannel;
+        if (routeOf[cell] >= 0) {
+            sorted[routeOf[cell]].gain += gain;
+            continue;
+        }
+        routeOf[cell] = (int)sorted.size();
+        ChannelRoute live = route;
+        live.gain = gain;
+        sorted.push_back(live);
+    }
+
+    // With ramps on, cells that may still be sounding and that the plan
+    // drops fade out as inputs with a target of 0. The gains are the driver
+    // thread's, read without stopping it, so a cell at 0 counts as sounding
+    // too if a plan the driver thread may still mix (the current one, or a
+    // retired one it has not let go of) aims it higher: that plan can raise
+    // its gain after it is read here.
+    if (rampFrames > 0) {
+        std::vector<bool> sounding(numCells, false);
+        auto aimedAbove = [&sounding](const MixPlan* live) {
+            for (const auto& input : live->busInputs) {
+                if (input.gain != 0.0f) sounding[input.cell] = true;
+            }
+        };
+        if (MixPlan* latest = currentPlan.load(std::memory_order_relaxed)) {
+            aimedAbove(latest);
+        }
+        for (const MixPlan* old : retired) {
+            aimedAbove(old);
+        }
+        for (size_t cell = 0; cell < numCells; cell++) {
+            if (routeOf[cell] < 0 && (sounding[cell] || cellGain[cell].load(std::memory_order_relaxed) != 0.0f)) {
+                ChannelRoute fading;
+                fading.inputChannel = (int)(cell % numInputs);
+                fading.outputChannel = (int)(cell / numInputs);
+                fading.gain = 0.0f;
+                sorted.push_back(fading);
+            }
+        }
+    }
+
+    // Group by output, keeping route order within each output and the
+    // fading inputs after the live ones
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const ChannelRoute& a, const ChannelRoute& b) {
+                         if (a.outputChannel != b.outputChannel) {
+                             return a.outputChannel < b.outputChannel;
+                         }
+                         return a.gain != 0.0f && b.gain == 0.0f;
+                     });
+
+    std::vector<bool> routed(numOutputs, false);
+    for (size_t i = 0; i < sorted.size(); i++) {
+        int outCh = sorted[i].outputChannel;
+        if (!routed[outCh]) {
+            routed[outCh] = true;
+
+            OutputBus bus;
+            bus.outputChannel = outCh;
+            bus.firstInput = (int)plan->busInputs.size();
+            bus.numInputs = 0;
+            bus.numLive = 0;
+            bus.path = MixPathFloat;
+            bus.bytes = getSampleBytes(outputTypes[outCh]) * bufferSize;
+            BlockConverter outConv = getBlockConverter(outputTypes[outCh], bufferSize);
+            bus.fromFloat = outConv.fromFloatMetered;
+            bus.meter = outConv.meter;
+            bus.integerMix = nullptr;
+            plan->buses.push_back(bus);
+        }
+
+        BlockConverter conv = getBlockConverter(inputTypes[sorted[i].inputChannel], bufferSize);
+        BusInput input;
+        input.inputChannel = sorted[i].inputChannel;
+        input.stage = -1;
+        input.cell = outCh * numInputs + sorted[i].inputChannel;
+        input.silenceChecked = false;
+        input.gain = sorted[i].gain;
+        input.toFloat = conv.toFloat;
+        input.accumulate = conv.accumulate;
+        input.toFloatScaled = conv.toFloatScaled;
+        input.accumulateScaled = conv.accumulateScaled;
+        plan->busInputs.push_back(input);
+        plan->buses.back().numInputs++;
+        if (input.gain != 0.0f) {
+            plan->buses.back().numLive++;
+        }
+    }
+
+    // Pick the cheapest path each bus can take once its fades are done. A
+    // bus with only fading inputs is silent then, and stays a float bus.
+    for (auto& bus : plan->buses) {
+        ASIOSampleType outType = outputTypes[bus.outputChannel];
+        bool sameFormat = bus.numLive > 0;
+        for (int i = 0; i < bus.numLive; i++) {
+            const BusInput& input = plan->busInputs[bus.firstInput + i];
+            if (inputTypes[input.inputChannel] != outType || input.gain != 1.0f) {
+                sameFormat = false;
+            }
+        }
+
+        if (sameFormat && bus.numLive == 1) {
+            bus.path = MixPathCopy;
+        } else if (sameFormat && (bus.integerMix = getBlockConverter(outType, bufferSize).integerMix) != nullptr) {
+            bus.path = MixPathInteger;
+        }
+    }
+
+    // Stage inputs that feed enough float buses. Float32LSB inputs are
+    // already float and are read in place. Fading inputs read the staged
+    // copy when there is one, but do not count towards staging.
+    std::vector<int> fanOut(numInputs, 0);
+    for (const auto& bus : plan->buses) {
+        if (bus.path != MixPathFloat) continue;
+        for (int i = 0; i < bus.numLive; i++) {
+            fanOut[plan->busInputs[bus.firstInput + i].inputChannel]++;
+        }
+    }
+    std::vector<int> stageOf(numInputs, -1);
+    for (int ch = 0; ch < numInputs; ch++) {
+        if (fanOut[ch] >= kStageMinFanOut && inputTypes[ch] != ASIOSTFloat32LSB) {
+            stageOf[ch] = (int)plan->stagedInputs.size();
+            StagedInput staged;
+            staged.inputChannel = ch;
+            staged.toFloat = getBlockConverter(inputTypes[ch], bufferSize).toFloatMetered;
+            plan->stagedInputs.push_back(staged);
+        }
+    }
+    if (!plan->stagedInputs.empty()) {
+        BlockConverter floatConv = getBlockConverter(ASIOSTFloat32LSB, bufferSize);
+        for (const auto& bus : plan->buses) {
+            for (int i = 0; i < bus.numInputs; i++) {
+                BusInput& input = plan->busInputs[bus.firstInput + i];
+                if (stageOf[input.inputChannel] < 0) continue;
+                if (bus.path != MixPathFloat && i < bus.numLive) continue;
+                input.stage = stageOf[input.inputChannel];
+                input.toFloat = floatConv.toFloat;
+                input.accumulate = floatConv.accumulate;
+                input.toFloatScaled = floatConv.toFloatScaled;
+                input.accumulateScaled = floatConv.accumulateScaled;
+            }
+        }
+    }
+
+    // Silence is checked on the inputs of live routes only
+    std::vector<bool> used(numInputs, false);
+    for (const auto& bus : plan->buses) {
+        for (int i = 0; i < bus.numLive; i++) {
+            int ch = plan->busInputs[bus.firstInput + i].inputChannel;
+            if (!used[ch]) {
+                used[ch] = true;
+                if (stageOf[ch] < 0) {
+                    plan->meteredInputs.push_back(ch);
+                }
+            }
+        }
+    }
+    for (auto& input : plan->busInputs) {
+        input.silenceChecked = used[input.inputChannel];
+    }
+    for (int ch = 0; ch < numInputs; ch++) {
+        if (!used[ch]) {
+            plan->unusedInputs.push_back(ch);
+        }
+    }
+
+    // Cells left out of the plan, whose stale gains startRamps() clears
+    std::vector<bool> usedCell(numCells, false);
+    for (const auto& input : plan->busInputs) {
+        usedCell[input.cell] = true;
+    }
+    for (size_t cell = 0; cell < numCells; cell++) {
+        if (!usedCell[cell]) {
+            plan->unusedCells.push_back((int)cell);
+        }
+    }
+
+    for (int ch = 0; ch < numOutputs; ch++) {
+        if (!routed[ch]) {
+            SilentOutput silent;
+            silent.outputChannel = ch;
+            silent.bytes = getSampleBytes(outputTypes[ch]) * bufferSize;
+            plan->silentOutputs.push_back(silent);
+        }
+    }
+
+    partition(*plan);
+    return plan;
+}
+
+double MixEngine::busCost(const MixPlan& plan, const OutputBus& bus) const {
+    double perSample = 0.0;
+    switch (bus.path) {
+        case MixPathCopy:
+            perSample = kCostCopy;
+            break;
+        case MixPathInteger:
+            perSample = kCostIntegerInput * bus.numLive;
+            break;
+        default:
+            for (int i = 0; i < bus.numLive; i++) {
+                const BusInput& input = plan.busInputs[bus.firstInput + i];
+                bool isFloat = input.stage >= 0 || inputTypes[input.inputChannel] == ASIOSTFloat32LSB;
+                perSample += isFloat ? kCostFloatInput : kCostConvertInput;
+            }
+            perSample += kCostFromFloat;
+            break;
+    }
+    return kCostBus + perSample * bufferSize;
+}
+
+void MixEngine::partition(MixPlan& plan) const {
+    int numBuses = (int)plan.buses.size();
+    std::vector<double> costs(numBuses);
+    plan.cost = plan.stagedInputs.size() * kCostConvertInput * bufferSize;
+    double busTotal = 0.0;
+    for (int b = 0; b < numBuses; b++) {
+        costs[b] = busCost(plan, plan.buses[b]);
+        busTotal += costs[b];
+    }
+    plan.cost += busTotal;
+
+    int groups = std::min(maxGroups, numBuses);
+    if (plan.cost < minParallelCost) {
+        groups = 1;
+    }
+
+    // Contiguous runs of buses. A group ends before the bus whose midpoint
+    // crosses the next equal share of the total.
+    plan.partitionStart.assign(1, 0);
+    double target = busTotal / std::max(groups, 1);
+    double done = 0.0;
+    for (int b = 0; b < numBuses; b++) {
+        int made = (int)plan.partitionStart.size();
+        if (made < groups && b > plan.partitionStart.back() &&
+            done + costs[b] * 0.5 > target * made) {
+            plan.partitionStart.push_back(b);
+        }
+        done += costs[b];
+    }
+    plan.partitionStart.push_back(numBuses);
+}
+
+void MixEngine::clear() {
+    delete currentPlan.exchange(nullptr);
+    readerPlan.store(nullptr);
+    for (MixPlan* plan : retired) {
+        delete plan;
+    }
+    retired.clear();
+
+    inputTypes.clear();
+    outputTypes.clear();
+    bufferSize = 0;
+    isSilent = nullptr;
+    inputBytes = nullptr;
+    inputSilent = nullptr;
+    inputMeter = nullptr;
+    inputLevels = nullptr;
+    outputLevels = nullptr;
+    outputDirty[0] = nullptr;
+    outputDirty[1] = nullptr;
+    stageBuffer = nullptr;
+    mixBuffer = nullptr;
+    gatherBuffer = nullptr;
+    cellGain = nullptr;
+    busRamping = nullptr;
+    rampBuffer = nullptr;
+    planRoutes.clear();
+    ownArena.release();
+}
+
+void MixEngine::invalidateOutputs() {
+    invalidateRequested.store(true, std::memory_order_release);
+}
+
+void MixEngine::process(int bufferIndex, void* const* inputs, void* const* outputs) {
+    // Pin the current plan: publish it as in use, then confirm it is still
+    // current so the control thread cannot have retired it in between
+    MixPlan* plan = currentPlan.load(std::memory_order_seq_cst);
+    for (;;) {
+        readerPlan.store(plan, std::memory_order_seq_cst);
+        MixPlan* again = currentPlan.load(std::memory_order_seq_cst);
+        if (again == plan) break;
+        plan = again;
+    }
+    if (!plan) {
+        readerPlan.store(nullptr, std::memory_order_release);
+        return;
+    }
+
+    if (plan->serial != rampSerial) {
+        startRamps(*plan);
+    }
+
+    if (invalidateRequested.load(std::memory_order_relaxed) &&
+        invalidateRequested.exchange(false, std::memory_order_acquire)) {
+        memset(outputDirty[0], 1, outputTypes.size());
+        memset(outputDirty[1], 1, outputTypes.size());
+    }
+
+    // Check each used input once, however many outputs it feeds. Unstaged
+    // inputs are measured while the check has just brought them into cache.
+    for (int ch : plan->meteredInputs) {
+        inputSilent[ch] = isSilent(inputs[ch], inputBytes[ch]);
+        if (!inputSilent[ch]) {
+            inputMeter[ch](inputs[ch], bufferSize, &inputLevels[ch]);
+        } else {
+            inputLevels[ch] = BlockLevel();
+        }
+    }
+
+    // Convert shared inputs once, measuring them on the way
+    float* stage = stageBuffer;
+    for (size_t k = 0; k < plan->stagedInputs.size(); k++) {
+        int ch = plan->stagedInputs[k].inputChannel;
+        inputSilent[ch] = isSilent(inputs[ch], inputBytes[ch]);
+        if (!inputSilent[ch]) {
+            plan->stagedInputs[k].toFloat(inputs[ch], stage + k * bufferSize, bufferSize, &inputLevels[ch]);
+        } else {
+            inputLevels[ch] = BlockLevel();
+        }
+    }
+
+    // Unrouted inputs are read only to measure them, so their meters still
+    // show whether anything arrives on them
+    for (int ch : plan->unusedInputs) {
+        inputMeter[ch](inputs[ch], bufferSize, &inputLevels[ch]);
+    }
+
+    uint8_t* dirty = outputDirty[bufferIndex & 1];
+
+    for (const auto& silent : plan->silentOutputs) {
+        outputLevels[silent.outputChannel] = BlockLevel();
+        if (dirty[silent.outputChannel]) {
+            memset(outputs[silent.outputChannel], 0, silent.bytes);
+            dirty[silent.outputChannel] = 0;
+        }
+    }
+
+    // Mix the buses, in parallel if the plan was split into groups
+    BlockJob job = { this, plan, inputs, outputs, dirty };
+    workers.run(&MixEngine::mixGroupJob, &job, (int)plan->partitionStart.size() - 1);
+
+    readerPlan.store(nullptr, std::memory_order_release);
+}
+
+void MixEngine::mixGroupJob(void* context, int group) {
+    BlockJob* job = (BlockJob*)context;
+    job->engine->mixBuses(*job->plan, group, job->inputs, job->outputs, job->dirty);
+}
+
+void MixEngine::mixBuses(MixPlan& plan, int group, void* const* inputs, void* const* outputs, uint8_t* dirty) {
+    // Groups touch disjoint outputs and their own mix and gather slices;
+    // inputs, silence flags and staged inputs are only read
+    const float* stage = stageBuffer;
+    float* mix = mixBuffer + (size_t)group * bufferSize;
+    const void** gather = gatherBuffer + (size_t)group * inputTypes.size();
+    int endBus = plan.partitionStart[group + 1];
+    for (int b = plan.partitionStart[group]; b < endBus; b++) {
+        if (busRamping[b]) {
+            mixRamping(plan, b, inputs, outputs, dirty, mix, rampBuffer + (size_t)group * bufferSize);
+            continue;
+        }
+
+        const OutputBus& bus = plan.buses[b];
+        const BusInput* in = &plan.busInputs[bus.firstInput];
+        void* out = outputs[bus.outputChannel];
+
+        int firstActive = -1;
+        for (int i = 0; i < bus.numLive; i++) {
+            if (!inputSilent[in[i].inputChannel]) {
+                firstActive = i;
+                break;
+            }
+        }
+
+        // All inputs silent: clear the output once, then leave it alone
+        if (firstActive < 0) {
+            outputLevels[bus.outputChannel] = BlockLevel();
+            if (dirty[bus.outputChannel]) {
+                memset(out, 0, bus.bytes);
+                dirty[bus.outputChannel] = 0;
+            }
+            continue;
+        }
+        dirty[bus.outputChannel] = 1;
+
+        switch (bus.path) {
+            case MixPathCopy:
+                // Bit-exact passthrough; float formats are not clamped here
+                memcpy(out, inputs[in[0].inputChannel], bus.bytes);
+                outputLevels[bus.outputChannel] = inputLevels[in[0].inputChannel];
+                break;
+
+            case MixPathInteger: {
+                const void** sources = gather;
+                int numSources = 0;
+                for (int i = firstActive; i < bus.numLive; i++) {
+                    if (!inputSilent[in[i].inputChannel]) {
+                        sources[numSources++] = inputs[in[i].inputChannel];
+                    }
+                }
+                bus.integerMix(sources, numSources, out, bufferSize);
+                bus.meter(out, bufferSize, &outputLevels[bus.outputChannel]);
+                break;
+            }
+
+            default: {
+                // Sum the scaled active inputs in float, then clamp and convert
+                // once. The first one overwrites the bus so it never needs
+                // clearing; unity gain skips the multiply.
+                const BusInput& first = in[firstActive];
+                const void* src = first.stage >= 0 ? (const void*)(stage + first.stage * bufferSize)
+                                                   : inputs[first.inputChannel];
+                if (first.gain == 1.0f) {
+                    first.toFloat(src, mix, bufferSize);
+                } else {
+                    first.toFloatScaled(src, mix, first.gain, bufferSize);
+                }
+                for (int i = firstActive + 1; i < bus.numLive; i++) {
+                    if (inputSilent[in[i].inputChannel]) continue;
+                    src = in[i].stage >= 0 ? (const void*)(stage + in[i].stage * bufferSize)
+                                           : inputs[in[i].inputChannel];
+                    if (in[i].gain == 1.0f) {
+                        in[i].accumulate(src, mix, bufferSize);
+                    } else {
+                        in[i].accumulateScaled(src, mix, in[i].gain, bufferSize);
+                    }
+                }
+                bus.fromFloat(mix, out, bufferSize, &outputLevels[bus.outputChannel]);
+                break;
+            }
+        }
+    }
+
+}
+
+void MixEngine::startRamps(const MixPlan& plan) {
+    rampSerial = plan.serial;
+    int numBuses = (int)plan.buses.size();
+    if (plan.rampStep == 0.0f) {
+        // No ramps: jump to the new gains. Cells the plan dropped are silent.
+        size_t numCells = inputTypes.size() * outputTypes.size();
+        for (size_t cell = 0; cell < numCells; cell++) {
+            cellGain[cell].store(0.0f, std::memory_order_relaxed);
+        }
+        for (const auto& input : plan.busInputs) {
+            cellGain[input.cell].store(input.gain, std::memory_order_relaxed);
+        }
+        memset(busRamping, 0, numBuses);
+        return;
+    }
+
+    // A cell the plan left out plays nothing, so a stale gain must not be
+    // where a later ramp on it starts
+    for (int cell : plan.unusedCells) {
+        cellGain[cell].store(0.0f, std::memory_order_relaxed);
+    }
+
+    // Only the buses with a cell away from its target take the ramp path
+    for (int b = 0; b < numBuses; b++) {
+        const OutputBus& bus = plan.buses[b];
+        busRamping[b] = 0;
+        for (int i = 0; i < bus.numInputs; i++) {
+            const BusInput& input = plan.busInputs[bus.firstInput + i];
+            if (cellGain[input.cell].load(std::memory_order_relaxed) != input.gain) {
+                busRamping[b] = 1;
+                break;
+            }
+        }
+    }
+}
+
+void MixEngine::mixRamping(const MixPlan& plan, int b, void* const* inputs, void* const* outputs, uint8_t* dirty,
+                           float* mix, float* scratch) {
+    const OutputBus& bus = plan.buses[b];
+    const BusInput* in = &plan.busInputs[bus.firstInput];
+    bool settled = true;
+
+    memset(mix, 0, bufferSize * sizeof(float));
+    for (int i = 0; i < bus.numInputs; i++) {
+        const BusInput& input = in[i];
+        float from = cellGain[input.cell].load(std::memory_order_relaxed);
+        float to = input.gain;
+        if (from == 0.0f && to == 0.0f) continue;
+
+        // Ramp from the gain playing towards the target, in power for an
+        // equal-power ramp, for as much of the block as it takes. Ramps
+        // between gains of opposite sign stay linear.
+        float start = from;
+        float step = 0.0f;
+        int frames = 0;
+        bool power = plan.rampShape == RampEqualPower && from >= 0.0f && to >= 0.0f;
+        if (from != to) {
+            float a = power ? from * from : from;
+            float z = power ? to * to : to;
+            double left = std::ceil(std::fabs((double)z - a) / plan.rampStep);
+            frames = left < bufferSize ? std::max((int)left, 1) : bufferSize;
+            step = z > a ? plan.rampStep : -plan.rampStep;
+            start = a;
+            float reached = to;
+            if (frames < left) {
+                reached = a + step * (float)frames;
+                reached = power ? std::sqrt(std::max(reached, 0.0f)) : reached;
+                settled = false;
+            }
+            cellGain[input.cell].store(reached, std::memory_order_relaxed);
+        }
+
+        if (input.silenceChecked && inputSilent[input.inputChannel]) continue;
+        const float* src;
+        if (input.stage >= 0) {
+            src = stageBuffer + input.stage * bufferSize;
+        } else if (inputTypes[input.inputChannel] == ASIOSTFloat32LSB) {
+            src = (const float*)inputs[input.inputChannel];
+        } else {
+            input.toFloat(inputs[input.inputChannel], scratch, bufferSize);
+            src = scratch;
+        }
+        if (frames > 0) {
+            rampMixers[power ? RampEqualPower : RampLinear](src, mix, start, step, frames);
+        }
+        if (frames < bufferSize && to != 0.0f) {
+            accumulateFloat(src + frames, mix + frames, to, bufferSize - frames);
+        }
+    }
+
+    bus.fromFloat(mix, outputs[bus.outputChannel], bufferSize, &outputLevels[bus.outputChannel]);
+    dirty[bus.outputChannel] = 1;
+    if (settled) {
+        busRamping[b] = 0;
+    }
+}
+
+MixPathCounts MixEngine::getPathCounts() const {
+    MixPathCounts counts = {};
+    // Plans are only freed by the control thread, which is also the caller
+    const MixPlan* plan = currentPlan.load(std::memory_order_acquire);
+    if (!plan) {
+        return counts;
+    }
+    for (const auto& bus : plan->buses) {
+        counts.routes[bus.path] += bus.numLive;
+        for (int i = 0; i < bus.numLive; i++) {
+            if (plan->busInputs[bus.firstInput + i].gain != 1.0f) counts.scaledRoutes++;
+        }
+    }
+    counts.stagedInputs = (int)plan->stagedInputs.size();
+    counts.silentOutputs = (int)plan->silentOutputs.size();
+    counts.partitions = (int)plan->partitionStart.size() - 1;
+    return counts;
+}
+
+double MixEngine::estimateCost() const {
+    const MixPlan* plan = currentPlan.load(std::memory_order_acquire);
+    return plan ? plan->cost : 0.0;
+}
+
+const char* MixEngine::getPathName(MixPath path) {
+    switch (path) {
+        case MixPathCopy:    return "direct copy";
+        case MixPathInteger: return "integer sum";
+        case MixPathFloat:   return "float bus";
+        default:             return "unknown";
+    }
+}
@@ -0,0 +1,291 @@
+#pragma once
+
+#include "asio_types.h"
+#include "routing_matrix.h"
+#include "sample_convert.h"
+#include "stream_arena.h"
+#include "worker_pool.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// How an output bus is produced each block
+enum MixPath {
+    MixPathCopy = 0,    // One unity-gain input, same format: straight memcpy
+    MixPathInteger,     // Same-format unity-gain integer fan-in: wide sum, saturated
+    MixPathFloat,       // Anything else: float multiply-accumulate bus
+    NumMixPaths
+};
+
+// Number of routes that take each path in the current plan
+struct MixPathCounts {
+    int routes[NumMixPaths];
+    int scaledRoutes;       // Routes with a gain other than 1
+    int stagedInputs;       // Inputs converted to float once and shared
+    int silentOutputs;
+    int partitions;         // Output groups mixed in parallel (1 = serial)
+};
+
+// Mute, solo and gain on top of the routing matrix, per output
+struct OutputControl {
+    float gain = 1.0f;      // Scales every route into the output
+    bool muted = false;
+    bool soloed = false;
+};
+
+// Mute and solo of one route (matrix cell)
+struct RouteControl {
+    int inputChannel;
+    int outputChannel;
+    bool muted;
+    bool soloed;
+};
+
+// A muted route or output plays nothing. While any output is soloed only
+// the soloed outputs play, and while any route is soloed only the soloed
+// routes do.
+struct MixControls {
+    std::vector<OutputControl> outputs;     // By output channel; missing ones are left alone
+    std::vector<RouteControl> routes;       // Routes with a flag set
+};
+
+// Float mix bus. Routes are grouped by output; every input feeding an
+// output is scaled by its gain and summed in float, and the result is
+// clamped and converted to the output format once per block. Outputs whose
+// inputs all share the output's format at unity gain skip float entirely
+// (see MixPath).
+//
+// An input feeding several float buses is converted to float once per
+// block and the buses read the staged copy, so a dense downmix costs one
+// conversion per input plus one multiply-accumulate per cell.
+//
+// Every channel's peak and sum of squares is measured as a by-product of
+// its conversion: staged inputs as they are converted, float buses as
+// they are clamped and stored. Copied outputs take their input's level;
+// integer sums and the remaining inputs are measured in one read right
+// after they were written or silence-checked, while still in cache.
+//
+// Digitally silent inputs are detected per block and skipped. Outputs that
+// were cleared and have stayed silent are not cleared again; this is
+// tracked per double-buffer half, since each half is a separate buffer.
+//
+// Gain changes, whether from new routes or from the controls, can ramp
+// instead of jumping (see setRamp). The gain each cell is playing at is
+// kept per cell on the driver thread. A new plan that changes it marks the
+// buses involved as ramping, and only those are mixed through the float bus
+// with a per-sample gain ramp (RampMixFn); routes that went silent stay in
+// the plan as fading inputs until they reach zero. Once a bus has reached
+// its targets it is mixed by its normal path again, so settled gains cost
+// nothing extra.
+//
+// Optionally the buses are split into groups of roughly equal estimated
+// cost and mixed in parallel: the driver thread takes the first group and
+// a WorkerPool the rest, and process() returns once all are done. Silence
+// checks and staging stay on the driver thread. Plans too cheap to gain
+// from it are mixed serially.
+//
+// Threading: process() runs on the driver thread; everything else belongs
+// to one control thread. The plan is an immutable snapshot published
+// through an atomic pointer, so setRoutes() can swap it while audio runs.
+// process() takes no locks and never allocates. A replaced plan is retired
+// and freed by the control thread once process() is no longer reading it.
+class MixEngine {
+public:
+    MixEngine() = default;
+    ~MixEngine();
+    MixEngine(const MixEngine&) = delete;
+    MixEngine& operator=(const MixEngine&) = delete;
+
+    // Set the channel formats and block size and publish the first plan.
+    // Plans use the kernels compiled for the block size where it has them.
+    // Everything process() writes is taken from arena, which must have
+    // arenaBytes() to spare; without one the engine allocates its own.
+    // Not real-time safe; process() must not be running.
+    void configure(const std::vector<ASIOSampleType>& inputTypes,
+                   const std::vector<ASIOSampleType>& outputTypes,
+                   const std::vector<ChannelRoute>& routes,
+                   int bufferSize,
+                   StreamArena* arena = nullptr);
+
+    // Arena space configure() takes, with the workers set at the time
+    size_t arenaBytes(int numInputs, int numOutputs, int bufferSize) const;
+
+    // Mix with this many worker threads besides the driver thread (0 =
+    // serial). Plans whose estimated cost per block is below minBlockCost
+    // stay serial; see estimateCost(). Applies to plans built afterwards,
+    // so call it before configure(). process() must not be running.
+    void setWorkers(int workers, double minBlockCost = kParallelMinCost);
+
+    // Estimated cost per block of the published plan, in the units of
+    // kParallelMinCost
+    double estimateCost() const;
+
+    // Cost per block below which parallel mixing does not pay for waking
+    // the workers. One unit is one float multiply-accumulate of one sample.
+    static const double kParallelMinCost;
+
+    // Build a plan for new routes and swap it in. Safe while process() runs
+    // on the driver thread. Returns false if the engine is not configured.
+    bool setRoutes(const std::vector<ChannelRoute>& routes);
+
+    // Mute, solo and output gain, applied to the routes as a new plan like
+    // setRoutes(). Before configure() they are only stored; configure()
+    // starts with them.
+    bool setControls(const MixControls& controls);
+    const MixControls& getControls() const { return controls; }
+
+    // Ramp gain changes over this many frames for a full-scale (0 to 1)
+    // change; smaller changes take proportionally less. 0 (the default)
+    // applies them at the next block. Applies to plans built afterwards.
+    void setRamp(int frames, RampShape shape = RampLinear);
+
+    // Free retired plans that process() has finished with. setRoutes()
+    // calls this; call it again later to release a plan that was still in
+    // use at the time.
+    void reclaim();
+
+    // Drop all plans and free the bus. process() must not be running.
+    void clear();
+
+    // Mix one block. bufferIndex is the ASIO double-buffer half (0 or 1);
+    // inputs/outputs hold that half's buffer pointer per channel.
+    void process(int bufferIndex, void* const* inputs, void* const* outputs);
+
+    // Forget which outputs are known to be zero, e.g. if something other
+    // than process() may have written to the output buffers. Takes effect
+    // at the start of the next block.
+    void invalidateOutputs();
+
+    // Levels of the block process() just mixed, per input and output
+    // channel. Driver thread, between blocks (see LevelMeters).
+    const BlockLevel* getInputLevels() const { return inputLevels; }
+    const BlockLevel* getOutputLevels() const { return outputLevels; }
+
+    // Routes per path for the published plan
+    MixPathCounts getPathCounts() const;
+
+    // Plans retired but not yet freed
+    int getRetiredCount() const { return (int)retired.size(); }
+
+    static const char* getPathName(MixPath path);
+
+private:
+    // One output and the contiguous run of inputs that feed it
+    struct OutputBus {
+        int outputChannel;
+        int firstInput;
+        int numInputs;          // Live inputs first, then fading ones
+        int numLive;            // Inputs with a gain other than 0
+        MixPath path;
+        int bytes;              // Block size in bytes, for MixPathCopy
+        FromFloatMeteredFn fromFloat;
+        MeterFn meter;          // For MixPathInteger, which has no float pass
+        IntegerMixFn integerMix;
+    };
+
+    struct BusInput {
+        int inputChannel;
+        int stage;              // Index into stagedInputs, or -1 to read the input
+        int cell;               // Index into cellGain
+        bool silenceChecked;    // inputSilent is refreshed for this input every block
+        float gain;             // Target; 0 for a fading input
+        ToFloatFn toFloat;
+        AccumulateFn accumulate;
+        ScaledFn toFloatScaled;
+        ScaledFn accumulateScaled;
+    };
+
+    // Inputs converted to float once per block for several buses
+    struct StagedInput {
+        int inputChannel;
+        ToFloatMeteredFn toFloat;
+    };
+
+    // Outputs with no routes are just kept cleared
+    struct SilentOutput {
+        int outputChannel;
+        int bytes;
+    };
+
+    // One routing snapshot, read-only once published
+    struct MixPlan {
+        std::vector<OutputBus> buses;
+        std::vector<BusInput> busInputs;
+        std::vector<SilentOutput> silentOutputs;
+        std::vector<StagedInput> stagedInputs;
+        std::vector<int> meteredInputs;         // Inputs some bus reads unstaged
+        std::vector<int> unusedInputs;          // Inputs no bus reads
+        std::vector<int> unusedCells;           // Cells no bus reads; their gains go to 0
+        std::vector<int> partitionStart;        // First bus of each group, plus the end
+        double cost = 0.0;                      // Estimated per block
+        float rampStep = 0.0f;                  // Gain (or power) per frame, 0 = jump
+        RampShape rampShape = RampLinear;
+        uint64_t serial = 0;                    // Tells plans apart even if one reuses another's memory
+    };
+
+    // One block in flight, shared with the workers
+    struct BlockJob {
+        MixEngine* engine;
+        MixPlan* plan;
+        void* const* inputs;
+        void* const* outputs;
+        uint8_t* dirty;
+    };
+
+    MixPlan* buildPlan();
+    bool publishPlan();
+    float targetGain(const ChannelRoute& route, const std::vector<uint8_t>& routeFlags,
+                     bool anyOutputSoloed, bool anyRouteSoloed) const;
+    double busCost(const MixPlan& plan, const OutputBus& bus) const;
+    void partition(MixPlan& plan) const;
+
+    // Mix one group of buses
+    void mixBuses(MixPlan& plan, int group, void* const* inputs, void* const* outputs, uint8_t* dirty);
+    static void mixGroupJob(void* context, int group);
+
+    // Ramps: find the buses a new plan moves, and mix one of them
+    void startRamps(const MixPlan& plan);
+    void mixRamping(const MixPlan& plan, int bus, void* const* inputs, void* const* outputs, uint8_t* dirty,
+                    float* mix, float* scratch);
+
+    // Formats fixed by configure()
+    std::vector<ASIOSampleType> inputTypes;
+    std::vector<ASIOSampleType> outputTypes;
+    int bufferSize = 0;
+    int maxGroups = 1;                          // Worker count + 1 at configure()
+
+    // Control thread. Plan publication: readerPlan (below) is the plan
+    // process() is using (a hazard pointer); retired plans are freed once
+    // they no longer match it.
+    std::atomic<MixPlan*> currentPlan{nullptr};
+    std::vector<MixPlan*> retired;
+    WorkerPool workers;
+    double minParallelCost = kParallelMinCost;
+    StreamArena ownArena;                       // Used when configure() is given none
+    std::vector<ChannelRoute> planRoutes;       // As last given
+    MixControls controls;
+    int rampFrames = 0;
+    RampShape rampShape = RampLinear;
+    uint64_t planSerial = 0;
+
+    // Driver thread, from a fresh cache line so control-thread writes above
+    // never evict it. The buffers are pieces of the stream arena.
+    alignas(StreamArena::kCacheLine) std::atomic<MixPlan*> readerPlan{nullptr};
+    std::atomic<bool> invalidateRequested{false};
+    SilenceCheckFn isSilent = nullptr;
+    int* inputBytes = nullptr;                  // Block size in bytes per input
+    uint8_t* inputSilent = nullptr;             // Per input, refreshed every block
+    MeterFn* inputMeter = nullptr;              // Per input
+    BlockLevel* inputLevels = nullptr;          // Per input, refreshed every block
+    BlockLevel* outputLevels = nullptr;         // Per output, refreshed every block
+    uint8_t* outputDirty[2] = {};               // Per output and buffer half: may be non-zero
+    float* stageBuffer = nullptr;               // bufferSize floats per input
+    float* mixBuffer = nullptr;                 // bufferSize floats per group
+    const void** gatherBuffer = nullptr;        // numInputs pointers per group, for MixPathInteger
+    std::atomic<float>* cellGain = nullptr;     // Gain playing per cell (output x input); read by buildPlan
+    uint8_t* busRamping = nullptr;              // Per bus of the current plan
+    float* rampBuffer = nullptr;                // bufferSize floats per group, for converting ramped inputs
+    uint64_t rampSerial = 0;                    // Plan startRamps() last ran for
+    RampMixFn rampMixers[2] = {};               // By RampShape
+    ScaledFn accumulateFloat = nullptr;
+};
@@ -0,0 +1,243 @@
+#include "resampler.h"
+#include "simd_target.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if ASIO_HOST_X86
+#include <immintrin.h>
+#endif
+
+// Kaiser window shape: about 86 dB of stopband with the kTaps-long filter,
+// whose transition band is then about 9% of the cutoff wide
+static const double kKaiserBeta = 8.6;
+static const double kPassband = 0.91;
+static const double kPi = 3.14159265358979323846;
+
+// Zeroth-order modified Bessel function of the first kind, for the window
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 64 && term > 1e-12 * sum; k++) {
+        double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+namespace {
+
+// Tap k of the row for fraction f weighs history[floor(position) + k],
+// which lies k - (kTaps/2 - 1) - f frames from the output
+void scalarKernel(const float* coeffs, const float* history, double position, double step,
+                  float* output, int outputFrames) {
+    const int taps = Resampler::kTaps;
+    for (int j = 0; j < outputFrames; j++) {
+        double pos = position + j * step;
+        int index = (int)pos;
+        float phase = (float)(pos - index) * Resampler::kPhases;
+        int row = (int)phase < Resampler::kPhases ? (int)phase : Resampler::kPhases - 1;
+        float frac = phase - row;
+        const float* c0 = coeffs + row * taps;
+        const float* c1 = c0 + taps;
+        const float* h = history + index;
+        float sum = 0.0f;
+        for (int k = 0; k < taps; k++) {
+            sum += h[k] * (c0[k] + frac * (c1[k] - c0[k]));
+        }
+        output[j] = sum;
+    }
+}
+
+#if ASIO_HOST_X86
+
+ASIO_TARGET_SSE2 void sse2Kernel(const float* coeffs, const float* history, double position, double step,
+                                 float* output, int outputFrames) {
+    const int taps = Resampler::kTaps;
+    for (int j = 0; j < outputFrames; j++) {
+        double pos = position + j * step;
+        int index = (int)pos;
+        float phase = (float)(pos - index) * Resampler::kPhases;
+        int row = (int)phase < Resampler::kPhases ? (int)phase : Resampler::kPhases - 1;
+        const __m128 frac = _mm_set1_ps(phase - row);
+        const float* c0 = coeffs + row * taps;
+        const float* c1 = c0 + taps;
+        const float* h = history + index;
+        // Two accumulators hide the add latency
+        __m128 a0 = _mm_setzero_ps();
+        __m128 a1 = _mm_setzero_ps();
+        for (int k = 0; k < taps; k += 8) {
+            __m128 lo0 = _mm_load_ps(c0 + k);
+            __m128 hi0 = _mm_load_ps(c0 + k + 4);
+            __m128 lo = _mm_add_ps(lo0, _mm_mul_ps(frac, _mm_sub_ps(_mm_load_ps(c1 + k), lo0)));
+            __m128 hi = _mm_add_ps(hi0, _mm_mul_ps(frac, _mm_sub_ps(_mm_load_ps(c1 + k + 4), hi0)));
+            a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(h + k), lo));
+            a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(h + k + 4), hi));
+        }
+        __m128 sum = _mm_add_ps(a0, a1);
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        output[j] = _mm_cvtss_f32(sum);
+    }
+}
+
+ASIO_TARGET_AVX2 void avx2Kernel(const float* coeffs, const float* history, double position, double step,
+                                 float* output, int outputFrames) {
+    const int taps = Resampler::kTaps;
+    for (int j = 0; j < outputFrames; j++) {
+        double pos = position + j * step;
+        int index = (int)pos;
+        float phase = (float)(pos - index) * Resampler::kPhases;
+        int row = (int)phase < Resampler::kPhases ? (int)phase : Resampler::kPhases - 1;
+        const __m256 frac = _mm256_set1_ps(phase - row);
+        const float* c0 = coeffs + row * taps;
+        const float* c1 = c0 + taps;
+        const float* h = history + index;
+        __m256 a0 = _mm256_setzero_ps();
+        __m256 a1 = _mm256_setzero_ps();
+        for (int k = 0; k < taps; k += 16) {
+            __m256 lo0 = _mm256_load_ps(c0 + k);
+            __m256 hi0 = _mm256_load_ps(c0 + k + 8);
+            __m256 lo = _mm256_add_ps(lo0, _mm256_mul_ps(frac, _mm256_sub_ps(_mm256_load_ps(c1 + k), lo0)));
+            __m256 hi = _mm256_add_ps(hi0, _mm256_mul_ps(frac, _mm256_sub_ps(_mm256_load_ps(c1 + k + 8), hi0)));
+            a0 = _mm256_add_ps(a0, _mm256_mul_ps(_mm256_loadu_ps(h + k), lo));
+            a1 = _mm256_add_ps(a1, _mm256_mul_ps(_mm256_loadu_ps(h + k + 8), hi));
+        }
+        __m256 sum8 = _mm256_add_ps(a0, a1);
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        output[j] = _mm_cvtss_f32(sum);
+    }
+}
+
+#endif
+
+} // namespace
+
+Resampler::KernelFn Resampler::getKernel(SimdLevel level) {
+    if (level > detectSimdLevel()) {
+        level = detectSimdLevel();
+    }
+#if ASIO_HOST_X86
+    if (level >= SimdAVX2) return &avx2Kernel;
+    if (level >= SimdSSE2) return &sse2Kernel;
+#endif
+    return &scalarKernel;
+}
+
+int Resampler::historyFrames(int maxOutputFrames, double maxStep) {
+    return kTaps + (int)std::ceil(maxOutputFrames * maxStep) + 2;
+}
+
+size_t Resampler::arenaBytes(int channels, int maxOutputFrames, double nominalStep, double maxDeviation) {
+    int frames = historyFrames(maxOutputFrames, nominalStep * (1.0 + maxDeviation));
+    return StreamArena::bytesFor<float>((kPhases + 1) * kTaps) + StreamArena::bytesFor<float*>(channels) +
+           StreamArena::bytesFor<float>(frames) * channels;
+}
+
+bool Resampler::configure(int numChannels, int maxFrames, double nominal, double maxDeviation,
+                          StreamArena* arena) {
+    if (numChannels <= 0 || maxFrames <= 0 || nominal <= 0.0 || maxDeviation < 0.0 || maxDeviation >= 1.0) {
+        return false;
+    }
+    channels = numChannels;
+    maxOutputFrames = maxFrames;
+    nominalStep = nominal;
+    minStep = nominal * (1.0 - maxDeviation);
+    maxStep = nominal * (1.0 + maxDeviation);
+    step = nominal;
+    kernel = getKernel(getSimdLevel());
+
+    // Cutoff in cycles per input frame, below the output's Nyquist
+    // frequency when the output is the slower side
+    double cutoff = 0.5 / std::max(1.0, maxStep) * kPassband;
+    float* table = arena->take<float>((kPhases + 1) * kTaps);
+    if (!table) {
+        return false;
+    }
+    double half = kTaps / 2;
+    double window0 = besselI0(kKaiserBeta);
+    for (int row = 0; row <= kPhases; row++) {
+        double frac = (double)row / kPhases;
+        double taps[kTaps];
+        double sum = 0.0;
+        for (int k = 0; k < kTaps; k++) {
+            double d = k - (half - 1) - frac;
+            double x = 2.0 * cutoff * d;
+            double sinc = d == 0.0 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+            double r = d / half;
+            double window = r * r < 1.0 ? besselI0(kKaiserBeta * std::sqrt(1.0 - r * r)) / window0 : 0.0;
+            taps[k] = sinc * window;
+            sum += taps[k];
+        }
+        // Unity gain at DC for every fraction
+        for (int k = 0; k < kTaps; k++) {
+            table[row * kTaps + k] = (float)(taps[k] / sum);
+        }
+    }
+    coeffs = table;
+
+    historyCapacity = historyFrames(maxFrames, maxStep);
+    history = arena->take<float*>(channels);
+    if (!history) {
+        return false;
+    }
+    for (int ch = 0; ch < channels; ch++) {
+        if (!(history[ch] = arena->take<float>(historyCapacity))) {
+            return false;
+        }
+    }
+    reset();
+    return true;
+}
+
+void Resampler::reset() {
+    // Start centred on the first input frame, with silence before it
+    held = kTaps / 2 - 1;
+    position = 0.0;
+    for (int ch = 0; ch < channels; ch++) {
+        memset(history[ch], 0, historyCapacity * sizeof(float));
+    }
+}
+
+void Resampler::setStep(double newStep) {
+    step = std::min(maxStep, std::max(minStep, newStep));
+}
+
+int Resampler::getInputNeeded(int outputFrames) const {
+    if (outputFrames <= 0) {
+        return 0;
+    }
+    double last = position + (outputFrames - 1) * step;
+    return std::max(0, (int)last + kTaps - held);
+}
+
+bool Resampler::process(const float* const* input, int inputFrames, float* const* output, int outputFrames) {
+    if (outputFrames > maxOutputFrames || held + inputFrames > historyCapacity) {
+        // Silence rather than whatever the outputs held from the last block
+        for (int ch = 0; ch < channels; ch++) {
+            memset(output[ch], 0, std::max(outputFrames, 0) * sizeof(float));
+        }
+        reset();
+        return false;
+    }
+    for (int ch = 0; ch < channels; ch++) {
+        memcpy(history[ch] + held, input[ch], inputFrames * sizeof(float));
+    }
+    held += inputFrames;
+    for (int ch = 0; ch < channels; ch++) {
+        kernel(coeffs, history[ch], position, step, output[ch], outputFrames);
+    }
+
+    // Keep the frames the next block's filter still reaches back to
+    double end = position + outputFrames * step;
+    int consumed = std::min((int)end, held);
+    for (int ch = 0; ch < channels; ch++) {
+        memmove(history[ch], history[ch] + consumed, (held - consumed) * sizeof(float));
+    }
+    held -= consumed;
+    position = end - consumed;
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "sample_convert.h"
+#include "stream_arena.h"
+
+// Windowed-sinc polyphase resampler for planar float audio at a ratio that
+// may change every block, for carrying audio between two clocks. The
+// filter has kTaps taps; its coefficients are tabulated for kPhases
+// fractional positions and linearly interpolated between them. The
+// cutoff sits below the lower of the two Nyquist frequencies over the
+// whole range of ratios configure() allows.
+//
+// The step is input frames consumed per output frame. Per block, ask
+// getInputNeeded() for the input that outputFrames need at the current
+// step and pass exactly that much to process(). The inner loop runs at the
+// active SIMD level (see getSimdLevel()).
+//
+// configure() is for the control thread; the rest belongs to the one
+// thread that runs the resampler. No allocation after configure().
+class Resampler {
+public:
+    static const int kTaps = 64;
+    static const int kPhases = 128;
+
+    // Arena space for configure() with these arguments
+    static size_t arenaBytes(int channels, int maxOutputFrames, double nominalStep, double maxDeviation);
+
+    // nominalStep is input rate / output rate; setStep() may move it by up
+    // to maxDeviation (relative) either way
+    bool configure(int channels, int maxOutputFrames, double nominalStep, double maxDeviation,
+                   StreamArena* arena);
+
+    // Forget the input history (silence), keeping the configuration
+    void reset();
+
+    // Clamped to the configured range
+    void setStep(double step);
+    double getStep() const { return step; }
+    double getNominalStep() const { return nominalStep; }
+
+    int getInputNeeded(int outputFrames) const;
+
+    // False, with the outputs silenced and the input history forgotten,
+    // when the block is larger than configured or the input more than the
+    // history holds
+    bool process(const float* const* input, int inputFrames, float* const* output, int outputFrames);
+
+    // Delay through the filter, in input frames
+    static double getLatencyFrames() { return kTaps / 2 - 1; }
+
+    // Inner loop: outputFrames frames of one channel from history, the
+    // first at position (integer part in frames, fraction in [0, 1)) and
+    // each next one step further on
+    typedef void (*KernelFn)(const float* coeffs, const float* history, double position, double step,
+                             float* output, int outputFrames);
+    static KernelFn getKernel(SimdLevel level);
+
+private:
+    static int historyFrames(int maxOutputFrames, double maxStep);
+
+    int channels = 0;
+    int maxOutputFrames = 0;
+    double nominalStep = 1.0;
+    double minStep = 1.0;
+    double maxStep = 1.0;
+    double step = 1.0;
+    KernelFn kernel = nullptr;
+
+    const float* coeffs = nullptr;  // (kPhases + 1) rows of kTaps
+    float** history = nullptr;      // Per channel: held frames, then new input
+    int historyCapacity = 0;
+    int held = 0;
+    double position = 0.0;          // Next output, in frames from history[0]
+};
@@ -0,0 +1,106 @@
+#include "routing_matrix.h"
+#include <algorithm>
+#include <cstdio>
+
+static bool cellBefore(const ChannelRoute& a, int inputChannel, int outputChannel) {
+    if (a.outputChannel != outputChannel) return a.outputChannel < outputChannel;
+    return a.inputChannel < inputChannel;
+}
+
+void RoutingMatrix::setGain(int inputChannel, int outputChannel, float gain) {
+    auto it = std::lower_bound(cells.begin(), cells.end(), 0,
+                               [&](const ChannelRoute& cell, int) {
+                                   return cellBefore(cell, inputChannel, outputChannel);
+                               });
+    bool found = it != cells.end() && it->inputChannel == inputChannel &&
+                 it->outputChannel == outputChannel;
+
+    if (gain == 0.0f) {
+        if (found) cells.erase(it);
+    } else if (found) {
+        it->gain = gain;
+    } else {
+        ChannelRoute cell;
+        cell.inputChannel = inputChannel;
+        cell.outputChannel = outputChannel;
+        cell.gain = gain;
+        cells.insert(it, cell);
+    }
+}
+
+float RoutingMatrix::getGain(int inputChannel, int outputChannel) const {
+    auto it = std::lower_bound(cells.begin(), cells.end(), 0,
+                               [&](const ChannelRoute& cell, int) {
+                                   return cellBefore(cell, inputChannel, outputChannel);
+                               });
+    if (it != cells.end() && it->inputChannel == inputChannel &&
+        it->outputChannel == outputChannel) {
+        return it->gain;
+    }
+    return 0.0f;
+}
+
+void RoutingMatrix::clear() {
+    cells.clear();
+}
+
+std::string RoutingMatrix::render(const std::vector<std::string>& inputNames,
+                                  const std::vector<std::string>& outputNames) const {
+    if (cells.empty()) {
+        return "(no routes)\n";
+    }
+
+    // Only rows and columns that carry a cell
+    std::vector<int> rows;
+    std::vector<int> columns;
+    for (const auto& cell : cells) {
+        rows.push_back(cell.inputChannel);
+        if (columns.empty() || columns.back() != cell.outputChannel) {
+            columns.push_back(cell.outputChannel);
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    const int labelWidth = 28;
+    std::string text;
+    char buf[64];
+
+    text.append(labelWidth, ' ');
+    for (int out : columns) {
+        snprintf(buf, sizeof(buf), " %8s", ("Out[" + std::to_string(out) + "]").c_str());
+        text += buf;
+    }
+    text += "\n";
+
+    for (int in : rows) {
+        std::string label = "In[" + std::to_string(in) + "]";
+        if (in < (int)inputNames.size() && !inputNames[in].empty()) {
+            label += " " + inputNames[in];
+        }
+        if ((int)label.size() > labelWidth - 1) {
+            label.resize(labelWidth - 1);
+        }
+        label.resize(labelWidth, ' ');
+        text += label;
+
+        for (int out : columns) {
+            float gain = getGain(in, out);
+            if (gain == 0.0f) {
+                snprintf(buf, sizeof(buf), " %8s", ".");
+            } else {
+                snprintf(buf, sizeof(buf), " %8.2f", gain);
+            }
+            text += buf;
+        }
+        text += "\n";
+    }
+
+    // Column legend
+    for (int out : columns) {
+        if (out < (int)outputNames.size() && !outputNames[out].empty()) {
+            text += "Out[" + std::to_string(out) + "] = " + outputNames[out] + "\n";
+        }
+    }
+    return text;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// One cell of the routing matrix: input -> output at a linear gain
+struct ChannelRoute {
+    int inputChannel;   // Source input channel
+    int outputChannel;  // Destination output channel
+    float gain = 1.0f;  // Linear gain applied to the input
+};
+
+// Sparse input x output gain matrix. Only non-zero cells are stored, kept
+// sorted by output and then input, which is the order the mixer walks them
+// in: each output's inputs are one contiguous run.
+class RoutingMatrix {
+public:
+    // Set one cell's gain; a gain of 0 removes the cell
+    void setGain(int inputChannel, int outputChannel, float gain);
+
+    // Gain of a cell, 0 if it is not routed
+    float getGain(int inputChannel, int outputChannel) const;
+
+    void clear();
+    bool empty() const { return cells.empty(); }
+    int size() const { return (int)cells.size(); }
+
+    // Non-zero cells, sorted by output then input
+    const std::vector<ChannelRoute>& getCells() const { return cells; }
+
+    // Text grid of the routed inputs (rows) and outputs (columns). Names are
+    // optional and indexed by channel.
+    std::string render(const std::vector<std::string>& inputNames,
+                       const std::vector<std::string>& outputNames) const;
+
+private:
+    std::vector<ChannelRoute> cells;
+};
@@ -0,0 +1,525 @@
+#include "routing_rules.h"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static char foldCase(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+void PatternMatcher::build(const std::vector<std::string>& patterns) {
+    memset(classes, 0, sizeof(classes));
+    numClasses = 1;
+    next.clear();
+    outputStart.clear();
+    outputs.clear();
+    patternLengths.clear();
+    if (patterns.empty()) {
+        return;
+    }
+
+    // Alphabet: each distinct folded character gets a class, shared by
+    // its upper case form; everything else is class 0 and leads to the root
+    for (const std::string& pattern : patterns) {
+        for (char c : pattern) {
+            uint8_t folded = (uint8_t)foldCase(c);
+            if (classes[folded] == 0) {
+                classes[folded] = (uint8_t)numClasses++;
+                if (folded >= 'a' && folded <= 'z') {
+                    classes[folded - 'a' + 'A'] = classes[folded];
+                }
+            }
+        }
+    }
+
+    // Trie of the patterns, -1 for no edge
+    next.assign(numClasses, -1);
+    std::vector<std::vector<int>> ends(1);
+    for (size_t p = 0; p < patterns.size(); p++) {
+        patternLengths.push_back((int)patterns[p].size());
+        if (patterns[p].empty()) {
+            continue;   // Matches nothing
+        }
+        int state = 0;
+        for (char c : patterns[p]) {
+            int cls = classes[(uint8_t)foldCase(c)];
+            if (next[state * numClasses + cls] < 0) {
+                next[state * numClasses + cls] = (int)ends.size();
+                next.resize(next.size() + numClasses, -1);
+                ends.emplace_back();
+            }
+            state = next[state * numClasses + cls];
+        }
+        ends[state].push_back((int)p);
+    }
+
+    // Breadth first, fill in each missing edge from the state's failure
+    // link and inherit the failure link's matches
+    int numStates = (int)ends.size();
+    std::vector<int> fail(numStates, 0);
+    std::vector<int> queue;
+    queue.reserve(numStates);
+    for (int c = 0; c < numClasses; c++) {
+        int& to = next[c];
+        if (to < 0) {
+            to = 0;
+        } else {
+            queue.push_back(to);
+        }
+    }
+    for (size_t head = 0; head < queue.size(); head++) {
+        int state = queue[head];
+        const std::vector<int>& inherited = ends[fail[state]];
+        ends[state].insert(ends[state].end(), inherited.begin(), inherited.end());
+        for (int c = 0; c < numClasses; c++) {
+            int& to = next[state * numClasses + c];
+            int viaFail = next[fail[state] * numClasses + c];
+            if (to < 0) {
+                to = viaFail;
+            } else {
+                fail[to] = viaFail;
+                queue.push_back(to);
+            }
+        }
+    }
+
+    outputStart.resize(numStates + 1);
+    for (int s = 0; s < numStates; s++) {
+        outputStart[s] = (int)outputs.size();
+        outputs.insert(outputs.end(), ends[s].begin(), ends[s].end());
+    }
+    outputStart[numStates] = (int)outputs.size();
+}
+
+// The classifier this host always had: its hardware names, all of them
+// hardware on either side
+static const char* const kHardwarePatterns[] = {
+    "asio4all", "asio 4 all",
+    "realtek", "nvidia", "amd", "intel",
+    "usb", "hdmi", "spdif", "optical",
+    "focusrite", "scarlett", "steinberg", "yamaha",
+    "motu", "rme", "universal audio", "presonus",
+    "behringer", "native instruments", "m-audio",
+    "flexasio", "wasapi", "wdm",
+    "speaker", "headphone", "line out", "line in",
+    "microphone", "mic in", "aux",
+    "topping", "fiio", "schiit", "jds", "geshelli",
+    "not connected", "disconnected",
+    "^ch"
+};
+
+RoutingRules::RoutingRules() {
+    std::vector<RoutingRule> defaults;
+    for (const char* pattern : kHardwarePatterns) {
+        RoutingRule rule;
+        rule.pattern = pattern;
+        defaults.push_back(rule);
+    }
+    setRules(defaults);
+}
+
+RoutingRules RoutingRules::none() {
+    RoutingRules rules;
+    rules.setRules({});
+    return rules;
+}
+
+RoutingRules RoutingRules::builtIn() {
+    return RoutingRules();
+}
+
+void RoutingRules::setRules(const std::vector<RoutingRule>& newRules) {
+    rules = newRules;
+    compile();
+}
+
+void RoutingRules::compile() {
+    std::vector<std::string> patterns;
+    anchoredStart.assign(rules.size(), 0);
+    anchoredEnd.assign(rules.size(), 0);
+    for (size_t i = 0; i < rules.size(); i++) {
+        std::string pattern = rules[i].pattern;
+        if (!pattern.empty() && pattern[0] == '^') {
+            anchoredStart[i] = 1;
+            pattern.erase(0, 1);
+        }
+        if (!pattern.empty() && pattern.back() == '$') {
+            anchoredEnd[i] = 1;
+            pattern.pop_back();
+        }
+        patterns.push_back(pattern);
+    }
+    matcher.build(patterns);
+
+    // FNV-1a of the text form, which holds everything that affects a plan
+    std::string text = format();
+    hash = 14695981039346656037ull;
+    for (char c : text) {
+        hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+    }
+}
+
+const RoutingRule* RoutingRules::findRule(const std::string& name, bool isInput) const {
+    int scope = isInput ? ScopeInputs : ScopeOutputs;
+    int best = -1;
+    matcher.match(name, [&](int p, size_t start) {
+        const RoutingRule& rule = rules[p];
+        if (!(rule.scope & scope) ||
+            (anchoredStart[p] && start != 0) ||
+            (anchoredEnd[p] && start + matcherLength(p) != name.size())) {
+            return;
+        }
+        if (best < 0 || rule.priority > rules[best].priority ||
+            (rule.priority == rules[best].priority && p < best)) {
+            best = p;
+        }
+    });
+    return best >= 0 ? &rules[best] : nullptr;
+}
+
+size_t RoutingRules::matcherLength(int rule) const {
+    return rules[rule].pattern.size() - anchoredStart[rule] - anchoredEnd[rule];
+}
+
+static ChannelRole fallbackRole(const std::string& name, bool isInput) {
+    // Mostly digits (like "01" or "1-2") is a bare channel number
+    size_t digitCount = 0;
+    for (char c : name) {
+        if (isdigit((uint8_t)c) || c == '-' || c == ' ') digitCount++;
+    }
+    if (!name.empty() && digitCount >= name.size() / 2) {
+        return RoleHardware;
+    }
+    // SAR virtual endpoints have user-defined names ("Game", "Discord",
+    // "Browser"), so any other named input is taken for one
+    return (isInput && !name.empty()) ? RoleVirtual : RoleNone;
+}
+
+ChannelRole RoutingRules::classify(const std::string& name, bool isInput) const {
+    const RoutingRule* rule = findRule(name, isInput);
+    return rule ? rule->role : fallbackRole(name, isInput);
+}
+
+RoutingMatrix RoutingRules::plan(const std::vector<std::string>& inputNames,
+                                 const std::vector<std::string>& outputNames,
+                                 std::vector<ChannelRole>* inputRoles,
+                                 std::vector<ChannelRole>* outputRoles) const {
+    RoutingMatrix routes;
+    int numInputs = (int)inputNames.size();
+    int numOutputs = (int)outputNames.size();
+    inputRoles->resize(numInputs);
+    outputRoles->resize(numOutputs);
+
+    // Inputs with a route rule go where it says; the other virtual inputs
+    // are paired with the hardware outputs
+    std::vector<int> pairedInputs;
+    bool anyVirtual = false;
+    for (int i = 0; i < numInputs; i++) {
+        const RoutingRule* rule = findRule(inputNames[i], true);
+        ChannelRole role = rule ? rule->role : fallbackRole(inputNames[i], true);
+        (*inputRoles)[i] = role;
+        anyVirtual |= role == RoleVirtual;
+        if (rule && !rule->outputs.empty()) {
+            for (int output : rule->outputs) {
+                if (output >= 0 && output < numOutputs) {
+                    routes.setGain(i, output, rule->gain);
+                }
+            }
+        } else if (role == RoleVirtual) {
+            pairedInputs.push_back(i);
+        }
+    }
+
+    // If no input is virtual, the driver has no physical inputs (common
+    // for DACs) and all of them are
+    if (!anyVirtual) {
+        for (int i = 0; i < numInputs; i++) {
+            if ((*inputRoles)[i] != RoleIgnore) {
+                pairedInputs.push_back(i);
+            }
+        }
+    }
+
+    std::vector<int> hardwareOutputs;
+    for (int i = 0; i < numOutputs; i++) {
+        (*outputRoles)[i] = classify(outputNames[i], false);
+        if ((*outputRoles)[i] == RoleHardware) {
+            hardwareOutputs.push_back(i);
+        }
+    }
+
+    // If no output looks like hardware, use the first two; SAR typically
+    // puts hardware channels first
+    if (hardwareOutputs.empty()) {
+        for (int i = 0; i < numOutputs && hardwareOutputs.size() < 2; i++) {
+            if ((*outputRoles)[i] != RoleIgnore) {
+                hardwareOutputs.push_back(i);
+            }
+        }
+    }
+
+    // Input i lands on hardware channel i modulo the hardware width; the
+    // mixer sums cells that share an output. A mono output takes each
+    // stereo pair as (L + R) / 2 rather than L + R.
+    int numHwChannels = (int)hardwareOutputs.size();
+    if (numHwChannels == 0) {
+        return routes;
+    }
+    float gain = (numHwChannels == 1 && pairedInputs.size() > 1) ? 0.5f : 1.0f;
+    for (size_t i = 0; i < pairedInputs.size(); i++) {
+        routes.setGain(pairedInputs[i], hardwareOutputs[i % numHwChannels], gain);
+    }
+    return routes;
+}
+
+const char* RoutingRules::getRoleName(ChannelRole role) {
+    switch (role) {
+    case RoleVirtual:  return "virtual";
+    case RoleHardware: return "hardware";
+    case RoleIgnore:   return "ignore";
+    default:           return "none";
+    }
+}
+
+static const char* getScopeName(int scope) {
+    switch (scope) {
+    case ScopeInputs:  return "inputs";
+    case ScopeOutputs: return "outputs";
+    default:           return "any";
+    }
+}
+
+// Splits a rule line into words; a quoted word may hold spaces and
+// backslash-escaped quotes
+static bool tokenize(const std::string& line, std::vector<std::string>* words, std::string* error) {
+    size_t i = 0;
+    while (i < line.size()) {
+        char c = line[i];
+        if (c == '#') {
+            break;
+        }
+        if (isspace((uint8_t)c)) {
+            i++;
+            continue;
+        }
+        std::string word;
+        if (c == '"') {
+            i++;
+            bool closed = false;
+            while (i < line.size()) {
+                c = line[i++];
+                if (c == '"') {
+                    closed = true;
+                    break;
+                }
+                if (c == '\\' && i < line.size()) {
+                    c = line[i++];
+                }
+                word += c;
+            }
+            if (!closed) {
+                *error = "unterminated pattern";
+                return false;
+            }
+        } else {
+            while (i < line.size() && !isspace((uint8_t)line[i]) && line[i] != '#') {
+                word += line[i++];
+            }
+        }
+        words->push_back(word);
+    }
+    return true;
+}
+
+static bool parseInt(const std::string& word, int* value) {
+    char* end = nullptr;
+    long parsed = strtol(word.c_str(), &end, 10);
+    if (word.empty() || *end != '\0') {
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
+static bool parseRule(const std::vector<std::string>& words, RoutingRule* rule, std::string* error) {
+    if (words.size() < 3) {
+        *error = "expected <inputs|outputs|any> \"<pattern>\" <role>";
+        return false;
+    }
+    if (words[0] == "inputs" || words[0] == "input") {
+        rule->scope = ScopeInputs;
+    } else if (words[0] == "outputs" || words[0] == "output") {
+        rule->scope = ScopeOutputs;
+    } else if (words[0] == "any") {
+        rule->scope = ScopeAny;
+    } else {
+        *error = "unknown scope '" + words[0] + "'";
+        return false;
+    }
+
+    rule->pattern = words[1];
+    std::string stripped = rule->pattern;
+    if (!stripped.empty() && stripped[0] == '^') stripped.erase(0, 1);
+    if (!stripped.empty() && stripped.back() == '$') stripped.pop_back();
+    if (stripped.empty()) {
+        *error = "empty pattern";
+        return false;
+    }
+
+    size_t w = 3;
+    const std::string& role = words[2];
+    if (role == "virtual") {
+        rule->role = RoleVirtual;
+    } else if (role == "hardware") {
+        rule->role = RoleHardware;
+    } else if (role == "ignore") {
+        rule->role = RoleIgnore;
+    } else if (role == "none") {
+        rule->role = RoleNone;
+    } else if (role == "route") {
+        if (rule->scope != ScopeInputs) {
+            *error = "only inputs rules can route";
+            return false;
+        }
+        if (words.size() < 4) {
+            *error = "route needs output channels";
+            return false;
+        }
+        rule->role = RoleVirtual;
+        std::stringstream list(words[3]);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            int output;
+            if (!parseInt(item, &output) || output < 0) {
+                *error = "bad output channel '" + item + "'";
+                return false;
+            }
+            rule->outputs.push_back(output);
+        }
+        w = 4;
+    } else {
+        *error = "unknown role '" + role + "'";
+        return false;
+    }
+
+    for (; w < words.size(); w += 2) {
+        if (w + 1 >= words.size()) {
+            *error = "'" + words[w] + "' needs a value";
+            return false;
+        }
+        const std::string& value = words[w + 1];
+        if (words[w] == "priority") {
+            if (!parseInt(value, &rule->priority)) {
+                *error = "bad priority '" + value + "'";
+                return false;
+            }
+        } else if (words[w] == "gain" && !rule->outputs.empty()) {
+            char* end = nullptr;
+            rule->gain = strtof(value.c_str(), &end);
+            if (value.empty() || *end != '\0' || !std::isfinite(rule->gain)) {
+                *error = "bad gain '" + value + "'";
+                return false;
+            }
+        } else {
+            *error = "unexpected '" + words[w] + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RoutingRules::parse(const std::string& text, std::string* error) {
+    std::vector<RoutingRule> parsed;
+    std::stringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::vector<std::string> words;
+        std::string message;
+        RoutingRule rule;
+        bool ok = tokenize(line, &words, &message);
+        if (ok && words.empty()) {
+            continue;
+        }
+        if (!ok || !parseRule(words, &rule, &message)) {
+            if (error) {
+                *error = "line " + std::to_string(lineNumber) + ": " + message;
+            }
+            return false;
+        }
+        parsed.push_back(rule);
+    }
+    setRules(parsed);
+    return true;
+}
+
+bool RoutingRules::load(const std::string& path, std::string* error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        if (error) {
+            *error = "cannot open " + path;
+        }
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return parse(text.str(), error);
+}
+
+static std::string quote(const std::string& pattern) {
+    std::string quoted = "\"";
+    for (char c : pattern) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+std::string RoutingRules::format() const {
+    std::stringstream ss;
+    char number[32];
+    for (const RoutingRule& rule : rules) {
+        ss << getScopeName(rule.scope) << " " << quote(rule.pattern) << " ";
+        if (!rule.outputs.empty()) {
+            ss << "route ";
+            for (size_t i = 0; i < rule.outputs.size(); i++) {
+                ss << (i ? "," : "") << rule.outputs[i];
+            }
+            if (rule.gain != 1.0f) {
+                snprintf(number, sizeof(number), "%.9g", rule.gain);
+                ss << " gain " << number;
+            }
+        } else {
+            ss << getRoleName(rule.role);
+        }
+        if (rule.priority != 0) {
+            ss << " priority " << rule.priority;
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+bool RoutingRules::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    file << "# Channel routing rules, highest priority first, then in order.\n"
+            "#   <inputs|outputs|any> \"<pattern>\" <virtual|hardware|none|ignore> [priority N]\n"
+            "#   inputs \"<pattern>\" route <output>[,<output>...] [gain G] [priority N]\n"
+            "# Patterns match anywhere in a channel name, ignoring case; ^ and $\n"
+            "# anchor them to its start and end. Output channels count from 0.\n\n"
+         << format();
+    return (bool)file;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "routing_matrix.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a channel is to the automatic routing
+enum ChannelRole {
+    RoleNone = 0,       // Neither: an output no input is sent to
+    RoleVirtual,        // An input endpoint to route (SAR playback endpoint)
+    RoleHardware,       // A device channel: outputs receive the virtual inputs
+    RoleIgnore          // Never routed, even when nothing else is found
+};
+
+enum RuleScope {
+    ScopeInputs = 1,
+    ScopeOutputs = 2,
+    ScopeAny = ScopeInputs | ScopeOutputs
+};
+
+// A channel name pattern and what a matching channel is. Patterns match
+// anywhere in the name, ignoring ASCII case; a leading ^ anchors one to
+// the start and a trailing $ to the end.
+struct RoutingRule {
+    std::string pattern;
+    int scope = ScopeAny;
+    ChannelRole role = RoleHardware;
+    std::vector<int> outputs;       // Inputs only: send to these outputs instead of pairing
+    float gain = 1.0f;              // For outputs
+    int priority = 0;               // Highest wins; ties go to the rule listed first
+};
+
+// Case-insensitive multi-pattern substring search (Aho-Corasick). All
+// patterns are compiled into one automaton with a dense transition table
+// over the characters that occur in them, so a name is classified in one
+// pass over its bytes, whatever the number of patterns.
+class PatternMatcher {
+public:
+    void build(const std::vector<std::string>& patterns);
+
+    // onMatch(pattern, start) for every occurrence, in order of its end
+    template <typename Fn>
+    void match(const std::string& text, Fn onMatch) const {
+        if (patternLengths.empty()) {
+            return;
+        }
+        int state = 0;
+        for (size_t i = 0; i < text.size(); i++) {
+            state = next[state * numClasses + classes[(uint8_t)text[i]]];
+            for (int k = outputStart[state]; k < outputStart[state + 1]; k++) {
+                int pattern = outputs[k];
+                onMatch(pattern, i + 1 - patternLengths[pattern]);
+            }
+        }
+    }
+
+private:
+    uint8_t classes[256] = {};          // Folded byte -> alphabet class, 0 = in no pattern
+    int numClasses = 1;
+    std::vector<int> next;              // State x class -> state, failure links folded in
+    std::vector<int> outputStart;       // Per state, its range in outputs
+    std::vector<int> outputs;           // Patterns ending at each state, suffixes included
+    std::vector<int> patternLengths;
+};
+
+// An ordered set of routing rules, compiled for matching. The text form,
+// one rule per line ('#' starts a comment):
+//
+//   <inputs|outputs|any> "<pattern>" <virtual|hardware|none|ignore> [priority N]
+//   inputs "<pattern>" route <output>[,<output>...] [gain G] [priority N]
+//
+// Channels no rule matches fall back to the built-in heuristics: names
+// that are mostly digits are hardware, and any other named input is
+// virtual.
+class RoutingRules {
+public:
+    RoutingRules();     // The built-in rules
+
+    static RoutingRules none();
+    static RoutingRules builtIn();
+
+    const std::vector<RoutingRule>& getRules() const { return rules; }
+    void setRules(const std::vector<RoutingRule>& rules);
+
+    // Replace the rules with the text's; on error the rules are unchanged
+    // and error names the line
+    bool parse(const std::string& text, std::string* error);
+    bool load(const std::string& path, std::string* error);
+    std::string format() const;
+    bool save(const std::string& path) const;
+
+    // Identifies the rule set, for caching what was derived from it
+    uint64_t getHash() const { return hash; }
+
+    // Highest-priority rule matching a channel name, or nullptr
+    const RoutingRule* findRule(const std::string& name, bool isInput) const;
+
+    ChannelRole classify(const std::string& name, bool isInput) const;
+
+    // Default routing for a channel layout. Virtual inputs with no route
+    // rule go round-robin onto the hardware outputs; if no input is
+    // virtual, every input not ignored is, and if no output is hardware,
+    // the first two outputs not ignored are. A single hardware output
+    // takes several inputs at half gain. The roles are returned too.
+    RoutingMatrix plan(const std::vector<std::string>& inputNames, const std::vector<std::string>& outputNames,
+                       std::vector<ChannelRole>* inputRoles, std::vector<ChannelRole>* outputRoles) const;
+
+    static const char* getRoleName(ChannelRole role);
+
+private:
+    void compile();
+    size_t matcherLength(int rule) const;   // Pattern without its anchors
+
+    std::vector<RoutingRule> rules;
+    PatternMatcher matcher;
+    std::vector<uint8_t> anchoredStart;
+    std::vector<uint8_t> anchoredEnd;
+    uint64_t hash = 0;
+};
@@ -0,0 +1,1269 @@
+#include "rtp_stream.h"
+#include "callback_stats.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <system_error>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET SocketHandle;
+typedef WSABUF IoVector;
+struct PacketMessage {
+    int unused;
+};
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+typedef mmsghdr PacketMessage;     // Batched: one system call for many packets
+#else
+typedef msghdr PacketMessage;
+#endif
+typedef int SocketHandle;
+typedef iovec IoVector;
+#endif
+
+static const intptr_t kNoSocket = -1;
+static const int kRtpHeaderBytes = 12;
+static const int kExtensionBytes = 16;          // RFC 8285 one-byte header, one 8-byte element, padded
+static const int kCaptureTimeId = 1;            // Extension element carrying the capture time
+static const int kMaxDatagram = 1472;           // UDP payload in a 1500-byte Ethernet frame
+static const uint64_t kWritingStamp = ~0ull;    // Slot being rewritten
+static const uint64_t kCountMask = (1ull << 40) - 1;
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit value");
+
+// Sleep while word still holds expected; may return spuriously
+static void waitOnValue(std::atomic<uint32_t>& word, uint32_t expected) {
+#ifdef _WIN32
+    WaitOnAddress(&word, &expected, sizeof(expected), INFINITE);
+#elif defined(__linux__)
+    syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    (void)word;
+    (void)expected;
+    std::this_thread::yield();
+#endif
+}
+
+static void wakeAll(std::atomic<uint32_t>& word) {
+#ifdef _WIN32
+    WakeByAddressAll(&word);
+#elif defined(__linux__)
+    syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAKE_PRIVATE, 0x7fffffff, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+static int lastSocketError() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+static std::string socketErrorText(int code) {
+#ifdef _WIN32
+    return std::system_category().message(code);
+#else
+    return std::generic_category().message(code);
+#endif
+}
+
+static bool isTimeout(int code) {
+#ifdef _WIN32
+    return code == WSAETIMEDOUT || code == WSAEWOULDBLOCK || code == WSAEINTR;
+#else
+    return code == EAGAIN || code == EWOULDBLOCK || code == EINTR;
+#endif
+}
+
+static intptr_t openSocket() {
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+        return kNoSocket;
+    }
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) {
+        int error = WSAGetLastError();
+        WSACleanup();
+        WSASetLastError(error);
+        return kNoSocket;
+    }
+    return (intptr_t)s;
+#else
+    return socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#endif
+}
+
+static void closeSocket(intptr_t sock) {
+    if (sock == kNoSocket) {
+        return;
+    }
+#ifdef _WIN32
+    closesocket((SocketHandle)sock);
+    WSACleanup();
+#else
+    close((SocketHandle)sock);
+#endif
+}
+
+static bool setOption(intptr_t sock, int level, int name, const void* value, int size) {
+    return setsockopt((SocketHandle)sock, level, name, (const char*)value, size) == 0;
+}
+
+static bool isMulticast(const in_addr& address) {
+    return (ntohl(address.s_addr) & 0xF0000000u) == 0xE0000000u;
+}
+
+static void setVector(IoVector& vector, void* data, size_t bytes) {
+#ifdef _WIN32
+    vector.buf = (CHAR*)data;
+    vector.len = (ULONG)bytes;
+#else
+    vector.iov_base = data;
+    vector.iov_len = bytes;
+#endif
+}
+
+#ifndef _WIN32
+static msghdr& messageHeader(PacketMessage& message) {
+#ifdef __linux__
+    return message.msg_hdr;
+#else
+    return message;
+#endif
+}
+#endif
+
+static void put16(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, v >> 16);
+    put16(p + 2, v);
+}
+
+static void put64(uint8_t* p, uint64_t v) {
+    put32(p, (uint32_t)(v >> 32));
+    put32(p + 4, (uint32_t)v);
+}
+
+static uint32_t get16(const uint8_t* p) {
+    return ((uint32_t)p[0] << 8) | p[1];
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return (get16(p) << 16) | get16(p + 2);
+}
+
+static uint64_t get64(const uint8_t* p) {
+    return ((uint64_t)get32(p) << 32) | get32(p + 4);
+}
+
+// One channel's samples into, or out of, every stride-th slot of a packet
+template <int Width>
+static void interleaveWidth(const uint8_t* src, uint8_t* dst, int frames, int stride) {
+    for (int i = 0; i < frames; i++) {
+        memcpy(dst + (size_t)i * stride, src + (size_t)i * Width, Width);
+    }
+}
+
+template <int Width>
+static void deinterleaveWidth(const uint8_t* src, uint8_t* dst, int frames, int stride) {
+    for (int i = 0; i < frames; i++) {
+        memcpy(dst + (size_t)i * Width, src + (size_t)i * stride, Width);
+    }
+}
+
+static void interleave(const uint8_t* src, uint8_t* dst, int frames, int width, int stride) {
+    if (width == 2) interleaveWidth<2>(src, dst, frames, stride);
+    else interleaveWidth<3>(src, dst, frames, stride);
+}
+
+static void deinterleave(const uint8_t* src, uint8_t* dst, int frames, int width, int stride) {
+    if (width == 2) deinterleaveWidth<2>(src, dst, frames, stride);
+    else deinterleaveWidth<3>(src, dst, frames, stride);
+}
+
+static ASIOSampleType wireType(RtpEncoding encoding) {
+    return encoding == RtpL16 ? ASIOSTInt16MSB : ASIOSTInt24MSB;
+}
+
+static const char* encodingName(RtpEncoding encoding) {
+    return encoding == RtpL16 ? "L16" : "L24";
+}
+
+static void keepMax(std::atomic<int64_t>& value, int64_t sample) {
+    if (sample > value.load(std::memory_order_relaxed)) {
+        value.store(sample, std::memory_order_relaxed);
+    }
+}
+
+RtpSender::~RtpSender() {
+    stop();
+}
+
+void RtpSender::prepare(const StreamFormat& streamFormat) {
+    if (sending && !matches(streamFormat)) {
+        stop();
+        stopReason = "the stream's format changed";
+    }
+    format = streamFormat;
+    haveFormat = true;
+}
+
+bool RtpSender::matches(const StreamFormat& streamFormat) const {
+    if (streamFormat.sampleRate != format.sampleRate || streamFormat.bufferSize * 2 > ring.getCapacity()) {
+        return false;
+    }
+    for (int ch : config.channels) {
+        if (ch >= (int)streamFormat.outputTypes.size() || streamFormat.outputTypes[ch] != format.outputTypes[ch]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RtpSender::fail(const std::string& reason) {
+    stopReason = reason;
+    closeSocket(sock);
+    sock = kNoSocket;
+    return false;
+}
+
+bool RtpSender::start(const RtpSendConfig& sendConfig) {
+    if (sending) {
+        return false;
+    }
+    if (!haveFormat || format.bufferSize <= 0 || format.sampleRate <= 0.0) {
+        return fail("the host has no stream");
+    }
+    if (sendConfig.channels.empty()) {
+        return fail("no channels to send");
+    }
+    for (int ch : sendConfig.channels) {
+        if (ch < 0 || ch >= format.numOutputs) {
+            return fail("output " + std::to_string(ch) + " does not exist");
+        }
+    }
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)sendConfig.port);
+    if (sendConfig.port <= 0 || sendConfig.port > 65535 ||
+        inet_pton(AF_INET, sendConfig.address.c_str(), &address.sin_addr) != 1) {
+        return fail("bad destination " + sendConfig.address + ":" + std::to_string(sendConfig.port));
+    }
+    config = sendConfig;
+    channels = (int)config.channels.size();
+    rate = format.sampleRate;
+    sampleBytes = getSampleBytes(wireType(config.encoding));
+    packetFrames = std::max(1, (int)std::lround(config.packetMs * rate / 1000.0));
+    payloadBytes = packetFrames * channels * sampleBytes;
+    headerBytes = kRtpHeaderBytes + (config.sendCaptureTimes ? kExtensionBytes : 0);
+    if (headerBytes + payloadBytes > kMaxDatagram) {
+        return fail("a packet of " + std::to_string(headerBytes + payloadBytes) +
+                    " bytes does not fit one datagram; send fewer channels or shorter packets");
+    }
+
+    // The ring holds ringSeconds, a few blocks, and two full batches
+    std::vector<int> rawBytes(channels);
+    for (int i = 0; i < channels; i++) {
+        rawBytes[i] = getSampleBytes(format.outputTypes[config.channels[i]]);
+    }
+    int batchFrames = kMaxBatch * packetFrames;
+    int capacity = std::max({ (int)(config.ringSeconds * rate), format.bufferSize * 4, batchFrames * 2 });
+    size_t bytes = SpscRing::arenaBytes(rawBytes.data(), channels, capacity) +
+                   StreamArena::bytesFor<int>(channels) +
+                   StreamArena::bytesFor<const void*>(channels) +
+                   StreamArena::bytesFor<BlockStamp>(kMaxStamps) +
+                   StreamArena::bytesFor<Gap>(kMaxGaps) +
+                   StreamArena::bytesFor<SampleConverter>(channels) +
+                   StreamArena::bytesFor<void*>(channels) +
+                   StreamArena::bytesFor<float*>(channels) +
+                   StreamArena::bytesFor<uint8_t*>(channels) +
+                   StreamArena::bytesFor<uint8_t>((size_t)kMaxBatch * headerBytes) +
+                   StreamArena::bytesFor<uint8_t>((size_t)kMaxBatch * payloadBytes) +
+                   StreamArena::bytesFor<IoVector>(kMaxBatch * 2) +
+                   StreamArena::bytesFor<PacketMessage>(kMaxBatch) +
+                   StreamArena::bytesFor<sockaddr_in>(1);
+    for (int i = 0; i < channels; i++) {
+        bytes += StreamArena::bytesFor<uint8_t>((size_t)batchFrames * rawBytes[i]) +
+                 StreamArena::bytesFor<float>(batchFrames) +
+                 StreamArena::bytesFor<uint8_t>((size_t)batchFrames * sampleBytes);
+    }
+    if (!arena.allocate(bytes) || !ring.configure(rawBytes.data(), channels, capacity, &arena)) {
+        return fail("out of memory");
+    }
+    int* map = arena.take<int>(channels);
+    sources = arena.take<const void*>(channels);
+    stamps = arena.take<BlockStamp>(kMaxStamps);
+    gaps = arena.take<Gap>(kMaxGaps);
+    converters = arena.take<SampleConverter>(channels);
+    rawStaging = arena.take<void*>(channels);
+    floatStaging = arena.take<float*>(channels);
+    wireStaging = arena.take<uint8_t*>(channels);
+    headers = arena.take<uint8_t>((size_t)kMaxBatch * headerBytes);
+    payloads = arena.take<uint8_t>((size_t)kMaxBatch * payloadBytes);
+    IoVector* iov = arena.take<IoVector>(kMaxBatch * 2);
+    PacketMessage* batch = arena.take<PacketMessage>(kMaxBatch);
+    sockaddr_in* target = arena.take<sockaddr_in>(1);
+    if (!map || !sources || !stamps || !gaps || !converters || !rawStaging || !floatStaging || !wireStaging ||
+        !headers || !payloads || !iov || !batch || !target) {
+        return fail("out of memory");
+    }
+    for (int i = 0; i < channels; i++) {
+        map[i] = config.channels[i];
+        converters[i] = getSampleConverter(format.outputTypes[map[i]]);
+        if (!(rawStaging[i] = arena.take<uint8_t>((size_t)batchFrames * rawBytes[i])) ||
+            !(floatStaging[i] = arena.take<float>(batchFrames)) ||
+            !(wireStaging[i] = arena.take<uint8_t>((size_t)batchFrames * sampleBytes))) {
+            return fail("out of memory");
+        }
+    }
+    channelMap = map;
+    toWire = getSampleConverter(wireType(config.encoding)).fromFloat;
+    *target = address;
+    destination = target;
+
+    // Everything in a header but the sequence number, timestamp and
+    // capture time is the same for every packet; RFC 3550 starts the
+    // first two at random
+    std::mt19937 random(std::random_device{}());
+    ssrc = (uint32_t)random();
+    sequence = (uint16_t)random();
+    rtpOrigin = (uint32_t)random();
+    for (int p = 0; p < kMaxBatch; p++) {
+        uint8_t* header = headers + (size_t)p * headerBytes;
+        header[0] = 0x80 | (config.sendCaptureTimes ? 0x10 : 0);
+        header[1] = (uint8_t)(config.payloadType & 0x7f);
+        put32(header + 8, ssrc);
+        if (config.sendCaptureTimes) {
+            put16(header + 12, 0xBEDE);
+            put16(header + 14, (kExtensionBytes - 4) / 4);
+            header[16] = (uint8_t)((kCaptureTimeId << 4) | (8 - 1));
+        }
+        setVector(iov[p * 2], header, headerBytes);
+        setVector(iov[p * 2 + 1], payloads + (size_t)p * payloadBytes, payloadBytes);
+#ifndef _WIN32
+        msghdr& message = messageHeader(batch[p]);
+        message.msg_name = target;
+        message.msg_namelen = sizeof(sockaddr_in);
+        message.msg_iov = &iov[p * 2];
+        message.msg_iovlen = 2;
+#endif
+    }
+    vectors = iov;
+    messages = batch;
+
+    sock = openSocket();
+    if (sock == kNoSocket) {
+        return fail("no socket: " + socketErrorText(lastSocketError()));
+    }
+    // Priority and buffer size are best effort
+    int tos = (config.dscp & 0x3f) << 2;
+    int sendBuffer = 1 << 20;
+    setOption(sock, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+    setOption(sock, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    if (isMulticast(address.sin_addr)) {
+        int ttl = config.ttl;
+        int loop = 1;   // Receivers on this machine hear it too
+        if (!setOption(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) ||
+            !setOption(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop))) {
+            return fail("multicast setup failed: " + socketErrorText(lastSocketError()));
+        }
+    }
+
+    stopReason.clear();
+    quit.store(false, std::memory_order_relaxed);
+    haveStamp = false;
+    stampsWritten.store(0, std::memory_order_relaxed);
+    stampsRead.store(0, std::memory_order_relaxed);
+    blocksWritten.store(0, std::memory_order_relaxed);
+    senderWaiting.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    droppedFrames.store(0, std::memory_order_relaxed);
+    pendingGap = 0;
+    gapFrames = 0;
+    gapsWritten.store(0, std::memory_order_relaxed);
+    gapsRead.store(0, std::memory_order_relaxed);
+    packets.store(0, std::memory_order_relaxed);
+    bytesSent.store(0, std::memory_order_relaxed);
+    sendCalls.store(0, std::memory_order_relaxed);
+    sendErrors.store(0, std::memory_order_relaxed);
+    ringPeak.store(0, std::memory_order_relaxed);
+    socketError.store(0, std::memory_order_relaxed);
+    sender = std::thread(&RtpSender::senderLoop, this);
+
+    // Everything the callback reads is in place before it sees armed
+    armed.store(true);
+    sending = true;
+    return true;
+}
+
+void RtpSender::stop() {
+    if (!sending) {
+        return;
+    }
+    // After this, no callback is inside capture() or will enter it
+    armed.store(false);
+    while (inProcess.load()) {
+        std::this_thread::yield();
+    }
+    quit.store(true, std::memory_order_release);
+    blocksWritten.fetch_add(1, std::memory_order_seq_cst);
+    wakeAll(blocksWritten);
+    sender.join();
+    closeSocket(sock);
+    sock = kNoSocket;
+    sending = false;
+}
+
+void RtpSender::process(const StreamBlock& block) {
+    // Sequentially consistent with stop(): either it sees this callback
+    // inside, or this callback sees the sender disarmed
+    inProcess.store(true);
+    if (armed.load()) {
+        capture(block);
+    }
+    inProcess.store(false, std::memory_order_release);
+}
+
+void RtpSender::capture(const StreamBlock& block) {
+    for (int i = 0; i < channels; i++) {
+        sources[i] = block.outputs[channelMap[i]];
+    }
+    // The block's time goes first, so the sender never sees its frames
+    // without it; while the sender is behind, it falls back on older ones
+    uint64_t position = ring.getWritten();
+    uint32_t written = stampsWritten.load(std::memory_order_relaxed);
+    if (written - stampsRead.load(std::memory_order_acquire) < kMaxStamps) {
+        stamps[written % kMaxStamps] = { position, block.callbackNs };
+        stampsWritten.store(written + 1, std::memory_order_release);
+    }
+    // Frames dropped before this block go in the gap queue first, and only
+    // with room for the block behind them, so the timeline skips them
+    // where they belong
+    if (pendingGap > 0) {
+        uint32_t queued = gapsWritten.load(std::memory_order_relaxed);
+        if (queued - gapsRead.load(std::memory_order_acquire) == kMaxGaps || ring.getSpace() < block.frames) {
+            drop(block.frames);
+            return;
+        }
+        gaps[queued % kMaxGaps] = { position, pendingGap };
+        gapsWritten.store(queued + 1, std::memory_order_release);
+        pendingGap = 0;
+    }
+    if (!ring.write(sources, block.frames)) {
+        drop(block.frames);
+        return;
+    }
+    // Only a sleeping sender costs the callback a system call
+    blocksWritten.fetch_add(1, std::memory_order_seq_cst);
+    if (senderWaiting.load(std::memory_order_seq_cst)) {
+        wakeAll(blocksWritten);
+    }
+}
+
+void RtpSender::drop(int frames) {
+    pendingGap += frames;
+    overruns.fetch_add(1, std::memory_order_relaxed);
+    droppedFrames.fetch_add(frames, std::memory_order_relaxed);
+}
+
+void RtpSender::senderLoop() {
+    for (;;) {
+        uint32_t seen = blocksWritten.load(std::memory_order_acquire);
+        sendAvailable();
+        if (quit.load(std::memory_order_acquire)) {
+            return;
+        }
+        senderWaiting.store(1, std::memory_order_seq_cst);
+        if (blocksWritten.load(std::memory_order_seq_cst) == seen) {
+            waitOnValue(blocksWritten, seen);
+        }
+        senderWaiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+void RtpSender::sendAvailable() {
+    int frameBytes = channels * sampleBytes;
+    for (;;) {
+        // The index first: a gap at or before it is then visible too
+        int available = ring.getAvailable();
+        if (available > ringPeak.load(std::memory_order_relaxed)) {
+            ringPeak.store(available, std::memory_order_relaxed);
+        }
+        uint64_t position = ring.getRead();
+        uint32_t next = gapsRead.load(std::memory_order_relaxed);
+        bool gapQueued = next != gapsWritten.load(std::memory_order_acquire);
+        uint64_t beforeGap = gapQueued ? gaps[next % kMaxGaps].position - position : (uint64_t)available;
+
+        // The timeline keeps counting through dropped frames, so packets
+        // keep their place. A packet that would straddle a gap is dropped
+        // with it, and after it frames are skipped up to the packet grid,
+        // so the timestamps jump by whole packets.
+        uint64_t timeline = position + gapFrames;
+        int offGrid = (int)(timeline % (uint64_t)packetFrames);
+        if (offGrid > 0) {
+            int skip = (int)std::min<uint64_t>({ (uint64_t)(packetFrames - offGrid), beforeGap, (uint64_t)available });
+            if (skip > 0) {
+                ring.skip(skip);
+                continue;
+            }
+            if (!gapQueued || beforeGap > 0) {
+                return;
+            }
+        }
+        if (gapQueued && beforeGap < (uint64_t)packetFrames) {
+            // The frames before a gap were written before it was queued
+            if ((uint64_t)available < beforeGap) {
+                continue;
+            }
+            ring.skip((int)beforeGap);
+            gapFrames += gaps[next % kMaxGaps].frames;
+            gapsRead.store(next + 1, std::memory_order_release);
+            continue;
+        }
+
+        // Whole packets only; a partial one waits for the next block
+        int count = (int)std::min<uint64_t>(std::min<uint64_t>(available, beforeGap) / packetFrames, kMaxBatch);
+        if (count == 0) {
+            return;
+        }
+        int frames = count * packetFrames;
+        ring.read(rawStaging, frames);
+        for (int i = 0; i < channels; i++) {
+            converters[i].toFloat(rawStaging[i], floatStaging[i], frames);
+            toWire(floatStaging[i], wireStaging[i], frames);
+        }
+        for (int p = 0; p < count; p++) {
+            uint8_t* header = headers + (size_t)p * headerBytes;
+            put16(header + 2, sequence++);
+            put32(header + 4, rtpOrigin + (uint32_t)(timeline + (uint64_t)p * packetFrames));
+            if (config.sendCaptureTimes) {
+                put64(header + 17, (uint64_t)captureTime(position + (uint64_t)p * packetFrames));
+            }
+            uint8_t* payload = payloads + (size_t)p * payloadBytes;
+            for (int i = 0; i < channels; i++) {
+                interleave(wireStaging[i] + (size_t)p * packetFrames * sampleBytes, payload + i * sampleBytes,
+                           packetFrames, sampleBytes, frameBytes);
+            }
+        }
+        sendBatch(count);
+    }
+}
+
+int64_t RtpSender::captureTime(uint64_t position) {
+    // Callback time of the block holding the position: the latest that
+    // starts at or before it
+    uint32_t next = stampsRead.load(std::memory_order_relaxed);
+    while (next != stampsWritten.load(std::memory_order_acquire) && stamps[next % kMaxStamps].position <= position) {
+        lastStamp = stamps[next % kMaxStamps];
+        haveStamp = true;
+        next++;
+    }
+    stampsRead.store(next, std::memory_order_release);
+    return haveStamp ? lastStamp.ns : 0;
+}
+
+void RtpSender::sendBatch(int count) {
+    // A packet the socket refuses is dropped with the rest of its batch;
+    // by the time it could be retried its audio would be late
+    int sent = 0;
+#if defined(_WIN32)
+    IoVector* iov = (IoVector*)vectors;
+    for (; sent < count; sent++) {
+        DWORD done = 0;
+        int result = WSASendTo((SocketHandle)sock, &iov[sent * 2], 2, &done, 0, (const sockaddr*)destination,
+                               sizeof(sockaddr_in), nullptr, nullptr);
+        sendCalls.fetch_add(1, std::memory_order_relaxed);
+        if (result != 0) break;
+    }
+#elif defined(__linux__)
+    PacketMessage* batch = (PacketMessage*)messages;
+    while (sent < count) {
+        int result = sendmmsg((SocketHandle)sock, batch + sent, count - sent, 0);
+        sendCalls.fetch_add(1, std::memory_order_relaxed);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) break;
+        sent += result;
+    }
+#else
+    PacketMessage* batch = (PacketMessage*)messages;
+    for (; sent < count; sent++) {
+        ssize_t result = sendmsg((SocketHandle)sock, &batch[sent], 0);
+        sendCalls.fetch_add(1, std::memory_order_relaxed);
+        if (result < 0) break;
+    }
+#endif
+    if (sent < count) {
+        int error = lastSocketError();
+        int none = 0;
+        socketError.compare_exchange_strong(none, error != 0 ? error : EIO, std::memory_order_relaxed);
+        sendErrors.fetch_add(count - sent, std::memory_order_relaxed);
+    }
+    packets.fetch_add(sent, std::memory_order_relaxed);
+    bytesSent.fetch_add((uint64_t)sent * (headerBytes + payloadBytes), std::memory_order_relaxed);
+}
+
+RtpSendReport RtpSender::getReport() const {
+    RtpSendReport r;
+    r.sending = sending;
+    r.destination = config.channels.empty() ? "" : config.address + ":" + std::to_string(config.port);
+    r.channels = channels;
+    r.sampleRate = rate;
+    r.encoding = encodingName(config.encoding);
+    r.packetFrames = packetFrames;
+    r.ssrc = ssrc;
+    r.packets = packets.load(std::memory_order_relaxed);
+    r.bytes = bytesSent.load(std::memory_order_relaxed);
+    r.sendCalls = sendCalls.load(std::memory_order_relaxed);
+    r.sendErrors = sendErrors.load(std::memory_order_relaxed);
+    r.overruns = overruns.load(std::memory_order_relaxed);
+    r.droppedFrames = droppedFrames.load(std::memory_order_relaxed);
+    r.ringPeakPercent = ring.getCapacity() > 0 ? ringPeak.load(std::memory_order_relaxed) * 100.0 / ring.getCapacity() : 0.0;
+    r.error = stopReason;
+    int error = socketError.load(std::memory_order_relaxed);
+    if (error != 0) {
+        r.error = "send failed: " + socketErrorText(error);
+    }
+    return r;
+}
+
+std::string RtpSender::formatText(const RtpSendReport& r) {
+    if (r.destination.empty()) {
+        return r.error.empty() ? "Not sending\n" : "Not sending: " + r.error + "\n";
+    }
+    char buf[320];
+    std::string text = (r.sending ? "Sending to " : "Sent to ") + r.destination + "\n";
+    snprintf(buf, sizeof(buf),
+             "%d channels, %s at %.0f Hz, %d frames (%.3f ms) per packet, SSRC %08x\n"
+             "%llu packets, %.1f MB in %llu send calls (%.1f packets each); %llu send errors\n"
+             "Ring: peak %.0f%% full; %llu overruns, %llu frames skipped\n",
+             r.channels, r.encoding, r.sampleRate, r.packetFrames,
+             r.sampleRate > 0 ? r.packetFrames * 1000.0 / r.sampleRate : 0.0, r.ssrc,
+             (unsigned long long)r.packets, r.bytes / 1048576.0, (unsigned long long)r.sendCalls,
+             r.sendCalls > 0 ? (double)r.packets / r.sendCalls : 0.0, (unsigned long long)r.sendErrors,
+             r.ringPeakPercent, (unsigned long long)r.overruns, (unsigned long long)r.droppedFrames);
+    text += buf;
+    if (!r.error.empty()) {
+        text += "Stopped: " + r.error + "\n";
+    }
+    return text;
+}
+
+RtpReceiver::~RtpReceiver() {
+    stop();
+}
+
+void RtpReceiver::prepare(const StreamFormat& streamFormat) {
+    if (receiving && !matches(streamFormat)) {
+        stop();
+        stopReason = "the stream's format changed";
+    }
+    format = streamFormat;
+    haveFormat = true;
+}
+
+bool RtpReceiver::matches(const StreamFormat& streamFormat) const {
+    if (streamFormat.sampleRate != format.sampleRate || streamFormat.bufferSize != format.bufferSize) {
+        return false;
+    }
+    for (int ch : config.channels) {
+        if (ch >= (int)streamFormat.inputTypes.size() || streamFormat.inputTypes[ch] != format.inputTypes[ch]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RtpReceiver::fail(const std::string& reason) {
+    stopReason = reason;
+    closeSocket(sock);
+    sock = kNoSocket;
+    return false;
+}
+
+bool RtpReceiver::start(const RtpReceiveConfig& receiveConfig) {
+    if (receiving) {
+        return false;
+    }
+    if (!haveFormat || format.bufferSize <= 0 || format.sampleRate <= 0.0) {
+        return fail("the host has no stream");
+    }
+    if (receiveConfig.channels.empty()) {
+        return fail("no channels to play into");
+    }
+    for (int ch : receiveConfig.channels) {
+        if (ch < 0 || ch >= format.numInputs) {
+            return fail("input " + std::to_string(ch) + " does not exist");
+        }
+    }
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)receiveConfig.port);
+    if (receiveConfig.port < 0 || receiveConfig.port > 65535 ||
+        inet_pton(AF_INET, receiveConfig.address.c_str(), &address.sin_addr) != 1) {
+        return fail("bad address " + receiveConfig.address + ":" + std::to_string(receiveConfig.port));
+    }
+    config = receiveConfig;
+    channels = (int)config.channels.size();
+    rate = format.sampleRate;
+    sampleBytes = getSampleBytes(wireType(config.encoding));
+    packetFrames = std::max(1, (int)std::lround(config.packetMs * rate / 1000.0));
+    payloadBytes = packetFrames * channels * sampleBytes;
+    if (kRtpHeaderBytes + payloadBytes > kMaxPacketBytes) {
+        return fail("packets of " + std::to_string(payloadBytes) + " payload bytes do not fit one datagram");
+    }
+
+    // Playout trails the newest packet by the jitter allowance and the
+    // block it plays; the slots hold the most it may trail by, plus the
+    // block being read
+    targetFrames = (int)std::ceil(config.jitterMs * rate / 1000.0) + format.bufferSize;
+    maxFrames = std::max((int)(config.bufferMs * rate / 1000.0), targetFrames + format.bufferSize + packetFrames);
+    int slots = 1;
+    while (slots < (maxFrames + format.bufferSize) / packetFrames + 2) {
+        slots <<= 1;
+    }
+    slotMask = (uint32_t)slots - 1;
+    std::vector<int> widths(channels);
+    slotBytes = 0;
+    for (int i = 0; i < channels; i++) {
+        widths[i] = getSampleBytes(format.inputTypes[config.channels[i]]);
+        slotBytes += StreamArena::bytesFor<uint8_t>((size_t)packetFrames * widths[i]);
+    }
+    size_t bytes = StreamArena::bytesFor<uint8_t>((size_t)slots * slotBytes) +
+                   StreamArena::bytesFor<std::atomic<uint64_t>>(slots) +
+                   StreamArena::bytesFor<int64_t>(slots) +
+                   StreamArena::bytesFor<size_t>(channels) +
+                   StreamArena::bytesFor<int>(channels) * 2 +
+                   StreamArena::bytesFor<uint8_t>((size_t)kMaxBatch * kMaxPacketBytes) +
+                   StreamArena::bytesFor<IoVector>(kMaxBatch) +
+                   StreamArena::bytesFor<PacketMessage>(kMaxBatch) +
+                   StreamArena::bytesFor<int>(kMaxBatch) +
+                   StreamArena::bytesFor<SampleConverter>(channels) +
+                   StreamArena::bytesFor<uint8_t>((size_t)packetFrames * sampleBytes) +
+                   StreamArena::bytesFor<float>(packetFrames);
+    if (!arena.allocate(bytes)) {
+        return fail("out of memory");
+    }
+    slotData = arena.take<uint8_t>((size_t)slots * slotBytes);
+    slotStamps = arena.take<std::atomic<uint64_t>>(slots);
+    slotCaptureNs = arena.take<int64_t>(slots);
+    planeOffsets = arena.take<size_t>(channels);
+    planeWidths = arena.take<int>(channels);
+    int* map = arena.take<int>(channels);
+    packetBuffers = arena.take<uint8_t>((size_t)kMaxBatch * kMaxPacketBytes);
+    IoVector* iov = arena.take<IoVector>(kMaxBatch);
+    PacketMessage* batch = arena.take<PacketMessage>(kMaxBatch);
+    lengths = arena.take<int>(kMaxBatch);
+    converters = arena.take<SampleConverter>(channels);
+    wireStaging = arena.take<uint8_t>((size_t)packetFrames * sampleBytes);
+    floatStaging = arena.take<float>(packetFrames);
+    if (!slotData || !slotStamps || !slotCaptureNs || !planeOffsets || !planeWidths || !map || !packetBuffers ||
+        !iov || !batch || !lengths || !converters || !wireStaging || !floatStaging) {
+        return fail("out of memory");
+    }
+    size_t offset = 0;
+    for (int i = 0; i < channels; i++) {
+        map[i] = config.channels[i];
+        planeWidths[i] = widths[i];
+        planeOffsets[i] = offset;
+        offset += StreamArena::bytesFor<uint8_t>((size_t)packetFrames * widths[i]);
+        converters[i] = getSampleConverter(format.inputTypes[map[i]]);
+    }
+    channelMap = map;
+    fromWire = getSampleConverter(wireType(config.encoding));
+    for (int p = 0; p < kMaxBatch; p++) {
+        setVector(iov[p], packetBuffers + (size_t)p * kMaxPacketBytes, kMaxPacketBytes);
+#ifndef _WIN32
+        msghdr& message = messageHeader(batch[p]);
+        message.msg_iov = &iov[p];
+        message.msg_iovlen = 1;
+#endif
+    }
+    vectors = iov;
+    messages = batch;
+
+    // A multicast group is joined on a socket bound to any address
+    sock = openSocket();
+    if (sock == kNoSocket) {
+        return fail("no socket: " + socketErrorText(lastSocketError()));
+    }
+    bool multicast = isMulticast(address.sin_addr);
+    int reuse = 1;
+    int receiveBuffer = 1 << 20;
+    setOption(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    setOption(sock, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+#ifdef _WIN32
+    DWORD timeout = kWakeMs;
+#else
+    timeval timeout = { 0, kWakeMs * 1000 };
+#endif
+    setOption(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in local = address;
+    if (multicast) {
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+    }
+    if (bind((SocketHandle)sock, (const sockaddr*)&local, sizeof(local)) != 0) {
+        return fail("could not bind " + config.address + ":" + std::to_string(config.port) + ": " +
+                    socketErrorText(lastSocketError()));
+    }
+    if (multicast) {
+        ip_mreq group = {};
+        group.imr_multiaddr = address.sin_addr;
+        group.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (!setOption(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group))) {
+            return fail("could not join " + config.address + ": " + socketErrorText(lastSocketError()));
+        }
+    }
+    socklen_t localBytes = sizeof(local);
+    getsockname((SocketHandle)sock, (sockaddr*)&local, &localBytes);
+    port = ntohs(local.sin_port);
+
+    stopReason.clear();
+    quit.store(false, std::memory_order_relaxed);
+    haveSource = false;
+    epoch = 0;
+    lostBefore = 0;
+    expectedBefore = 0;
+    jitter = 0.0;
+    haveTransit = false;
+    newest.store(0, std::memory_order_relaxed);
+    played.store(0, std::memory_order_relaxed);
+    epochSeen = 0;
+    priming = true;
+    dryEnd = 0;
+    primingNow.store(true, std::memory_order_relaxed);
+    blocks.store(0, std::memory_order_relaxed);
+    missingFrames.store(0, std::memory_order_relaxed);
+    underruns.store(0, std::memory_order_relaxed);
+    resyncs.store(0, std::memory_order_relaxed);
+    lastFill.store(0, std::memory_order_relaxed);
+    playoutCount.store(0, std::memory_order_relaxed);
+    playoutSumNs.store(0, std::memory_order_relaxed);
+    playoutMaxNs.store(0, std::memory_order_relaxed);
+    packets.store(0, std::memory_order_relaxed);
+    bytesReceived.store(0, std::memory_order_relaxed);
+    receiveCalls.store(0, std::memory_order_relaxed);
+    lost.store(0, std::memory_order_relaxed);
+    expected.store(0, std::memory_order_relaxed);
+    late.store(0, std::memory_order_relaxed);
+    duplicates.store(0, std::memory_order_relaxed);
+    malformed.store(0, std::memory_order_relaxed);
+    restarts.store(0, std::memory_order_relaxed);
+    jitterFrames.store(0.0, std::memory_order_relaxed);
+    timedPackets.store(0, std::memory_order_relaxed);
+    transitSumNs.store(0, std::memory_order_relaxed);
+    transitMaxNs.store(0, std::memory_order_relaxed);
+    socketError.store(0, std::memory_order_relaxed);
+    receiver = std::thread(&RtpReceiver::receiverLoop, this);
+
+    armed.store(true);
+    receiving = true;
+    return true;
+}
+
+void RtpReceiver::stop() {
+    if (!receiving) {
+        return;
+    }
+    armed.store(false);
+    while (inProcess.load()) {
+        std::this_thread::yield();
+    }
+    // The receive timeout brings the thread round to see quit
+    quit.store(true, std::memory_order_release);
+    receiver.join();
+    closeSocket(sock);
+    sock = kNoSocket;
+    receiving = false;
+}
+
+void RtpReceiver::receiverLoop() {
+    while (!quit.load(std::memory_order_acquire)) {
+        int count = receiveBatch();
+        int64_t arrivalNs = (int64_t)CallbackStats::now();
+        for (int p = 0; p < count; p++) {
+            handlePacket(packetBuffers + (size_t)p * kMaxPacketBytes, lengths[p], arrivalNs);
+        }
+    }
+}
+
+int RtpReceiver::receiveBatch() {
+    int count;
+#ifdef __linux__
+    // Waits for the first packet, then takes whatever else is queued
+    PacketMessage* batch = (PacketMessage*)messages;
+    count = recvmmsg((SocketHandle)sock, batch, kMaxBatch, MSG_WAITFORONE, nullptr);
+    for (int p = 0; p < count; p++) {
+        lengths[p] = (batch[p].msg_hdr.msg_flags & MSG_TRUNC) ? kMaxPacketBytes + 1 : (int)batch[p].msg_len;
+    }
+#else
+    count = (int)recv((SocketHandle)sock, (char*)packetBuffers, kMaxPacketBytes, 0);
+    if (count >= 0) {
+        lengths[0] = count;
+        count = 1;
+    }
+#endif
+    if (count < 0) {
+        int error = lastSocketError();
+#ifdef _WIN32
+        if (error == WSAEMSGSIZE) {
+            malformed.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+#endif
+        if (!isTimeout(error)) {
+            int none = 0;
+            socketError.compare_exchange_strong(none, error, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::milliseconds(kWakeMs));
+        }
+        return 0;
+    }
+    receiveCalls.fetch_add(1, std::memory_order_relaxed);
+    return count;
+}
+
+void RtpReceiver::handlePacket(const uint8_t* data, int length, int64_t arrivalNs) {
+    if (length < kRtpHeaderBytes || length > kMaxPacketBytes || (data[0] >> 6) != 2 ||
+        (data[1] & 0x7f) != config.payloadType) {
+        malformed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    int received = length;
+    if (data[0] & 0x20) {
+        length -= data[length - 1];     // Padding
+    }
+    int offset = kRtpHeaderBytes + 4 * (data[0] & 0x0f);
+    int64_t captureNs = 0;
+    if ((data[0] & 0x10) && offset + 4 <= length) {
+        int end = offset + 4 + 4 * (int)get16(data + offset + 2);
+        if (get16(data + offset) == 0xBEDE) {
+            // One-byte elements: ID and length - 1 in a byte, then the data
+            for (int i = offset + 4; i < end && end <= length;) {
+                if (data[i] == 0) {
+                    i++;
+                    continue;
+                }
+                int id = data[i] >> 4;
+                int size = (data[i] & 0x0f) + 1;
+                if (id == 15) break;
+                if (id == kCaptureTimeId && size == 8 && i + 9 <= end) {
+                    captureNs = (int64_t)get64(data + i + 1);
+                }
+                i += 1 + size;
+            }
+        }
+        offset = end;
+    } else if (data[0] & 0x10) {
+        offset = length + 1;
+    }
+    if (length - offset != payloadBytes) {
+        malformed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Timestamps extend to 64 bits from the newest one seen. A new source,
+    // or a jump further than the slots reach, starts a new timeline.
+    uint16_t seq = (uint16_t)get16(data + 2);
+    uint32_t timestamp = get32(data + 4);
+    uint32_t packetSsrc = get32(data + 8);
+    int64_t reach = (int64_t)(slotMask + 1) * packetFrames;
+    int64_t time = newestTime + (int32_t)(timestamp - newestRtpTime);
+    if (!haveSource || packetSsrc != sourceSsrc || time - newestTime > reach || newestTime - time > reach) {
+        restart(packetSsrc, seq, timestamp);
+        time = newestTime;
+    }
+
+    // RFC 3550 A.1: expected from the highest sequence number seen,
+    // counting wraps; reordered and duplicate packets do not move it
+    uint16_t ahead = (uint16_t)(seq - maxSeq);
+    if (ahead < 0x8000) {
+        if (seq < maxSeq) {
+            seqCycles += 65536;
+        }
+        maxSeq = seq;
+    }
+    epochReceived++;
+    uint64_t epochExpected = seqCycles + maxSeq - baseSeq + 1;
+    uint64_t epochLost = epochExpected > epochReceived ? epochExpected - epochReceived : 0;
+    expected.store(expectedBefore + epochExpected, std::memory_order_relaxed);
+    lost.store(lostBefore + epochLost, std::memory_order_relaxed);
+
+    // RFC 3550 6.4.1 interarrival jitter, in frames
+    double transit = (double)arrivalNs * rate / 1e9 - (double)time;
+    if (haveTransit) {
+        jitter += (std::fabs(transit - lastTransit) - jitter) / 16.0;
+        jitterFrames.store(jitter, std::memory_order_relaxed);
+    }
+    lastTransit = transit;
+    haveTransit = true;
+
+    if (captureNs > 0) {
+        timedPackets.fetch_add(1, std::memory_order_relaxed);
+        transitSumNs.fetch_add(arrivalNs - captureNs, std::memory_order_relaxed);
+        keepMax(transitMaxNs, arrivalNs - captureNs);
+    }
+    if (time > newestTime) {
+        newestTime = time;
+        newestRtpTime = timestamp;
+    }
+
+    int64_t position = time - origin;
+    if (position >= 0 && position % packetFrames != 0) {
+        malformed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    int64_t index = position / packetFrames;
+    uint64_t playedTo = played.load(std::memory_order_acquire);
+    if (position < 0 || ((playedTo >> kEpochShift) == epoch && index < (int64_t)(playedTo & kCountMask))) {
+        late.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (!store(index, data + offset, captureNs)) {
+        duplicates.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    packets.fetch_add(1, std::memory_order_relaxed);
+    bytesReceived.fetch_add(received, std::memory_order_relaxed);
+}
+
+void RtpReceiver::restart(uint32_t packetSsrc, uint16_t seq, uint32_t timestamp) {
+    if (haveSource) {
+        restarts.fetch_add(1, std::memory_order_relaxed);
+        lostBefore = lost.load(std::memory_order_relaxed);
+        expectedBefore = expected.load(std::memory_order_relaxed);
+    }
+    haveSource = true;
+    sourceSsrc = packetSsrc;
+    epoch++;
+    origin = timestamp;
+    newestTime = timestamp;
+    newestRtpTime = timestamp;
+    newestIndex = 0;
+    baseSeq = seq;
+    maxSeq = seq;
+    seqCycles = 0;
+    epochReceived = 0;
+    haveTransit = false;
+    newest.store((uint64_t)epoch << kEpochShift, std::memory_order_release);
+}
+
+bool RtpReceiver::store(int64_t index, const uint8_t* payload, int64_t captureNs) {
+    uint32_t slot = (uint32_t)index & slotMask;
+    uint64_t stamp = ((uint64_t)epoch << kEpochShift) | (uint64_t)(index + 1);
+    if (slotStamps[slot].load(std::memory_order_relaxed) == stamp) {
+        return false;
+    }
+    // Seqlock write: the callback sees the slot in flux until the new
+    // stamp lands, and rejects a copy that overlapped it
+    slotStamps[slot].store(kWritingStamp, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    uint8_t* data = slotData + slot * slotBytes;
+    int frameBytes = channels * sampleBytes;
+    for (int i = 0; i < channels; i++) {
+        deinterleave(payload + i * sampleBytes, wireStaging, packetFrames, sampleBytes, frameBytes);
+        fromWire.toFloat(wireStaging, floatStaging, packetFrames);
+        converters[i].fromFloat(floatStaging, data + planeOffsets[i], packetFrames);
+    }
+    slotCaptureNs[slot] = captureNs;
+    slotStamps[slot].store(stamp, std::memory_order_release);
+    if (index + 1 > newestIndex) {
+        newestIndex = index + 1;
+        newest.store(stamp, std::memory_order_release);
+    }
+    return true;
+}
+
+void RtpReceiver::feed(const StreamBlock& block) {
+    // Sequentially consistent with stop(), as in DiskRecorder
+    inProcess.store(true);
+    if (armed.load()) {
+        play(block);
+    }
+    inProcess.store(false, std::memory_order_release);
+}
+
+void RtpReceiver::playSilence(const StreamBlock& block, int start, int frames) {
+    // Zero bytes are silence in every sample format
+    for (int i = 0; i < channels; i++) {
+        memset((uint8_t*)block.inputs[channelMap[i]] + (size_t)start * planeWidths[i], 0,
+               (size_t)frames * planeWidths[i]);
+    }
+}
+
+void RtpReceiver::play(const StreamBlock& block) {
+    int frames = block.frames;
+    blocks.fetch_add(1, std::memory_order_relaxed);
+    uint64_t head = newest.load(std::memory_order_acquire);
+    uint32_t headEpoch = (uint32_t)(head >> kEpochShift);
+    int64_t end = (int64_t)(head & kCountMask) * packetFrames;
+    if (headEpoch != epochSeen) {
+        epochSeen = headEpoch;
+        priming = true;
+        dryEnd = 0;
+    }
+    // Priming waits for a packet newer than any already played
+    if (priming) {
+        if (end == 0 || head == dryEnd) {
+            playSilence(block, 0, frames);
+            return;
+        }
+        priming = false;
+        primingNow.store(false, std::memory_order_relaxed);
+        playPosition = end - targetFrames;
+    }
+    int64_t fill = end - playPosition;
+    if (fill <= 0) {
+        priming = true;
+        dryEnd = head;
+        primingNow.store(true, std::memory_order_relaxed);
+        underruns.fetch_add(1, std::memory_order_relaxed);
+        missingFrames.fetch_add(frames, std::memory_order_relaxed);
+        lastFill.store(0, std::memory_order_relaxed);
+        playSilence(block, 0, frames);
+        return;
+    }
+    if (fill > maxFrames) {
+        playPosition = end - targetFrames;
+        fill = targetFrames;
+        resyncs.fetch_add(1, std::memory_order_relaxed);
+    }
+    lastFill.store(fill, std::memory_order_relaxed);
+
+    bool timed = false;
+    for (int done = 0; done < frames;) {
+        int64_t position = playPosition + done;
+        if (position < 0) {
+            int count = (int)std::min<int64_t>(frames - done, -position);
+            playSilence(block, done, count);
+            missingFrames.fetch_add(count, std::memory_order_relaxed);
+            done += count;
+            continue;
+        }
+        int64_t index = position / packetFrames;
+        int offset = (int)(position - index * packetFrames);
+        int count = std::min(frames - done, packetFrames - offset);
+        uint32_t slot = (uint32_t)index & slotMask;
+        uint64_t stamp = ((uint64_t)epochSeen << kEpochShift) | (uint64_t)(index + 1);
+        bool valid = slotStamps[slot].load(std::memory_order_acquire) == stamp;
+        int64_t captureNs = 0;
+        if (valid) {
+            const uint8_t* data = slotData + slot * slotBytes;
+            for (int i = 0; i < channels; i++) {
+                int width = planeWidths[i];
+                memcpy((uint8_t*)block.inputs[channelMap[i]] + (size_t)done * width,
+                       data + planeOffsets[i] + (size_t)offset * width, (size_t)count * width);
+            }
+            captureNs = slotCaptureNs[slot];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            valid = slotStamps[slot].load(std::memory_order_relaxed) == stamp;
+        }
+        if (!valid) {
+            playSilence(block, done, count);
+            missingFrames.fetch_add(count, std::memory_order_relaxed);
+        } else if (!timed && captureNs > 0) {
+            // From the callback that sent the packet to this one
+            int64_t latency = block.callbackNs - captureNs;
+            playoutCount.fetch_add(1, std::memory_order_relaxed);
+            playoutSumNs.fetch_add(latency, std::memory_order_relaxed);
+            keepMax(playoutMaxNs, latency);
+            timed = true;
+        }
+        done += count;
+    }
+    playPosition += frames;
+    played.store(((uint64_t)epochSeen << kEpochShift) | (uint64_t)std::max<int64_t>(playPosition / packetFrames, 0),
+                 std::memory_order_release);
+}
+
+RtpReceiveReport RtpReceiver::getReport() const {
+    RtpReceiveReport r;
+    r.receiving = receiving;
+    r.port = port;
+    r.channels = channels;
+    r.sampleRate = rate;
+    r.encoding = encodingName(config.encoding);
+    r.packetFrames = packetFrames;
+    r.packets = packets.load(std::memory_order_relaxed);
+    r.bytes = bytesReceived.load(std::memory_order_relaxed);
+    r.receiveCalls = receiveCalls.load(std::memory_order_relaxed);
+    r.lost = lost.load(std::memory_order_relaxed);
+    r.late = late.load(std::memory_order_relaxed);
+    r.duplicates = duplicates.load(std::memory_order_relaxed);
+    r.malformed = malformed.load(std::memory_order_relaxed);
+    r.restarts = restarts.load(std::memory_order_relaxed);
+    uint64_t expectedPackets = expected.load(std::memory_order_relaxed);
+    r.lossPercent = expectedPackets > 0 ? r.lost * 100.0 / expectedPackets : 0.0;
+    r.jitterMs = rate > 0.0 ? jitterFrames.load(std::memory_order_relaxed) * 1000.0 / rate : 0.0;
+    r.timedPackets = timedPackets.load(std::memory_order_relaxed);
+    r.transitMeanMs = r.timedPackets > 0 ? transitSumNs.load(std::memory_order_relaxed) / 1e6 / r.timedPackets : 0.0;
+    r.transitMaxMs = transitMaxNs.load(std::memory_order_relaxed) / 1e6;
+    uint64_t timedBlocks = playoutCount.load(std::memory_order_relaxed);
+    r.playoutMeanMs = timedBlocks > 0 ? playoutSumNs.load(std::memory_order_relaxed) / 1e6 / timedBlocks : 0.0;
+    r.playoutMaxMs = playoutMaxNs.load(std::memory_order_relaxed) / 1e6;
+    r.blocks = blocks.load(std::memory_order_relaxed);
+    r.missingFrames = missingFrames.load(std::memory_order_relaxed);
+    r.underruns = underruns.load(std::memory_order_relaxed);
+    r.resyncs = resyncs.load(std::memory_order_relaxed);
+    r.fillMs = rate > 0.0 ? lastFill.load(std::memory_order_relaxed) * 1000.0 / rate : 0.0;
+    r.priming = primingNow.load(std::memory_order_relaxed);
+    r.error = stopReason;
+    int error = socketError.load(std::memory_order_relaxed);
+    if (error != 0) {
+        r.error = "receive failed: " + socketErrorText(error);
+    }
+    return r;
+}
+
+std::string RtpReceiver::formatText(const RtpReceiveReport& r) {
+    if (r.port == 0) {
+        return r.error.empty() ? "Not receiving\n" : "Not receiving: " + r.error + "\n";
+    }
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "%s on port %d%s\n"
+             "%d channels, %s at %.0f Hz, %d frames per packet\n"
+             "%llu packets, %.1f MB in %llu receive calls; %llu lost (%.2f%%), %llu late, %llu duplicate, "
+             "%llu malformed, %llu restarts\n"
+             "Jitter %.3f ms; buffer %.2f ms ahead; %llu underruns, %llu resyncs, %.3f s played as silence\n",
+             r.receiving ? "Receiving" : "Received", r.port, r.priming && r.receiving ? " (waiting for packets)" : "",
+             r.channels, r.encoding, r.sampleRate, r.packetFrames,
+             (unsigned long long)r.packets, r.bytes / 1048576.0, (unsigned long long)r.receiveCalls,
+             (unsigned long long)r.lost, r.lossPercent, (unsigned long long)r.late,
+             (unsigned long long)r.duplicates, (unsigned long long)r.malformed, (unsigned long long)r.restarts,
+             r.jitterMs, r.fillMs, (unsigned long long)r.underruns, (unsigned long long)r.resyncs,
+             r.sampleRate > 0 ? r.missingFrames / r.sampleRate : 0.0);
+    std::string text = buf;
+    if (r.timedPackets > 0) {
+        snprintf(buf, sizeof(buf), "Latency: capture to arrival %.3f ms mean, %.3f max; to the mix %.3f ms mean, %.3f max\n",
+                 r.transitMeanMs, r.transitMaxMs, r.playoutMeanMs, r.playoutMaxMs);
+        text += buf;
+    }
+    if (!r.error.empty()) {
+        text += "Stopped: " + r.error + "\n";
+    }
+    return text;
+}
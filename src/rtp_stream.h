@@ -0,0 +1,368 @@
+#pragma once
+
+#include "sample_convert.h"
+#include "spsc_ring.h"
+#include "stream_arena.h"
+#include "stream_tap.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum RtpEncoding {
+    RtpL24 = 0,     // 24-bit big-endian PCM, AES67's format
+    RtpL16          // 16-bit big-endian PCM
+};
+
+struct RtpSendConfig {
+    std::string address = "239.69.0.1";     // IPv4 destination, unicast or multicast
+    int port = 5004;
+    std::vector<int> channels;              // Host outputs sent, in packet order
+    RtpEncoding encoding = RtpL24;
+    double packetMs = 1.0;                  // AES67 packet time; 0.125, 0.25 and 4 ms are also used
+    int payloadType = 96;                   // Dynamic
+    int ttl = 16;                           // Multicast hops
+    int dscp = 34;                          // AF41, AES67's class for media
+    bool sendCaptureTimes = true;           // Capture time of each packet in a header extension
+    double ringSeconds = 0.1;               // Audio the ring holds while the sender is held up
+};
+
+struct RtpSendReport {
+    bool sending;
+    std::string destination;    // address:port
+    int channels;
+    double sampleRate;
+    const char* encoding;
+    int packetFrames;
+    uint32_t ssrc;
+    uint64_t packets;
+    uint64_t bytes;             // RTP headers and payload
+    uint64_t sendCalls;         // System calls made; packets / sendCalls is the batching achieved
+    uint64_t sendErrors;        // Packets the socket refused
+    uint64_t overruns;          // Blocks the callback dropped because the ring was full
+    uint64_t droppedFrames;     // Frames in those blocks; the timestamps skip over them
+    double ringPeakPercent;     // Fullest the sender has found the ring
+    std::string error;
+};
+
+struct RtpReceiveConfig {
+    std::string address = "0.0.0.0";       // Local address to bind, or a multicast group to join
+    int port = 5004;                        // 0 = any free port, see getPort()
+    std::vector<int> channels;              // Host inputs the stream's channels replace, in packet order
+    RtpEncoding encoding = RtpL24;
+    double packetMs = 1.0;                  // As the sender sends
+    int payloadType = 96;
+    double jitterMs = 2.0;                  // Held back beyond one block: network jitter and the sender's block
+    double bufferMs = 40.0;                 // Most the jitter buffer holds before it resyncs
+};
+
+struct RtpReceiveReport {
+    bool receiving;
+    int port;
+    int channels;
+    double sampleRate;
+    const char* encoding;
+    int packetFrames;
+    uint64_t packets;           // Stored in the jitter buffer
+    uint64_t bytes;
+    uint64_t receiveCalls;      // System calls that returned packets
+    uint64_t lost;              // Sequence numbers never seen
+    uint64_t late;              // Arrived after their audio was played
+    uint64_t duplicates;
+    uint64_t malformed;         // Not RTP, or the wrong payload type, size or alignment
+    uint64_t restarts;          // New sources or timeline jumps that restarted the buffer
+    double lossPercent;
+    double jitterMs;            // RFC 3550 interarrival jitter
+    uint64_t timedPackets;      // Packets that carried a capture time
+    double transitMeanMs;       // Capture to arrival
+    double transitMaxMs;
+    double playoutMeanMs;       // Capture to the callback that mixes it
+    double playoutMaxMs;
+    uint64_t blocks;
+    uint64_t missingFrames;     // Played as silence for lack of a packet
+    uint64_t underruns;         // Times the buffer ran dry and primed again
+    uint64_t resyncs;           // Times it held more than bufferMs and skipped ahead
+    double fillMs;              // Buffered ahead of playout at the latest block
+    bool priming;
+    std::string error;
+};
+
+// Sends output channels of a host stream to the network as RTP over UDP,
+// L24 or L16 at an AES67-style packet time. The tap's process() only
+// copies the chosen outputs' driver buffers into a lock-free SPSC ring and
+// wakes the sender thread through a futex when it sleeps. The sender
+// converts whole batches of packets at once, big-endian and interleaved,
+// straight into preallocated payload buffers; each packet goes out as a
+// header and a payload gathered by the kernel, and a batch is one
+// sendmmsg() call on Linux (one sendmsg / WSASendTo per packet elsewhere).
+//
+// With sendCaptureTimes, each packet carries the steady-clock time of the
+// callback that delivered its first frame, in an RFC 8285 header
+// extension that other receivers ignore. A receiver on the same machine
+// turns it into per-packet latency.
+//
+// The callback never waits for the sender: a block that does not fit in
+// the ring is dropped and counted. Register the tap with the host once,
+// then start() and stop() from the control thread after the host has
+// created its buffers. A buffer size change keeps sending; any other
+// format change stops it.
+class RtpSender : public StreamTap {
+public:
+    RtpSender() = default;
+    ~RtpSender() override;
+    RtpSender(const RtpSender&) = delete;
+    RtpSender& operator=(const RtpSender&) = delete;
+
+    // StreamTap
+    void prepare(const StreamFormat& format) override;
+    void process(const StreamBlock& block) override;
+
+    // Control thread. start() fails if the host has no buffers, a channel
+    // does not exist, a packet would not fit one datagram, or the socket
+    // cannot be set up; the report says why.
+    bool start(const RtpSendConfig& config);
+    void stop();
+    bool isSending() const { return sending; }
+
+    RtpSendReport getReport() const;
+    static std::string formatText(const RtpSendReport& report);
+
+private:
+    // Callback time of the block that starts at a ring position
+    struct BlockStamp {
+        uint64_t position;
+        int64_t ns;
+    };
+    // Frames the callback dropped, owed to the timeline at a ring position
+    struct Gap {
+        uint64_t position;
+        uint64_t frames;
+    };
+    static const uint32_t kMaxStamps = 64;
+    static const uint32_t kMaxGaps = 64;
+    static const int kMaxBatch = 32;
+
+    bool matches(const StreamFormat& format) const;
+    void capture(const StreamBlock& block);
+    void drop(int frames);
+    bool fail(const std::string& reason);
+
+    // Sender thread
+    void senderLoop();
+    void sendAvailable();
+    int64_t captureTime(uint64_t position);
+    void sendBatch(int count);
+
+    // Control thread
+    StreamFormat format;
+    bool haveFormat = false;
+    RtpSendConfig config;
+    bool sending = false;
+    std::string stopReason;
+    StreamArena arena;
+    std::thread sender;
+    intptr_t sock = -1;
+    int channels = 0;
+    double rate = 0.0;
+    int packetFrames = 0;
+    int sampleBytes = 0;                // Per sample on the wire
+    int headerBytes = 0;
+    int payloadBytes = 0;
+    uint32_t ssrc = 0;
+
+    SpscRing ring;
+
+    // Driver's thread
+    alignas(StreamArena::kCacheLine) const int* channelMap = nullptr;
+    const void** sources = nullptr;
+    uint64_t pendingGap = 0;
+    std::atomic<bool> armed{false};
+    std::atomic<bool> inProcess{false};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> droppedFrames{0};
+    BlockStamp* stamps = nullptr;
+    std::atomic<uint32_t> stampsWritten{0};
+    Gap* gaps = nullptr;
+    std::atomic<uint32_t> gapsWritten{0};
+    std::atomic<uint32_t> blocksWritten{0};     // Futex word the sender sleeps on
+    std::atomic<uint32_t> senderWaiting{0};
+
+    // Sender thread
+    alignas(StreamArena::kCacheLine) std::atomic<uint32_t> stampsRead{0};
+    std::atomic<uint32_t> gapsRead{0};
+    std::atomic<bool> quit{false};
+    BlockStamp lastStamp = {};
+    bool haveStamp = false;
+    SampleConverter* converters = nullptr;
+    FromFloatFn toWire = nullptr;
+    void** rawStaging = nullptr;
+    float** floatStaging = nullptr;
+    uint8_t** wireStaging = nullptr;
+    uint8_t* headers = nullptr;         // kMaxBatch headers, headerBytes apart
+    uint8_t* payloads = nullptr;        // kMaxBatch payloads, payloadBytes apart
+    void* vectors = nullptr;            // Header and payload of each packet, for the gather
+    void* messages = nullptr;           // One per packet, batched where the OS can
+    void* destination = nullptr;
+    uint16_t sequence = 0;
+    uint32_t rtpOrigin = 0;             // Timestamp of the stream's first frame
+    uint64_t gapFrames = 0;             // Dropped frames the read position has passed
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<uint64_t> sendCalls{0};
+    std::atomic<uint64_t> sendErrors{0};
+    std::atomic<int> ringPeak{0};
+    std::atomic<int> socketError{0};    // First failed send
+};
+
+// Receives an RTP stream from RtpSender or another AES67-style sender and
+// plays it into input channels of a host stream, so the routing mixes it
+// like any driver input. A receiver thread takes packets off the socket in
+// batches (recvmmsg() on Linux), checks them, converts each to the input
+// channels' driver formats and stores it in a jitter buffer: a ring of
+// packet slots indexed by RTP timestamp, each with a stamp naming the
+// packet it holds. The tap's feed() copies the slots for its block into
+// the input buffers before the mix, checking each stamp before and after
+// the copy, so a slot the receiver rewrote meanwhile plays as silence
+// rather than torn audio. Nothing is locked and the receiver never waits.
+//
+// Playout starts jitterMs plus one block behind the newest packet. Frames
+// whose packet is missing play as silence; a buffer that runs dry primes
+// again when packets return, and one that holds more than bufferMs (the
+// sender's clock running fast) skips ahead. Sender and host clocks are
+// assumed locked, as AES67 requires of its devices. Loss, reordering and
+// jitter follow RFC 3550; latency needs capture times from a sender on
+// the same clock, i.e. this machine.
+//
+// Register the tap with the host once, then start() and stop() from the
+// control thread after the host has created its buffers. Any format
+// change stops it.
+class RtpReceiver : public StreamTap {
+public:
+    static const int kWakeMs = 50;      // Receive timeout, so stop() is seen
+
+    RtpReceiver() = default;
+    ~RtpReceiver() override;
+    RtpReceiver(const RtpReceiver&) = delete;
+    RtpReceiver& operator=(const RtpReceiver&) = delete;
+
+    // StreamTap
+    void prepare(const StreamFormat& format) override;
+    void feed(const StreamBlock& block) override;
+    void process(const StreamBlock& block) override { (void)block; }
+
+    // Control thread. start() fails if the host has no buffers, a channel
+    // does not exist or the socket cannot be bound; the report says why.
+    bool start(const RtpReceiveConfig& config);
+    void stop();
+    bool isReceiving() const { return receiving; }
+    int getPort() const { return port; }    // Bound port, once started
+
+    RtpReceiveReport getReport() const;
+    static std::string formatText(const RtpReceiveReport& report);
+
+private:
+    static const int kMaxBatch = 32;
+    static const int kMaxPacketBytes = 1500;
+    static const int kEpochShift = 40;      // Epoch above, packet count below
+
+    bool matches(const StreamFormat& format) const;
+    void play(const StreamBlock& block);
+    void playSilence(const StreamBlock& block, int start, int frames);
+    bool fail(const std::string& reason);
+
+    // Receiver thread
+    void receiverLoop();
+    int receiveBatch();
+    void handlePacket(const uint8_t* data, int length, int64_t arrivalNs);
+    void restart(uint32_t packetSsrc, uint16_t seq, uint32_t timestamp);
+    bool store(int64_t index, const uint8_t* payload, int64_t captureNs);
+
+    // Control thread
+    StreamFormat format;
+    bool haveFormat = false;
+    RtpReceiveConfig config;
+    bool receiving = false;
+    std::string stopReason;
+    StreamArena arena;
+    std::thread receiver;
+    intptr_t sock = -1;
+    int port = 0;
+    int channels = 0;
+    double rate = 0.0;
+    int packetFrames = 0;
+    int sampleBytes = 0;
+    int payloadBytes = 0;
+    int targetFrames = 0;
+    int maxFrames = 0;
+    uint32_t slotMask = 0;
+    size_t slotBytes = 0;
+
+    // Jitter buffer, shared: slot contents are published by their stamps
+    uint8_t* slotData = nullptr;
+    size_t* planeOffsets = nullptr;     // Each channel's plane within a slot
+    int* planeWidths = nullptr;         // Bytes per frame of each channel's input
+    std::atomic<uint64_t>* slotStamps = nullptr;
+    int64_t* slotCaptureNs = nullptr;
+    std::atomic<uint64_t> newest{0};    // Epoch, and the end of the newest packet stored
+    std::atomic<uint64_t> played{0};    // Epoch, and the first packet not yet fully played
+
+    // Driver's thread
+    alignas(StreamArena::kCacheLine) const int* channelMap = nullptr;
+    std::atomic<bool> armed{false};
+    std::atomic<bool> inProcess{false};
+    uint32_t epochSeen = 0;
+    bool priming = true;
+    uint64_t dryEnd = 0;                // Newest packet when the buffer ran dry
+    int64_t playPosition = 0;           // Frames since the epoch's first packet
+    std::atomic<bool> primingNow{true};
+    std::atomic<uint64_t> blocks{0};
+    std::atomic<uint64_t> missingFrames{0};
+    std::atomic<uint64_t> underruns{0};
+    std::atomic<uint64_t> resyncs{0};
+    std::atomic<int64_t> lastFill{0};
+    std::atomic<uint64_t> playoutCount{0};
+    std::atomic<int64_t> playoutSumNs{0};
+    std::atomic<int64_t> playoutMaxNs{0};
+
+    // Receiver thread
+    alignas(StreamArena::kCacheLine) std::atomic<bool> quit{false};
+    uint8_t* packetBuffers = nullptr;   // kMaxBatch datagrams
+    void* vectors = nullptr;
+    void* messages = nullptr;
+    int* lengths = nullptr;
+    SampleConverter fromWire = {};
+    SampleConverter* converters = nullptr;
+    uint8_t* wireStaging = nullptr;     // One channel of a packet, as sent
+    float* floatStaging = nullptr;
+    bool haveSource = false;
+    uint32_t sourceSsrc = 0;
+    uint32_t epoch = 0;
+    int64_t origin = 0;                 // Extended timestamp of the epoch's packet 0
+    int64_t newestTime = 0;             // Highest extended timestamp seen
+    uint32_t newestRtpTime = 0;
+    int64_t newestIndex = 0;            // End of the newest packet stored
+    uint16_t maxSeq = 0;
+    uint32_t seqCycles = 0;
+    uint32_t baseSeq = 0;
+    uint64_t epochReceived = 0;
+    uint64_t lostBefore = 0;            // Lost and expected in earlier epochs
+    uint64_t expectedBefore = 0;
+    double jitter = 0.0;                // In frames
+    double lastTransit = 0.0;
+    bool haveTransit = false;
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> bytesReceived{0};
+    std::atomic<uint64_t> receiveCalls{0};
+    std::atomic<uint64_t> lost{0};
+    std::atomic<uint64_t> expected{0};
+    std::atomic<uint64_t> late{0};
+    std::atomic<uint64_t> duplicates{0};
+    std::atomic<uint64_t> malformed{0};
+    std::atomic<uint64_t> restarts{0};
+    std::atomic<double> jitterFrames{0.0};
+    std::atomic<uint64_t> timedPackets{0};
+    std::atomic<int64_t> transitSumNs{0};
+    std::atomic<int64_t> transitMaxNs{0};
+    std::atomic<int> socketError{0};
+};
@@ -0,0 +1,304 @@
+#include "sample_convert_impl.h"
+#include <atomic>
+
+#if ASIO_HOST_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+template <ASIOSampleType Type>
+static void meterBlockScalar(const void* src, int count, BlockLevel* level) {
+    float peak = 0.0f, sumSquares = 0.0f;
+    meterScalar<Type>(src, count, peak, sumSquares);
+    level->peak = peak;
+    level->sumSquares = sumSquares;
+}
+
+template <ASIOSampleType Type>
+static void toFloatMeteredBlockScalar(const void* src, float* dst, int count, BlockLevel* level) {
+    float peak = 0.0f, sumSquares = 0.0f;
+    toFloatMeteredScalar<Type>(src, dst, count, peak, sumSquares);
+    level->peak = peak;
+    level->sumSquares = sumSquares;
+}
+
+template <ASIOSampleType Type>
+static void fromFloatMeteredBlockScalar(const float* src, void* dst, int count, BlockLevel* level) {
+    float peak = 0.0f, sumSquares = 0.0f;
+    fromFloatMeteredScalar<Type>(src, dst, count, peak, sumSquares);
+    level->peak = peak;
+    level->sumSquares = sumSquares;
+}
+
+template <ASIOSampleType Type>
+static SampleConverter makeScalarConverter() {
+    SampleConverter conv;
+    conv.toFloat = &toFloatScalar<Type>;
+    conv.accumulate = &accumulateScalar<Type>;
+    conv.toFloatScaled = &toFloatScaledScalar<Type>;
+    conv.accumulateScaled = &accumulateScaledScalar<Type>;
+    conv.fromFloat = &fromFloatScalar<Type>;
+    conv.meter = &meterBlockScalar<Type>;
+    conv.toFloatMetered = &toFloatMeteredBlockScalar<Type>;
+    conv.fromFloatMetered = &fromFloatMeteredBlockScalar<Type>;
+    return conv;
+}
+
+static SampleConverter getScalarConverter(ASIOSampleType type) {
+    switch (type) {
+        case ASIOSTInt16MSB:   return makeScalarConverter<ASIOSTInt16MSB>();
+        case ASIOSTInt24MSB:   return makeScalarConverter<ASIOSTInt24MSB>();
+        case ASIOSTInt32MSB:   return makeScalarConverter<ASIOSTInt32MSB>();
+        case ASIOSTFloat32MSB: return makeScalarConverter<ASIOSTFloat32MSB>();
+        case ASIOSTFloat64MSB: return makeScalarConverter<ASIOSTFloat64MSB>();
+        case ASIOSTInt32MSB16: return makeScalarConverter<ASIOSTInt32MSB16>();
+        case ASIOSTInt32MSB18: return makeScalarConverter<ASIOSTInt32MSB18>();
+        case ASIOSTInt32MSB20: return makeScalarConverter<ASIOSTInt32MSB20>();
+        case ASIOSTInt32MSB24: return makeScalarConverter<ASIOSTInt32MSB24>();
+        case ASIOSTInt16LSB:   return makeScalarConverter<ASIOSTInt16LSB>();
+        case ASIOSTInt24LSB:   return makeScalarConverter<ASIOSTInt24LSB>();
+        case ASIOSTFloat32LSB: return makeScalarConverter<ASIOSTFloat32LSB>();
+        case ASIOSTFloat64LSB: return makeScalarConverter<ASIOSTFloat64LSB>();
+        case ASIOSTInt32LSB16: return makeScalarConverter<ASIOSTInt32LSB16>();
+        case ASIOSTInt32LSB18: return makeScalarConverter<ASIOSTInt32LSB18>();
+        case ASIOSTInt32LSB20: return makeScalarConverter<ASIOSTInt32LSB20>();
+        case ASIOSTInt32LSB24: return makeScalarConverter<ASIOSTInt32LSB24>();
+        default:
+            // Unknown types: assume 32-bit int LSB as fallback
+            return makeScalarConverter<ASIOSTInt32LSB>();
+    }
+}
+
+static void mixInt16Scalar(const void* const* inputs, int numInputs, void* dst, int count) {
+    mixIntegerScalar<int16_t, int32_t>(inputs, numInputs, dst, 0, count);
+}
+
+static void mixInt32Scalar(const void* const* inputs, int numInputs, void* dst, int count) {
+    mixIntegerScalar<int32_t, int64_t>(inputs, numInputs, dst, 0, count);
+}
+
+static void rampLinearBlockScalar(const float* src, float* dst, float start, float step, int count) {
+    rampLinearScalar(src, dst, start, step, 0, count);
+}
+
+static void rampPowerBlockScalar(const float* src, float* dst, float start, float step, int count) {
+    rampPowerScalar(src, dst, start, step, 0, count);
+}
+
+static bool isSilentBlockScalar(const void* buffer, int bytes) {
+    return isSilentScalar(buffer, 0, bytes);
+}
+
+#if ASIO_HOST_X86
+static void cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i = 0; i < 4; i++) regs[i] = (unsigned int)r[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long readXCR0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+#endif
+
+static SimdLevel probeSimdLevel() {
+#if ASIO_HOST_X86
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    unsigned int maxLeaf = regs[0];
+
+    cpuid(1, 0, regs);
+    bool sse2 = (regs[3] & (1u << 26)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+
+    if (!sse2) {
+        return SimdScalar;
+    }
+
+    // AVX2 needs the OS to save YMM state as well as the CPU feature bit
+    if (maxLeaf >= 7 && osxsave && avx && (readXCR0() & 0x6) == 0x6) {
+        cpuid(7, 0, regs);
+        if (regs[1] & (1u << 5)) {
+            return SimdAVX2;
+        }
+    }
+    return SimdSSE2;
+#else
+    return SimdScalar;
+#endif
+}
+
+static std::atomic<int> activeLevel(-1);
+
+SimdLevel detectSimdLevel() {
+    static const SimdLevel detected = probeSimdLevel();
+    return detected;
+}
+
+SimdLevel getSimdLevel() {
+    int level = activeLevel.load(std::memory_order_relaxed);
+    if (level < 0) {
+        return detectSimdLevel();
+    }
+    return (SimdLevel)level;
+}
+
+void setSimdLevel(SimdLevel level) {
+    if (level > detectSimdLevel()) {
+        level = detectSimdLevel();
+    }
+    activeLevel.store(level, std::memory_order_relaxed);
+}
+
+int getSampleBytes(ASIOSampleType type) {
+    switch (type) {
+        case ASIOSTInt16MSB:
+        case ASIOSTInt16LSB:
+            return 2;
+        case ASIOSTInt24MSB:
+        case ASIOSTInt24LSB:
+            return 3;
+        case ASIOSTFloat64MSB:
+        case ASIOSTFloat64LSB:
+            return 8;
+        default:
+            // Every 32-bit type, and the Int32LSB fallback for unknown types
+            return 4;
+    }
+}
+
+const char* getSimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdScalar: return "scalar";
+        case SimdSSE2:   return "sse2";
+        case SimdAVX2:   return "avx2";
+        default:         return "unknown";
+    }
+}
+
+SampleConverter getSampleConverter(ASIOSampleType type) {
+    return getSampleConverter(type, getSimdLevel());
+}
+
+// Kernels for blocks of frames samples, or the generic ones for 0
+static SampleConverter pickConverter(ASIOSampleType type, SimdLevel level, int frames) {
+    if (level > detectSimdLevel()) {
+        level = detectSimdLevel();
+    }
+
+    SampleConverter conv;
+    if (level >= SimdAVX2 && getSampleConverterAVX2(type, frames, &conv)) {
+        return conv;
+    }
+    if (level >= SimdSSE2 && getSampleConverterSSE2(type, frames, &conv)) {
+        return conv;
+    }
+    return getScalarConverter(type);
+}
+
+SampleConverter getSampleConverter(ASIOSampleType type, SimdLevel level) {
+    return pickConverter(type, level, 0);
+}
+
+bool hasFixedFrameKernels(int frames) {
+    return selectFrames(frames, [](auto n) { return decltype(n)::value != 0; });
+}
+
+static IntegerMixFn pickIntegerMixer(ASIOSampleType type, SimdLevel level, int frames) {
+    if (level > detectSimdLevel()) {
+        level = detectSimdLevel();
+    }
+
+    IntegerMixFn fn = nullptr;
+    if (level >= SimdAVX2 && (fn = getIntegerMixerAVX2(type, frames)) != nullptr) {
+        return fn;
+    }
+    if (level >= SimdSSE2 && (fn = getIntegerMixerSSE2(type, frames)) != nullptr) {
+        return fn;
+    }
+    switch (type) {
+        case ASIOSTInt16LSB: return &mixInt16Scalar;
+        case ASIOSTInt32LSB: return &mixInt32Scalar;
+        default:             return nullptr;
+    }
+}
+
+IntegerMixFn getIntegerMixer(ASIOSampleType type) {
+    return getIntegerMixer(type, getSimdLevel());
+}
+
+IntegerMixFn getIntegerMixer(ASIOSampleType type, SimdLevel level) {
+    return pickIntegerMixer(type, level, 0);
+}
+
+BlockConverter getBlockConverter(ASIOSampleType type, int frames) {
+    return getBlockConverter(type, getSimdLevel(), frames);
+}
+
+BlockConverter getBlockConverter(ASIOSampleType type, SimdLevel level, int frames) {
+    SampleConverter conv = pickConverter(type, level, frames);
+    BlockConverter block;
+    block.frames = frames;
+    block.toFloat = conv.toFloat;
+    block.accumulate = conv.accumulate;
+    block.toFloatScaled = conv.toFloatScaled;
+    block.accumulateScaled = conv.accumulateScaled;
+    block.fromFloat = conv.fromFloat;
+    block.meter = conv.meter;
+    block.toFloatMetered = conv.toFloatMetered;
+    block.fromFloatMetered = conv.fromFloatMetered;
+    block.integerMix = pickIntegerMixer(type, level, frames);
+    return block;
+}
+
+RampMixFn getRampMixer(RampShape shape) {
+    return getRampMixer(shape, getSimdLevel());
+}
+
+RampMixFn getRampMixer(RampShape shape, SimdLevel level) {
+    if (level > detectSimdLevel()) {
+        level = detectSimdLevel();
+    }
+
+    RampMixFn fn = nullptr;
+    if (level >= SimdAVX2 && (fn = getRampMixerAVX2(shape)) != nullptr) {
+        return fn;
+    }
+    if (level >= SimdSSE2 && (fn = getRampMixerSSE2(shape)) != nullptr) {
+        return fn;
+    }
+    return shape == RampEqualPower ? &rampPowerBlockScalar : &rampLinearBlockScalar;
+}
+
+SilenceCheckFn getSilenceCheck() {
+    return getSilenceCheck(getSimdLevel());
+}
+
+SilenceCheckFn getSilenceCheck(SimdLevel level) {
+    if (level > detectSimdLevel()) {
+        level = detectSimdLevel();
+    }
+
+    SilenceCheckFn fn = nullptr;
+    if (level >= SimdAVX2 && (fn = getSilenceCheckAVX2()) != nullptr) {
+        return fn;
+    }
+    if (level >= SimdSSE2 && (fn = getSilenceCheckSSE2()) != nullptr) {
+        return fn;
+    }
+    return &isSilentBlockScalar;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "asio_types.h"
+
+// Block converters between native ASIO sample formats and normalized float.
+// The widest instruction set supported by the CPU is picked on first use;
+// every level produces bit-identical output to the scalar SampleTraits path.
+
+// Convert count samples from src into dst
+typedef void (*ToFloatFn)(const void* src, float* dst, int count);
+
+// Convert count samples from src and add them into dst
+typedef void (*AccumulateFn)(const void* src, float* dst, int count);
+
+// Convert count samples from src, scale them by gain, and store (toFloat)
+// or add (accumulate) them into dst
+typedef void (*ScaledFn)(const void* src, float* dst, float gain, int count);
+
+// Clamp count floats to [-1, 1] and store them in the native format
+typedef void (*FromFloatFn)(const float* src, void* dst, int count);
+
+// Peak magnitude and sum of squares of one block, in float full scale
+struct BlockLevel {
+    float peak;
+    float sumSquares;
+};
+
+// Measure count samples without converting them
+typedef void (*MeterFn)(const void* src, int count, BlockLevel* level);
+
+// toFloat and fromFloat that measure the samples in the same pass;
+// fromFloat measures them after clamping, as they are stored
+typedef void (*ToFloatMeteredFn)(const void* src, float* dst, int count, BlockLevel* level);
+typedef void (*FromFloatMeteredFn)(const float* src, void* dst, int count, BlockLevel* level);
+
+enum SimdLevel {
+    SimdScalar = 0,
+    SimdSSE2,
+    SimdAVX2,
+    NumSimdLevels
+};
+
+// Sum numInputs same-format integer blocks into dst using a wider
+// accumulator, saturating once at the end. Exact: no float round trip.
+typedef void (*IntegerMixFn)(const void* const* inputs, int numInputs, void* dst, int count);
+
+// True if every byte of the block is zero (digital silence)
+typedef bool (*SilenceCheckFn)(const void* buffer, int bytes);
+
+// How a gain moves from one value to another
+enum RampShape {
+    RampLinear = 0,     // Gain changes by the same amount every sample
+    RampEqualPower      // Gain squared does, so loudness moves evenly in a crossfade
+};
+
+// Add count float samples into dst, scaled by a gain that ramps: sample i
+// is scaled by start + step * i (linear), or by the square root of that,
+// taken as at least 0 (equal power)
+typedef void (*RampMixFn)(const float* src, float* dst, float start, float step, int count);
+
+struct SampleConverter {
+    ToFloatFn toFloat;
+    AccumulateFn accumulate;
+    ScaledFn toFloatScaled;
+    ScaledFn accumulateScaled;
+    FromFloatFn fromFloat;
+    MeterFn meter;
+    ToFloatMeteredFn toFloatMetered;
+    FromFloatMeteredFn fromFloatMetered;
+};
+
+// Highest level the CPU and OS support
+SimdLevel detectSimdLevel();
+
+// Level used by getSampleConverter(type); defaults to detectSimdLevel()
+SimdLevel getSimdLevel();
+
+// Force a lower level (benchmarks, A/B checks). Clamped to what the CPU supports.
+void setSimdLevel(SimdLevel level);
+
+const char* getSimdLevelName(SimdLevel level);
+
+// Bytes per sample for a type, matching what its converter reads and writes
+int getSampleBytes(ASIOSampleType type);
+
+// Converter for a sample type at the active level
+SampleConverter getSampleConverter(ASIOSampleType type);
+
+// Converter for a sample type at a specific level (falls back to narrower
+// levels for formats the requested level does not specialize)
+SampleConverter getSampleConverter(ASIOSampleType type, SimdLevel level);
+
+// Integer mixer for a type at the active level, or nullptr if the type has
+// no integer path (Int16LSB and Int32LSB have one)
+IntegerMixFn getIntegerMixer(ASIOSampleType type);
+IntegerMixFn getIntegerMixer(ASIOSampleType type, SimdLevel level);
+
+// Converter and integer mixer for blocks of exactly frames samples. For the
+// common buffer sizes (powers of two from 32 to 1024) the SIMD levels have
+// kernels compiled for that length, which ignore their count argument and
+// always process frames samples; for other sizes, and at the scalar level,
+// these are the generic ones. Same bits either way. Being a type of their
+// own keeps them from being passed where a SampleConverter is taken: call
+// them with a count of frames and nothing else.
+struct BlockConverter {
+    int frames;
+    ToFloatFn toFloat;
+    AccumulateFn accumulate;
+    ScaledFn toFloatScaled;
+    ScaledFn accumulateScaled;
+    FromFloatFn fromFloat;
+    MeterFn meter;
+    ToFloatMeteredFn toFloatMetered;
+    FromFloatMeteredFn fromFloatMetered;
+    IntegerMixFn integerMix;    // nullptr if the type has no integer path
+};
+
+// Block kernels for a sample type at the active level, or a specific one
+BlockConverter getBlockConverter(ASIOSampleType type, int frames);
+BlockConverter getBlockConverter(ASIOSampleType type, SimdLevel level, int frames);
+// True if frames is one of the block lengths with kernels of its own
+bool hasFixedFrameKernels(int frames);
+
+// Ramped float accumulate at the active level
+RampMixFn getRampMixer(RampShape shape);
+RampMixFn getRampMixer(RampShape shape, SimdLevel level);
+
+// All-zero block check at the active level
+SilenceCheckFn getSilenceCheck();
+SilenceCheckFn getSilenceCheck(SimdLevel level);
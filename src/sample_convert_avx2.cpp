@@ -0,0 +1,554 @@
+#include "sample_convert_impl.h"
+
+#if ASIO_HOST_X86
+
+#include <immintrin.h>
+#include <cstring>
+
+// AVX2 block converters. Same structure as the SSE2 level with 8-wide
+// vectors, including the per-length instantiations; 24-bit samples and MSB
+// byte orders are handled with byte shuffles.
+
+namespace {
+
+ASIO_TARGET_AVX2 inline __m256 clampVector(__m256 v) {
+    // Operand order matches clampSample() so NaN clamps to +1 in both paths
+    v = _mm256_min_ps(v, _mm256_set1_ps(1.0f));
+    return _mm256_max_ps(v, _mm256_set1_ps(-1.0f));
+}
+
+// Running peak and sum of squares, as in the SSE2 level
+ASIO_TARGET_AVX2 inline void meterVector(__m256 v, __m256& peak, __m256& sumSquares) {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    peak = _mm256_max_ps(_mm256_and_ps(v, absMask), peak);
+    sumSquares = _mm256_add_ps(sumSquares, _mm256_mul_ps(v, v));
+}
+
+ASIO_TARGET_AVX2 inline void finishLevel(const __m256 peaks[4], const __m256 sums[4], BlockLevel* level) {
+    __m256 peak8 = _mm256_max_ps(_mm256_max_ps(peaks[0], peaks[1]), _mm256_max_ps(peaks[2], peaks[3]));
+    __m256 sum8 = _mm256_add_ps(_mm256_add_ps(sums[0], sums[1]), _mm256_add_ps(sums[2], sums[3]));
+    __m128 peak = _mm_max_ps(_mm256_castps256_ps128(peak8), _mm256_extractf128_ps(peak8, 1));
+    __m128 sumSquares = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+    peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+    peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, 1));
+    sumSquares = _mm_add_ps(sumSquares, _mm_movehl_ps(sumSquares, sumSquares));
+    sumSquares = _mm_add_ss(sumSquares, _mm_shuffle_ps(sumSquares, sumSquares, 1));
+    level->peak = _mm_cvtss_f32(peak);
+    level->sumSquares = _mm_cvtss_f32(sumSquares);
+}
+
+// Byte swaps within 16/32/64-bit lanes for the MSB formats
+ASIO_TARGET_AVX2 inline __m256i swapBytes16(__m256i x) {
+    const __m256i mask = _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    return _mm256_shuffle_epi8(x, mask);
+}
+
+ASIO_TARGET_AVX2 inline __m256i swapBytes32(__m256i x) {
+    const __m256i mask = _mm256_setr_epi8(
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    return _mm256_shuffle_epi8(x, mask);
+}
+
+ASIO_TARGET_AVX2 inline __m256i swapBytes64(__m256i x) {
+    const __m256i mask = _mm256_setr_epi8(
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    return _mm256_shuffle_epi8(x, mask);
+}
+
+template <ASIOSampleType Type, bool BigEndian>
+struct Int16Ops {
+    static const ASIOSampleType type = Type;
+    static const int width = 16;
+    static const int overread = 0;
+
+    ASIO_TARGET_AVX2 static void load(const void* src, int i, __m256 out[2]) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)((const int16_t*)src + i));
+        if (BigEndian) x = swapBytes16(x);
+        __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(x));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1));
+        const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+        out[0] = _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale);
+        out[1] = _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale);
+    }
+    ASIO_TARGET_AVX2 static void store(const __m256 in[2], void* dst, int i) {
+        const __m256 scale = _mm256_set1_ps(32767.0f);
+        __m256i lo = _mm256_cvttps_epi32(_mm256_mul_ps(in[0], scale));
+        __m256i hi = _mm256_cvttps_epi32(_mm256_mul_ps(in[1], scale));
+        // packs works per 128-bit lane; restore sample order afterwards
+        __m256i x = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        if (BigEndian) x = swapBytes16(x);
+        _mm256_storeu_si256((__m256i*)((int16_t*)dst + i), x);
+    }
+};
+
+template <ASIOSampleType Type, bool BigEndian>
+struct Int24Ops {
+    static const ASIOSampleType type = Type;
+    static const int width = 8;
+    // The upper 16-byte load ends 4 bytes past the 8th sample
+    static const int overread = 2;
+
+    ASIO_TARGET_AVX2 static void load(const void* src, int i, __m256 out[1]) {
+        const uint8_t* p = (const uint8_t*)src + i * 3;
+        __m256i x = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+            _mm_loadu_si128((const __m128i*)(p + 12)), 1);
+        // Place each 3-byte sample in the top of a 32-bit lane
+        const __m256i unpackLE = _mm256_setr_epi8(
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+        const __m256i unpackBE = _mm256_setr_epi8(
+            -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9,
+            -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+        x = _mm256_shuffle_epi8(x, BigEndian ? unpackBE : unpackLE);
+        x = _mm256_srai_epi32(x, 8);
+        out[0] = _mm256_mul_ps(_mm256_cvtepi32_ps(x), _mm256_set1_ps(1.0f / 8388608.0f));
+    }
+    ASIO_TARGET_AVX2 static void store(const __m256 in[1], void* dst, int i) {
+        __m256i x = _mm256_cvttps_epi32(_mm256_mul_ps(in[0], _mm256_set1_ps(8388607.0f)));
+        // Drop the top byte of each lane, packing 4 samples into 12 bytes
+        const __m256i packLE = _mm256_setr_epi8(
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        const __m256i packBE = _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        x = _mm256_shuffle_epi8(x, BigEndian ? packBE : packLE);
+        uint8_t* p = (uint8_t*)dst + i * 3;
+        storeLane12(p, _mm256_castsi256_si128(x));
+        storeLane12(p + 12, _mm256_extracti128_si256(x, 1));
+    }
+    ASIO_TARGET_AVX2 static void storeLane12(uint8_t* p, __m128i lane) {
+        _mm_storel_epi64((__m128i*)p, lane);
+        int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(lane, 8));
+        memcpy(p + 8, &last, 4);
+    }
+};
+
+// DataBits of signed data in a 32-bit container; 32 for plain Int32
+template <ASIOSampleType Type, int DataBits, bool BigEndian>
+struct Int32Ops {
+    static const ASIOSampleType type = Type;
+    static const int width = 8;
+    static const int overread = 0;
+    static const int shift = 32 - DataBits;
+
+    ASIO_TARGET_AVX2 static void load(const void* src, int i, __m256 out[1]) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)((const int32_t*)src + i));
+        if (BigEndian) x = swapBytes32(x);
+        if (shift) x = _mm256_srai_epi32(_mm256_slli_epi32(x, shift), shift);
+        const __m256 scale = _mm256_set1_ps(1.0f / (float)(1u << (DataBits - 1)));
+        out[0] = _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale);
+    }
+    ASIO_TARGET_AVX2 static void store(const __m256 in[1], void* dst, int i) {
+        __m256 v;
+        if (DataBits == 32) {
+            v = _mm256_min_ps(_mm256_mul_ps(in[0], _mm256_set1_ps(2147483648.0f)),
+                              _mm256_set1_ps(kInt32MaxFloat));
+        } else {
+            v = _mm256_mul_ps(in[0], _mm256_set1_ps((float)((1 << (DataBits - 1)) - 1)));
+        }
+        __m256i x = _mm256_cvttps_epi32(v);
+        if (BigEndian) x = swapBytes32(x);
+        _mm256_storeu_si256((__m256i*)((int32_t*)dst + i), x);
+    }
+};
+
+template <ASIOSampleType Type, bool BigEndian>
+struct Float32Ops {
+    static const ASIOSampleType type = Type;
+    static const int width = 8;
+    static const int overread = 0;
+
+    ASIO_TARGET_AVX2 static void load(const void* src, int i, __m256 out[1]) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)((const float*)src + i));
+        if (BigEndian) x = swapBytes32(x);
+        out[0] = _mm256_castsi256_ps(x);
+    }
+    ASIO_TARGET_AVX2 static void store(const __m256 in[1], void* dst, int i) {
+        __m256i x = _mm256_castps_si256(in[0]);
+        if (BigEndian) x = swapBytes32(x);
+        _mm256_storeu_si256((__m256i*)((float*)dst + i), x);
+    }
+};
+
+template <ASIOSampleType Type, bool BigEndian>
+struct Float64Ops {
+    static const ASIOSampleType type = Type;
+    static const int width = 8;
+    static const int overread = 0;
+
+    ASIO_TARGET_AVX2 static __m256d loadQuad(const double* p) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)p);
+        if (BigEndian) x = swapBytes64(x);
+        return _mm256_castsi256_pd(x);
+    }
+    ASIO_TARGET_AVX2 static void storeQuad(double* p, __m256d v) {
+        __m256i x = _mm256_castpd_si256(v);
+        if (BigEndian) x = swapBytes64(x);
+        _mm256_storeu_si256((__m256i*)p, x);
+    }
+    ASIO_TARGET_AVX2 static void load(const void* src, int i, __m256 out[1]) {
+        const double* p = (const double*)src + i;
+        __m128 lo = _mm256_cvtpd_ps(loadQuad(p));
+        __m128 hi = _mm256_cvtpd_ps(loadQuad(p + 4));
+        out[0] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+    }
+    ASIO_TARGET_AVX2 static void store(const __m256 in[1], void* dst, int i) {
+        double* p = (double*)dst + i;
+        storeQuad(p, _mm256_cvtps_pd(_mm256_castps256_ps128(in[0])));
+        storeQuad(p + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(in[0], 1)));
+    }
+};
+
+template <class Ops, int Frames>
+ASIO_TARGET_AVX2 void toFloatAVX2(const void* src, float* dst, int count) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 8;
+    int i = 0;
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m256 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            _mm256_storeu_ps(dst + i + k * 8, v[k]);
+        }
+    }
+    toFloatScalar<Ops::type>(sampleOffset<Ops::type>(src, i), dst + i, count - i);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_AVX2 void accumulateAVX2(const void* src, float* dst, int count) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 8;
+    int i = 0;
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m256 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            float* d = dst + i + k * 8;
+            _mm256_storeu_ps(d, _mm256_add_ps(_mm256_loadu_ps(d), v[k]));
+        }
+    }
+    accumulateScalar<Ops::type>(sampleOffset<Ops::type>(src, i), dst + i, count - i);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_AVX2 void toFloatScaledAVX2(const void* src, float* dst, float gain, int count) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 8;
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m256 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            _mm256_storeu_ps(dst + i + k * 8, _mm256_mul_ps(v[k], g));
+        }
+    }
+    toFloatScaledScalar<Ops::type>(sampleOffset<Ops::type>(src, i), dst + i, gain, count - i);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_AVX2 void accumulateScaledAVX2(const void* src, float* dst, float gain, int count) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 8;
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m256 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            float* d = dst + i + k * 8;
+            // Separate multiply and add (no FMA) to match the scalar rounding
+            _mm256_storeu_ps(d, _mm256_add_ps(_mm256_loadu_ps(d), _mm256_mul_ps(v[k], g)));
+        }
+    }
+    accumulateScaledScalar<Ops::type>(sampleOffset<Ops::type>(src, i), dst + i, gain, count - i);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_AVX2 void fromFloatAVX2(const float* src, void* dst, int count) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 8;
+    int i = 0;
+    for (; i + Ops::width <= count; i += Ops::width) {
+        __m256 v[vectors];
+        for (int k = 0; k < vectors; k++) {
+            v[k] = clampVector(_mm256_loadu_ps(src + i + k * 8));
+        }
+        Ops::store(v, dst, i);
+    }
+    fromFloatScalar<Ops::type>(src + i, sampleOffset<Ops::type>(dst, i), count - i);
+}
+
+// The metering loops take four vectors per step, each into its own
+// accumulator, so the max and add chains do not serialize the loop
+
+template <class Ops, int Frames>
+ASIO_TARGET_AVX2 void meterAVX2(const void* src, int count, BlockLevel* level) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 8;
+    const int steps = 4 / vectors;
+    __m256 peak[4], sumSquares[4];
+    for (int a = 0; a < 4; a++) {
+        peak[a] = sumSquares[a] = _mm256_setzero_ps();
+    }
+    int i = 0;
+    for (; i + steps * Ops::width + Ops::overread <= count; i += steps * Ops::width) {
+        for (int s = 0; s < steps; s++) {
+            __m256 v[vectors];
+            Ops::load(src, i + s * Ops::width, v);
+            for (int k = 0; k < vectors; k++) {
+                meterVector(v[k], peak[s * vectors + k], sumSquares[s * vectors + k]);
+            }
+        }
+    }
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m256 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            meterVector(v[k], peak[k], sumSquares[k]);
+        }
+    }
+    finishLevel(peak, sumSquares, level);
+    meterScalar<Ops::type>(sampleOffset<Ops::type>(src, i), count - i, level->peak, level->sumSquares);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_AVX2 void toFloatMeteredAVX2(const void* src, float* dst, int count, BlockLevel* level) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 8;
+    const int steps = 4 / vectors;
+    __m256 peak[4], sumSquares[4];
+    for (int a = 0; a < 4; a++) {
+        peak[a] = sumSquares[a] = _mm256_setzero_ps();
+    }
+    int i = 0;
+    for (; i + steps * Ops::width + Ops::overread <= count; i += steps * Ops::width) {
+        for (int s = 0; s < steps; s++) {
+            __m256 v[vectors];
+            Ops::load(src, i + s * Ops::width, v);
+            for (int k = 0; k < vectors; k++) {
+                _mm256_storeu_ps(dst + i + s * Ops::width + k * 8, v[k]);
+                meterVector(v[k], peak[s * vectors + k], sumSquares[s * vectors + k]);
+            }
+        }
+    }
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m256 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            _mm256_storeu_ps(dst + i + k * 8, v[k]);
+            meterVector(v[k], peak[k], sumSquares[k]);
+        }
+    }
+    finishLevel(peak, sumSquares, level);
+    toFloatMeteredScalar<Ops::type>(sampleOffset<Ops::type>(src, i), dst + i, count - i,
+                                    level->peak, level->sumSquares);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_AVX2 void fromFloatMeteredAVX2(const float* src, void* dst, int count, BlockLevel* level) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 8;
+    const int steps = 4 / vectors;
+    __m256 peak[4], sumSquares[4];
+    for (int a = 0; a < 4; a++) {
+        peak[a] = sumSquares[a] = _mm256_setzero_ps();
+    }
+    int i = 0;
+    for (; i + steps * Ops::width <= count; i += steps * Ops::width) {
+        for (int s = 0; s < steps; s++) {
+            __m256 v[vectors];
+            for (int k = 0; k < vectors; k++) {
+                v[k] = clampVector(_mm256_loadu_ps(src + i + s * Ops::width + k * 8));
+                meterVector(v[k], peak[s * vectors + k], sumSquares[s * vectors + k]);
+            }
+            Ops::store(v, dst, i + s * Ops::width);
+        }
+    }
+    for (; i + Ops::width <= count; i += Ops::width) {
+        __m256 v[vectors];
+        for (int k = 0; k < vectors; k++) {
+            v[k] = clampVector(_mm256_loadu_ps(src + i + k * 8));
+            meterVector(v[k], peak[k], sumSquares[k]);
+        }
+        Ops::store(v, dst, i);
+    }
+    finishLevel(peak, sumSquares, level);
+    fromFloatMeteredScalar<Ops::type>(src + i, sampleOffset<Ops::type>(dst, i), count - i,
+                                      level->peak, level->sumSquares);
+}
+
+template <class Ops, int Frames>
+SampleConverter makeConverter() {
+    SampleConverter conv;
+    conv.toFloat = &toFloatAVX2<Ops, Frames>;
+    conv.accumulate = &accumulateAVX2<Ops, Frames>;
+    conv.toFloatScaled = &toFloatScaledAVX2<Ops, Frames>;
+    conv.accumulateScaled = &accumulateScaledAVX2<Ops, Frames>;
+    conv.fromFloat = &fromFloatAVX2<Ops, Frames>;
+    conv.meter = &meterAVX2<Ops, Frames>;
+    conv.toFloatMetered = &toFloatMeteredAVX2<Ops, Frames>;
+    conv.fromFloatMetered = &fromFloatMeteredAVX2<Ops, Frames>;
+    return conv;
+}
+
+template <class Ops>
+SampleConverter makeConverterFor(int frames) {
+    return selectFrames(frames, [](auto n) { return makeConverter<Ops, decltype(n)::value>(); });
+}
+
+// Int16: sign-extend to 32-bit lanes, sum, and let packs saturate
+template <int Frames>
+ASIO_TARGET_AVX2 void mixInt16AVX2(const void* const* inputs, int numInputs, void* dst, int count) {
+    if (Frames) count = Frames;
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i lo = _mm256_setzero_si256();
+        __m256i hi = _mm256_setzero_si256();
+        for (int k = 0; k < numInputs; k++) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)((const int16_t*)inputs[k] + i));
+            lo = _mm256_add_epi32(lo, _mm256_cvtepi16_epi32(_mm256_castsi256_si128(x)));
+            hi = _mm256_add_epi32(hi, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1)));
+        }
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256((__m256i*)((int16_t*)dst + i), packed);
+    }
+    mixIntegerScalar<int16_t, int32_t>(inputs, numInputs, dst, i, count);
+}
+
+// Int32: sum in double lanes, which hold any realistic fan-in exactly
+template <int Frames>
+ASIO_TARGET_AVX2 void mixInt32AVX2(const void* const* inputs, int numInputs, void* dst, int count) {
+    if (Frames) count = Frames;
+    const __m256d lo = _mm256_set1_pd(-2147483648.0);
+    const __m256d hi = _mm256_set1_pd(2147483647.0);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256d a = _mm256_setzero_pd();
+        __m256d b = _mm256_setzero_pd();
+        for (int k = 0; k < numInputs; k++) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)((const int32_t*)inputs[k] + i));
+            a = _mm256_add_pd(a, _mm256_cvtepi32_pd(_mm256_castsi256_si128(x)));
+            b = _mm256_add_pd(b, _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)));
+        }
+        __m128i ra = _mm256_cvttpd_epi32(_mm256_max_pd(_mm256_min_pd(a, hi), lo));
+        __m128i rb = _mm256_cvttpd_epi32(_mm256_max_pd(_mm256_min_pd(b, hi), lo));
+        _mm256_storeu_si256((__m256i*)((int32_t*)dst + i),
+                            _mm256_inserti128_si256(_mm256_castsi128_si256(ra), rb, 1));
+    }
+    mixIntegerScalar<int32_t, int64_t>(inputs, numInputs, dst, i, count);
+}
+
+// Ramped accumulate, eight samples at a time, lane gains from the sample
+// index as in the scalar loop
+template <bool EqualPower>
+ASIO_TARGET_AVX2 void rampMixAVX2(const float* src, float* dst, float start, float step, int count) {
+    const __m256 vStart = _mm256_set1_ps(start);
+    const __m256 vStep = _mm256_set1_ps(step);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 gain = _mm256_add_ps(vStart, _mm256_mul_ps(vStep, _mm256_cvtepi32_ps(index)));
+        if (EqualPower) {
+            gain = _mm256_sqrt_ps(_mm256_max_ps(gain, _mm256_setzero_ps()));
+        }
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(src + i), gain);
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), x));
+        index = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+    }
+    if (EqualPower) {
+        rampPowerScalar(src, dst, start, step, i, count);
+    } else {
+        rampLinearScalar(src, dst, start, step, i, count);
+    }
+}
+
+// OR 128 bytes at a time and stop at the first non-zero chunk
+ASIO_TARGET_AVX2 bool isSilentAVX2(const void* buffer, int bytes) {
+    const uint8_t* p = (const uint8_t*)buffer;
+    int i = 0;
+    for (; i + 128 <= bytes; i += 128) {
+        __m256i a = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(p + i)),
+                                    _mm256_loadu_si256((const __m256i*)(p + i + 32)));
+        __m256i b = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(p + i + 64)),
+                                    _mm256_loadu_si256((const __m256i*)(p + i + 96)));
+        __m256i x = _mm256_or_si256(a, b);
+        if (!_mm256_testz_si256(x, x)) {
+            return false;
+        }
+    }
+    return isSilentScalar(buffer, i, bytes);
+}
+
+} // namespace
+
+SilenceCheckFn getSilenceCheckAVX2() {
+    return &isSilentAVX2;
+}
+
+IntegerMixFn getIntegerMixerAVX2(ASIOSampleType type, int frames) {
+    switch (type) {
+        case ASIOSTInt16LSB:
+            return selectFrames(frames, [](auto n) -> IntegerMixFn { return &mixInt16AVX2<decltype(n)::value>; });
+        case ASIOSTInt32LSB:
+            return selectFrames(frames, [](auto n) -> IntegerMixFn { return &mixInt32AVX2<decltype(n)::value>; });
+        default:
+            return nullptr;
+    }
+}
+
+RampMixFn getRampMixerAVX2(RampShape shape) {
+    return shape == RampEqualPower ? &rampMixAVX2<true> : &rampMixAVX2<false>;
+}
+
+bool getSampleConverterAVX2(ASIOSampleType type, int frames, SampleConverter* conv) {
+    switch (type) {
+        case ASIOSTInt16MSB:   *conv = makeConverterFor<Int16Ops<ASIOSTInt16MSB, true>>(frames); return true;
+        case ASIOSTInt24MSB:   *conv = makeConverterFor<Int24Ops<ASIOSTInt24MSB, true>>(frames); return true;
+        case ASIOSTInt32MSB:   *conv = makeConverterFor<Int32Ops<ASIOSTInt32MSB, 32, true>>(frames); return true;
+        case ASIOSTFloat32MSB: *conv = makeConverterFor<Float32Ops<ASIOSTFloat32MSB, true>>(frames); return true;
+        case ASIOSTFloat64MSB: *conv = makeConverterFor<Float64Ops<ASIOSTFloat64MSB, true>>(frames); return true;
+        case ASIOSTInt32MSB16: *conv = makeConverterFor<Int32Ops<ASIOSTInt32MSB16, 16, true>>(frames); return true;
+        case ASIOSTInt32MSB18: *conv = makeConverterFor<Int32Ops<ASIOSTInt32MSB18, 18, true>>(frames); return true;
+        case ASIOSTInt32MSB20: *conv = makeConverterFor<Int32Ops<ASIOSTInt32MSB20, 20, true>>(frames); return true;
+        case ASIOSTInt32MSB24: *conv = makeConverterFor<Int32Ops<ASIOSTInt32MSB24, 24, true>>(frames); return true;
+        case ASIOSTInt16LSB:   *conv = makeConverterFor<Int16Ops<ASIOSTInt16LSB, false>>(frames); return true;
+        case ASIOSTInt24LSB:   *conv = makeConverterFor<Int24Ops<ASIOSTInt24LSB, false>>(frames); return true;
+        case ASIOSTFloat32LSB: *conv = makeConverterFor<Float32Ops<ASIOSTFloat32LSB, false>>(frames); return true;
+        case ASIOSTFloat64LSB: *conv = makeConverterFor<Float64Ops<ASIOSTFloat64LSB, false>>(frames); return true;
+        case ASIOSTInt32LSB16: *conv = makeConverterFor<Int32Ops<ASIOSTInt32LSB16, 16, false>>(frames); return true;
+        case ASIOSTInt32LSB18: *conv = makeConverterFor<Int32Ops<ASIOSTInt32LSB18, 18, false>>(frames); return true;
+        case ASIOSTInt32LSB20: *conv = makeConverterFor<Int32Ops<ASIOSTInt32LSB20, 20, false>>(frames); return true;
+        case ASIOSTInt32LSB24: *conv = makeConverterFor<Int32Ops<ASIOSTInt32LSB24, 24, false>>(frames); return true;
+        default:
+            // Unknown types: assume 32-bit int LSB as fallback
+            *conv = makeConverterFor<Int32Ops<ASIOSTInt32LSB, 32, false>>(frames);
+            return true;
+    }
+}
+
+#else
+
+bool getSampleConverterAVX2(ASIOSampleType, int, SampleConverter*) {
+    return false;
+}
+
+IntegerMixFn getIntegerMixerAVX2(ASIOSampleType, int) {
+    return nullptr;
+}
+
+RampMixFn getRampMixerAVX2(RampShape) {
+    return nullptr;
+}
+
+SilenceCheckFn getSilenceCheckAVX2() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,166 @@
+#pragma once
+
+// Internal to the sample_convert*.cpp translation units.
+
+#include "sample_convert.h"
+#include "sample_format.h"
+#include "simd_target.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+// Scalar block converters, generated from the per-format traits. The SIMD
+// levels use these for the tail of a block that does not fill a vector.
+
+template <ASIOSampleType Type>
+static void toFloatScalar(const void* src, float* dst, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = SampleTraits<Type>::load(src, i);
+    }
+}
+
+template <ASIOSampleType Type>
+static void accumulateScalar(const void* src, float* dst, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] += SampleTraits<Type>::load(src, i);
+    }
+}
+
+template <ASIOSampleType Type>
+static void toFloatScaledScalar(const void* src, float* dst, float gain, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = SampleTraits<Type>::load(src, i) * gain;
+    }
+}
+
+template <ASIOSampleType Type>
+static void accumulateScaledScalar(const void* src, float* dst, float gain, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] += SampleTraits<Type>::load(src, i) * gain;
+    }
+}
+
+template <ASIOSampleType Type>
+static void fromFloatScalar(const float* src, void* dst, int count) {
+    for (int i = 0; i < count; i++) {
+        SampleTraits<Type>::store(clampSample(src[i]), dst, i);
+    }
+}
+
+// Scalar metering, folded into a running peak and sum of squares so the
+// SIMD levels can finish their blocks with it too. A NaN leaves the peak
+// as it was, as the vector max does.
+inline void meterSample(float x, float& peak, float& sumSquares) {
+    peak = std::max(peak, std::fabs(x));
+    sumSquares += x * x;
+}
+
+template <ASIOSampleType Type>
+static void meterScalar(const void* src, int count, float& peak, float& sumSquares) {
+    for (int i = 0; i < count; i++) {
+        meterSample(SampleTraits<Type>::load(src, i), peak, sumSquares);
+    }
+}
+
+template <ASIOSampleType Type>
+static void toFloatMeteredScalar(const void* src, float* dst, int count, float& peak, float& sumSquares) {
+    for (int i = 0; i < count; i++) {
+        float x = SampleTraits<Type>::load(src, i);
+        dst[i] = x;
+        meterSample(x, peak, sumSquares);
+    }
+}
+
+template <ASIOSampleType Type>
+static void fromFloatMeteredScalar(const float* src, void* dst, int count, float& peak, float& sumSquares) {
+    for (int i = 0; i < count; i++) {
+        float x = clampSample(src[i]);
+        SampleTraits<Type>::store(x, dst, i);
+        meterSample(x, peak, sumSquares);
+    }
+}
+
+// Scalar integer mix over samples [begin, end): sum in Wide, saturate to T
+template <typename T, typename Wide>
+static void mixIntegerScalar(const void* const* inputs, int numInputs, void* dst, int begin, int end) {
+    const Wide lo = (Wide)std::numeric_limits<T>::min();
+    const Wide hi = (Wide)std::numeric_limits<T>::max();
+    for (int i = begin; i < end; i++) {
+        Wide sum = 0;
+        for (int k = 0; k < numInputs; k++) {
+            sum += ((const T*)inputs[k])[i];
+        }
+        ((T*)dst)[i] = (T)std::max(lo, std::min(hi, sum));
+    }
+}
+
+// Scalar ramped accumulate over samples [begin, end). The gain of sample i
+// is computed from i itself, not stepped, so every level gets the same bits.
+static void rampLinearScalar(const float* src, float* dst, float start, float step, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        dst[i] += src[i] * (start + step * (float)i);
+    }
+}
+
+static void rampPowerScalar(const float* src, float* dst, float start, float step, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        dst[i] += src[i] * std::sqrt(std::max(start + step * (float)i, 0.0f));
+    }
+}
+
+// Scalar all-zero check over bytes [begin, bytes)
+static bool isSilentScalar(const void* buffer, int begin, int bytes) {
+    const uint8_t* p = (const uint8_t*)buffer;
+    uint64_t bits = 0;
+    int i = begin;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        bits |= word;
+    }
+    for (; i < bytes; i++) {
+        bits |= p[i];
+    }
+    return bits == 0;
+}
+
+// Byte offset of sample i in a buffer of the given type
+template <ASIOSampleType Type>
+inline const void* sampleOffset(const void* buffer, int i) {
+    return (const uint8_t*)buffer + i * SampleTraits<Type>::bytes;
+}
+
+template <ASIOSampleType Type>
+inline void* sampleOffset(void* buffer, int i) {
+    return (uint8_t*)buffer + i * SampleTraits<Type>::bytes;
+}
+
+// The block lengths the SIMD levels compile kernels for: calls
+// make(std::integral_constant<int, frames>) for one of them, and
+// make(std::integral_constant<int, 0>), the generic kernel, for any other
+template <class Make>
+auto selectFrames(int frames, Make make) -> decltype(make(std::integral_constant<int, 0>())) {
+    switch (frames) {
+        case 32:   return make(std::integral_constant<int, 32>());
+        case 64:   return make(std::integral_constant<int, 64>());
+        case 128:  return make(std::integral_constant<int, 128>());
+        case 256:  return make(std::integral_constant<int, 256>());
+        case 512:  return make(std::integral_constant<int, 512>());
+        case 1024: return make(std::integral_constant<int, 1024>());
+        default:   return make(std::integral_constant<int, 0>());
+    }
+}
+
+// Per-level tables, with kernels for blocks of frames samples (0 =
+// any). Each returns false for formats it does not specialize.
+bool getSampleConverterSSE2(ASIOSampleType type, int frames, SampleConverter* conv);
+bool getSampleConverterAVX2(ASIOSampleType type, int frames, SampleConverter* conv);
+IntegerMixFn getIntegerMixerSSE2(ASIOSampleType type, int frames);
+IntegerMixFn getIntegerMixerAVX2(ASIOSampleType type, int frames);
+RampMixFn getRampMixerSSE2(RampShape shape);
+RampMixFn getRampMixerAVX2(RampShape shape);
+SilenceCheckFn getSilenceCheckSSE2();
+SilenceCheckFn getSilenceCheckAVX2();
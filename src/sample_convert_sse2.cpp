@@ -0,0 +1,540 @@
+#include "sample_convert_impl.h"
+
+#if ASIO_HOST_X86
+
+#include <emmintrin.h>
+#include <cstring>
+
+// SSE2 block converters. Each format provides vector load/store ops over a
+// fixed number of samples; the generic loops below handle the block and
+// hand the remainder to the scalar traits.
+//
+// Each loop is also instantiated per block length (Frames, see
+// selectFrames). Those take Frames as the count, so the trip count is a
+// constant: short blocks unroll completely and the scalar tail folds away.
+// Frames = 0 is the generic loop.
+
+namespace {
+
+ASIO_TARGET_SSE2 inline __m128 clampVector(__m128 v) {
+    // Operand order matches clampSample() so NaN clamps to +1 in both paths
+    v = _mm_min_ps(v, _mm_set1_ps(1.0f));
+    return _mm_max_ps(v, _mm_set1_ps(-1.0f));
+}
+
+// Running peak and sum of squares, one of each per lane. The absolute
+// value goes first so a NaN sample leaves the peak alone, as meterSample()
+// does.
+ASIO_TARGET_SSE2 inline void meterVector(__m128 v, __m128& peak, __m128& sumSquares) {
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    peak = _mm_max_ps(_mm_and_ps(v, absMask), peak);
+    sumSquares = _mm_add_ps(sumSquares, _mm_mul_ps(v, v));
+}
+
+ASIO_TARGET_SSE2 inline void finishLevel(const __m128 peaks[4], const __m128 sums[4], BlockLevel* level) {
+    __m128 peak = _mm_max_ps(_mm_max_ps(peaks[0], peaks[1]), _mm_max_ps(peaks[2], peaks[3]));
+    __m128 sumSquares = _mm_add_ps(_mm_add_ps(sums[0], sums[1]), _mm_add_ps(sums[2], sums[3]));
+    peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+    peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, 1));
+    sumSquares = _mm_add_ps(sumSquares, _mm_movehl_ps(sumSquares, sumSquares));
+    sumSquares = _mm_add_ss(sumSquares, _mm_shuffle_ps(sumSquares, sumSquares, 1));
+    level->peak = _mm_cvtss_f32(peak);
+    level->sumSquares = _mm_cvtss_f32(sumSquares);
+}
+
+// Byte swaps within 16/32/64-bit lanes for the MSB formats
+ASIO_TARGET_SSE2 inline __m128i swapBytes16(__m128i x) {
+    return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+ASIO_TARGET_SSE2 inline __m128i swapBytes32(__m128i x) {
+    x = swapBytes16(x);
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+}
+
+ASIO_TARGET_SSE2 inline __m128i swapBytes64(__m128i x) {
+    return _mm_shuffle_epi32(swapBytes32(x), 0xB1);
+}
+
+template <ASIOSampleType Type, bool BigEndian>
+struct Int16Ops {
+    static const ASIOSampleType type = Type;
+    static const int width = 8;
+    static const int overread = 0;
+
+    ASIO_TARGET_SSE2 static void load(const void* src, int i, __m128 out[2]) {
+        __m128i x = _mm_loadu_si128((const __m128i*)((const int16_t*)src + i));
+        if (BigEndian) x = swapBytes16(x);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+        out[0] = _mm_mul_ps(_mm_cvtepi32_ps(lo), scale);
+        out[1] = _mm_mul_ps(_mm_cvtepi32_ps(hi), scale);
+    }
+    ASIO_TARGET_SSE2 static void store(const __m128 in[2], void* dst, int i) {
+        const __m128 scale = _mm_set1_ps(32767.0f);
+        __m128i lo = _mm_cvttps_epi32(_mm_mul_ps(in[0], scale));
+        __m128i hi = _mm_cvttps_epi32(_mm_mul_ps(in[1], scale));
+        __m128i x = _mm_packs_epi32(lo, hi);
+        if (BigEndian) x = swapBytes16(x);
+        _mm_storeu_si128((__m128i*)((int16_t*)dst + i), x);
+    }
+};
+
+template <ASIOSampleType Type, bool BigEndian>
+struct Int24Ops {
+    static const ASIOSampleType type = Type;
+    static const int width = 4;
+    // The last 32-bit load reads one byte of the following sample
+    static const int overread = 1;
+
+    ASIO_TARGET_SSE2 static void load(const void* src, int i, __m128 out[1]) {
+        const uint8_t* p = (const uint8_t*)src + i * 3;
+        int32_t w[4];
+        memcpy(&w[0], p, 4);
+        memcpy(&w[1], p + 3, 4);
+        memcpy(&w[2], p + 6, 4);
+        memcpy(&w[3], p + 9, 4);
+        __m128i x = _mm_loadu_si128((const __m128i*)w);
+        // Move the 24-bit payload to the top and shift back to sign extend
+        x = BigEndian ? swapBytes32(x) : _mm_slli_epi32(x, 8);
+        x = _mm_srai_epi32(x, 8);
+        out[0] = _mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(1.0f / 8388608.0f));
+    }
+    ASIO_TARGET_SSE2 static void store(const __m128 in[1], void* dst, int i) {
+        __m128i x = _mm_cvttps_epi32(_mm_mul_ps(in[0], _mm_set1_ps(8388607.0f)));
+        int32_t w[4];
+        _mm_storeu_si128((__m128i*)w, x);
+        uint8_t* p = (uint8_t*)dst + i * 3;
+        const int lo = BigEndian ? 2 : 0;
+        const int hi = BigEndian ? 0 : 2;
+        for (int k = 0; k < 4; k++) {
+            p[k * 3 + lo] = w[k] & 0xFF;
+            p[k * 3 + 1] = (w[k] >> 8) & 0xFF;
+            p[k * 3 + hi] = (w[k] >> 16) & 0xFF;
+        }
+    }
+};
+
+// DataBits of signed data in a 32-bit container; 32 for plain Int32
+template <ASIOSampleType Type, int DataBits, bool BigEndian>
+struct Int32Ops {
+    static const ASIOSampleType type = Type;
+    static const int width = 4;
+    static const int overread = 0;
+    static const int shift = 32 - DataBits;
+
+    ASIO_TARGET_SSE2 static void load(const void* src, int i, __m128 out[1]) {
+        __m128i x = _mm_loadu_si128((const __m128i*)((const int32_t*)src + i));
+        if (BigEndian) x = swapBytes32(x);
+        if (shift) x = _mm_srai_epi32(_mm_slli_epi32(x, shift), shift);
+        const __m128 scale = _mm_set1_ps(1.0f / (float)(1u << (DataBits - 1)));
+        out[0] = _mm_mul_ps(_mm_cvtepi32_ps(x), scale);
+    }
+    ASIO_TARGET_SSE2 static void store(const __m128 in[1], void* dst, int i) {
+        __m128 v;
+        if (DataBits == 32) {
+            v = _mm_min_ps(_mm_mul_ps(in[0], _mm_set1_ps(2147483648.0f)),
+                           _mm_set1_ps(kInt32MaxFloat));
+        } else {
+            v = _mm_mul_ps(in[0], _mm_set1_ps((float)((1 << (DataBits - 1)) - 1)));
+        }
+        __m128i x = _mm_cvttps_epi32(v);
+        if (BigEndian) x = swapBytes32(x);
+        _mm_storeu_si128((__m128i*)((int32_t*)dst + i), x);
+    }
+};
+
+template <ASIOSampleType Type, bool BigEndian>
+struct Float32Ops {
+    static const ASIOSampleType type = Type;
+    static const int width = 4;
+    static const int overread = 0;
+
+    ASIO_TARGET_SSE2 static void load(const void* src, int i, __m128 out[1]) {
+        __m128i x = _mm_loadu_si128((const __m128i*)((const float*)src + i));
+        if (BigEndian) x = swapBytes32(x);
+        out[0] = _mm_castsi128_ps(x);
+    }
+    ASIO_TARGET_SSE2 static void store(const __m128 in[1], void* dst, int i) {
+        __m128i x = _mm_castps_si128(in[0]);
+        if (BigEndian) x = swapBytes32(x);
+        _mm_storeu_si128((__m128i*)((float*)dst + i), x);
+    }
+};
+
+template <ASIOSampleType Type, bool BigEndian>
+struct Float64Ops {
+    static const ASIOSampleType type = Type;
+    static const int width = 4;
+    static const int overread = 0;
+
+    ASIO_TARGET_SSE2 static __m128d loadPair(const double* p) {
+        __m128i x = _mm_loadu_si128((const __m128i*)p);
+        if (BigEndian) x = swapBytes64(x);
+        return _mm_castsi128_pd(x);
+    }
+    ASIO_TARGET_SSE2 static void storePair(double* p, __m128d v) {
+        __m128i x = _mm_castpd_si128(v);
+        if (BigEndian) x = swapBytes64(x);
+        _mm_storeu_si128((__m128i*)p, x);
+    }
+    ASIO_TARGET_SSE2 static void load(const void* src, int i, __m128 out[1]) {
+        const double* p = (const double*)src + i;
+        __m128 lo = _mm_cvtpd_ps(loadPair(p));
+        __m128 hi = _mm_cvtpd_ps(loadPair(p + 2));
+        out[0] = _mm_movelh_ps(lo, hi);
+    }
+    ASIO_TARGET_SSE2 static void store(const __m128 in[1], void* dst, int i) {
+        double* p = (double*)dst + i;
+        storePair(p, _mm_cvtps_pd(in[0]));
+        storePair(p + 2, _mm_cvtps_pd(_mm_movehl_ps(in[0], in[0])));
+    }
+};
+
+template <class Ops, int Frames>
+ASIO_TARGET_SSE2 void toFloatSSE2(const void* src, float* dst, int count) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 4;
+    int i = 0;
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m128 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            _mm_storeu_ps(dst + i + k * 4, v[k]);
+        }
+    }
+    toFloatScalar<Ops::type>(sampleOffset<Ops::type>(src, i), dst + i, count - i);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_SSE2 void accumulateSSE2(const void* src, float* dst, int count) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 4;
+    int i = 0;
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m128 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            float* d = dst + i + k * 4;
+            _mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(d), v[k]));
+        }
+    }
+    accumulateScalar<Ops::type>(sampleOffset<Ops::type>(src, i), dst + i, count - i);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_SSE2 void toFloatScaledSSE2(const void* src, float* dst, float gain, int count) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 4;
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m128 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            _mm_storeu_ps(dst + i + k * 4, _mm_mul_ps(v[k], g));
+        }
+    }
+    toFloatScaledScalar<Ops::type>(sampleOffset<Ops::type>(src, i), dst + i, gain, count - i);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_SSE2 void accumulateScaledSSE2(const void* src, float* dst, float gain, int count) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 4;
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m128 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            float* d = dst + i + k * 4;
+            // Separate multiply and add (no FMA) to match the scalar rounding
+            _mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(d), _mm_mul_ps(v[k], g)));
+        }
+    }
+    accumulateScaledScalar<Ops::type>(sampleOffset<Ops::type>(src, i), dst + i, gain, count - i);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_SSE2 void fromFloatSSE2(const float* src, void* dst, int count) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 4;
+    int i = 0;
+    for (; i + Ops::width <= count; i += Ops::width) {
+        __m128 v[vectors];
+        for (int k = 0; k < vectors; k++) {
+            v[k] = clampVector(_mm_loadu_ps(src + i + k * 4));
+        }
+        Ops::store(v, dst, i);
+    }
+    fromFloatScalar<Ops::type>(src + i, sampleOffset<Ops::type>(dst, i), count - i);
+}
+
+// The metering loops take four vectors per step, each into its own
+// accumulator, so the max and add chains do not serialize the loop
+
+template <class Ops, int Frames>
+ASIO_TARGET_SSE2 void meterSSE2(const void* src, int count, BlockLevel* level) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 4;
+    const int steps = 4 / vectors;
+    __m128 peak[4], sumSquares[4];
+    for (int a = 0; a < 4; a++) {
+        peak[a] = sumSquares[a] = _mm_setzero_ps();
+    }
+    int i = 0;
+    for (; i + steps * Ops::width + Ops::overread <= count; i += steps * Ops::width) {
+        for (int s = 0; s < steps; s++) {
+            __m128 v[vectors];
+            Ops::load(src, i + s * Ops::width, v);
+            for (int k = 0; k < vectors; k++) {
+                meterVector(v[k], peak[s * vectors + k], sumSquares[s * vectors + k]);
+            }
+        }
+    }
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m128 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            meterVector(v[k], peak[k], sumSquares[k]);
+        }
+    }
+    finishLevel(peak, sumSquares, level);
+    meterScalar<Ops::type>(sampleOffset<Ops::type>(src, i), count - i, level->peak, level->sumSquares);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_SSE2 void toFloatMeteredSSE2(const void* src, float* dst, int count, BlockLevel* level) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 4;
+    const int steps = 4 / vectors;
+    __m128 peak[4], sumSquares[4];
+    for (int a = 0; a < 4; a++) {
+        peak[a] = sumSquares[a] = _mm_setzero_ps();
+    }
+    int i = 0;
+    for (; i + steps * Ops::width + Ops::overread <= count; i += steps * Ops::width) {
+        for (int s = 0; s < steps; s++) {
+            __m128 v[vectors];
+            Ops::load(src, i + s * Ops::width, v);
+            for (int k = 0; k < vectors; k++) {
+                _mm_storeu_ps(dst + i + s * Ops::width + k * 4, v[k]);
+                meterVector(v[k], peak[s * vectors + k], sumSquares[s * vectors + k]);
+            }
+        }
+    }
+    for (; i + Ops::width + Ops::overread <= count; i += Ops::width) {
+        __m128 v[vectors];
+        Ops::load(src, i, v);
+        for (int k = 0; k < vectors; k++) {
+            _mm_storeu_ps(dst + i + k * 4, v[k]);
+            meterVector(v[k], peak[k], sumSquares[k]);
+        }
+    }
+    finishLevel(peak, sumSquares, level);
+    toFloatMeteredScalar<Ops::type>(sampleOffset<Ops::type>(src, i), dst + i, count - i,
+                                    level->peak, level->sumSquares);
+}
+
+template <class Ops, int Frames>
+ASIO_TARGET_SSE2 void fromFloatMeteredSSE2(const float* src, void* dst, int count, BlockLevel* level) {
+    if (Frames) count = Frames;
+    const int vectors = Ops::width / 4;
+    const int steps = 4 / vectors;
+    __m128 peak[4], sumSquares[4];
+    for (int a = 0; a < 4; a++) {
+        peak[a] = sumSquares[a] = _mm_setzero_ps();
+    }
+    int i = 0;
+    for (; i + steps * Ops::width <= count; i += steps * Ops::width) {
+        for (int s = 0; s < steps; s++) {
+            __m128 v[vectors];
+            for (int k = 0; k < vectors; k++) {
+                v[k] = clampVector(_mm_loadu_ps(src + i + s * Ops::width + k * 4));
+                meterVector(v[k], peak[s * vectors + k], sumSquares[s * vectors + k]);
+            }
+            Ops::store(v, dst, i + s * Ops::width);
+        }
+    }
+    for (; i + Ops::width <= count; i += Ops::width) {
+        __m128 v[vectors];
+        for (int k = 0; k < vectors; k++) {
+            v[k] = clampVector(_mm_loadu_ps(src + i + k * 4));
+            meterVector(v[k], peak[k], sumSquares[k]);
+        }
+        Ops::store(v, dst, i);
+    }
+    finishLevel(peak, sumSquares, level);
+    fromFloatMeteredScalar<Ops::type>(src + i, sampleOffset<Ops::type>(dst, i), count - i,
+                                      level->peak, level->sumSquares);
+}
+
+template <class Ops, int Frames>
+SampleConverter makeConverter() {
+    SampleConverter conv;
+    conv.toFloat = &toFloatSSE2<Ops, Frames>;
+    conv.accumulate = &accumulateSSE2<Ops, Frames>;
+    conv.toFloatScaled = &toFloatScaledSSE2<Ops, Frames>;
+    conv.accumulateScaled = &accumulateScaledSSE2<Ops, Frames>;
+    conv.fromFloat = &fromFloatSSE2<Ops, Frames>;
+    conv.meter = &meterSSE2<Ops, Frames>;
+    conv.toFloatMetered = &toFloatMeteredSSE2<Ops, Frames>;
+    conv.fromFloatMetered = &fromFloatMeteredSSE2<Ops, Frames>;
+    return conv;
+}
+
+template <class Ops>
+SampleConverter makeConverterFor(int frames) {
+    return selectFrames(frames, [](auto n) { return makeConverter<Ops, decltype(n)::value>(); });
+}
+
+// Int16: sign-extend to 32-bit lanes, sum, and let packs saturate
+template <int Frames>
+ASIO_TARGET_SSE2 void mixInt16SSE2(const void* const* inputs, int numInputs, void* dst, int count) {
+    if (Frames) count = Frames;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        for (int k = 0; k < numInputs; k++) {
+            __m128i x = _mm_loadu_si128((const __m128i*)((const int16_t*)inputs[k] + i));
+            lo = _mm_add_epi32(lo, _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+            hi = _mm_add_epi32(hi, _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+        }
+        _mm_storeu_si128((__m128i*)((int16_t*)dst + i), _mm_packs_epi32(lo, hi));
+    }
+    mixIntegerScalar<int16_t, int32_t>(inputs, numInputs, dst, i, count);
+}
+
+// Int32: sum in double lanes, which hold any realistic fan-in exactly
+template <int Frames>
+ASIO_TARGET_SSE2 void mixInt32SSE2(const void* const* inputs, int numInputs, void* dst, int count) {
+    if (Frames) count = Frames;
+    const __m128d lo = _mm_set1_pd(-2147483648.0);
+    const __m128d hi = _mm_set1_pd(2147483647.0);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128d a = _mm_setzero_pd();
+        __m128d b = _mm_setzero_pd();
+        for (int k = 0; k < numInputs; k++) {
+            __m128i x = _mm_loadu_si128((const __m128i*)((const int32_t*)inputs[k] + i));
+            a = _mm_add_pd(a, _mm_cvtepi32_pd(x));
+            b = _mm_add_pd(b, _mm_cvtepi32_pd(_mm_shuffle_epi32(x, 0xEE)));
+        }
+        __m128i ra = _mm_cvttpd_epi32(_mm_max_pd(_mm_min_pd(a, hi), lo));
+        __m128i rb = _mm_cvttpd_epi32(_mm_max_pd(_mm_min_pd(b, hi), lo));
+        _mm_storeu_si128((__m128i*)((int32_t*)dst + i), _mm_unpacklo_epi64(ra, rb));
+    }
+    mixIntegerScalar<int32_t, int64_t>(inputs, numInputs, dst, i, count);
+}
+
+// Ramped accumulate, four samples at a time. Lane gains come from the
+// sample index as in the scalar loop, so the bits match.
+template <bool EqualPower>
+ASIO_TARGET_SSE2 void rampMixSSE2(const float* src, float* dst, float start, float step, int count) {
+    const __m128 vStart = _mm_set1_ps(start);
+    const __m128 vStep = _mm_set1_ps(step);
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 gain = _mm_add_ps(vStart, _mm_mul_ps(vStep, _mm_cvtepi32_ps(index)));
+        if (EqualPower) {
+            gain = _mm_sqrt_ps(_mm_max_ps(gain, _mm_setzero_ps()));
+        }
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(src + i), gain);
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), x));
+        index = _mm_add_epi32(index, _mm_set1_epi32(4));
+    }
+    if (EqualPower) {
+        rampPowerScalar(src, dst, start, step, i, count);
+    } else {
+        rampLinearScalar(src, dst, start, step, i, count);
+    }
+}
+
+// OR 64 bytes at a time and stop at the first non-zero chunk; audio that
+// is not silent almost always fails on the first one
+ASIO_TARGET_SSE2 bool isSilentSSE2(const void* buffer, int bytes) {
+    const uint8_t* p = (const uint8_t*)buffer;
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 64 <= bytes; i += 64) {
+        __m128i a = _mm_or_si128(_mm_loadu_si128((const __m128i*)(p + i)),
+                                 _mm_loadu_si128((const __m128i*)(p + i + 16)));
+        __m128i b = _mm_or_si128(_mm_loadu_si128((const __m128i*)(p + i + 32)),
+                                 _mm_loadu_si128((const __m128i*)(p + i + 48)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(a, b), zero)) != 0xFFFF) {
+            return false;
+        }
+    }
+    return isSilentScalar(buffer, i, bytes);
+}
+
+} // namespace
+
+SilenceCheckFn getSilenceCheckSSE2() {
+    return &isSilentSSE2;
+}
+
+IntegerMixFn getIntegerMixerSSE2(ASIOSampleType type, int frames) {
+    switch (type) {
+        case ASIOSTInt16LSB:
+            return selectFrames(frames, [](auto n) -> IntegerMixFn { return &mixInt16SSE2<decltype(n)::value>; });
+        case ASIOSTInt32LSB:
+            return selectFrames(frames, [](auto n) -> IntegerMixFn { return &mixInt32SSE2<decltype(n)::value>; });
+        default:
+            return nullptr;
+    }
+}
+
+RampMixFn getRampMixerSSE2(RampShape shape) {
+    return shape == RampEqualPower ? &rampMixSSE2<true> : &rampMixSSE2<false>;
+}
+
+bool getSampleConverterSSE2(ASIOSampleType type, int frames, SampleConverter* conv) {
+    switch (type) {
+        case ASIOSTInt16MSB:   *conv = makeConverterFor<Int16Ops<ASIOSTInt16MSB, true>>(frames); return true;
+        case ASIOSTInt24MSB:   *conv = makeConverterFor<Int24Ops<ASIOSTInt24MSB, true>>(frames); return true;
+        case ASIOSTInt32MSB:   *conv = makeConverterFor<Int32Ops<ASIOSTInt32MSB, 32, true>>(frames); return true;
+        case ASIOSTFloat32MSB: *conv = makeConverterFor<Float32Ops<ASIOSTFloat32MSB, true>>(frames); return true;
+        case ASIOSTFloat64MSB: *conv = makeConverterFor<Float64Ops<ASIOSTFloat64MSB, true>>(frames); return true;
+        case ASIOSTInt32MSB16: *conv = makeConverterFor<Int32Ops<ASIOSTInt32MSB16, 16, true>>(frames); return true;
+        case ASIOSTInt32MSB18: *conv = makeConverterFor<Int32Ops<ASIOSTInt32MSB18, 18, true>>(frames); return true;
+        case ASIOSTInt32MSB20: *conv = makeConverterFor<Int32Ops<ASIOSTInt32MSB20, 20, true>>(frames); return true;
+        case ASIOSTInt32MSB24: *conv = makeConverterFor<Int32Ops<ASIOSTInt32MSB24, 24, true>>(frames); return true;
+        case ASIOSTInt16LSB:   *conv = makeConverterFor<Int16Ops<ASIOSTInt16LSB, false>>(frames); return true;
+        case ASIOSTInt24LSB:   *conv = makeConverterFor<Int24Ops<ASIOSTInt24LSB, false>>(frames); return true;
+        case ASIOSTFloat32LSB: *conv = makeConverterFor<Float32Ops<ASIOSTFloat32LSB, false>>(frames); return true;
+        case ASIOSTFloat64LSB: *conv = makeConverterFor<Float64Ops<ASIOSTFloat64LSB, false>>(frames); return true;
+        case ASIOSTInt32LSB16: *conv = makeConverterFor<Int32Ops<ASIOSTInt32LSB16, 16, false>>(frames); return true;
+        case ASIOSTInt32LSB18: *conv = makeConverterFor<Int32Ops<ASIOSTInt32LSB18, 18, false>>(frames); return true;
+        case ASIOSTInt32LSB20: *conv = makeConverterFor<Int32Ops<ASIOSTInt32LSB20, 20, false>>(frames); return true;
+        case ASIOSTInt32LSB24: *conv = makeConverterFor<Int32Ops<ASIOSTInt32LSB24, 24, false>>(frames); return true;
+        default:
+            // Unknown types: assume 32-bit int LSB as fallback
+            *conv = makeConverterFor<Int32Ops<ASIOSTInt32LSB, 32, false>>(frames);
+            return true;
+    }
+}
+
+#else
+
+bool getSampleConverterSSE2(ASIOSampleType, int, SampleConverter*) {
+    return false;
+}
+
+IntegerMixFn getIntegerMixerSSE2(ASIOSampleType, int) {
+    return nullptr;
+}
+
+RampMixFn getRampMixerSSE2(RampShape) {
+    return nullptr;
+}
+
+SilenceCheckFn getSilenceCheckSSE2() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,214 @@
+#pragma once
+
+#include "asio_types.h"
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+
+// Per-format sample traits. Each specialization knows how to load one
+// sample as a normalized float and store a clamped float back. These are
+// the scalar reference that the block converters in sample_convert.h match.
+
+// Largest float below 2^31, so full-scale positive does not wrap to INT32_MIN
+static const float kInt32MaxFloat = 2147483520.0f;
+
+// Byte-order helpers for the MSB formats
+inline uint16_t swapBytes16(uint16_t v) {
+    return (uint16_t)((v << 8) | (v >> 8));
+}
+
+inline uint32_t swapBytes32(uint32_t v) {
+    return (v << 24) | ((v << 8) & 0x00FF0000u) | ((v >> 8) & 0x0000FF00u) | (v >> 24);
+}
+
+inline uint64_t swapBytes64(uint64_t v) {
+    return ((uint64_t)swapBytes32((uint32_t)v) << 32) | swapBytes32((uint32_t)(v >> 32));
+}
+
+template <ASIOSampleType Type>
+struct SampleTraits;
+
+template <>
+struct SampleTraits<ASIOSTInt16LSB> {
+    static const int bytes = 2;
+
+    static float load(const void* buffer, int i) {
+        return ((const int16_t*)buffer)[i] / 32768.0f;
+    }
+    static void store(float value, void* buffer, int i) {
+        ((int16_t*)buffer)[i] = (int16_t)(value * 32767.0f);
+    }
+};
+
+template <>
+struct SampleTraits<ASIOSTInt24LSB> {
+    static const int bytes = 3;
+
+    static float load(const void* buffer, int i) {
+        const uint8_t* p = (const uint8_t*)buffer + i * 3;
+        int32_t val = (p[0]) | (p[1] << 8) | (p[2] << 16);
+        if (val & 0x800000) val |= 0xFF000000;  // Sign extend
+        return val / 8388608.0f;
+    }
+    static void store(float value, void* buffer, int i) {
+        int32_t val = (int32_t)(value * 8388607.0f);
+        uint8_t* p = (uint8_t*)buffer + i * 3;
+        p[0] = val & 0xFF;
+        p[1] = (val >> 8) & 0xFF;
+        p[2] = (val >> 16) & 0xFF;
+    }
+};
+
+template <>
+struct SampleTraits<ASIOSTInt32LSB> {
+    static const int bytes = 4;
+
+    static float load(const void* buffer, int i) {
+        return ((const int32_t*)buffer)[i] / 2147483648.0f;
+    }
+    static void store(float value, void* buffer, int i) {
+        ((int32_t*)buffer)[i] = (int32_t)std::min(value * 2147483648.0f, kInt32MaxFloat);
+    }
+};
+
+template <>
+struct SampleTraits<ASIOSTFloat32LSB> {
+    static const int bytes = 4;
+
+    static float load(const void* buffer, int i) {
+        return ((const float*)buffer)[i];
+    }
+    static void store(float value, void* buffer, int i) {
+        ((float*)buffer)[i] = value;
+    }
+};
+
+template <>
+struct SampleTraits<ASIOSTFloat64LSB> {
+    static const int bytes = 8;
+
+    static float load(const void* buffer, int i) {
+        return (float)((const double*)buffer)[i];
+    }
+    static void store(float value, void* buffer, int i) {
+        ((double*)buffer)[i] = value;
+    }
+};
+
+template <>
+struct SampleTraits<ASIOSTInt16MSB> {
+    static const int bytes = 2;
+
+    static float load(const void* buffer, int i) {
+        uint16_t raw;
+        memcpy(&raw, (const uint8_t*)buffer + i * 2, 2);
+        return (int16_t)swapBytes16(raw) / 32768.0f;
+    }
+    static void store(float value, void* buffer, int i) {
+        uint16_t raw = swapBytes16((uint16_t)(int16_t)(value * 32767.0f));
+        memcpy((uint8_t*)buffer + i * 2, &raw, 2);
+    }
+};
+
+template <>
+struct SampleTraits<ASIOSTInt24MSB> {
+    static const int bytes = 3;
+
+    static float load(const void* buffer, int i) {
+        const uint8_t* p = (const uint8_t*)buffer + i * 3;
+        int32_t val = (p[0] << 16) | (p[1] << 8) | (p[2]);
+        if (val & 0x800000) val |= 0xFF000000;  // Sign extend
+        return val / 8388608.0f;
+    }
+    static void store(float value, void* buffer, int i) {
+        int32_t val = (int32_t)(value * 8388607.0f);
+        uint8_t* p = (uint8_t*)buffer + i * 3;
+        p[0] = (val >> 16) & 0xFF;
+        p[1] = (val >> 8) & 0xFF;
+        p[2] = val & 0xFF;
+    }
+};
+
+template <>
+struct SampleTraits<ASIOSTFloat32MSB> {
+    static const int bytes = 4;
+
+    static float load(const void* buffer, int i) {
+        uint32_t raw;
+        memcpy(&raw, (const uint8_t*)buffer + i * 4, 4);
+        raw = swapBytes32(raw);
+        float value;
+        memcpy(&value, &raw, 4);
+        return value;
+    }
+    static void store(float value, void* buffer, int i) {
+        uint32_t raw;
+        memcpy(&raw, &value, 4);
+        raw = swapBytes32(raw);
+        memcpy((uint8_t*)buffer + i * 4, &raw, 4);
+    }
+};
+
+template <>
+struct SampleTraits<ASIOSTFloat64MSB> {
+    static const int bytes = 8;
+
+    static float load(const void* buffer, int i) {
+        uint64_t raw;
+        memcpy(&raw, (const uint8_t*)buffer + i * 8, 8);
+        raw = swapBytes64(raw);
+        double value;
+        memcpy(&value, &raw, 8);
+        return (float)value;
+    }
+    static void store(float value, void* buffer, int i) {
+        double wide = value;
+        uint64_t raw;
+        memcpy(&raw, &wide, 8);
+        raw = swapBytes64(raw);
+        memcpy((uint8_t*)buffer + i * 8, &raw, 8);
+    }
+};
+
+// 32-bit containers holding DataBits of signed data in the low bits
+// (ASIO's "32 bit data with N bit alignment"). Int32MSB is the 32-bit case.
+template <int DataBits, bool BigEndian>
+struct Int32ContainerTraits {
+    static const int bytes = 4;
+    static const int shift = 32 - DataBits;
+
+    static float load(const void* buffer, int i) {
+        uint32_t raw;
+        memcpy(&raw, (const uint8_t*)buffer + i * 4, 4);
+        if (BigEndian) raw = swapBytes32(raw);
+        // Sign extend from DataBits, ignoring whatever the driver left above
+        int32_t val = (int32_t)(raw << shift) >> shift;
+        return val / (float)(1u << (DataBits - 1));
+    }
+    static void store(float value, void* buffer, int i) {
+        int32_t val;
+        if (DataBits == 32) {
+            val = (int32_t)std::min(value * 2147483648.0f, kInt32MaxFloat);
+        } else {
+            val = (int32_t)(value * (float)((1 << (DataBits - 1)) - 1));
+        }
+        uint32_t raw = (uint32_t)val;
+        if (BigEndian) raw = swapBytes32(raw);
+        memcpy((uint8_t*)buffer + i * 4, &raw, 4);
+    }
+};
+
+template <> struct SampleTraits<ASIOSTInt32MSB> : Int32ContainerTraits<32, true> {};
+template <> struct SampleTraits<ASIOSTInt32MSB16> : Int32ContainerTraits<16, true> {};
+template <> struct SampleTraits<ASIOSTInt32MSB18> : Int32ContainerTraits<18, true> {};
+template <> struct SampleTraits<ASIOSTInt32MSB20> : Int32ContainerTraits<20, true> {};
+template <> struct SampleTraits<ASIOSTInt32MSB24> : Int32ContainerTraits<24, true> {};
+template <> struct SampleTraits<ASIOSTInt32LSB16> : Int32ContainerTraits<16, false> {};
+template <> struct SampleTraits<ASIOSTInt32LSB18> : Int32ContainerTraits<18, false> {};
+template <> struct SampleTraits<ASIOSTInt32LSB20> : Int32ContainerTraits<20, false> {};
+template <> struct SampleTraits<ASIOSTInt32LSB24> : Int32ContainerTraits<24, false> {};
+
+// Clamp a float sample to the valid [-1, 1] range
+inline float clampSample(float value) {
+    return std::max(-1.0f, std::min(1.0f, value));
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// Shared by the translation units that carry SSE2/AVX2 kernels next to
+// their scalar versions (sample conversion, resampling). The level to run
+// is picked at run time; see detectSimdLevel().
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ASIO_HOST_X86 1
+#else
+#define ASIO_HOST_X86 0
+#endif
+
+// Function-level target attributes keep the wider instruction sets out of
+// shared inline code (the traits, std::min) that the linker may merge.
+#if defined(__GNUC__) || defined(__clang__)
+#define ASIO_TARGET_SSE2 __attribute__((target("sse2")))
+#define ASIO_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ASIO_TARGET_SSE2
+#define ASIO_TARGET_AVX2
+#endif
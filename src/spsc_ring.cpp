@@ -0,0 +1,121 @@
+#include "spsc_ring.h"
+#include <cstring>
+
+static uint32_t roundUpPowerOfTwo(int frames) {
+    uint32_t size = 1;
+    while (size < (uint32_t)frames) {
+        size <<= 1;
+    }
+    return size;
+}
+
+size_t SpscRing::arenaBytes(int channels, int capacityFrames) {
+    // The float widths take one more piece
+    return StreamArena::bytesFor<int>(channels) * 2 + StreamArena::bytesFor<uint8_t*>(channels) +
+           StreamArena::bytesFor<float>(roundUpPowerOfTwo(capacityFrames)) * channels;
+}
+
+size_t SpscRing::arenaBytes(const int* sampleBytes, int channels, int capacityFrames) {
+    size_t bytes = StreamArena::bytesFor<int>(channels) + StreamArena::bytesFor<uint8_t*>(channels);
+    for (int ch = 0; ch < channels; ch++) {
+        bytes += StreamArena::bytesFor<uint8_t>((size_t)roundUpPowerOfTwo(capacityFrames) * sampleBytes[ch]);
+    }
+    return bytes;
+}
+
+bool SpscRing::configure(int numChannels, int capacityFrames, StreamArena* arena) {
+    int* sampleBytes = arena->take<int>(numChannels);
+    if (!sampleBytes) {
+        return false;
+    }
+    for (int ch = 0; ch < numChannels; ch++) {
+        sampleBytes[ch] = sizeof(float);
+    }
+    return configure(sampleBytes, numChannels, capacityFrames, arena);
+}
+
+bool SpscRing::configure(const int* sampleBytes, int numChannels, int capacityFrames, StreamArena* arena) {
+    uint32_t capacity = roundUpPowerOfTwo(capacityFrames);
+    int* sizes = arena->take<int>(numChannels);
+    data = arena->take<uint8_t*>(numChannels);
+    if (!sizes || !data) {
+        return false;
+    }
+    for (int ch = 0; ch < numChannels; ch++) {
+        sizes[ch] = sampleBytes[ch];
+        if (!(data[ch] = arena->take<uint8_t>((size_t)capacity * sizes[ch]))) {
+            return false;
+        }
+    }
+    widths = sizes;
+    channels = numChannels;
+    mask = capacity - 1;
+    clear();
+    return true;
+}
+
+void SpscRing::clear() {
+    writeIndex.store(0, std::memory_order_relaxed);
+    readIndex.store(0, std::memory_order_relaxed);
+    producerReadCopy = 0;
+    consumerWriteCopy = 0;
+}
+
+int SpscRing::getSpace() {
+    producerReadCopy = readIndex.load(std::memory_order_acquire);
+    return (int)((uint64_t)mask + 1 - (writeIndex.load(std::memory_order_relaxed) - producerReadCopy));
+}
+
+bool SpscRing::write(const void* const* input, int frames) {
+    if (frames <= 0) {
+        return frames == 0;
+    }
+    uint64_t write = writeIndex.load(std::memory_order_relaxed);
+    if (mask + 1 - (write - producerReadCopy) < (uint64_t)frames && getSpace() < frames) {
+        return false;
+    }
+    uint32_t start = (uint32_t)write & mask;
+    int first = (int)(mask + 1 - start) < frames ? (int)(mask + 1 - start) : frames;
+    for (int ch = 0; ch < channels; ch++) {
+        size_t width = widths[ch];
+        memcpy(data[ch] + start * width, input[ch], first * width);
+        memcpy(data[ch], (const uint8_t*)input[ch] + first * width, (frames - first) * width);
+    }
+    // The samples are visible before the index that covers them
+    writeIndex.store(write + frames, std::memory_order_release);
+    return true;
+}
+
+int SpscRing::getAvailable() {
+    uint64_t read = readIndex.load(std::memory_order_relaxed);
+    consumerWriteCopy = writeIndex.load(std::memory_order_acquire);
+    return (int)(consumerWriteCopy - read);
+}
+
+bool SpscRing::read(void* const* output, int frames) {
+    if (frames <= 0) {
+        return frames == 0;
+    }
+    uint64_t read = readIndex.load(std::memory_order_relaxed);
+    if (consumerWriteCopy - read < (uint64_t)frames && getAvailable() < frames) {
+        return false;
+    }
+    uint32_t start = (uint32_t)read & mask;
+    int first = (int)(mask + 1 - start) < frames ? (int)(mask + 1 - start) : frames;
+    for (int ch = 0; ch < channels; ch++) {
+        size_t width = widths[ch];
+        memcpy(output[ch], data[ch] + start * width, first * width);
+        memcpy((uint8_t*)output[ch] + first * width, data[ch], (frames - first) * width);
+    }
+    // Done with the samples before the producer may overwrite them
+    readIndex.store(read + frames, std::memory_order_release);
+    return true;
+}
+
+void SpscRing::skip(int frames) {
+    int available = getAvailable();
+    if (frames > available) frames = available;
+    if (frames > 0) {
+        readIndex.store(readIndex.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+    }
+}
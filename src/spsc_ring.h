@@ -0,0 +1,57 @@
+#pragma once
+
+#include "stream_arena.h"
+#include <atomic>
+#include <cstdint>
+
+// Lock-free ring of planar audio between exactly one producer thread and
+// one consumer thread, e.g. two drivers' callbacks. It carries float by
+// default, or raw samples of any width per channel (driver buffers as they
+// are). Capacity is a power of two; the indices count frames forever and
+// are masked on access. Each side owns one index and keeps a private copy
+// of the other's, reloading it only when that copy says the ring is too
+// full or too empty, so in steady state the two sides rarely touch the
+// same cache line.
+//
+// configure() and clear() are for the control thread while neither side
+// runs. Memory comes from the caller's arena.
+class SpscRing {
+public:
+    // Arena space for configure() with these arguments
+    static size_t arenaBytes(int channels, int capacityFrames);
+    static size_t arenaBytes(const int* sampleBytes, int channels, int capacityFrames);
+
+    // Capacity is rounded up to a power of two. The first form carries
+    // float; the second sampleBytes[ch] bytes per frame of channel ch.
+    bool configure(int channels, int capacityFrames, StreamArena* arena);
+    bool configure(const int* sampleBytes, int channels, int capacityFrames, StreamArena* arena);
+    void clear();
+
+    int getChannels() const { return channels; }
+    int getCapacity() const { return (int)(mask + 1); }
+
+    // Producer side. write() stores all frames or none.
+    int getSpace();
+    bool write(const void* const* input, int frames);
+    bool write(const float* const* input, int frames) { return write((const void* const*)input, frames); }
+    uint64_t getWritten() const { return writeIndex.load(std::memory_order_relaxed); }
+
+    // Consumer side. read() takes all frames or none; skip() drops them.
+    int getAvailable();
+    bool read(void* const* output, int frames);
+    bool read(float* const* output, int frames) { return read((void* const*)output, frames); }
+    void skip(int frames);
+    uint64_t getRead() const { return readIndex.load(std::memory_order_relaxed); }
+
+private:
+    uint8_t** data = nullptr;       // One capacity-sized buffer per channel
+    const int* widths = nullptr;    // Bytes per frame of each channel
+    int channels = 0;
+    uint32_t mask = 0;
+
+    alignas(StreamArena::kCacheLine) std::atomic<uint64_t> writeIndex{0};
+    uint64_t producerReadCopy = 0;      // Producer's view of readIndex
+
+    alignas(StreamArena::kCacheLine) std::atomic<uint64_t> readIndex{0};
+    uint64_t consumerWriteCopy = 0;     // Consumer's view of writeIndex
+};
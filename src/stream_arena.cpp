@@ -0,0 +1,90 @@
+#include "stream_arena.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static size_t pageSize() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t)page : 4096;
+#endif
+}
+
+StreamArena::~StreamArena() {
+    release();
+}
+
+bool StreamArena::allocate(size_t bytes) {
+    release();
+    size_t page = pageSize();
+    size_t total = (bytes + page - 1) / page * page;
+    if (total == 0) {
+        total = page;
+    }
+
+#ifdef _WIN32
+    void* memory = VirtualAlloc(nullptr, total, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!memory) {
+        return false;
+    }
+#else
+    void* memory = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+#endif
+    base = (uint8_t*)memory;
+    size = total;
+    used = 0;
+
+    // Prefault: fresh pages read as zero but are only mapped on first write
+    for (size_t offset = 0; offset < total; offset += page) {
+        ((volatile uint8_t*)base)[offset] = 0;
+    }
+
+#ifdef _WIN32
+    locked = VirtualLock(base, total) != 0;
+    if (!locked) {
+        // The minimum working set caps what can be locked; grow it once
+        SIZE_T minimum = 0, maximum = 0;
+        HANDLE process = GetCurrentProcess();
+        if (GetProcessWorkingSetSize(process, &minimum, &maximum)) {
+            minimum += total;
+            if (maximum < minimum) maximum = minimum;
+        }
+        if (minimum > total && SetProcessWorkingSetSize(process, minimum, maximum)) {
+            locked = VirtualLock(base, total) != 0;
+        }
+    }
+#else
+    locked = mlock(base, total) == 0;
+#endif
+    return true;
+}
+
+void StreamArena::release() {
+    if (!base) {
+        return;
+    }
+#ifdef _WIN32
+    if (locked) VirtualUnlock(base, size);
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    if (locked) munlock(base, size);
+    munmap(base, size);
+#endif
+    base = nullptr;
+    size = 0;
+    used = 0;
+    locked = false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// One block of memory for everything the audio callback touches while
+// streaming. It is allocated once per stream (createBuffers), straight
+// from the OS in whole pages, prefaulted, and locked into RAM where the
+// process is allowed to (VirtualLock / mlock), so the callback can never
+// take a page fault or reach the heap. Pieces are handed out in order,
+// each starting on its own cache line, and come back zeroed.
+//
+// Size the arena with bytesFor() for every piece, allocate() it, then
+// take() the pieces in any order. Control thread only; the pieces
+// themselves belong to whoever took them.
+class StreamArena {
+public:
+    static const size_t kCacheLine = 64;
+
+    StreamArena() = default;
+    ~StreamArena();
+    StreamArena(const StreamArena&) = delete;
+    StreamArena& operator=(const StreamArena&) = delete;
+
+    // Space one piece of count Ts occupies, padding included
+    template <typename T>
+    static size_t bytesFor(size_t count) {
+        return (count * sizeof(T) + kCacheLine - 1) & ~(kCacheLine - 1);
+    }
+
+    // Replace the arena with a new one of at least this many bytes.
+    // False if the memory could not be allocated; failing to lock it is
+    // not an error (see isLocked()).
+    bool allocate(size_t bytes);
+    void release();
+
+    // Next piece of count Ts, or nullptr if the arena is too small
+    template <typename T>
+    T* take(size_t count) {
+        size_t bytes = bytesFor<T>(count);
+        if (!base || used + bytes > size) {
+            return nullptr;
+        }
+        T* piece = (T*)(base + used);
+        used += bytes;
+        return piece;
+    }
+
+    size_t getSize() const { return size; }
+    size_t getUsed() const { return used; }
+    bool isLocked() const { return locked; }
+
+private:
+    uint8_t* base = nullptr;
+    size_t size = 0;
+    size_t used = 0;
+    bool locked = false;
+};
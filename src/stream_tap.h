@@ -0,0 +1,39 @@
+#pragma once
+
+#include "asio_types.h"
+#include <cstdint>
+#include <vector>
+
+// A host stream's shape, as set up by createBuffers
+struct StreamFormat {
+    int numInputs = 0;
+    int numOutputs = 0;
+    std::vector<ASIOSampleType> inputTypes;
+    std::vector<ASIOSampleType> outputTypes;
+    int bufferSize = 0;
+    double sampleRate = 0.0;
+};
+
+// One block as the host's callback sees it
+struct StreamBlock {
+    void* const* inputs;        // Driver buffers per input channel, in inputTypes
+    void* const* outputs;       // Driver buffers per output channel, mixed once process() runs
+    int frames;
+    int64_t systemTimeNs;       // From the driver's time info, 0 if it passes none
+    int64_t callbackNs;         // CallbackStats::now() as the callback began
+};
+
+// Work that rides on a host's audio callback: bridges to other drivers,
+// recorders, network streams. prepare() runs on the control thread each
+// time the host creates its buffers, with the stream stopped; process()
+// runs on the driver's thread after every mix and must not block or
+// allocate. feed() runs on the same thread before the mix, under the same
+// rules; a tap that supplies audio may overwrite input buffers there, and
+// the mix then routes what it wrote.
+class StreamTap {
+public:
+    virtual ~StreamTap() = default;
+    virtual void prepare(const StreamFormat& format) = 0;
+    virtual void feed(const StreamBlock& block) { (void)block; }
+    virtual void process(const StreamBlock& block) = 0;
+};
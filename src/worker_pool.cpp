@@ -0,0 +1,175 @@
+#include "worker_pool.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define CPU_PAUSE() _mm_pause()
+#else
+#define CPU_PAUSE() std::this_thread::yield()
+#endif
+
+// Spin this many pauses (a few microseconds) before sleeping. Long enough
+// to catch a block that follows right away, short enough not to burn a
+// core through the whole buffer period.
+static const int kSpinCount = 2000;
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit value");
+
+// Sleep while word still holds expected; may return spuriously
+static void waitOnValue(std::atomic<uint32_t>& word, uint32_t expected) {
+#ifdef _WIN32
+    WaitOnAddress(&word, &expected, sizeof(expected), INFINITE);
+#elif defined(__linux__)
+    syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    (void)word;
+    (void)expected;
+    std::this_thread::yield();
+#endif
+}
+
+static void wakeAll(std::atomic<uint32_t>& word) {
+#ifdef _WIN32
+    WakeByAddressAll(&word);
+#elif defined(__linux__)
+    syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAKE_PRIVATE, 0x7fffffff, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+static void pinToCore(std::thread& thread, int core) {
+#ifdef _WIN32
+    SetThreadAffinityMask((HANDLE)thread.native_handle(), (DWORD_PTR)1 << (core % 64));
+    // Match the priority ASIO drivers give their callback thread
+    SetThreadPriority((HANDLE)thread.native_handle(), THREAD_PRIORITY_TIME_CRITICAL);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+int WorkerPool::getCoreCount() {
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 0 ? (int)cores : 1;
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start(int workers) {
+    stop();
+    if (workers <= 0) {
+        return;
+    }
+    int cores = getCoreCount();
+    quit = false;
+    pending.store(0, std::memory_order_relaxed);
+    // Workers start from the current generation, so a run() that comes
+    // before a new thread gets going is not missed
+    uint32_t first = generation.load(std::memory_order_relaxed);
+    for (int i = 0; i < workers; i++) {
+        threads.emplace_back(&WorkerPool::workerLoop, this, i, first);
+        pinToCore(threads.back(), (i + 1) % cores);
+    }
+}
+
+void WorkerPool::stop() {
+    if (threads.empty()) {
+        return;
+    }
+    quit = true;
+    generation.fetch_add(1, std::memory_order_seq_cst);
+    wakeAll(generation);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+}
+
+void WorkerPool::run(JobFn fn, void* context, int parts) {
+    if (parts <= 1 || threads.empty()) {
+        for (int part = 0; part < parts; part++) {
+            fn(context, part);
+        }
+        return;
+    }
+
+    // Publish the job, then wake any worker that has gone to sleep. Every
+    // worker checks in, including those without a part, so none can still
+    // be reading the job when the next run() rewrites it.
+    job = fn;
+    jobContext = context;
+    jobParts = parts;
+    pending.store((uint32_t)threads.size(), std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_seq_cst) > 0) {
+        wakeAll(generation);
+    }
+
+    fn(context, 0);
+    for (int part = (int)threads.size() + 1; part < parts; part++) {
+        fn(context, part);
+    }
+
+    for (int spin = 0; spin < kSpinCount; spin++) {
+        if (pending.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        CPU_PAUSE();
+    }
+    callerWaiting.store(1, std::memory_order_seq_cst);
+    for (;;) {
+        uint32_t left = pending.load(std::memory_order_seq_cst);
+        if (left == 0) break;
+        waitOnValue(pending, left);
+    }
+    callerWaiting.store(0, std::memory_order_relaxed);
+}
+
+void WorkerPool::workerLoop(int index, uint32_t seen) {
+    for (;;) {
+        uint32_t current = seen;
+        for (int spin = 0; spin < kSpinCount && current == seen; spin++) {
+            CPU_PAUSE();
+            current = generation.load(std::memory_order_acquire);
+        }
+        while (current == seen) {
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            if (generation.load(std::memory_order_seq_cst) == seen) {
+                waitOnValue(generation, seen);
+            }
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            current = generation.load(std::memory_order_acquire);
+        }
+        seen = current;
+
+        if (quit) {
+            return;
+        }
+        if (index + 1 < jobParts) {
+            job(jobContext, index + 1);
+        }
+        if (pending.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+            callerWaiting.load(std::memory_order_seq_cst)) {
+            wakeAll(pending);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Pre-spawned threads that help the audio callback with one job per block.
+// run() hands the job to the workers through a generation counter and
+// runs part 0 itself, then waits for the rest. Both sides spin briefly and
+// then sleep on a futex (WaitOnAddress on Windows), so a worker that is
+// awake between blocks starts at once and an idle pool costs no CPU.
+// Workers are pinned one per core, starting after core 0.
+//
+// start() and stop() belong to the control thread; run() to one real-time
+// thread. run() takes no locks and never allocates.
+class WorkerPool {
+public:
+    typedef void (*JobFn)(void* context, int part);
+
+    WorkerPool() = default;
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Replace the pool with this many workers (0 = none). Not real-time
+    // safe; run() must not be in progress.
+    void start(int workers);
+    void stop();
+
+    int getWorkerCount() const { return (int)threads.size(); }
+
+    // Call job(context, part) for every part in [0, parts): part 0 on the
+    // calling thread, part n on worker n - 1 (the caller also takes any
+    // part beyond the last worker). Returns once all are done.
+    void run(JobFn job, void* context, int parts);
+
+    // Cores available to the process
+    static int getCoreCount();
+
+private:
+    void workerLoop(int index, uint32_t seen);
+
+    std::vector<std::thread> threads;
+
+    // Job for the current generation; written by run() before the bump.
+    // Block hand-off state starts a cache line away from the thread list.
+    alignas(64) JobFn job = nullptr;
+    void* jobContext = nullptr;
+    int jobParts = 0;
+    bool quit = false;
+
+    std::atomic<uint32_t> generation{0};    // Bumped once per run()
+    std::atomic<uint32_t> sleepers{0};      // Workers waiting on generation
+    std::atomic<uint32_t> pending{0};       // Workers yet to finish this run
+    std::atomic<uint32_t> callerWaiting{0}; // run() is waiting on pending
+};